@@ -37,7 +37,8 @@ std::future<FileAndData> ReadFile(const FileLoadSystem::path &p,
                                   std::unique_ptr<char[]> ptr);
 
 /*
-  Reads a File Completely using a thread. Allocates memory to load it
+  Reads a File Completely using a thread. Allocates memory to load it, with a
+  null terminator after the data
 */
 std::future<FileAndData> ReadFileWithAlloc(const FileLoadSystem::path &p);
 
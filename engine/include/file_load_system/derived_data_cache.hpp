@@ -0,0 +1,149 @@
+#pragma once
+#ifndef DERIVED_DATA_CACHE_HPP
+#define DERIVED_DATA_CACHE_HPP 1
+
+#include "file_load_system/file_load_system.hpp"
+#include "utils/hash.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* File Load and Writing System */
+namespace FileLoadSystem {
+
+/*
+  Identifies a derived output: which source it comes from and which transform
+  (and version of it) produced it. Bump the version when a transform changes
+*/
+struct DerivedDataKey {
+  /* Hash of the source content */
+  Hash::hash_t m_source = 0;
+  /* Hash of the transform name */
+  Hash::hash_t m_transform = 0;
+  /* Version of the transform */
+  std::uint32_t m_version = 0;
+};
+
+/* Create a Key from the source content and a transform name and version */
+inline DerivedDataKey MakeDerivedDataKey(const char *source, size_t size,
+                                         const char *transform,
+                                         std::uint32_t version) {
+  return {Hash::Fnv1a(source, size), Hash::Fnv1a(transform), version};
+}
+
+/* Usage Statistics of a Derived Data Cache */
+struct DerivedDataStats {
+  std::uint64_t m_hits = 0;
+  std::uint64_t m_misses = 0;
+  std::uint64_t m_inserts = 0;
+  std::uint64_t m_evictions = 0;
+  /* Bytes currently used on disk */
+  file_size_t m_size = 0;
+
+  /* Hits over lookups, 0 if there were no lookups */
+  inline double HitRate() const {
+    const std::uint64_t lookups = m_hits + m_misses;
+    return lookups == 0 ? 0.0
+                        : static_cast<double>(m_hits) /
+                              static_cast<double>(lookups);
+  }
+};
+
+/*
+  On Disk Cache of Derived Data (i.e. JSON to binary conversions) that survives
+  between runs. Inserts are atomic (written to a temporary file and renamed),
+  the least recently used outputs are evicted when the cache grows past its
+  maximum size. This class is not thread safe, like the rest of the system
+*/
+class DerivedDataCache {
+public:
+  /* Default Maximum Size in bytes */
+  static constexpr file_size_t kDefaultMaxSize = 512ull * 1024ull * 1024ull;
+
+  DerivedDataCache() = default;
+  ~DerivedDataCache() = default;
+
+  /* Move Semantics */
+  DerivedDataCache(DerivedDataCache &&) = default;
+  DerivedDataCache &operator=(DerivedDataCache &&) = default;
+
+  /* Copy is not allowed because it doesn't make sense */
+  DerivedDataCache(const DerivedDataCache &) = delete;
+  DerivedDataCache &operator=(const DerivedDataCache &) = delete;
+
+  /*
+    Open (creating it if needed) the cache at a directory. Must be called
+    before any other operation
+  */
+  error_status Open(const path &directory,
+                    file_size_t max_size = kDefaultMaxSize);
+
+  /*
+    Open the cache under the Temp Directory. SetupFileLoadSystem must have been
+    called before
+  */
+  error_status Open(file_size_t max_size = kDefaultMaxSize);
+
+  /* Get a cached output. Returns false on a miss */
+  bool Get(const DerivedDataKey &key, std::vector<char> &result);
+
+  /* Store an output, evicting old ones if needed */
+  bool Put(const DerivedDataKey &key, const char *data, size_t size);
+
+  /*
+    Get a cached output or build it with build and store it. Returns false only
+    if build fails
+  */
+  bool GetOrBuild(const DerivedDataKey &key, std::vector<char> &result,
+                  const std::function<bool(std::vector<char> &)> &build);
+
+  /* Remove every cached output */
+  error_status Purge();
+
+  /* Usage Statistics */
+  inline const DerivedDataStats &GetStats() const { return m_stats; }
+
+  /* Human readable report of the usage statistics */
+  std::string GetReport() const;
+
+  /* Where the cache lives */
+  inline const path &GetDirectory() const { return m_directory; }
+
+private:
+  /* What we know of an output on disk */
+  struct Record {
+    file_size_t m_size = 0;
+    std::uint64_t m_lastUse = 0;
+  };
+
+  /* File Name of a Key */
+  static std::string GetFileName(const DerivedDataKey &key);
+
+  /* Remove the least recently used outputs until size fits */
+  void Evict(file_size_t max_size);
+
+  /* Forget and delete an output */
+  void Drop(const std::string &name);
+
+  /* Where the cache lives */
+  path m_directory;
+
+  /* Maximum size in bytes */
+  file_size_t m_maxSize = kDefaultMaxSize;
+
+  /* Outputs on disk by File Name */
+  std::unordered_map<std::string, Record> m_records;
+
+  /* Use counter used for least recently used order */
+  std::uint64_t m_useCounter = 0;
+
+  /* Usage Statistics */
+  DerivedDataStats m_stats;
+};
+
+} // namespace FileLoadSystem
+
+#endif // !DERIVED_DATA_CACHE_HPP
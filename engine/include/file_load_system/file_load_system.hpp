@@ -96,6 +96,12 @@ inline void Rename(const path &from, const path &to, error_status &error) {
   return std::filesystem::rename(from, to, error);
 }
 
+/*
+  Unique path next to p, ending in .tmp, to write a file that is renamed to p
+  once it is complete. Writers of other threads and runs never get the same
+*/
+path GetTemporaryPath(const path &p);
+
 /* ftell for Large Files */
 inline file_size_t FTell(std::FILE *f) {
 
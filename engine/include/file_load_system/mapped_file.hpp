@@ -0,0 +1,62 @@
+#pragma once
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP 1
+
+#include "file_load_system/file_load_system.hpp"
+
+#include <cstddef>
+
+/* File Load and Writing System */
+namespace FileLoadSystem {
+
+/*
+  RAII Class for a File mapped read only into memory. Opening is O(1): pages
+  are only read from disk when they are touched
+*/
+class MappedFile {
+public:
+  MappedFile() = default;
+  inline MappedFile(MappedFile &&other) noexcept
+      : m_data(other.m_data), m_size(other.m_size) {
+    other.m_data = nullptr;
+    other.m_size = 0;
+  }
+  /* Copy is not allowed because it doesn't make sense */
+  MappedFile(const MappedFile &) = delete;
+  inline MappedFile &operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+      Close();
+      m_data = other.m_data;
+      m_size = other.m_size;
+      other.m_data = nullptr;
+      other.m_size = 0;
+    }
+    return *this;
+  }
+  /* Copy is not allowed because it doesn't make sense */
+  MappedFile &operator=(const MappedFile &) = delete;
+  inline ~MappedFile() { Close(); }
+
+  /* Map a whole File, closing the one mapped before. Empty Files fail */
+  bool Open(const path &p);
+
+  /* Unmap the File */
+  void Close();
+
+  /* Start of the File. Aligned to a page */
+  inline const char *Data() const { return m_data; }
+
+  /* Size of the File in bytes */
+  inline size_t Size() const { return m_size; }
+
+  /* If a File is mapped */
+  inline bool IsValid() const { return m_data != nullptr; }
+
+private:
+  const char *m_data = nullptr;
+  size_t m_size = 0;
+};
+
+} // namespace FileLoadSystem
+
+#endif // !MAPPED_FILE_HPP
@@ -0,0 +1,103 @@
+#pragma once
+#ifndef PACK_BUILDER_HPP
+#define PACK_BUILDER_HPP 1
+
+#include "file_load_system/file_load_system.hpp"
+#include "utils/hash.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* File Load and Writing System */
+namespace FileLoadSystem {
+
+/*
+  Pack Archive Layout (little endian):
+    Header: magic, format version, entry count, table offset
+    Data: every entry, in table order, aligned to kPackAlignment
+    Table: for every entry offset, size, stored size, hash, method and name
+*/
+
+/* Pack Archive Magic Number */
+constexpr char kPackMagic[4] = {'K', 'C', 'H', 'P'};
+
+/* Pack Archive Format Version */
+constexpr std::uint32_t kPackVersion = 2;
+
+/* Alignment of every entry data inside a Pack Archive */
+constexpr file_size_t kPackAlignment = 16;
+
+/* How an entry is stored inside a Pack Archive */
+enum class PackMethod : std::uint8_t {
+  /* Bytes as they are */
+  kStored = 0,
+  /* LZ4 block (see utils/lz4.hpp) */
+  kLz4 = 1,
+};
+
+/* A File inside a Pack Archive */
+struct PackEntry {
+  /* Name inside the pack. Generic (/) UTF8 path relative to the content */
+  std::string m_name;
+  /* Where the file comes from */
+  path m_source;
+  /* Offset of the data from the start of the pack */
+  file_size_t m_offset = 0;
+  /* Size of the original file */
+  file_size_t m_size = 0;
+  /* Size of the data inside the pack */
+  file_size_t m_storedSize = 0;
+  /* Hash of the original file */
+  Hash::hash_t m_hash = 0;
+  /* How the data is stored */
+  PackMethod m_method = PackMethod::kStored;
+};
+
+/* Pack Building Options */
+struct PackBuildOptions {
+  /* Amount of worker threads. 0 uses every core */
+  unsigned m_workers = 0;
+  /* Compress the entries that get smaller, the rest are stored */
+  bool m_compress = true;
+  /*
+    Optional text file with one entry name per line. Entries listed there are
+    placed first and in that order, the rest follow sorted by name
+  */
+  path m_accessOrder;
+};
+
+/*
+  Gather every file inside a content directory recursively (like
+  CopyRecursive), sorted by name
+*/
+error_status GatherPackEntries(const path &content,
+                               std::vector<PackEntry> &entries);
+
+/* Reorder entries using an access order list (see PackBuildOptions) */
+error_status OrderPackEntries(const path &access_order,
+                              std::vector<PackEntry> &entries);
+
+/*
+  Build a Pack Archive from a content directory. Reading, hashing and
+  compressing is done in parallel, writing keeps the entries order. The pack
+  is written to a temporary file and renamed when completed, a failed build
+  leaves nothing behind
+*/
+error_status BuildPack(const path &content, const path &pack,
+                       const PackBuildOptions &options,
+                       std::vector<PackEntry> *result = nullptr);
+
+/* Read the table of a Pack Archive. Sources are left empty */
+error_status ReadPackTable(const path &pack, std::vector<PackEntry> &entries);
+
+/*
+  Read an entry of a Pack Archive, decompressed, into data. Fails if the hash
+  doesn't match
+*/
+error_status ReadPackEntry(const path &pack, const PackEntry &entry,
+                           std::vector<char> &data);
+
+} // namespace FileLoadSystem
+
+#endif // !PACK_BUILDER_HPP
@@ -0,0 +1,42 @@
+#pragma once
+#ifndef CPU_FEATURES_HPP
+#define CPU_FEATURES_HPP 1
+
+/* Os Detection Constants */
+namespace OsDetection {
+
+/* SIMD instruction sets, from worst to best for each architecture */
+enum class SimdLevel : unsigned char { kNone, kSse2, kSse42, kNeon };
+
+#if defined(KCH_JSON_SIMD_SSE42)
+/* SIMD the JSON parser was built with (see RAPIDJSON_SIMD in CMake) */
+constexpr SimdLevel kJsonSimdLevel = SimdLevel::kSse42;
+#elif defined(KCH_JSON_SIMD_SSE2)
+/* SIMD the JSON parser was built with (see RAPIDJSON_SIMD in CMake) */
+constexpr SimdLevel kJsonSimdLevel = SimdLevel::kSse2;
+#elif defined(KCH_JSON_SIMD_NEON)
+/* SIMD the JSON parser was built with (see RAPIDJSON_SIMD in CMake) */
+constexpr SimdLevel kJsonSimdLevel = SimdLevel::kNeon;
+#else
+/* SIMD the JSON parser was built with (see RAPIDJSON_SIMD in CMake) */
+constexpr SimdLevel kJsonSimdLevel = SimdLevel::kNone;
+#endif
+
+/* Instruction sets of the CPU we are running on */
+struct CpuFeatures {
+  bool m_sse2 = false;
+  bool m_sse42 = false;
+  bool m_neon = false;
+};
+
+/* Instruction sets of the CPU we are running on, detected once */
+const CpuFeatures &GetCpuFeatures();
+
+/* If the CPU we are running on can execute level */
+bool HasSimd(SimdLevel level);
+
+/* Name of level, for logging */
+const char *GetSimdName(SimdLevel level);
+
+} // namespace OsDetection
+#endif // !CPU_FEATURES_HPP
@@ -0,0 +1,83 @@
+#pragma once
+#ifndef BACKGROUND_SAVE_HPP
+#define BACKGROUND_SAVE_HPP 1
+
+#include "file_load_system/file_load_system.hpp"
+#include "serialization/serializer.hpp"
+#include "serialization/serializer_factory.hpp"
+
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace Serializer {
+/*
+  State that is saved in the background while the game keeps changing it.
+  A snapshot only keeps the current state alive, and the first Write after
+  it always copies the state, so taking one costs a reference count and it
+  never changes while a save reads it. T must be copyable. Only one thread
+  (the game) calls Read, Write and Snapshot
+*/
+template <class T> class CopyOnWrite {
+public:
+  CopyOnWrite() : m_state(std::make_shared<T>()) {}
+  explicit CopyOnWrite(T state)
+      : m_state(std::make_shared<T>(std::move(state))) {}
+  CopyOnWrite(CopyOnWrite &&) = default;
+  /* Copy is not allowed because it doesn't make sense */
+  CopyOnWrite(const CopyOnWrite &) = delete;
+  CopyOnWrite &operator=(CopyOnWrite &&) = default;
+  /* Copy is not allowed because it doesn't make sense */
+  CopyOnWrite &operator=(const CopyOnWrite &) = delete;
+  ~CopyOnWrite() = default;
+
+  /* Current state */
+  inline const T &Read() const { return *m_state; }
+
+  /*
+  Current state to change it, copied first if a snapshot was taken since the
+  last copy (use_count can't tell if a save on another thread is done with
+  it). Don't keep it after taking a snapshot
+  */
+  inline T &Write() {
+    if (m_shared) {
+      m_state = std::make_shared<T>(std::as_const(*m_state));
+      m_shared = false;
+    }
+    return *m_state;
+  }
+
+  /*
+  The current state, which won't change anymore. Only Serialize can be
+  called on it
+  */
+  inline std::shared_ptr<T> Snapshot() const {
+    m_shared = true;
+    return m_state;
+  }
+
+private:
+  std::shared_ptr<T> m_state;
+
+  /* If a snapshot has the current state */
+  mutable bool m_shared = false;
+};
+
+/*
+  Serialize snapshot as name with a new serializer of format, compile it
+  (pretty if asked) and write it to path, everything on a worker thread. The
+  text is written to a unique file next to path and then renamed, so a save
+  that fails never leaves a broken file behind and overlapping saves don't
+  write the same file. Nothing else can use snapshot until the future
+  is ready, and its destructor waits for the save. False if any step fails
+*/
+std::future<bool> SaveInBackground(std::shared_ptr<ISerializable> snapshot,
+                                   std::string name,
+                                   FileLoadSystem::path path,
+                                   SerializerFormat format,
+                                   bool pretty = false);
+
+} // namespace Serializer
+
+#endif // !BACKGROUND_SAVE_HPP
@@ -0,0 +1,89 @@
+#pragma once
+#ifndef BINARY_SERIALIZER_HPP
+#define BINARY_SERIALIZER_HPP 1
+
+#include "serialization/serializer.hpp"
+#include "serialization/tree_serializer.hpp"
+
+#include <cstdint>
+
+namespace Serializer {
+/*
+  Compact Binary Serializer.
+  Layout (little endian): magic, body size (8 bytes), body. The body is the
+  root entries count followed by the entries. Every value is a tag byte
+  followed by its payload: integers are varints (signed ones zigzag encoded),
+  doubles raw IEEE 754, strings and names length prefixed. Blobs are their size,
+  a padding count and that many zeros, so their raw bytes are aligned to
+  kBlobAlignment from the start and can be used in place. Members of entries
+  are prefixed by their name. There is no text formatting, so Compile and
+  CompilePretty give the same result
+*/
+class BinarySerializer final : public TreeSerializer {
+public:
+  BinarySerializer() = default;
+  BinarySerializer(BinarySerializer &&) = default;
+  /* Copy is not allowed because it doesn't make sense */
+  BinarySerializer(const BinarySerializer &) = delete;
+  BinarySerializer &operator=(BinarySerializer &&) = default;
+  /* Copy is not allowed because it doesn't make sense */
+  BinarySerializer &operator=(const BinarySerializer &) = delete;
+  ~BinarySerializer() = default;
+
+  /*
+  Parse from Text. The size is read from the header, so text must have at
+  least kHeaderSize bytes, only use it with a text that is known to be whole
+  */
+  bool ParseText(const char *text) final;
+  /* Parse from Text using length*/
+  bool ParseText(const char *text, size_t length) final;
+  /* Compile internals */
+  bool Compile() final;
+  /* Compile internals in a Pretty Format (same as Compile) */
+  bool CompilePretty() final;
+
+  /* Magic Number at the start of the compiled internals */
+  static constexpr char kMagic[4] = {'K', 'C', 'H', 'B'};
+
+  /* Size of the header of the compiled internals */
+  static constexpr size_t kHeaderSize = sizeof(kMagic) + sizeof(std::uint64_t);
+
+  /* Alignment of the bytes of blobs in the compiled internals */
+  static constexpr size_t kBlobAlignment = 16;
+
+private:
+  /* Tag byte of each encoded value */
+  enum Tag : std::uint8_t {
+    kTagNull = 0,
+    kTagFalse = 1,
+    kTagTrue = 2,
+    kTagUint = 3,
+    kTagSint = 4,
+    kTagDouble = 5,
+    kTagString = 6,
+    kTagArray = 7,
+    kTagEntry = 8,
+    kTagBlob = 9,
+  };
+
+  /* Append a varint */
+  void WriteVarint(std::uint64_t value);
+
+  /* Append the children of a node */
+  void WriteChildren(node_index parent, bool named);
+
+  /* Append a node value (not its name) */
+  void WriteValue(const Node &node, node_index index);
+
+  /* Read a varint */
+  static bool ReadVarint(const char *&cursor, const char *end,
+                         std::uint64_t *value);
+
+  /* Read count children into parent, which is nested depth times */
+  bool ReadChildren(const char *&cursor, const char *end, node_index parent,
+                    bool named, std::uint32_t depth);
+};
+
+} // namespace Serializer
+
+#endif // !BINARY_SERIALIZER_HPP
@@ -0,0 +1,82 @@
+#pragma once
+#ifndef FLAT_SERIALIZER_HPP
+#define FLAT_SERIALIZER_HPP 1
+
+#include "serialization/serializer.hpp"
+#include "serialization/tree_serializer.hpp"
+
+#include <cstdint>
+
+namespace Serializer {
+/*
+  Read optimized Serializer: the compiled internals are an image of the tree,
+  so parsing them decodes nothing.
+  Layout: header (magic, node size, byte order mark, node count, strings size),
+  the nodes (fixed size, 8 aligned, children and siblings are node indexes)
+  and the null terminated strings. Reads follow the indexes in place, so a
+  mapped file (see FileLoadSystem::MappedFile) is opened in O(1) and its pages
+  are only read when they are touched. Images are only read on the kind of
+  machine that wrote them (same node layout and byte order), which is checked.
+  There is no text formatting, so Compile and CompilePretty give the same
+  result
+*/
+class FlatSerializer final : public TreeSerializer {
+public:
+  FlatSerializer() = default;
+  FlatSerializer(FlatSerializer &&) = default;
+  /* Copy is not allowed because it doesn't make sense */
+  FlatSerializer(const FlatSerializer &) = delete;
+  FlatSerializer &operator=(FlatSerializer &&) = default;
+  /* Copy is not allowed because it doesn't make sense */
+  FlatSerializer &operator=(const FlatSerializer &) = delete;
+  ~FlatSerializer() = default;
+
+  /*
+  Parse from Text without copying it. The size is read from the header. Text
+  must be 8 aligned and outlive the next Clear, Parse or Set (the first Set
+  copies it)
+  */
+  bool ParseText(const char *text) final;
+  /*
+  Parse from Text using length, without copying it. It might have more bytes
+  after the image. Text must be 8 aligned and outlive the next Clear, Parse
+  or Set (the first Set copies it)
+  */
+  bool ParseText(const char *text, size_t length) final;
+  /* Compile internals */
+  bool Compile() final;
+  /* Compile internals in a Pretty Format (same as Compile) */
+  bool CompilePretty() final;
+
+  /*
+  Check every node of a parsed image: types, indexes and strings in bounds.
+  Parse only checks the header (it is O(1)), call this O(n) check before
+  reading images that don't come from a trusted bake
+  */
+  bool Verify() const;
+
+  /* Magic Number at the start of the compiled internals */
+  static constexpr char kMagic[4] = {'K', 'C', 'H', 'F'};
+
+  /* Size of the header of the compiled internals */
+  static constexpr size_t kHeaderSize = 32;
+
+private:
+  /* Written as a 32 bits integer, it tells the byte order */
+  static constexpr std::uint32_t kByteOrderMark = 0x01020304;
+
+  /* Fields of the header */
+  struct Header {
+    std::uint32_t m_nodeSize;
+    std::uint32_t m_byteOrderMark;
+    std::uint64_t m_nodeCount;
+    std::uint64_t m_stringsSize;
+  };
+
+  /* Read and check the header, false if it can't be an image of this machine */
+  static bool ReadHeader(const char *text, Header *header);
+};
+
+} // namespace Serializer
+
+#endif // !FLAT_SERIALIZER_HPP
@@ -0,0 +1,91 @@
+#pragma once
+#ifndef INCREMENTAL_SAVE_HPP
+#define INCREMENTAL_SAVE_HPP 1
+
+#include "serialization/json_serializer.hpp"
+#include "serialization/json_stream_serializer.hpp"
+#include "serialization/serializer.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Serializer {
+/*
+  Save passes that only serialize the objects changed since the previous one.
+  The compiled text of every object that tracks its changes (see
+  DirtyTracking) is kept, and while its generation stays the same the text is
+  written again instead of calling Serialize. Objects that don't track their
+  changes are serialized every time. The result is the same text as calling
+  Serialize on every object.
+  Objects are known by their address, so one that is moved gets serialized
+  again. Nothing is shared, use one per thread
+*/
+class IncrementalSave {
+public:
+  IncrementalSave();
+  IncrementalSave(IncrementalSave &&) = default;
+  /* Copy is not allowed because it doesn't make sense */
+  IncrementalSave(const IncrementalSave &) = delete;
+  IncrementalSave &operator=(IncrementalSave &&) = default;
+  /* Copy is not allowed because it doesn't make sense */
+  IncrementalSave &operator=(const IncrementalSave &) = delete;
+  ~IncrementalSave() = default;
+
+  /*
+  Write object with name into the current entry of target, from the cache if
+  it didn't change. Length excludes null terminator. If it is at the same
+  level as an opened array, the name is not used and it is appended
+  */
+  bool Save(JsonStreamSerializer &target, ISerializable &object,
+            const char *name, s_size name_length);
+
+  /*
+  Finish a save pass. Cached objects that were not saved during it are
+  dropped (i.e. destroyed ones) and the counts start again
+  */
+  void EndPass();
+
+  /* Drop everything cached */
+  void Clear();
+
+  /* Objects serialized during the current pass */
+  inline size_t GetSerializedCount() const { return m_serializedCount; }
+
+  /* Objects written from the cache during the current pass */
+  inline size_t GetReusedCount() const { return m_reusedCount; }
+
+  /* Objects in the cache */
+  inline size_t GetCachedCount() const { return m_cache.size(); }
+
+  /* Memory Statistics of the arena the objects are serialized in */
+  inline JsonSerializer::ArenaStats GetArenaStats() {
+    return m_scratch.GetArenaStats();
+  }
+
+private:
+  /* Compiled text of an object */
+  struct CachedObject {
+    std::uint64_t m_generation = ISerializable::kUntrackedGeneration;
+    std::string m_name;
+    std::vector<JsonSerializer::Fragment> m_fragments;
+    bool m_saved = false;
+  };
+
+  /* Serialize object into cached and refresh its text */
+  bool Compile(ISerializable &object, const char *name, s_size name_length,
+               std::uint64_t generation, CachedObject *cached);
+
+  std::unordered_map<const ISerializable *, CachedObject> m_cache;
+
+  /* Reused by every object serialized, resets its arena every time */
+  JsonSerializer m_scratch;
+
+  size_t m_serializedCount = 0;
+  size_t m_reusedCount = 0;
+};
+
+} // namespace Serializer
+
+#endif // !INCREMENTAL_SAVE_HPP
@@ -0,0 +1,107 @@
+#pragma once
+#ifndef JSON_LINES_READER_HPP
+#define JSON_LINES_READER_HPP 1
+
+#include "file_load_system/smart_file.hpp"
+#include "serialization/json_serializer.hpp"
+
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace Serializer {
+/*
+  Reader of JSON Lines texts (one JSON document per line, i.e. telemetry or
+  replay logs). The text is split in chunks at line ends, the chunks are parsed
+  concurrently on worker threads into separate JsonSerializer documents and the
+  documents are handed out in order on the calling thread. Only a window of
+  chunks is in memory at a time, so Files of any size can be read.
+  Empty lines are skipped
+*/
+class JsonLinesReader {
+public:
+  /*
+  Called with every document, in order. line is the line of the text it was
+  in, starting at 0. The document only lives until it returns. Returning false
+  stops reading
+  */
+  using Handler = std::function<bool(size_t line, JsonSerializer &document)>;
+
+  /* Default size of a chunk in bytes */
+  static constexpr size_t kDefaultChunkSize = 1024 * 1024;
+
+  /*
+  Read using up to workers threads (0 for one per hardware thread), each
+  parsing chunkSize bytes at a time
+  */
+  explicit JsonLinesReader(unsigned workers = 0,
+                           size_t chunkSize = kDefaultChunkSize);
+  /* Copy is not allowed because it doesn't make sense */
+  JsonLinesReader(const JsonLinesReader &) = delete;
+  /* Copy is not allowed because it doesn't make sense */
+  JsonLinesReader &operator=(const JsonLinesReader &) = delete;
+  ~JsonLinesReader() = default;
+
+  /* Read a text in memory. It is not copied */
+  bool Read(const char *text, size_t length, const Handler &handler);
+
+  /* Read a File from its current position to its end. It is not owned */
+  bool Read(std::FILE *file, const Handler &handler);
+
+  /* Read a File from its current position to its end. It is not owned */
+  bool Read(FileLoadSystem::SmartReadFile &file, const Handler &handler);
+
+  /* Line that failed to parse in the last Read, false if none did */
+  bool GetErrorLine(size_t *line) const;
+
+private:
+  /* Documents parsed from a chunk */
+  struct ParsedChunk {
+    /* One per document. Declared before the documents, which use them */
+    std::vector<std::unique_ptr<JsonSerializer::AllocatorType>> m_allocators;
+    std::vector<std::unique_ptr<JsonSerializer>> m_documents;
+    /* Line of each document, counted from the start of the chunk */
+    std::vector<size_t> m_lines;
+    /* Lines in the chunk */
+    size_t m_lineCount = 0;
+    /* If a line failed to parse, the documents end before it */
+    bool m_failed = false;
+    size_t m_failedLine = 0;
+  };
+
+  /* Parse every line of a chunk */
+  static ParsedChunk ParseChunk(const char *text, size_t length);
+
+  /* Hand out the documents of a chunk whose first line is line */
+  bool Deliver(ParsedChunk &chunk, size_t line, const Handler &handler);
+
+  /* Chunks parsed at the same time */
+  size_t m_window;
+
+  /* Size of a chunk in bytes */
+  size_t m_chunkSize;
+
+  /* If a line failed to parse in the last Read */
+  bool m_failed = false;
+
+  /* Line that failed to parse in the last Read */
+  size_t m_errorLine = 0;
+};
+
+inline bool JsonLinesReader::Read(FileLoadSystem::SmartReadFile &file,
+                                  const Handler &handler) {
+  return Read(file.Get(), handler);
+}
+
+inline bool JsonLinesReader::GetErrorLine(size_t *line) const {
+  if (!m_failed) {
+    return false;
+  }
+  *line = m_errorLine;
+  return true;
+}
+
+} // namespace Serializer
+
+#endif // !JSON_LINES_READER_HPP
@@ -0,0 +1,552 @@
+#pragma once
+#ifndef JSON_PULL_SERIALIZER_HPP
+#define JSON_PULL_SERIALIZER_HPP 1
+
+#include "file_load_system/smart_file.hpp"
+#include "rapidjson/reader.h"
+#include "serialization/serializer.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Serializer {
+/*
+  rapidjson Input Stream over a text in memory or over a File read in chunks
+  into a fixed buffer, so the memory used doesn't grow with the text
+*/
+class JsonPullStream {
+public:
+  /* Character type used */
+  using Ch = char;
+
+  /* Size of the buffer in bytes */
+  static constexpr size_t kBufferSize = 16 * 1024;
+
+  JsonPullStream() = default;
+  /* Copy is not allowed because it doesn't make sense */
+  JsonPullStream(const JsonPullStream &) = delete;
+  /* Copy is not allowed because it doesn't make sense */
+  JsonPullStream &operator=(const JsonPullStream &) = delete;
+  ~JsonPullStream() = default;
+
+  /* Read from a text in memory. It is not copied */
+  void Open(const char *text, size_t length);
+
+  /* Read from a File. It is not owned */
+  void Open(std::FILE *file);
+
+  /* Stop reading */
+  void Close();
+
+  /* Current character, '\0' at the end */
+  inline Ch Peek() const { return m_current != m_end ? *m_current : '\0'; }
+
+  /* Take the current character, '\0' at the end */
+  inline Ch Take() {
+    if (m_current == m_end) {
+      return '\0';
+    }
+
+    Ch c = *m_current++;
+
+    if (m_current == m_end) {
+      Refill();
+    }
+    return c;
+  }
+
+  /* Amount of characters taken */
+  inline size_t Tell() const {
+    return m_count + static_cast<size_t>(m_current - m_begin);
+  }
+
+  /* Only used by in situ parsing, which is not supported */
+  inline Ch *PutBegin() { return nullptr; }
+  /* Only used by in situ parsing, which is not supported */
+  inline void Put(Ch) {}
+  /* Only used by in situ parsing, which is not supported */
+  inline void Flush() {}
+  /* Only used by in situ parsing, which is not supported */
+  inline size_t PutEnd(Ch *) { return 0; }
+
+private:
+  /* Read the next chunk of the File */
+  void Refill();
+
+  std::FILE *m_file = nullptr;
+  const Ch *m_begin = nullptr;
+  const Ch *m_current = nullptr;
+  const Ch *m_end = nullptr;
+  /* Characters taken before m_begin */
+  size_t m_count = 0;
+  Ch m_buffer[kBufferSize];
+};
+
+/*
+  Read only, forward only JSON Serializer. Instead of building a document, the
+  text is parsed as entries are requested, so only what is being looked at is
+  kept in memory (i.e. large world files).
+  Names are searched forward from the last one found, so they should be read in
+  the order they were written. Members that are skipped while searching are
+  lost unless they are not entries or arrays, those are remembered until the
+  entry is closed. A value can be read again while no other name is requested.
+  Arrays are not counted ahead, that would keep the whole array in memory, so
+  GetArrayCapacity fails and they are read with CanMoveArray and MoveArray.
+  Nothing can be written, every Set call, Compile and GetText return false
+*/
+class JsonPullSerializer final : public ISerializer {
+public:
+  JsonPullSerializer();
+  /* Move is not allowed because the reader points to the stream */
+  JsonPullSerializer(JsonPullSerializer &&) = delete;
+  /* Copy is not allowed because it doesn't make sense */
+  JsonPullSerializer(const JsonPullSerializer &) = delete;
+  /* Move is not allowed because the reader points to the stream */
+  JsonPullSerializer &operator=(JsonPullSerializer &&) = delete;
+  /* Copy is not allowed because it doesn't make sense */
+  JsonPullSerializer &operator=(const JsonPullSerializer &) = delete;
+  ~JsonPullSerializer() = default;
+
+  /* Parse from Text. It is not copied, so it must outlive the reading */
+  bool ParseText(const char *text) final;
+  /*
+    Parse from Text using length. It is not copied, so it must outlive the
+    reading
+  */
+  bool ParseText(const char *text, size_t length) final;
+  /*
+    Parse from a File opened for reading. It is read in chunks as entries are
+    requested, so it must stay open until the reading ends
+  */
+  bool ParseFile(std::FILE *file);
+  /*
+    Parse from a File opened for reading. It is read in chunks as entries are
+    requested, so it must stay open until the reading ends
+  */
+  bool ParseFile(FileLoadSystem::SmartReadFile &file);
+  /* Clear internals */
+  bool Clear() final;
+  /* Not supported */
+  bool Compile() final;
+  /* Not supported */
+  bool CompilePretty() final;
+  /* Not supported */
+  bool GetSize(s_size *size) final;
+  /* Not supported */
+  bool GetLength(s_size *length) final;
+  /* Not supported */
+  bool GetText(char *text) final;
+
+  /* Not supported */
+  bool SetEntry(const char *name, s_size name_length, s_size version) final;
+  /*
+  Gets in the space of an entry and return its version
+  If it is at the same level as an opened array, the name is not used and the
+  array entry is opened
+  */
+  bool OpenEntry(const char *name, s_size *version) const final;
+  /* Close an entry, skipping what was not read */
+  bool CloseEntry() const final;
+
+  /* Not supported */
+  bool SetBool(const char *name, s_size name_length, bool value) final;
+  /*
+  Gets if the current/named entry is a bool
+  If it is at the same level as an opened array, the name is not used and it
+  checks if the current opened entry is
+  */
+  bool IsBool(const char *name) const final;
+  /*
+  Gets the named or current bool entry
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetBool(const char *name, bool *result) const final;
+
+  /* Not supported */
+  bool SetUint(const char *name, s_size name_length, unsigned value) final;
+  /*
+  Gets if the current/named entry is an unsigned
+  If it is at the same level as an opened array, the name is not used and it
+  checks if the current opened entry is
+  */
+  bool IsUint(const char *name) const final;
+  /*
+  Gets the named or current unsigned entry
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetUint(const char *name, unsigned *result) const final;
+
+  /* Not supported */
+  bool SetInt(const char *name, s_size name_length, int value) final;
+  /*
+  Gets if the current/named entry is an int
+  If it is at the same level as an opened array, the name is not used and it
+  checks if the current opened entry is
+  */
+  bool IsInt(const char *name) const final;
+  /*
+  Gets the named or current int entry
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetInt(const char *name, int *result) const final;
+
+  /* Not supported */
+  bool SetUint64(const char *name, s_size name_length, uint64_t value) final;
+  /*
+  Gets if the current/named entry is an uint64_t
+  If it is at the same level as an opened array, the name is not used and it
+  checks if the current opened entry is
+  */
+  bool IsUint64(const char *name) const final;
+  /*
+  Gets the named or current uint64_t entry
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetUint64(const char *name, uint64_t *result) const final;
+
+  /* Not supported */
+  bool SetInt64(const char *name, s_size name_length, int64_t value) final;
+  /*
+  Gets if the current/named entry is an int64_t
+  If it is at the same level as an opened array, the name is not used and it
+  checks if the current opened entry is
+  */
+  bool IsInt64(const char *name) const final;
+  /*
+  Gets the named or current int64_t entry
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetInt64(const char *name, int64_t *result) const final;
+
+  /* Not supported */
+  bool SetDouble(const char *name, s_size name_length, double value) final;
+  /*
+  Gets if the current/named entry is an double
+  If it is at the same level as an opened array, the name is not used and it
+  checks if the current opened entry is
+  */
+  bool IsDouble(const char *name) const final;
+  /*
+  Gets the named or current double entry
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetDouble(const char *name, double *result) const final;
+
+  /* Not supported */
+  bool SetString(const char *name, s_size name_length, const char *value,
+                 s_size length) final;
+  /*
+  Gets if the current/named entry is a string
+  If it is at the same level as an opened array, the name is not used and it
+  checks if the current opened entry is
+  */
+  bool IsString(const char *name) const final;
+  /*
+  Gets the named or current string entry length (UTF makes this tricky)
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetStringLength(const char *name, s_size *result) const final;
+  /*
+  Gets the named or current string size in bytes
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetStringSize(const char *name, s_size *result) const final;
+  /*
+  Gets the named or current string entry. The result pointer must be able to
+  hold the string If it is at the same level as an opened array, the name is not
+  used and it gets the current opened entry is
+  */
+  bool GetString(const char *name, char *result) const final;
+  /*
+  Gets the named or current string entry without copying it. The view is only
+  valid until another name is requested
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetStringView(const char *name, std::string_view *result) const final;
+
+  /* Not supported */
+  bool SetNull(const char *name, s_size name_length) final;
+  /*
+  Gets if the current/named entry is null
+  If it is at the same level as an opened array, the name is not used and it
+  checks if the current opened entry is
+  */
+  bool IsNull(const char *name) const final;
+
+  /* Not supported */
+  bool SetArray(const char *name, s_size name_length) final;
+  /* Not supported */
+  bool ReserveArray(const char *name, s_size size) final;
+  /*
+  Gets if the current/named entry is an array
+  If it is at the same level as an opened array, the name is not used and it
+  checks if the current opened entry is
+  */
+  bool IsArray(const char *name) const final;
+  /*
+  Gets in the space of an entry
+  If it is at the same level as an opened array, the name is not used and the
+  array entry is opened
+  */
+  bool OpenArray(const char *name) const final;
+  /* Not supported, iterate with CanMoveArray and MoveArray */
+  bool GetArrayCapacity(const char *name, s_size *size) const final;
+  /* If the Current Array Iterator is not end() */
+  bool CanMoveArray() const final;
+  /* Moves the Current Array Iterator. It starts at begin(). This function will
+   * return false when it tries to move end() */
+  bool MoveArray() const final;
+  /* Close an array entry, skipping what was not read */
+  bool CloseArray() const final;
+
+private:
+  /* Kind of parsed token */
+  enum class TokenType : unsigned char {
+    kNull,
+    kBool,
+    kUint,
+    kInt,
+    kDouble,
+    kString,
+    kKey,
+    kStartObject,
+    kEndObject,
+    kStartArray,
+    kEndArray,
+  };
+
+  /* A parsed token. Non negative integers are kUint, negative ones kInt */
+  struct Token {
+    TokenType m_type = TokenType::kNull;
+    union {
+      bool m_bool;
+      std::uint64_t m_uint;
+      std::int64_t m_int;
+      double m_double;
+    };
+    /* Strings and Keys */
+    std::string m_string;
+
+    Token() : m_uint(0) {}
+  };
+
+  /* rapidjson Handler that queues the tokens */
+  struct Handler {
+    std::deque<Token> *m_tokens;
+
+    bool Null();
+    bool Bool(bool value);
+    bool Int(int value);
+    bool Uint(unsigned value);
+    bool Int64(int64_t value);
+    bool Uint64(uint64_t value);
+    bool Double(double value);
+    bool RawNumber(const char *text, rapidjson::SizeType length, bool copy);
+    bool String(const char *text, rapidjson::SizeType length, bool copy);
+    bool StartObject();
+    bool Key(const char *text, rapidjson::SizeType length, bool copy);
+    bool EndObject(rapidjson::SizeType member_count);
+    bool StartArray();
+    bool EndArray(rapidjson::SizeType element_count);
+  };
+
+  /* An opened entry or array */
+  struct Level {
+    bool m_array = false;
+    /* Entries: the value of m_pendingName is at the front of the tokens */
+    bool m_pending = false;
+    /* Arrays: the current element was opened, so it is not at the front */
+    bool m_entered = false;
+    std::string m_pendingName;
+    /* Entries: skipped members that were not entries nor arrays */
+    std::vector<std::pair<std::string, Token>> m_skipped;
+  };
+
+  /* Start reading what the stream has */
+  bool Start();
+
+  /* Make sure there are at least count tokens queued */
+  bool Fill(size_t count) const;
+
+  /* First queued token, nullptr if there are no more */
+  const Token *Front() const;
+
+  /* Remove the front value (every token of it if it is an entry or array) */
+  bool SkipValue() const;
+
+  /* Skip everything until the end of the current level and leave it */
+  bool LeaveLevel(TokenType end) const;
+
+  /*
+    Find the named value (or the current one inside an array). nullptr if it
+    is not found
+  */
+  const Token *FindValue(const char *name) const;
+
+  /* Take the found front start token and enter a new level */
+  bool EnterLevel(const char *name, TokenType start) const;
+
+  /* If a token holds a T (Only primitives and no pointers) */
+  template <typename T> static bool IsTokenType(const Token &token);
+
+  /* If an entry is of type T (Only primitives and no pointers)*/
+  template <typename T> bool IsType(const char *name) const;
+
+  /* Get an entry of type T (Only primitives and no pointers)*/
+  template <typename T> bool GetType(const char *name, T *result) const;
+
+  /* Where the text comes from */
+  mutable JsonPullStream m_stream;
+
+  /* Parses the stream one token at a time */
+  mutable rapidjson::Reader m_reader;
+
+  /* Tokens parsed but not consumed */
+  mutable std::deque<Token> m_tokens;
+
+  /* Opened entries and arrays. Used as a Stack */
+  mutable std::vector<Level> m_levels;
+
+  /* If the parsing failed */
+  mutable bool m_failed = false;
+
+  /* The name of the version entry */
+  static constexpr char kVersionEntryName[] = "__VERSION__";
+};
+
+inline JsonPullSerializer::JsonPullSerializer() { Clear(); }
+
+template <typename T>
+bool JsonPullSerializer::IsTokenType(const Token &token) {
+  if constexpr (std::is_same_v<T, bool>) {
+    return token.m_type == TokenType::kBool;
+  } else if constexpr (std::is_same_v<T, double>) {
+    return token.m_type == TokenType::kDouble;
+  } else if constexpr (std::is_signed_v<T>) {
+    if (token.m_type == TokenType::kUint) {
+      return token.m_uint <=
+             static_cast<std::uint64_t>(std::numeric_limits<T>::max());
+    }
+    return token.m_type == TokenType::kInt &&
+           token.m_int >= static_cast<std::int64_t>(
+                              std::numeric_limits<T>::lowest());
+  } else {
+    return token.m_type == TokenType::kUint &&
+           token.m_uint <=
+               static_cast<std::uint64_t>(std::numeric_limits<T>::max());
+  }
+}
+
+template <typename T> bool JsonPullSerializer::IsType(const char *name) const {
+  const Token *token = FindValue(name);
+
+  return token != nullptr && IsTokenType<T>(*token);
+}
+
+template <typename T>
+bool JsonPullSerializer::GetType(const char *name, T *result) const {
+  const Token *token = FindValue(name);
+
+  if (token == nullptr) {
+    return false;
+  }
+
+  // Integers can be read as doubles
+  if constexpr (std::is_same_v<T, double>) {
+    if (token->m_type == TokenType::kUint) {
+      *result = static_cast<double>(token->m_uint);
+      return true;
+    }
+    if (token->m_type == TokenType::kInt) {
+      *result = static_cast<double>(token->m_int);
+      return true;
+    }
+  }
+
+  if (!IsTokenType<T>(*token)) {
+    return false;
+  }
+
+  if constexpr (std::is_same_v<T, bool>) {
+    *result = token->m_bool;
+  } else if constexpr (std::is_same_v<T, double>) {
+    *result = token->m_double;
+  } else if (token->m_type == TokenType::kUint) {
+    *result = static_cast<T>(token->m_uint);
+  } else {
+    *result = static_cast<T>(token->m_int);
+  }
+  return true;
+}
+
+inline bool JsonPullSerializer::IsBool(const char *name) const {
+  return IsType<bool>(name);
+}
+
+inline bool JsonPullSerializer::GetBool(const char *name, bool *result) const {
+  return GetType<bool>(name, result);
+}
+
+inline bool JsonPullSerializer::IsUint(const char *name) const {
+  return IsType<unsigned>(name);
+}
+
+inline bool JsonPullSerializer::GetUint(const char *name,
+                                        unsigned *result) const {
+  return GetType<unsigned>(name, result);
+}
+
+inline bool JsonPullSerializer::IsInt(const char *name) const {
+  return IsType<int>(name);
+}
+
+inline bool JsonPullSerializer::GetInt(const char *name, int *result) const {
+  return GetType<int>(name, result);
+}
+
+inline bool JsonPullSerializer::IsUint64(const char *name) const {
+  return IsType<uint64_t>(name);
+}
+
+inline bool JsonPullSerializer::GetUint64(const char *name,
+                                          uint64_t *result) const {
+  return GetType<uint64_t>(name, result);
+}
+
+inline bool JsonPullSerializer::IsInt64(const char *name) const {
+  return IsType<int64_t>(name);
+}
+
+inline bool JsonPullSerializer::GetInt64(const char *name,
+                                         int64_t *result) const {
+  return GetType<int64_t>(name, result);
+}
+
+inline bool JsonPullSerializer::IsDouble(const char *name) const {
+  return IsType<double>(name);
+}
+
+inline bool JsonPullSerializer::GetDouble(const char *name,
+                                          double *result) const {
+  return GetType<double>(name, result);
+}
+
+} // namespace Serializer
+
+#endif // !JSON_PULL_SERIALIZER_HPP
@@ -4,17 +4,55 @@
 
 #include "rapidjson/document.h"
 #include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#include "serialization/json_skip_index.hpp"
+#include "serialization/path_query.hpp"
 #include "serialization/serializer.hpp"
+#include "utils/hash.hpp"
 
 
 #include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 
 namespace Serializer {
 class JsonSerializer final : public ISerializer {
 public:
+  /* Allocator the values are stored with */
+  using AllocatorType = typename rapidjson::Document::AllocatorType;
+
+  /* Memory Statistics of the arena the values are allocated from */
+  struct ArenaStats {
+    /* Bytes used by the values */
+    size_t m_used = 0;
+    /* Bytes reserved, including what was allocated when it ran out */
+    size_t m_capacity = 0;
+    /* Times it was reset */
+    size_t m_resets = 0;
+    /* Times an owned arena was rebuilt bigger */
+    size_t m_growths = 0;
+  };
+
+  /* Default size of an owned arena */
+  static constexpr size_t kDefaultArenaSize = 64 * 1024;
+
   JsonSerializer();
+  /*
+  Store the values with allocator, which is not owned and must outlive the
+  serializer. The arena is reset on Clear, so it can't be shared with values
+  that outlive it
+  */
+  explicit JsonSerializer(AllocatorType *allocator);
+  /*
+  Store the values in buffer (not owned), going to the heap only when it runs
+  out. The arena is reset on Clear
+  */
+  JsonSerializer(void *buffer, size_t size);
   JsonSerializer(JsonSerializer &&) = default;
   /* Copy is not allowed because it doesn't make sense */
   JsonSerializer(const JsonSerializer &) = delete;
@@ -27,6 +65,29 @@ public:
   bool ParseText(const char *text) final;
   /* Parse from Text using length*/
   bool ParseText(const char *text, size_t length) final;
+  /*
+  Parse in place from a null terminated mutable buffer, strings are not copied
+  but decoded inside the buffer. It must outlive the next Clear or Parse
+  */
+  bool ParseInsitu(char *buffer);
+  /*
+  Parse in place from a mutable buffer using length, strings are not copied
+  but decoded inside the buffer. It must hold length + 1 chars, a null
+  terminator is written at buffer[length] (ReadFileWithAlloc buffers have
+  it). It must outlive the next Clear or Parse
+  */
+  bool ParseInsitu(char *buffer, size_t length);
+  /*
+  Parse from Text lazily. A fast scan records where the members of the root
+  and of its objects are, and only their names and small values are parsed.
+  Objects and arrays below are parsed the first time they are looked up
+  (OpenEntry, OpenArray, Get...). The text is not copied, it must outlive the
+  next Clear or Parse. A Set call or a Compile parses everything left. A
+  broken section is only found when it is touched: it is missing, and null
+  once everything is parsed. Texts that can't be scanned (the root is not an
+  object or names have escapes) are parsed whole
+  */
+  bool ParseTextLazy(const char *text, size_t length);
   /* Clear internals */
   bool Clear() final;
   /* Compile internals */
@@ -40,6 +101,13 @@ public:
   /* Put the compiled internals in a char array. It should have at least enough
    * space */
   bool GetText(char *text) final;
+  /*
+  Get the compiled internals without copying them, excluding null terminator.
+  The view is only valid until the serializer changes
+  */
+  bool GetView(std::string_view *view) const final;
+  /* Compile internals straight into sink, without GetText */
+  bool CompileTo(ISink &sink) final;
 
   /*
   Open an space for a new entry with name and version. Length excludes null
@@ -201,6 +269,22 @@ public:
   used and it gets the current opened entry is
   */
   bool GetString(const char *name, char *result) const final;
+  /*
+  Gets the named or current string entry without copying it. The view is only
+  valid until the serializer changes
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetStringView(const char *name, std::string_view *result) const final;
+
+  /*
+  Sets a new blob (size raw bytes) entry as a Base64 string, encoded straight
+  into the document memory. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetBlob(const char *name, s_size name_length, const void *data,
+               s_size size) final;
 
   /*
   Sets a new null entry. Length excludes null terminator.
@@ -247,10 +331,222 @@ public:
   /* Close an array entry */
   bool CloseArray() const final;
 
+  /*
+  Open the parent of the value path leads to, from the root, like OpenEntry
+  or OpenArray do (moved to the element). The value is then read with the
+  usual calls using path.GetName(), which is not used for an array element.
+  False if the value is not there
+  */
+  bool OpenPath(const PathQuery &path) const final;
+  /* Close what OpenPath opened */
+  bool ClosePath() const final;
+
+  /* Sets a new array of size bools at once */
+  bool SetBoolArray(const char *name, s_size name_length, const bool *values,
+                    s_size size) final;
+  /* Gets the named or current array of bools at once */
+  bool GetBoolArray(const char *name, bool *result, s_size size) const final;
+  /* Sets a new array of size unsigneds at once */
+  bool SetUintArray(const char *name, s_size name_length,
+                    const unsigned *values, s_size size) final;
+  /* Gets the named or current array of unsigneds at once */
+  bool GetUintArray(const char *name, unsigned *result,
+                    s_size size) const final;
+  /* Sets a new array of size ints at once */
+  bool SetIntArray(const char *name, s_size name_length, const int *values,
+                   s_size size) final;
+  /* Gets the named or current array of ints at once */
+  bool GetIntArray(const char *name, int *result, s_size size) const final;
+  /* Sets a new array of size uint64_t at once */
+  bool SetUint64Array(const char *name, s_size name_length,
+                      const uint64_t *values, s_size size) final;
+  /* Gets the named or current array of uint64_t at once */
+  bool GetUint64Array(const char *name, uint64_t *result,
+                      s_size size) const final;
+  /* Sets a new array of size int64_t at once */
+  bool SetInt64Array(const char *name, s_size name_length,
+                     const int64_t *values, s_size size) final;
+  /* Gets the named or current array of int64_t at once */
+  bool GetInt64Array(const char *name, int64_t *result,
+                     s_size size) const final;
+  /* Sets a new array of size doubles at once */
+  bool SetDoubleArray(const char *name, s_size name_length,
+                      const double *values, s_size size) final;
+  /* Gets the named or current array of doubles at once */
+  bool GetDoubleArray(const char *name, double *result,
+                      s_size size) const final;
+
+  /*
+  Objects with at least this many members get a hash index the first time a
+  name is looked up in them, smaller ones are searched linearly. Use
+  kNoMemberIndex to never build them
+  */
+  inline void SetMemberIndexThreshold(s_size threshold) {
+    m_memberIndexThreshold = threshold;
+  }
+
+  /*
+  Reset the arena on Clear and Parse instead of letting it grow. When the
+  serializer owns it (default constructor), it is rebuilt as a single block
+  with the peak capacity, so a serializer reused every frame stops allocating
+  once it has seen its biggest frame
+  */
+  inline void SetArenaReset(bool reset) { m_arenaReset = reset; }
+
+  /* Memory Statistics of the arena */
+  ArenaStats GetArenaStats();
+
+  /*
+  New empty serializer with the same settings, to fill an independent part
+  of this one (i.e. on another thread) and Splice it back
+  */
+  std::unique_ptr<JsonSerializer> Fork() const;
+
+  /*
+  Move the root members of child to the current entry, after the ones already
+  there. If it is at the same level as an opened array, their values are
+  appended to the array instead. Nothing is copied: the child's memory is kept
+  until this serializer is cleared or parsed, so the child can't be using a
+  user allocator or buffer. The child is left cleared
+  */
+  bool Splice(JsonSerializer &child);
+
+  /* A root member compiled on its own */
+  struct Fragment {
+    std::string m_name;
+    std::string m_text;
+    rapidjson::Type m_type = rapidjson::kNullType;
+  };
+
+  /*
+  Compile every root member on its own, to be written by another serializer
+  (see JsonStreamSerializer::Splice)
+  */
+  bool CompileFragments(std::vector<Fragment> *fragments) const;
+
+  /* Default member count from which objects get a hash index */
+  static constexpr s_size kDefaultMemberIndexThreshold = 16;
+
+  /* Threshold that disables the hash indexes */
+  static constexpr s_size kNoMemberIndex = static_cast<s_size>(-1);
+
 private:
+  /* Hash index of the members of an object */
+  struct MemberIndex {
+    /* Member count when it was built */
+    rapidjson::SizeType m_count = 0;
+    /* Name hash to member offset (the first one if hashes collide) */
+    std::unordered_map<Hash::hash_t, rapidjson::SizeType> m_offsets;
+  };
+
+  /* Member an open path leads to, read without looking it up by name */
+  struct PathMember {
+    /* Object that has it */
+    const rapidjson::Value *m_parent;
+    /* Name given to read it (PathQuery::GetName) */
+    const char *m_name;
+    rapidjson::Value::MemberIterator m_member;
+  };
+
+  /*
+  Find a member of an object, parsing its value if it is a lazy section.
+  MemberEnd if it is not there or it can't be parsed
+  */
+  rapidjson::Value::MemberIterator FindMember(rapidjson::Value &object,
+                                              const char *name) const;
+
+  /* Find a member of an object, using its hash index if it is wide enough */
+  rapidjson::Value::MemberIterator FindIndexedMember(rapidjson::Value &object,
+                                                     const char *name) const;
+
+  /* Text of a value of a lazy parse that is not parsed yet */
+  struct LazySection {
+    const char *m_text;
+    size_t m_length;
+  };
+
+  /* Add a member of a lazy parse to object. Objects and arrays are left null */
+  static bool AddLazyMember(rapidjson::Value &object, const char *text,
+                            const JsonSkipEntry &entry,
+                            AllocatorType &allocator);
+
+  /* Parse value if it is a lazy section. False if it fails */
+  bool LoadLazy(rapidjson::Value &value) const;
+
+  /* Parse every lazy section left, the ones that fail are left null */
+  void LoadAllLazy() const;
+
+  /* Writer used by Compile */
+  using CompactWriter = typename rapidjson::Writer<
+      /* typename OutputStream */ rapidjson::StringBuffer,
+      /* typename SourceEncoding */ rapidjson::UTF8<>,
+      /* typename TargetEncoding */ rapidjson::UTF8<>,
+      /* typename Allocator */ rapidjson::CrtAllocator,
+      /* unsigned writeFlags */ rapidjson::kWriteNanAndInfFlag>;
+
+  /* Memory of a spliced child, values of the document point into it */
+  struct SplicedMemory {
+    std::unique_ptr<char[]> m_arena;
+    std::unique_ptr<AllocatorType> m_allocator;
+    rapidjson::Document m_document;
+  };
+
+  /* Drop every value and reset the arena, growing it if it is owned */
+  void ResetArena();
+
+  /* Store the values in a new owned arena of size bytes */
+  void BuildArena(size_t size);
+
+  /*
+  Forget the hash indexes. Writing might move values, so they can't be kept.
+  Lazy sections are found by address too, so they are parsed first
+  */
+  inline void InvalidateLookups() {
+    InvalidatePaths();
+    if (!m_lazySections.empty()) {
+      LoadAllLazy();
+    }
+    if (!m_memberIndexes.empty()) {
+      m_memberIndexes.clear();
+    }
+  }
+
+  /* Forget the hash indexes and the lazy sections, every value is dropped */
+  inline void ResetLookups() {
+    InvalidatePaths();
+    if (!m_memberIndexes.empty()) {
+      m_memberIndexes.clear();
+    }
+    m_lazySections.clear();
+  }
+
+  /* The values changed, paths must be resolved again */
+  inline void InvalidatePaths() {
+    if (!m_pathMembers.empty()) {
+      m_pathMembers.clear();
+    }
+    if (m_pathResolved) {
+      m_pathGeneration = PathQuery::NextGeneration();
+      m_pathResolved = false;
+    }
+  }
+
+  /*
+  Where path leads: the parent and the element if it is in an array or the
+  member if it is in an object
+  */
+  bool ResolvePath(const PathQuery &path, rapidjson::Value **parent,
+                   std::uintptr_t *element) const;
+
   /* Check if we are currently inside an array */
   bool IsInsideArray() const;
 
+  /* Name of a new member, copied to the arena */
+  rapidjson::Value MakeName(const char *name, s_size name_length);
+
+  /* Find the version of an entry. SetEntry puts it first, it is tried first */
+  static rapidjson::Value::MemberIterator FindVersion(rapidjson::Value &entry);
+
   /* Sets an entry of type T (Only primitives and no pointers)*/
   template <typename T>
   bool SetType(const char *name, s_size name_length, T value);
@@ -261,6 +557,15 @@ private:
   /* Get an entry of type T (Only primitives and no pointers)*/
   template <typename T> bool GetType(const char *name, T *result) const;
 
+  /* Sets an array of T at once (Only primitives and no pointers)*/
+  template <typename T>
+  bool SetTypeArray(const char *name, s_size name_length, const T *values,
+                    s_size size);
+
+  /* Gets an array of T at once (Only primitives and no pointers)*/
+  template <typename T>
+  bool GetTypeArray(const char *name, T *result, s_size size) const;
+
   /* Current Entry we are looking at. Used as a Stack */
   mutable std::vector<std::reference_wrapper<rapidjson::Value>> m_currentEntry;
 
@@ -276,9 +581,56 @@ private:
   /* Where we compile */
   rapidjson::StringBuffer m_buffer;
 
+  /* Memory of the spliced children. Declared before the document, which uses
+   * it */
+  std::vector<SplicedMemory> m_spliced;
+
+  /* Owned arena. Declared before the document, which uses it */
+  std::unique_ptr<char[]> m_arena;
+
+  /* Owned allocator. Declared before the document, which uses it */
+  std::unique_ptr<AllocatorType> m_allocator;
+
   /* Where we store the JSON structure */
   rapidjson::Document m_document;
 
+  /* If the arena is reset on Clear and Parse */
+  bool m_arenaReset = false;
+
+  /* If the arena can be rebuilt (it is not the user's) */
+  bool m_ownsArena = true;
+
+  /* Capacity of the owned arena when it was built */
+  size_t m_arenaCapacity = 0;
+
+  /* Times the arena was reset */
+  size_t m_arenaResets = 0;
+
+  /* Times the owned arena was rebuilt bigger */
+  size_t m_arenaGrowths = 0;
+
+  /* Hash indexes of the wide objects looked up since the last write */
+  mutable std::unordered_map<const rapidjson::Value *, MemberIndex>
+      m_memberIndexes;
+
+  /* Member count from which objects get a hash index */
+  s_size m_memberIndexThreshold = kDefaultMemberIndexThreshold;
+
+  /* Values of the last lazy parse that are still text */
+  mutable std::unordered_map<rapidjson::Value *, LazySection> m_lazySections;
+
+  /* Where the lazy sections are parsed to */
+  AllocatorType *m_lazyAllocator = nullptr;
+
+  /* Generation of the values, for the paths resolved in them */
+  std::uint64_t m_pathGeneration = PathQuery::NextGeneration();
+
+  /* If a path was resolved in the current generation */
+  mutable bool m_pathResolved = false;
+
+  /* Members of the open paths, dropped on any write. Used as a Stack */
+  mutable std::vector<PathMember> m_pathMembers;
+
   /* The name of the version entry */
   static constexpr char kVersionEntryName[] = "__VERSION__";
 
@@ -292,22 +644,75 @@ private:
 
 inline JsonSerializer::JsonSerializer() { Clear(); }
 
+inline JsonSerializer::JsonSerializer(AllocatorType *allocator)
+    : m_document(rapidjson::kObjectType, allocator), m_arenaReset(true),
+      m_ownsArena(false) {
+  Clear();
+}
+
+inline JsonSerializer::JsonSerializer(void *buffer, size_t size)
+    : m_allocator(std::make_unique<AllocatorType>(buffer, size)),
+      m_document(rapidjson::kObjectType, m_allocator.get()), m_arenaReset(true),
+      m_ownsArena(false) {
+  Clear();
+}
+
 inline bool JsonSerializer::ParseText(const char *text) {
-  return !m_document.Parse<rapidjson::kParseNanAndInfFlag>(text)
-              .HasParseError();
+  ResetLookups();
+  if (m_arenaReset) {
+    ResetArena();
+  }
+  const bool parsed =
+      !m_document.Parse<rapidjson::kParseNanAndInfFlag>(text).HasParseError();
+  m_spliced.clear();
+  return parsed;
 }
 
 inline bool JsonSerializer::ParseText(const char *text, size_t length) {
-  return !m_document.Parse<rapidjson::kParseNanAndInfFlag>(text, length)
-              .HasParseError();
+  ResetLookups();
+  if (m_arenaReset) {
+    ResetArena();
+  }
+  const bool parsed =
+      !m_document.Parse<rapidjson::kParseNanAndInfFlag>(text, length)
+           .HasParseError();
+  m_spliced.clear();
+  return parsed;
+}
+
+inline bool JsonSerializer::ParseInsitu(char *buffer) {
+  ResetLookups();
+  if (m_arenaReset) {
+    ResetArena();
+  }
+  const bool parsed =
+      !m_document.ParseInsitu<rapidjson::kParseNanAndInfFlag>(buffer)
+           .HasParseError();
+  m_spliced.clear();
+  return parsed;
+}
+
+inline bool JsonSerializer::ParseInsitu(char *buffer, size_t length) {
+  buffer[length] = '\0';
+  return ParseInsitu(buffer);
 }
 
 inline bool JsonSerializer::IsInsideArray() const {
   return !m_currentArray.empty() && m_currentDepth == m_currentArray.back();
 }
 
+inline rapidjson::Value JsonSerializer::MakeName(const char *name,
+                                                 s_size name_length) {
+  const rapidjson::SizeType length =
+      static_cast<rapidjson::SizeType>(name_length);
+
+  return rapidjson::Value(name, length, m_document.GetAllocator());
+}
+
 template <typename T>
 bool JsonSerializer::SetType(const char *name, s_size name_length, T value) {
+  InvalidateLookups();
+
   rapidjson::Document::AllocatorType &allocator = m_document.GetAllocator();
   rapidjson::Value val(value);
 
@@ -319,9 +724,7 @@ bool JsonSerializer::SetType(const char *name, s_size name_length, T value) {
   }
   // We are in a normal entry
   else {
-    rapidjson::Value nameKey(name,
-                             static_cast<rapidjson::SizeType>(name_length),
-                             allocator); // copy string name
+    rapidjson::Value nameKey = MakeName(name, name_length);
 
     current.AddMember(nameKey.Move(), val.Move(), allocator);
   }
@@ -340,7 +743,7 @@ template <typename T> bool JsonSerializer::IsType(const char *name) const {
   else {
     rapidjson::Value &current = m_currentEntry.back().get();
 
-    rapidjson::Value::MemberIterator iter = current.FindMember(name);
+    rapidjson::Value::MemberIterator iter = FindMember(current, name);
 
     if (iter == current.MemberEnd()) {
       return false;
@@ -362,7 +765,7 @@ bool JsonSerializer::GetType(const char *name, T *result) const {
   else {
     rapidjson::Value &current = m_currentEntry.back().get();
 
-    rapidjson::Value::MemberIterator iter = current.FindMember(name);
+    rapidjson::Value::MemberIterator iter = FindMember(current, name);
 
     if (iter == current.MemberEnd()) {
       return false;
@@ -374,6 +777,84 @@ bool JsonSerializer::GetType(const char *name, T *result) const {
   return true;
 }
 
+template <typename T>
+bool JsonSerializer::SetTypeArray(const char *name, s_size name_length,
+                                  const T *values, s_size size) {
+  InvalidateLookups();
+
+  rapidjson::Document::AllocatorType &allocator = m_document.GetAllocator();
+  rapidjson::Value array(rapidjson::kArrayType);
+
+  // Filled in one pass, without going through the cursors
+  array.Reserve(static_cast<rapidjson::SizeType>(size), allocator);
+  for (s_size i = 0; i < size; ++i) {
+    array.PushBack(rapidjson::Value(values[i]).Move(), allocator);
+  }
+
+  rapidjson::Value &current = m_currentEntry.back().get();
+
+  // We are inside an array
+  if (IsInsideArray()) {
+    current.PushBack(array.Move(), allocator);
+  }
+  // We are in a normal entry
+  else {
+    rapidjson::Value nameKey = MakeName(name, name_length);
+
+    current.AddMember(nameKey.Move(), array.Move(), allocator);
+  }
+
+  return true;
+}
+
+template <typename T>
+bool JsonSerializer::GetTypeArray(const char *name, T *result,
+                                  s_size size) const {
+  const rapidjson::Value *array = nullptr;
+
+  // We are inside an array
+  if (IsInsideArray()) {
+    if (m_currentArrayIter.back() == m_currentEntry.back().get().End()) {
+      return false;
+    }
+
+    array = &*m_currentArrayIter.back();
+  }
+  // We are in a normal entry
+  else {
+    rapidjson::Value &current = m_currentEntry.back().get();
+
+    rapidjson::Value::MemberIterator iter = FindMember(current, name);
+
+    if (iter == current.MemberEnd()) {
+      return false;
+    }
+
+    array = &iter->value;
+  }
+
+  if (!array->IsArray() || array->Size() != size) {
+    return false;
+  }
+
+  for (rapidjson::SizeType i = 0; i < array->Size(); ++i) {
+    const rapidjson::Value &element = (*array)[i];
+
+    // Integers can be read as doubles
+    if constexpr (std::is_floating_point_v<T>) {
+      if (!element.IsNumber()) {
+        return false;
+      }
+    } else if (!element.Is<T>()) {
+      return false;
+    }
+
+    result[i] = element.Get<T>();
+  }
+
+  return true;
+}
+
 inline bool JsonSerializer::SetBool(const char *name, s_size name_length,
                                     bool value) {
   return SetType<bool>(name, name_length, value);
@@ -453,6 +934,67 @@ inline bool JsonSerializer::GetDouble(const char *name, double *result) const {
   return GetType<double>(name, result);
 }
 
+inline bool JsonSerializer::SetBoolArray(const char *name, s_size name_length,
+                                         const bool *values, s_size size) {
+  return SetTypeArray<bool>(name, name_length, values, size);
+}
+
+inline bool JsonSerializer::GetBoolArray(const char *name, bool *result,
+                                         s_size size) const {
+  return GetTypeArray<bool>(name, result, size);
+}
+
+inline bool JsonSerializer::SetUintArray(const char *name, s_size name_length,
+                                         const unsigned *values, s_size size) {
+  return SetTypeArray<unsigned>(name, name_length, values, size);
+}
+
+inline bool JsonSerializer::GetUintArray(const char *name, unsigned *result,
+                                         s_size size) const {
+  return GetTypeArray<unsigned>(name, result, size);
+}
+
+inline bool JsonSerializer::SetIntArray(const char *name, s_size name_length,
+                                        const int *values, s_size size) {
+  return SetTypeArray<int>(name, name_length, values, size);
+}
+
+inline bool JsonSerializer::GetIntArray(const char *name, int *result,
+                                        s_size size) const {
+  return GetTypeArray<int>(name, result, size);
+}
+
+inline bool JsonSerializer::SetUint64Array(const char *name, s_size name_length,
+                                           const uint64_t *values,
+                                           s_size size) {
+  return SetTypeArray<uint64_t>(name, name_length, values, size);
+}
+
+inline bool JsonSerializer::GetUint64Array(const char *name, uint64_t *result,
+                                           s_size size) const {
+  return GetTypeArray<uint64_t>(name, result, size);
+}
+
+inline bool JsonSerializer::SetInt64Array(const char *name, s_size name_length,
+                                          const int64_t *values, s_size size) {
+  return SetTypeArray<int64_t>(name, name_length, values, size);
+}
+
+inline bool JsonSerializer::GetInt64Array(const char *name, int64_t *result,
+                                          s_size size) const {
+  return GetTypeArray<int64_t>(name, result, size);
+}
+
+inline bool JsonSerializer::SetDoubleArray(const char *name, s_size name_length,
+                                           const double *values, s_size size) {
+  return SetTypeArray<double>(name, name_length, values, size);
+}
+
+inline bool JsonSerializer::GetDoubleArray(const char *name, double *result,
+                                           s_size size) const {
+  return GetTypeArray<double>(name, result, size);
+}
+
 inline bool JsonSerializer::IsString(const char *name) const {
   return IsType<const typename CharType *>(name);
 }
@@ -0,0 +1,36 @@
+#pragma once
+#ifndef JSON_SKIP_INDEX_HPP
+#define JSON_SKIP_INDEX_HPP 1
+
+#include <cstddef>
+#include <vector>
+
+namespace Serializer {
+/* Where a member of the first two levels of a JSON text is */
+struct JsonSkipEntry {
+  /* Name, without quotes */
+  size_t m_nameOffset = 0;
+  size_t m_nameLength = 0;
+  /* Value, from its first to its last character */
+  size_t m_valueOffset = 0;
+  size_t m_valueLength = 0;
+  /* Members of a first level object, they follow this entry */
+  size_t m_childCount = 0;
+  /* If the name has escapes, which are not decoded */
+  bool m_escapedName = false;
+};
+
+/*
+  Fast structural scan of a JSON text whose root is an object. It records the
+  members of the root and, for the ones that are objects, their members, in
+  order: each first level entry is followed by its children. Values are only
+  skipped (strings and nesting are tracked, nothing else is validated), so a
+  broken value is only found when it is parsed. False if the structure of the
+  first two levels is not valid
+*/
+bool BuildJsonSkipIndex(const char *text, size_t length,
+                        std::vector<JsonSkipEntry> *entries);
+
+} // namespace Serializer
+
+#endif // !JSON_SKIP_INDEX_HPP
@@ -0,0 +1,373 @@
+#pragma once
+#ifndef JSON_STREAM_SERIALIZER_HPP
+#define JSON_STREAM_SERIALIZER_HPP 1
+
+#include "rapidjson/writer.h"
+#include "serialization/json_serializer.hpp"
+#include "serialization/serializer.hpp"
+#include "serialization/sink.hpp"
+
+#include <type_traits>
+#include <vector>
+
+namespace Serializer {
+/*
+  Write only JSON Serializer. Instead of building a document, every Set call is
+  written right away to a sink (i.e. a File) through a fixed buffer, so large
+  dumps don't keep the whole text (or a DOM of it) in memory.
+  Compile finishes the text. There is nothing left to get or read, so GetSize,
+  GetLength, GetText, CompilePretty, ParseText and every Is/Get/Open call
+  return false. Clear starts a new text after the one already written
+*/
+class JsonStreamSerializer final : public ISerializer {
+public:
+  explicit JsonStreamSerializer(ISink &sink);
+  /* Move is not allowed because the writer points to the stream */
+  JsonStreamSerializer(JsonStreamSerializer &&) = delete;
+  /* Copy is not allowed because it doesn't make sense */
+  JsonStreamSerializer(const JsonStreamSerializer &) = delete;
+  /* Move is not allowed because the writer points to the stream */
+  JsonStreamSerializer &operator=(JsonStreamSerializer &&) = delete;
+  /* Copy is not allowed because it doesn't make sense */
+  JsonStreamSerializer &operator=(const JsonStreamSerializer &) = delete;
+  ~JsonStreamSerializer() = default;
+
+  /* Not supported */
+  bool ParseText(const char *text) final;
+  /* Not supported */
+  bool ParseText(const char *text, size_t length) final;
+  /* Start a new text. What was already written stays in the sink */
+  bool Clear() final;
+  /* Close what is left open and flush the sink */
+  bool Compile() final;
+  /* Not supported, the text is already written */
+  bool CompilePretty() final;
+  /* Not supported, the text is in the sink */
+  bool GetSize(s_size *size) final;
+  /* Not supported, the text is in the sink */
+  bool GetLength(s_size *length) final;
+  /* Not supported, the text is in the sink */
+  bool GetText(char *text) final;
+
+  /*
+  Open an space for a new entry with name and version. Length excludes null
+  terminator. If it is at the same level as an opened array, the name is not
+  used and the entry is appended to the array
+  */
+  bool SetEntry(const char *name, s_size name_length, s_size version) final;
+  /* Not supported */
+  bool OpenEntry(const char *name, s_size *version) const final;
+  /* Close an entry */
+  bool CloseEntry() const final;
+
+  /*
+  Sets a new bool. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetBool(const char *name, s_size name_length, bool value) final;
+  /* Not supported */
+  bool IsBool(const char *name) const final;
+  /* Not supported */
+  bool GetBool(const char *name, bool *result) const final;
+
+  /*
+  Sets a new unsigned entry. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetUint(const char *name, s_size name_length, unsigned value) final;
+  /* Not supported */
+  bool IsUint(const char *name) const final;
+  /* Not supported */
+  bool GetUint(const char *name, unsigned *result) const final;
+
+  /*
+  Sets a new int entry. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetInt(const char *name, s_size name_length, int value) final;
+  /* Not supported */
+  bool IsInt(const char *name) const final;
+  /* Not supported */
+  bool GetInt(const char *name, int *result) const final;
+
+  /*
+  Sets a new uint64_t entry. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetUint64(const char *name, s_size name_length, uint64_t value) final;
+  /* Not supported */
+  bool IsUint64(const char *name) const final;
+  /* Not supported */
+  bool GetUint64(const char *name, uint64_t *result) const final;
+
+  /*
+  Sets a new int64_t entry. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetInt64(const char *name, s_size name_length, int64_t value) final;
+  /* Not supported */
+  bool IsInt64(const char *name) const final;
+  /* Not supported */
+  bool GetInt64(const char *name, int64_t *result) const final;
+
+  /*
+  Sets a new double entry. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetDouble(const char *name, s_size name_length, double value) final;
+  /* Not supported */
+  bool IsDouble(const char *name) const final;
+  /* Not supported */
+  bool GetDouble(const char *name, double *result) const final;
+
+  /*
+  Sets a new string entry. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetString(const char *name, s_size name_length, const char *value,
+                 s_size length) final;
+  /* Not supported */
+  bool IsString(const char *name) const final;
+  /* Not supported */
+  bool GetStringLength(const char *name, s_size *result) const final;
+  /* Not supported */
+  bool GetStringSize(const char *name, s_size *result) const final;
+  /* Not supported */
+  bool GetString(const char *name, char *result) const final;
+
+  /*
+  Sets a new null entry. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetNull(const char *name, s_size name_length) final;
+  /* Not supported */
+  bool IsNull(const char *name) const final;
+
+  /*
+  Sets a new array entry. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetArray(const char *name, s_size name_length) final;
+  /* Nothing to reserve, elements are written as they come */
+  bool ReserveArray(const char *name, s_size size) final;
+  /* Not supported */
+  bool IsArray(const char *name) const final;
+  /* Not supported */
+  bool OpenArray(const char *name) const final;
+  /* Not supported */
+  bool GetArrayCapacity(const char *name, s_size *size) const final;
+  /* Not supported */
+  bool CanMoveArray() const final;
+  /* Not supported */
+  bool MoveArray() const final;
+  /* Close an array entry */
+  bool CloseArray() const final;
+
+  /* Sets a new array of size bools at once */
+  bool SetBoolArray(const char *name, s_size name_length, const bool *values,
+                    s_size size) final;
+  /* Sets a new array of size unsigneds at once */
+  bool SetUintArray(const char *name, s_size name_length,
+                    const unsigned *values, s_size size) final;
+  /* Sets a new array of size ints at once */
+  bool SetIntArray(const char *name, s_size name_length, const int *values,
+                   s_size size) final;
+  /* Sets a new array of size uint64_t at once */
+  bool SetUint64Array(const char *name, s_size name_length,
+                      const uint64_t *values, s_size size) final;
+  /* Sets a new array of size int64_t at once */
+  bool SetInt64Array(const char *name, s_size name_length,
+                     const int64_t *values, s_size size) final;
+  /* Sets a new array of size doubles at once */
+  bool SetDoubleArray(const char *name, s_size name_length,
+                      const double *values, s_size size) final;
+
+  /*
+  Write fragments compiled by JsonSerializer::CompileFragments, in order, as
+  members of the current entry. If it is at the same level as an opened array,
+  the names are not used and they are appended to the array
+  */
+  bool Splice(const std::vector<JsonSerializer::Fragment> &fragments);
+
+private:
+  /* What is open. Used as a Stack */
+  enum class Scope : unsigned char { kEntry, kArray };
+
+  /* Writer used */
+  using Writer = typename rapidjson::Writer<
+      /* typename OutputStream */ JsonSinkStream,
+      /* typename SourceEncoding */ rapidjson::UTF8<>,
+      /* typename TargetEncoding */ rapidjson::UTF8<>,
+      /* typename Allocator */ rapidjson::CrtAllocator,
+      /* unsigned writeFlags */ rapidjson::kWriteNanAndInfFlag>;
+
+  /* Check if we are currently inside an array */
+  bool IsInsideArray() const;
+
+  /* Write the name of the next value, unless we are inside an array */
+  bool WriteName(const char *name, s_size name_length);
+
+  /* Close the innermost scope if it is of type scope */
+  bool CloseScope(Scope scope) const;
+
+  /* Write a primitive (Only primitives and no pointers) */
+  template <typename T> bool WriteValue(T value);
+
+  /* Sets an array of T at once (Only primitives and no pointers)*/
+  template <typename T>
+  bool SetTypeArray(const char *name, s_size name_length, const T *values,
+                    s_size size);
+
+  /* Where the text ends */
+  ISink *m_sink;
+
+  /* Where we write to */
+  JsonSinkStream m_stream;
+
+  /*
+    Closing is const in the interface, but here it writes, so the writer and
+    what is open are mutable
+  */
+  mutable Writer m_writer;
+
+  /* What is open. Used as a Stack */
+  mutable std::vector<Scope> m_scopes;
+
+  /* If the text was finished by Compile */
+  bool m_finished = false;
+
+  /* The name of the version entry */
+  static constexpr char kVersionEntryName[] = "__VERSION__";
+
+  /* Length of the name of the version entry, excluding null terminator */
+  static constexpr s_size kVersionEntryNameLength =
+      sizeof(kVersionEntryName) - 1;
+};
+
+inline bool JsonStreamSerializer::IsInsideArray() const {
+  return !m_scopes.empty() && m_scopes.back() == Scope::kArray;
+}
+
+template <typename T> bool JsonStreamSerializer::WriteValue(T value) {
+  static_assert(std::is_arithmetic_v<T>, "Only primitives are supported");
+
+  if constexpr (std::is_same_v<T, bool>) {
+    return m_writer.Bool(value);
+  } else if constexpr (std::is_floating_point_v<T>) {
+    return m_writer.Double(value);
+  } else if constexpr (std::is_same_v<T, unsigned>) {
+    return m_writer.Uint(value);
+  } else if constexpr (std::is_same_v<T, int>) {
+    return m_writer.Int(value);
+  } else if constexpr (std::is_signed_v<T>) {
+    return m_writer.Int64(value);
+  } else {
+    return m_writer.Uint64(value);
+  }
+}
+
+template <typename T>
+bool JsonStreamSerializer::SetTypeArray(const char *name, s_size name_length,
+                                        const T *values, s_size size) {
+  if (!WriteName(name, name_length) || !m_writer.StartArray()) {
+    return false;
+  }
+
+  // Written right away, there is no scope to keep for it
+  bool res = true;
+  for (s_size i = 0; res && i < size; ++i) {
+    res = WriteValue<T>(values[i]);
+  }
+
+  return m_writer.EndArray() && res;
+}
+
+inline bool JsonStreamSerializer::SetBool(const char *name, s_size name_length,
+                                          bool value) {
+  return WriteName(name, name_length) && m_writer.Bool(value);
+}
+
+inline bool JsonStreamSerializer::SetUint(const char *name, s_size name_length,
+                                          unsigned value) {
+  return WriteName(name, name_length) && m_writer.Uint(value);
+}
+
+inline bool JsonStreamSerializer::SetInt(const char *name, s_size name_length,
+                                         int value) {
+  return WriteName(name, name_length) && m_writer.Int(value);
+}
+
+inline bool JsonStreamSerializer::SetUint64(const char *name,
+                                            s_size name_length,
+                                            uint64_t value) {
+  return WriteName(name, name_length) && m_writer.Uint64(value);
+}
+
+inline bool JsonStreamSerializer::SetInt64(const char *name,
+                                           s_size name_length, int64_t value) {
+  return WriteName(name, name_length) && m_writer.Int64(value);
+}
+
+inline bool JsonStreamSerializer::SetDouble(const char *name,
+                                            s_size name_length, double value) {
+  return WriteName(name, name_length) && m_writer.Double(value);
+}
+
+inline bool JsonStreamSerializer::SetNull(const char *name,
+                                          s_size name_length) {
+  return WriteName(name, name_length) && m_writer.Null();
+}
+
+inline bool JsonStreamSerializer::SetBoolArray(const char *name,
+                                               s_size name_length,
+                                               const bool *values,
+                                               s_size size) {
+  return SetTypeArray<bool>(name, name_length, values, size);
+}
+
+inline bool JsonStreamSerializer::SetUintArray(const char *name,
+                                               s_size name_length,
+                                               const unsigned *values,
+                                               s_size size) {
+  return SetTypeArray<unsigned>(name, name_length, values, size);
+}
+
+inline bool JsonStreamSerializer::SetIntArray(const char *name,
+                                              s_size name_length,
+                                              const int *values, s_size size) {
+  return SetTypeArray<int>(name, name_length, values, size);
+}
+
+inline bool JsonStreamSerializer::SetUint64Array(const char *name,
+                                                 s_size name_length,
+                                                 const uint64_t *values,
+                                                 s_size size) {
+  return SetTypeArray<uint64_t>(name, name_length, values, size);
+}
+
+inline bool JsonStreamSerializer::SetInt64Array(const char *name,
+                                                s_size name_length,
+                                                const int64_t *values,
+                                                s_size size) {
+  return SetTypeArray<int64_t>(name, name_length, values, size);
+}
+
+inline bool JsonStreamSerializer::SetDoubleArray(const char *name,
+                                                 s_size name_length,
+                                                 const double *values,
+                                                 s_size size) {
+  return SetTypeArray<double>(name, name_length, values, size);
+}
+
+} // namespace Serializer
+
+#endif // !JSON_STREAM_SERIALIZER_HPP
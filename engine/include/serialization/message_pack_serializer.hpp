@@ -0,0 +1,132 @@
+#pragma once
+#ifndef MESSAGE_PACK_SERIALIZER_HPP
+#define MESSAGE_PACK_SERIALIZER_HPP 1
+
+#include "serialization/serializer.hpp"
+#include "serialization/tree_serializer.hpp"
+
+#include <cstdint>
+
+namespace Serializer {
+/*
+  MessagePack Serializer (https://msgpack.org/).
+  The root is a map of the root entries. Entries are maps whose first member
+  is the version, named like the JSON one (__VERSION__), arrays are arrays,
+  strings str, blobs bin and doubles float 64. Integers take the smallest
+  encoding that holds them. Any MessagePack map with string keys can be
+  parsed: maps without version are entries of version 0, float 32 is read as
+  a double and extension types are not supported. There is no text formatting,
+  so Compile and CompilePretty give the same result
+*/
+class MessagePackSerializer final : public TreeSerializer {
+public:
+  MessagePackSerializer() = default;
+  MessagePackSerializer(MessagePackSerializer &&) = default;
+  /* Copy is not allowed because it doesn't make sense */
+  MessagePackSerializer(const MessagePackSerializer &) = delete;
+  MessagePackSerializer &operator=(MessagePackSerializer &&) = default;
+  /* Copy is not allowed because it doesn't make sense */
+  MessagePackSerializer &operator=(const MessagePackSerializer &) = delete;
+  ~MessagePackSerializer() = default;
+
+  /* Parse from Text. It ends with the root map, which must be valid */
+  bool ParseText(const char *text) final;
+  /* Parse from Text using length. It might include a null terminator */
+  bool ParseText(const char *text, size_t length) final;
+  /* Compile internals */
+  bool Compile() final;
+  /* Compile internals in a Pretty Format (same as Compile) */
+  bool CompilePretty() final;
+
+private:
+  /* Format bytes used */
+  enum Format : std::uint8_t {
+    kFormatFixMap = 0x80,
+    kFormatFixArray = 0x90,
+    kFormatFixStr = 0xA0,
+    kFormatNil = 0xC0,
+    kFormatFalse = 0xC2,
+    kFormatTrue = 0xC3,
+    kFormatBin8 = 0xC4,
+    kFormatBin16 = 0xC5,
+    kFormatBin32 = 0xC6,
+    kFormatFloat32 = 0xCA,
+    kFormatFloat64 = 0xCB,
+    kFormatUint8 = 0xCC,
+    kFormatUint16 = 0xCD,
+    kFormatUint32 = 0xCE,
+    kFormatUint64 = 0xCF,
+    kFormatInt8 = 0xD0,
+    kFormatInt16 = 0xD1,
+    kFormatInt32 = 0xD2,
+    kFormatInt64 = 0xD3,
+    kFormatStr8 = 0xD9,
+    kFormatStr16 = 0xDA,
+    kFormatStr32 = 0xDB,
+    kFormatArray16 = 0xDC,
+    kFormatArray32 = 0xDD,
+    kFormatMap16 = 0xDE,
+    kFormatMap32 = 0xDF,
+    kFormatNegativeFixInt = 0xE0,
+  };
+
+  /* Unread part of the text */
+  struct Reader {
+    const char *m_cursor;
+    size_t m_remaining;
+  };
+
+  /* Append size bytes of value, big endian */
+  void WriteBigEndian(std::uint64_t value, size_t size);
+
+  /* Append a format byte and the size bytes of value after it */
+  void WriteFormat(Format format, std::uint64_t value, size_t size);
+
+  /* Append an unsigned integer in its smallest encoding */
+  void WriteUint(std::uint64_t value);
+
+  /* Append a signed integer in its smallest encoding */
+  void WriteInt(std::int64_t value);
+
+  /* Append a string header and its bytes */
+  void WriteString(const char *text, std::uint32_t length);
+
+  /* Append the children of a node */
+  void WriteChildren(node_index parent, bool named);
+
+  /* Append a node value (not its name) */
+  void WriteValue(const Node &node, node_index index);
+
+  /* Read size bytes big endian */
+  static bool ReadBigEndian(Reader &reader, size_t size, std::uint64_t *value);
+
+  /* Read a string, which stays in the text */
+  static bool ReadString(Reader &reader, const char **text,
+                         std::uint32_t *length);
+
+  /*
+    Read count children into parent, which is nested depth times. Named ones
+    are the members of a map
+  */
+  bool ReadChildren(Reader &reader, std::uint64_t count, node_index parent,
+                    bool named, std::uint32_t depth);
+
+  /* Read the header of a map, the root can only be one */
+  static bool ReadMapSize(Reader &reader, std::uint64_t *count);
+
+  /*
+    Read a value into node. Arrays and maps only get their type and the count
+    of their children, which are read after
+  */
+  bool ReadValue(Reader &reader, Node &node, std::uint64_t *count);
+
+  /* Read the version at the start of a map, if it has one */
+  bool ReadVersion(Reader &reader, Node &node, std::uint64_t *count);
+
+  /* Parse the root map and what is after it */
+  bool Parse(const char *text, size_t length, bool exact);
+};
+
+} // namespace Serializer
+
+#endif // !MESSAGE_PACK_SERIALIZER_HPP
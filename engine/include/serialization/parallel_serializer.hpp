@@ -0,0 +1,148 @@
+#pragma once
+#ifndef PARALLEL_SERIALIZER_HPP
+#define PARALLEL_SERIALIZER_HPP 1
+
+#include "serialization/json_serializer.hpp"
+#include "serialization/json_stream_serializer.hpp"
+
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/*
+  Fork / Splice serialization of many independent items (i.e. every actor of a
+  level). The items are split in contiguous chunks, one per worker, each chunk
+  is filled into its own JsonSerializer on its own thread and the chunks are
+  spliced back into the target in order, so the result is the same as filling
+  the target item by item.
+  fill(JsonSerializer &child, size_t index) writes item index into child and
+  returns false if it fails. It runs concurrently for different indexes, so
+  everything it reads must be safe to read from several threads
+*/
+
+namespace Serializer {
+namespace Parallel {
+/* Workers used when 0 is asked, one per hardware thread */
+inline unsigned GetWorkers(unsigned workers) {
+  if (workers == 0) {
+    workers = std::max(1u, std::thread::hardware_concurrency());
+  }
+  return workers;
+}
+
+/* Number of chunks count items are split in */
+inline size_t GetChunkCount(size_t count, unsigned workers) {
+  return std::min(count, static_cast<size_t>(GetWorkers(workers)));
+}
+
+/*
+  Call work(chunk, begin, end) for every chunk of [0, count) on its own thread.
+  Chunk sizes differ at most by one
+*/
+template <class Work>
+std::vector<std::future<bool>> RunChunks(size_t count, size_t chunks,
+                                         Work &work) {
+  std::vector<std::future<bool>> futures;
+  futures.reserve(chunks);
+
+  size_t begin = 0;
+  for (size_t chunk = 0; chunk < chunks; ++chunk) {
+    const size_t end = begin + count / chunks + (chunk < count % chunks);
+
+    futures.push_back(
+        std::async(std::launch::async, [&work, chunk, begin, end]() {
+          return work(chunk, begin, end);
+        }));
+
+    begin = end;
+  }
+
+  return futures;
+}
+} // namespace Parallel
+
+/*
+  Fill count items into the current entry of target with fill, using up to
+  workers threads (0 for one per hardware thread). Inside an array the items
+  are appended and their names not used, as with any Set call
+*/
+template <class Fill>
+bool SerializeParallel(JsonSerializer &target, size_t count, Fill fill,
+                       unsigned workers = 0) {
+  const size_t chunks = Parallel::GetChunkCount(count, workers);
+  if (chunks == 0) {
+    return true;
+  }
+
+  std::vector<std::unique_ptr<JsonSerializer>> children;
+  children.reserve(chunks);
+  for (size_t chunk = 0; chunk < chunks; ++chunk) {
+    children.push_back(target.Fork());
+  }
+
+  auto work = [&children, &fill](size_t chunk, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      if (!fill(*children[chunk], i)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  std::vector<std::future<bool>> futures =
+      Parallel::RunChunks(count, chunks, work);
+
+  // Every chunk must finish before returning, even after a failure
+  bool res = true;
+  for (size_t chunk = 0; chunk < chunks; ++chunk) {
+    res = futures[chunk].get() && res;
+    res = res && target.Splice(*children[chunk]);
+  }
+
+  return res;
+}
+
+/*
+  Same as above, but each chunk is also compiled on its own thread and the
+  stream only writes the finished text. Every chunk is kept in memory until
+  it is written
+*/
+template <class Fill>
+bool SerializeParallel(JsonStreamSerializer &target, size_t count, Fill fill,
+                       unsigned workers = 0) {
+  const size_t chunks = Parallel::GetChunkCount(count, workers);
+  if (chunks == 0) {
+    return true;
+  }
+
+  std::vector<std::vector<JsonSerializer::Fragment>> fragments(chunks);
+
+  auto work = [&fragments, &fill](size_t chunk, size_t begin, size_t end) {
+    JsonSerializer child;
+
+    for (size_t i = begin; i < end; ++i) {
+      if (!fill(child, i)) {
+        return false;
+      }
+    }
+    return child.CompileFragments(&fragments[chunk]);
+  };
+
+  std::vector<std::future<bool>> futures =
+      Parallel::RunChunks(count, chunks, work);
+
+  // Every chunk must finish before returning, even after a failure
+  bool res = true;
+  for (size_t chunk = 0; chunk < chunks; ++chunk) {
+    res = futures[chunk].get() && res;
+    res = res && target.Splice(fragments[chunk]);
+  }
+
+  return res;
+}
+
+} // namespace Serializer
+
+#endif // !PARALLEL_SERIALIZER_HPP
@@ -0,0 +1,85 @@
+#pragma once
+#ifndef PATH_QUERY_HPP
+#define PATH_QUERY_HPP 1
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Serializer {
+/*
+  A path to a value from the root of a document, compiled once and reused
+  (see ISerializer::OpenPath). The serializer it was last opened in keeps
+  where it leads until that document changes, so opening it again doesn't
+  look anything up. That makes it a cache: use one per thread
+*/
+class PathQuery {
+public:
+  /* Index of a step that is not a number */
+  static constexpr size_t kNoIndex = std::numeric_limits<size_t>::max();
+
+  /* A step of the path */
+  struct Step {
+    /* Member name, unescaped */
+    std::string m_name;
+    /* Element index when it is inside an array, kNoIndex if not a number */
+    size_t m_index = kNoIndex;
+  };
+
+  /*
+  Compile a path. "/a/b/0" is a JSON pointer (~0 is ~ and ~1 is /), any other
+  path is split at '/' and '.', like "a/b/0" or "a.b.0". Numbers are names
+  inside entries and indexes inside arrays. False if there are no steps or a
+  split path has an empty one
+  */
+  static bool Compile(std::string_view path, PathQuery *query);
+
+  /* Steps, from the root */
+  inline const std::vector<Step> &GetSteps() const { return m_steps; }
+
+  /* Name of the value, to read it after OpenPath */
+  inline const char *GetName() const { return m_steps.back().m_name.c_str(); }
+
+  /* A new generation of a document, never used by another one */
+  static std::uint64_t NextGeneration();
+
+  /*
+  Where the path led in owner when its document was at generation, the
+  parent of the value and the value itself (in whatever form owner keeps it)
+  */
+  inline bool GetResolved(const void *owner, std::uint64_t generation,
+                          std::uintptr_t *parent,
+                          std::uintptr_t *value) const {
+    if (m_owner != owner || m_generation != generation) {
+      return false;
+    }
+    *parent = m_parent;
+    *value = m_value;
+    return true;
+  }
+
+  /* Keep where the path led in owner at generation */
+  inline void SetResolved(const void *owner, std::uint64_t generation,
+                          std::uintptr_t parent, std::uintptr_t value) const {
+    m_owner = owner;
+    m_generation = generation;
+    m_parent = parent;
+    m_value = value;
+  }
+
+private:
+  std::vector<Step> m_steps;
+
+  /* Last place it was resolved */
+  mutable const void *m_owner = nullptr;
+  mutable std::uint64_t m_generation = 0;
+  mutable std::uintptr_t m_parent = 0;
+  mutable std::uintptr_t m_value = 0;
+};
+
+} // namespace Serializer
+
+#endif // !PATH_QUERY_HPP
@@ -0,0 +1,398 @@
+#pragma once
+#ifndef REFLECTION_HPP
+#define REFLECTION_HPP 1
+
+#include "serialization/serializer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+/*
+  Compile time field lists. A class describes its members once:
+
+    class Foo {
+    public:
+      int m_a;
+      std::vector<double> m_b;
+
+      REFLECT_FIELDS(0, REFLECT_FIELD(Foo, m_a), REFLECT_FIELD(Foo, m_b))
+    };
+
+  and SerializeReflected / DeserializeReflected write and read it through
+  any serializer. They are templates on the serializer type, so with a
+  concrete (final) serializer every Set/Get call can be inlined instead of
+  going through the ISerializer vtable.
+  Supported members: bool, integers, floating points, std::string,
+  std::vector of those, other reflected classes and std::unique_ptr to them
+  (null when empty). Vectors of int, unsigned, int64_t, uint64_t and double
+  use the bulk array calls, vectors of bytes (uint8_t or std::byte) are blobs
+*/
+
+namespace Serializer {
+/* A reflected member: its name and where it is in the class */
+template <class Class, typename Member> struct Field {
+  const char *m_name;
+  s_size m_nameLength;
+  Member Class::*m_member;
+};
+
+/* Make a Field, the name length is taken from the literal */
+template <class Class, typename Member, size_t N>
+constexpr Field<Class, Member> MakeField(const char (&name)[N],
+                                         Member Class::*member) {
+  return Field<Class, Member>{name, N - 1, member};
+}
+
+// Describe a member for REFLECT_FIELDS
+#define REFLECT_FIELD(Class, member)                                           \
+  ::Serializer::MakeField(GET_NAME(member), &Class::member)
+
+// Describe the version and the members of a class. Use it in a public section
+#define REFLECT_FIELDS(version, ...)                                           \
+  static constexpr ::Serializer::s_size kReflectedVersion = version;           \
+  static constexpr auto ReflectedFields() {                                    \
+    return std::make_tuple(__VA_ARGS__);                                       \
+  }
+
+namespace Reflection {
+template <class T, class = void> struct is_reflected : std::false_type {};
+
+template <class T>
+struct is_reflected<T, std::void_t<decltype(T::ReflectedFields())>>
+    : std::true_type {};
+
+template <class T> struct is_vector : std::false_type {};
+
+template <class T, class A>
+struct is_vector<std::vector<T, A>> : std::true_type {};
+
+template <class T> struct is_unique_ptr : std::false_type {};
+
+template <class T, class D>
+struct is_unique_ptr<std::unique_ptr<T, D>> : std::true_type {};
+
+/* Integer type an integer T is stored as */
+template <typename T>
+using wire_integer = std::conditional_t<
+    std::is_signed_v<T>,
+    std::conditional_t<(sizeof(T) <= sizeof(int)), int, int64_t>,
+    std::conditional_t<(sizeof(T) <= sizeof(unsigned)), unsigned, uint64_t>>;
+
+/* If a vector of T can use the bulk array calls */
+template <typename T>
+constexpr bool is_bulk_v =
+    std::is_same_v<T, double> ||
+    (std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+     std::is_same_v<T, wire_integer<T>>);
+
+/* If a vector of T is stored as a blob */
+template <typename T>
+constexpr bool is_blob_v =
+    std::is_same_v<T, std::uint8_t> || std::is_same_v<T, std::byte>;
+} // namespace Reflection
+
+template <class S, class T>
+bool SerializeReflected(S &serializer, const char *name, s_size name_length,
+                        const T &object);
+
+template <class S, class T>
+bool DeserializeReflected(const S &serializer, const char *name, T *object);
+
+/* Write a member value of type T */
+template <class S, typename T>
+bool WriteReflected(S &serializer, const char *name, s_size name_length,
+                    const T &value) {
+  if constexpr (std::is_same_v<T, bool>) {
+    return serializer.SetBool(name, name_length, value);
+  } else if constexpr (std::is_floating_point_v<T>) {
+    return serializer.SetDouble(name, name_length, static_cast<double>(value));
+  } else if constexpr (std::is_integral_v<T>) {
+    using wire = Reflection::wire_integer<T>;
+
+    if constexpr (std::is_same_v<wire, int>) {
+      return serializer.SetInt(name, name_length, static_cast<wire>(value));
+    } else if constexpr (std::is_same_v<wire, unsigned>) {
+      return serializer.SetUint(name, name_length, static_cast<wire>(value));
+    } else if constexpr (std::is_same_v<wire, int64_t>) {
+      return serializer.SetInt64(name, name_length, static_cast<wire>(value));
+    } else {
+      return serializer.SetUint64(name, name_length, static_cast<wire>(value));
+    }
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    return serializer.SetString(name, name_length, value.c_str(),
+                                value.length());
+  } else if constexpr (Reflection::is_vector<T>::value) {
+    using element = typename T::value_type;
+
+    if constexpr (Reflection::is_blob_v<element>) {
+      return serializer.SetBlob(name, name_length, value.data(), value.size());
+    } else if constexpr (std::is_same_v<element, double>) {
+      return serializer.SetDoubleArray(name, name_length, value.data(),
+                                       value.size());
+    } else if constexpr (std::is_same_v<element, int>) {
+      return serializer.SetIntArray(name, name_length, value.data(),
+                                    value.size());
+    } else if constexpr (std::is_same_v<element, unsigned>) {
+      return serializer.SetUintArray(name, name_length, value.data(),
+                                     value.size());
+    } else if constexpr (std::is_same_v<element, int64_t>) {
+      return serializer.SetInt64Array(name, name_length, value.data(),
+                                      value.size());
+    } else if constexpr (std::is_same_v<element, uint64_t>) {
+      return serializer.SetUint64Array(name, name_length, value.data(),
+                                       value.size());
+    } else {
+      if (!serializer.SetArray(name, name_length)) {
+        return false;
+      }
+
+      for (const auto &item : value) {
+        if (!WriteReflected(serializer, nullptr, 0, item)) {
+          return false;
+        }
+      }
+
+      return serializer.CloseArray();
+    }
+  } else if constexpr (Reflection::is_unique_ptr<T>::value) {
+    if (!value) {
+      return serializer.SetNull(name, name_length);
+    }
+    return WriteReflected(serializer, name, name_length, *value);
+  } else {
+    static_assert(Reflection::is_reflected<T>::value,
+                  "Members must be primitives, strings, vectors, reflected "
+                  "classes or unique_ptr to them");
+
+    return SerializeReflected(serializer, name, name_length, value);
+  }
+}
+
+/* Read a member value of type T */
+template <class S, typename T>
+bool ReadReflected(const S &serializer, const char *name, T *value) {
+  if constexpr (std::is_same_v<T, bool>) {
+    return serializer.GetBool(name, value);
+  } else if constexpr (std::is_floating_point_v<T>) {
+    double tmp;
+    if (!serializer.GetDouble(name, &tmp)) {
+      return false;
+    }
+    *value = static_cast<T>(tmp);
+    return true;
+  } else if constexpr (std::is_integral_v<T>) {
+    using wire = Reflection::wire_integer<T>;
+    wire tmp;
+    bool res;
+
+    if constexpr (std::is_same_v<wire, int>) {
+      res = serializer.GetInt(name, &tmp);
+    } else if constexpr (std::is_same_v<wire, unsigned>) {
+      res = serializer.GetUint(name, &tmp);
+    } else if constexpr (std::is_same_v<wire, int64_t>) {
+      res = serializer.GetInt64(name, &tmp);
+    } else {
+      res = serializer.GetUint64(name, &tmp);
+    }
+
+    if (!res) {
+      return false;
+    }
+
+    // Smaller integers must hold the value
+    if constexpr (!std::is_same_v<T, wire>) {
+      if (tmp > static_cast<wire>(std::numeric_limits<T>::max())) {
+        return false;
+      }
+      if constexpr (std::is_signed_v<T>) {
+        if (tmp < static_cast<wire>(std::numeric_limits<T>::min())) {
+          return false;
+        }
+      }
+    }
+
+    *value = static_cast<T>(tmp);
+    return true;
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    std::string_view view;
+    if (serializer.GetStringView(name, &view)) {
+      value->assign(view.data(), view.size());
+      return true;
+    }
+
+    s_size length;
+    if (!serializer.GetStringLength(name, &length)) {
+      return false;
+    }
+
+    std::unique_ptr<char[]> text(new char[length]);
+    if (!serializer.GetString(name, text.get())) {
+      return false;
+    }
+
+    value->assign(text.get(), length - 1);
+    return true;
+  } else if constexpr (Reflection::is_vector<T>::value) {
+    using element = typename T::value_type;
+
+    s_size size = 0;
+
+    if constexpr (Reflection::is_blob_v<element>) {
+      if (!serializer.GetBlobSize(name, &size)) {
+        return false;
+      }
+      value->resize(static_cast<size_t>(size));
+      return serializer.GetBlob(name, value->data(), size);
+    } else {
+      // Readers that can't count ahead (i.e. JsonPullSerializer) are walked
+      const bool counted = serializer.GetArrayCapacity(name, &size);
+
+      value->clear();
+
+      if constexpr (Reflection::is_bulk_v<element>) {
+        if (counted) {
+          value->resize(static_cast<size_t>(size));
+
+          if constexpr (std::is_same_v<element, double>) {
+            return serializer.GetDoubleArray(name, value->data(), size);
+          } else if constexpr (std::is_same_v<element, int>) {
+            return serializer.GetIntArray(name, value->data(), size);
+          } else if constexpr (std::is_same_v<element, unsigned>) {
+            return serializer.GetUintArray(name, value->data(), size);
+          } else if constexpr (std::is_same_v<element, int64_t>) {
+            return serializer.GetInt64Array(name, value->data(), size);
+          } else {
+            return serializer.GetUint64Array(name, value->data(), size);
+          }
+        }
+      }
+
+      if (!serializer.OpenArray(name)) {
+        return false;
+      }
+
+      if (counted) {
+        value->reserve(static_cast<size_t>(size));
+      }
+
+      bool res = true;
+      for (s_size i = 0;
+           res && (counted ? i < size : serializer.CanMoveArray()); ++i) {
+        element item{};
+        res = ReadReflected(serializer, nullptr, &item) &&
+              serializer.MoveArray();
+        value->push_back(std::move(item));
+      }
+
+      return serializer.CloseArray() && res;
+    }
+  } else if constexpr (Reflection::is_unique_ptr<T>::value) {
+    if (serializer.IsNull(name)) {
+      value->reset();
+      return true;
+    }
+
+    auto item = std::make_unique<typename T::element_type>();
+    if (!ReadReflected(serializer, name, item.get())) {
+      return false;
+    }
+
+    *value = std::move(item);
+    return true;
+  } else {
+    static_assert(Reflection::is_reflected<T>::value,
+                  "Members must be primitives, strings, vectors, reflected "
+                  "classes or unique_ptr to them");
+
+    return DeserializeReflected(serializer, name, value);
+  }
+}
+
+/* Write a reflected class as an entry with its version and members */
+template <class S, class T>
+bool SerializeReflected(S &serializer, const char *name, s_size name_length,
+                        const T &object) {
+  if (!serializer.SetEntry(name, name_length, T::kReflectedVersion)) {
+    return false;
+  }
+
+  const bool res = std::apply(
+      [&](const auto &...fields) {
+        return (WriteReflected(serializer, fields.m_name, fields.m_nameLength,
+                               object.*(fields.m_member)) &&
+                ...);
+      },
+      T::ReflectedFields());
+
+  return serializer.CloseEntry() && res;
+}
+
+/* Read a reflected class from an entry, it fails on another version */
+template <class S, class T>
+bool DeserializeReflected(const S &serializer, const char *name, T *object) {
+  s_size version;
+
+  if (!serializer.OpenEntry(name, &version)) {
+    return false;
+  }
+
+  bool res = version == T::kReflectedVersion;
+
+  if (res) {
+    res = std::apply(
+        [&](const auto &...fields) {
+          return (ReadReflected(serializer, fields.m_name,
+                                &(object->*(fields.m_member))) &&
+                  ...);
+        },
+        T::ReflectedFields());
+  }
+
+  return serializer.CloseEntry() && res;
+}
+
+/* Read a reflected class from an entry, nullptr if it fails */
+template <class T, class S>
+std::unique_ptr<T> DeserializeReflected(const S &serializer,
+                                        const char *name) {
+  std::unique_ptr<T> object = std::make_unique<T>();
+
+  if (!DeserializeReflected(serializer, name, object.get())) {
+    return nullptr;
+  }
+
+  return object;
+}
+
+/*
+  ISerializableImpl of a reflected class: Serialize and DeserializeInto come
+  from its REFLECT_FIELDS, through the ISerializer interface. Code that knows
+  the serializer type can call SerializeReflected directly instead
+*/
+template <class Derived>
+class ISerializableReflected : public ISerializableImpl<Derived> {
+public:
+  /* Serialize this class */
+  bool Serialize(ISerializer *serializer, const char *name,
+                 s_size name_length) override {
+    return SerializeReflected(*serializer, name, name_length,
+                              static_cast<const Derived &>(*this));
+  }
+
+  /* Deserialize into existing storage */
+  static bool DeserializeInto(const ISerializer *serializer, const char *name,
+                              Derived *object) {
+    return DeserializeReflected(*serializer, name, object);
+  }
+};
+
+} // namespace Serializer
+
+#endif // !REFLECTION_HPP
@@ -2,15 +2,24 @@
 #ifndef SERIALIZER_HPP
 #define SERIALIZER_HPP 1
 
+#include "utils/base64.hpp"
+
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace Serializer {
 /* Type for sizes (arrays, strings, etc...) */
 using s_size = typename std::string::size_type;
 
+class ISink;
+class PathQuery;
+
 /* Handle Serialization of Things */
 class ISerializer {
 public:
@@ -31,6 +40,17 @@ public:
   /* Put the compiled internals in a char array. It should have at least enough
    * space */
   virtual bool GetText(char *text) = 0;
+  /*
+  Get the compiled internals without copying them, excluding null terminator.
+  The view is only valid until the serializer changes. Not every serializer
+  can do it, the default returns false, use GetText then
+  */
+  virtual bool GetView(std::string_view *) const { return false; }
+  /*
+  Compile internals straight into sink, without GetText. Not every serializer
+  can do it, the default returns false
+  */
+  virtual bool CompileTo(ISink &) { return false; }
 
   /*
   Open an space for a new entry with name and version. Length excludes null
@@ -197,6 +217,16 @@ public:
   used and it gets the current opened entry is
   */
   virtual bool GetString(const char *name, char *result) const = 0;
+  /*
+  Gets the named or current string entry without copying it. The view is only
+  valid until the serializer changes. Not every serializer can do it, the
+  default returns false, use GetString then
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  virtual bool GetStringView(const char *, std::string_view *) const {
+    return false;
+  }
 
   /*
   Sets a new null entry. Length excludes null terminator.
@@ -243,8 +273,257 @@ public:
   /* Close an array entry */
   virtual bool CloseArray() const = 0;
 
+  /*
+  Sets a new array of size bools at once. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  virtual bool SetBoolArray(const char *name, s_size name_length,
+                            const bool *values, s_size size) {
+    return SetEachElement(name, name_length, values, size,
+                          &ISerializer::SetBool);
+  }
+  /*
+  Gets the named or current array of bools at once. It fails if the array
+  doesn't have exactly size elements of the type (see GetArrayCapacity)
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  virtual bool GetBoolArray(const char *name, bool *result,
+                            s_size size) const {
+    return GetEachElement(name, result, size, &ISerializer::GetBool);
+  }
+
+  /*
+  Sets a new array of size unsigneds at once. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  virtual bool SetUintArray(const char *name, s_size name_length,
+                            const unsigned *values, s_size size) {
+    return SetEachElement(name, name_length, values, size,
+                          &ISerializer::SetUint);
+  }
+  /*
+  Gets the named or current array of unsigneds at once. It fails if the array
+  doesn't have exactly size elements of the type (see GetArrayCapacity)
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  virtual bool GetUintArray(const char *name, unsigned *result,
+                            s_size size) const {
+    return GetEachElement(name, result, size, &ISerializer::GetUint);
+  }
+
+  /*
+  Sets a new array of size ints at once. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  virtual bool SetIntArray(const char *name, s_size name_length,
+                           const int *values, s_size size) {
+    return SetEachElement(name, name_length, values, size,
+                          &ISerializer::SetInt);
+  }
+  /*
+  Gets the named or current array of ints at once. It fails if the array
+  doesn't have exactly size elements of the type (see GetArrayCapacity)
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  virtual bool GetIntArray(const char *name, int *result,
+                           s_size size) const {
+    return GetEachElement(name, result, size, &ISerializer::GetInt);
+  }
+
+  /*
+  Sets a new array of size uint64_t at once. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  virtual bool SetUint64Array(const char *name, s_size name_length,
+                              const uint64_t *values, s_size size) {
+    return SetEachElement(name, name_length, values, size,
+                          &ISerializer::SetUint64);
+  }
+  /*
+  Gets the named or current array of uint64_t at once. It fails if the array
+  doesn't have exactly size elements of the type (see GetArrayCapacity)
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  virtual bool GetUint64Array(const char *name, uint64_t *result,
+                              s_size size) const {
+    return GetEachElement(name, result, size, &ISerializer::GetUint64);
+  }
+
+  /*
+  Sets a new array of size int64_t at once. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  virtual bool SetInt64Array(const char *name, s_size name_length,
+                             const int64_t *values, s_size size) {
+    return SetEachElement(name, name_length, values, size,
+                          &ISerializer::SetInt64);
+  }
+  /*
+  Gets the named or current array of int64_t at once. It fails if the array
+  doesn't have exactly size elements of the type (see GetArrayCapacity)
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  virtual bool GetInt64Array(const char *name, int64_t *result,
+                             s_size size) const {
+    return GetEachElement(name, result, size, &ISerializer::GetInt64);
+  }
+
+  /*
+  Sets a new array of size doubles at once. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  virtual bool SetDoubleArray(const char *name, s_size name_length,
+                              const double *values, s_size size) {
+    return SetEachElement(name, name_length, values, size,
+                          &ISerializer::SetDouble);
+  }
+  /*
+  Gets the named or current array of doubles at once. It fails if the array
+  doesn't have exactly size elements of the type (see GetArrayCapacity)
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  virtual bool GetDoubleArray(const char *name, double *result,
+                              s_size size) const {
+    return GetEachElement(name, result, size, &ISerializer::GetDouble);
+  }
+
+  /*
+  Sets a new blob (size raw bytes) entry. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array. The default stores it as a Base64 string
+  */
+  virtual bool SetBlob(const char *name, s_size name_length, const void *data,
+                       s_size size) {
+    std::string text(Base64::GetEncodedLength(size), '\0');
+    Base64::Encode(data, size, text.data());
+    return SetString(name, name_length, text.c_str(), text.length());
+  }
+  /*
+  Gets the size in bytes of the named or current blob entry
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  virtual bool GetBlobSize(const char *name, s_size *size) const {
+    std::string_view text;
+    std::string storage;
+    size_t decoded;
+
+    if (!GetBase64(name, &text, &storage) ||
+        !Base64::GetDecodedSize(text.data(), text.size(), &decoded)) {
+      return false;
+    }
+
+    *size = static_cast<s_size>(decoded);
+    return true;
+  }
+  /*
+  Gets the named or current blob entry. It fails if it doesn't have exactly
+  size bytes (see GetBlobSize)
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  virtual bool GetBlob(const char *name, void *result, s_size size) const {
+    std::string_view text;
+    std::string storage;
+    size_t decoded;
+
+    return GetBase64(name, &text, &storage) &&
+           Base64::GetDecodedSize(text.data(), text.size(), &decoded) &&
+           decoded == size && Base64::Decode(text.data(), text.size(), result);
+  }
+
+  /*
+  Open the parent of the value path leads to, from the root, like OpenEntry
+  or OpenArray do (moved to the element). The value is then read with the
+  usual calls using path.GetName(), which is not used for an array element.
+  False if the value is not there. Close it with ClosePath. Not every
+  serializer can do it, the default returns false
+  */
+  virtual bool OpenPath(const PathQuery &) const { return false; }
+  /* Close what OpenPath opened */
+  virtual bool ClosePath() const { return false; }
+
   /* Virtual Destructor */
   virtual ~ISerializer() = default;
+
+protected:
+  /*
+    Text of a Base64 string entry, used by the default blob calls. It is only
+    copied to storage when the serializer can't give a view
+  */
+  bool GetBase64(const char *name, std::string_view *text,
+                 std::string *storage) const {
+    if (GetStringView(name, text)) {
+      return true;
+    }
+
+    s_size length;
+    if (!GetStringLength(name, &length)) {
+      return false;
+    }
+
+    std::unique_ptr<char[]> buffer(new char[length]);
+    if (!GetString(name, buffer.get())) {
+      return false;
+    }
+
+    storage->assign(buffer.get(), length - 1);
+    *text = *storage;
+    return true;
+  }
+
+  /*
+    Default of the bulk Set calls, element by element. Serializers override
+    them to fill the array in one pass
+  */
+  template <typename T>
+  bool SetEachElement(const char *name, s_size name_length, const T *values,
+                      s_size size,
+                      bool (ISerializer::*set)(const char *, s_size, T)) {
+    if (!SetArray(name, name_length)) {
+      return false;
+    }
+
+    bool res = true;
+    for (s_size i = 0; res && i < size; ++i) {
+      res = (this->*set)(nullptr, 0, values[i]);
+    }
+
+    return CloseArray() && res;
+  }
+
+  /* Default of the bulk Get calls, element by element */
+  template <typename T>
+  bool GetEachElement(const char *name, T *result, s_size size,
+                      bool (ISerializer::*get)(const char *, T *) const) const {
+    // Readers that can't count ahead check the end after reading
+    s_size capacity;
+    const bool counted = GetArrayCapacity(name, &capacity);
+    if ((counted && capacity != size) || !OpenArray(name)) {
+      return false;
+    }
+
+    bool res = true;
+    for (s_size i = 0; res && i < size; ++i) {
+      res = (counted || CanMoveArray()) &&
+            (this->*get)(nullptr, result + i) && MoveArray();
+    }
+
+    const bool ended = counted || !CanMoveArray();
+    return CloseArray() && res && ended;
+  }
 };
 
 // Get the name of a variable as a string
@@ -265,6 +544,18 @@ public:
   virtual bool Serialize(ISerializer *serializer, const char *name,
                          s_size name_length) = 0;
 
+  /* Generation of objects that don't track their changes */
+  static constexpr std::uint64_t kUntrackedGeneration = 0;
+
+  /*
+    Generation of the current state, it changes every time the object does.
+    kUntrackedGeneration if it doesn't track its changes, so it is always
+    serialized again (see DirtyTracking and IncrementalSave)
+  */
+  virtual std::uint64_t GetSaveGeneration() const {
+    return kUntrackedGeneration;
+  }
+
   /* Deserialize */
   template <class T>
   static inline auto Deserialize(const Serializer::ISerializer *serializer,
@@ -282,8 +573,93 @@ inline auto Deserialize(const Serializer::ISerializer *serializer,
   return ISerializable::Deserialize<T>(serializer, name);
 }
 
+/* Deserialize a class into existing storage (i.e. a pool slot) */
+template <class T>
+inline bool DeserializeInto(const Serializer::ISerializer *serializer,
+                            const char *name, T *object) {
+  return T::DeserializeInto(serializer, name, object);
+}
+
+/*
+  Deserialize the named or current array into objects, one per element, with
+  T::DeserializeInto. The objects already there are reused, so the vector
+  allocates once (or never if it has the capacity) instead of once per object.
+  Arrays that can't be counted ahead grow as they are read
+*/
+template <class T>
+inline bool DeserializeArrayInto(const Serializer::ISerializer *serializer,
+                                 const char *name, std::vector<T> *objects) {
+  // Readers that can't count ahead (i.e. JsonPullSerializer) are walked
+  s_size size = 0;
+  const bool counted = serializer->GetArrayCapacity(name, &size);
+  if (!serializer->OpenArray(name)) {
+    return false;
+  }
+
+  if (counted) {
+    objects->resize(static_cast<size_t>(size));
+  }
+
+  bool res = true;
+  size_t i = 0;
+  for (; res && (counted ? i < objects->size() : serializer->CanMoveArray());
+       ++i) {
+    if (i == objects->size()) {
+      objects->emplace_back();
+    }
+    res = T::DeserializeInto(serializer, nullptr, &(*objects)[i]) &&
+          serializer->MoveArray();
+  }
+
+  objects->resize(i);
+  return serializer->CloseArray() && res;
+}
+
+/*
+  Opt in change tracking for an ISerializableImpl, derive from both. Call
+  MarkDirty after every change that must be saved, including changes of the
+  objects it serializes inside itself. Generations come from one global
+  counter, so an object is never confused with an older one at the same address
+*/
+class DirtyTracking {
+public:
+  /* The object changed since it was last saved */
+  inline void MarkDirty() { m_generation = NextGeneration(); }
+
+  /* Generation of the current state */
+  inline std::uint64_t GetGeneration() const { return m_generation; }
+
+protected:
+  DirtyTracking() : m_generation(NextGeneration()) {}
+  /* A copy is a new object, never saved */
+  DirtyTracking(const DirtyTracking &) : m_generation(NextGeneration()) {}
+  /* The state changed */
+  DirtyTracking &operator=(const DirtyTracking &) {
+    MarkDirty();
+    return *this;
+  }
+  ~DirtyTracking() = default;
+
+private:
+  /* Next generation of any object, never kUntrackedGeneration */
+  static std::uint64_t NextGeneration() {
+    static std::atomic<std::uint64_t> s_generation{
+        ISerializable::kUntrackedGeneration};
+    return ++s_generation;
+  }
+
+  std::uint64_t m_generation;
+};
+
 /*
   Handle Serialization Checking
+  Derived deserializes with one of:
+    static std::unique_ptr<Derived> Deserialize(const ISerializer *serializer,
+                                                const char *name);
+    static bool DeserializeInto(const ISerializer *serializer,
+                                const char *name, Derived *object);
+  The second fills storage the caller already has (a pool slot, an element of
+  a vector, etc...), and Deserialize is then made from it
   Note: This uses a non trivial Destructor, don't use with implicit functions
   (i.e implicit move semantics), use explicit ones (PS. its a good practice)
 */
@@ -294,26 +670,79 @@ private:
   template <class T, class D>
   struct is_unique_ptr<std::unique_ptr<T, D>> : std::true_type {};
 
+  template <class T, class = void>
+  struct has_deserialize_into : std::false_type {};
+
+  template <class T>
+  struct has_deserialize_into<
+      T, std::void_t<decltype(T::DeserializeInto(
+             std::declval<const Serializer::ISerializer *>(),
+             std::declval<const char *>(), std::declval<T *>()))>>
+      : std::true_type {};
+
+  // The inherited Deserialize is a template, so only one of Derived is found
+  template <class T, class = void>
+  struct has_own_deserialize : std::false_type {};
+
+  template <class T>
+  struct has_own_deserialize<T, std::void_t<decltype(&T::Deserialize)>>
+      : std::true_type {};
+
 public:
+  /*
+    Deserialize into a new object with Derived::DeserializeInto. A Deserialize
+    of Derived hides it
+  */
+  template <class T = Derived>
+  static std::unique_ptr<T>
+  Deserialize(const Serializer::ISerializer *serializer, const char *name) {
+    static_assert(has_deserialize_into<T>::value,
+                  "Couldn't find a Deserialize or a DeserializeInto function");
+
+    std::unique_ptr<T> object = std::make_unique<T>();
+
+    if (!T::DeserializeInto(serializer, name, object.get())) {
+      return nullptr;
+    }
+
+    return object;
+  }
+
+  /* Generation of Derived if it uses DirtyTracking */
+  std::uint64_t GetSaveGeneration() const override {
+    if constexpr (std::is_base_of_v<DirtyTracking, Derived>) {
+      return static_cast<const Derived *>(this)->GetGeneration();
+    } else {
+      return ISerializable::GetSaveGeneration();
+    }
+  }
+
   virtual ~ISerializableImpl() {
+    static_assert(has_deserialize_into<Derived>::value ||
+                      has_own_deserialize<Derived>::value,
+                  "Couldn't find a Deserialize or a DeserializeInto function");
 
-    // This is used to get the return type of the function only for C++17
-    // God forgive you if you are using older standards
-    using derived_decltype = std::remove_cv_t<
-        std::invoke_result_t<decltype(&Derived::Deserialize),
-                             const Serializer::ISerializer *, const char *>>;
+    // The inherited one is already right
+    if constexpr (has_own_deserialize<Derived>::value) {
+      // This is used to get the return type of the function only for C++17
+      // God forgive you if you are using older standards
+      using derived_decltype = std::remove_cv_t<
+          std::invoke_result_t<decltype(&Derived::Deserialize),
+                               const Serializer::ISerializer *, const char *>>;
 
-    static_assert(
-        is_unique_ptr<derived_decltype>()
-        /* && std::is_same_v<derived_function_ptr, expected_function_ptr> */,
-        "Couldn't find a Deserialize function that returns a std::unique_ptr");
+      static_assert(
+          is_unique_ptr<derived_decltype>()
+          /* && std::is_same_v<derived_function_ptr, expected_function_ptr> */,
+          "Couldn't find a Deserialize function that returns a "
+          "std::unique_ptr");
 
-    using derived_decltype_element = typename std::remove_all_extents_t<
-        typename std::remove_cv_t<typename derived_decltype::element_type>>;
+      using derived_decltype_element = typename std::remove_all_extents_t<
+          typename std::remove_cv_t<typename derived_decltype::element_type>>;
 
-    static_assert(std::is_same_v<derived_decltype_element, Derived>,
-                  "The Serialization function does not return a unique_ptr of "
-                  "the Serialized Type");
+      static_assert(std::is_same_v<derived_decltype_element, Derived>,
+                    "The Serialization function does not return a unique_ptr "
+                    "of the Serialized Type");
+    }
   }
 };
 
@@ -0,0 +1,34 @@
+#pragma once
+#ifndef SERIALIZER_FACTORY_HPP
+#define SERIALIZER_FACTORY_HPP 1
+
+#include "serialization/serializer.hpp"
+
+#include <memory>
+#include <string_view>
+
+namespace Serializer {
+/* Encodings a serializer can be created for at runtime */
+enum class SerializerFormat {
+  /* JsonSerializer */
+  kJson,
+  /* BinarySerializer */
+  kBinary,
+  /* MessagePackSerializer */
+  kMessagePack,
+  /* FlatSerializer */
+  kFlat,
+};
+
+/*
+  Get the format named name ("json", "binary", "msgpack" or "flat"), i.e. from
+  a config file or the command line. False if there is no format with that name
+*/
+bool GetSerializerFormat(std::string_view name, SerializerFormat *format);
+
+/* Create an empty serializer of the format */
+std::unique_ptr<ISerializer> CreateSerializer(SerializerFormat format);
+
+} // namespace Serializer
+
+#endif // !SERIALIZER_FACTORY_HPP
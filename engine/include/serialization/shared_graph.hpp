@@ -0,0 +1,216 @@
+#pragma once
+#ifndef SHARED_GRAPH_HPP
+#define SHARED_GRAPH_HPP 1
+
+#include "serialization/serializer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+namespace Serializer {
+/* Version of the entry of an object written by SharedWriter */
+constexpr s_size kSharedVersion = 1;
+/* Member with the ID of an object */
+constexpr char kSharedIdName[] = "__ID__";
+/* Member with the object itself */
+constexpr char kSharedObjectName[] = "__OBJECT__";
+
+/*
+  Writes objects shared by several pointers once. The first time an object is
+  set it is an entry with its ID (__ID__) and the object (__OBJECT__), after
+  that only its ID is set, as an uint64. Cycles are written, an object is an
+  ID inside itself, but once read a cycle of std::shared_ptr never frees, so
+  back links should be std::weak_ptr, which SetShared and GetShared take too.
+  While it exists SetShared uses it on this thread, so objects find it from
+  their Serialize. Keep one for a whole document, IDs are only unique in it
+*/
+class SharedWriter {
+public:
+  SharedWriter();
+  /* Copy is not allowed because it doesn't make sense */
+  SharedWriter(const SharedWriter &) = delete;
+  /* Copy is not allowed because it doesn't make sense */
+  SharedWriter &operator=(const SharedWriter &) = delete;
+  ~SharedWriter();
+
+  /* Set object as name, null if there is no object */
+  bool Set(ISerializer *serializer, const char *name, s_size name_length,
+           ISerializable *object);
+
+  /* Objects written */
+  inline size_t GetObjectCount() const { return m_ids.size(); }
+
+  /* Writer of this thread, nullptr if there is none */
+  static SharedWriter *GetCurrent();
+
+private:
+  std::unordered_map<const ISerializable *, std::uint64_t> m_ids;
+  SharedWriter *m_previous;
+};
+
+/*
+  Reads what SharedWriter wrote. Each object is created once, with
+  T::DeserializeInto, and every pointer to it shares it. An ID read before its
+  object (i.e. the members were read in another order than written) is kept
+  and fixed in Resolve, so the pointers it fills must not move until then.
+  Every object is kept until the reader is destroyed, after that an object
+  that only std::weak_ptr point to expires. While it exists GetShared uses it
+  on this thread
+*/
+class SharedReader {
+public:
+  SharedReader();
+  /* Copy is not allowed because it doesn't make sense */
+  SharedReader(const SharedReader &) = delete;
+  /* Copy is not allowed because it doesn't make sense */
+  SharedReader &operator=(const SharedReader &) = delete;
+  ~SharedReader();
+
+  /* Get the named or current object into object, which might wait Resolve */
+  template <class T>
+  bool Get(const ISerializer *serializer, const char *name,
+           std::shared_ptr<T> *object);
+
+  /* Get the named or current object into a weak object */
+  template <class T>
+  bool Get(const ISerializer *serializer, const char *name,
+           std::weak_ptr<T> *object);
+
+  /*
+  Fill the pointers whose object was read after them. False if an object was
+  never read or has another type
+  */
+  bool Resolve();
+
+  /* Objects read */
+  inline size_t GetObjectCount() const { return m_objects.size(); }
+
+  /* Reader of this thread, nullptr if there is none */
+  static SharedReader *GetCurrent();
+
+private:
+  /* Sets a std::shared_ptr<T> or std::weak_ptr<T> from the object */
+  using Setter = void (*)(void *target, const std::shared_ptr<void> &object);
+
+  /* An object read and its type */
+  struct Object {
+    std::shared_ptr<void> m_object;
+    const std::type_info *m_type;
+  };
+
+  /* A pointer read before its object */
+  struct Fixup {
+    std::uint64_t m_id;
+    const std::type_info *m_type;
+    void *m_target;
+    Setter m_setter;
+  };
+
+  template <class T, class Pointer>
+  static void SetObject(void *target, const std::shared_ptr<void> &object) {
+    *static_cast<Pointer *>(target) = std::static_pointer_cast<T>(object);
+  }
+
+  /* Add an object, false if its ID was already read */
+  bool Register(std::uint64_t id, const std::type_info &type,
+                std::shared_ptr<void> object);
+
+  /* Set target to the object with id now, or in Resolve */
+  bool Link(std::uint64_t id, const std::type_info &type, void *target,
+            Setter setter);
+
+  std::unordered_map<std::uint64_t, Object> m_objects;
+  std::vector<Fixup> m_fixups;
+  SharedReader *m_previous;
+};
+
+template <class T>
+bool SharedReader::Get(const ISerializer *serializer, const char *name,
+                       std::shared_ptr<T> *object) {
+  if (serializer->IsNull(name)) {
+    object->reset();
+    return true;
+  }
+
+  std::uint64_t id;
+
+  if (serializer->IsUint64(name)) {
+    return serializer->GetUint64(name, &id) &&
+           Link(id, typeid(T), object, &SetObject<T, std::shared_ptr<T>>);
+  }
+
+  s_size version;
+  if (!serializer->OpenEntry(name, &version)) {
+    return false;
+  }
+
+  // Registered before it is filled, so it can be an ID inside itself
+  std::shared_ptr<T> read = std::make_shared<T>();
+  bool res = version == kSharedVersion &&
+             serializer->GetUint64(kSharedIdName, &id) &&
+             Register(id, typeid(T), read) &&
+             DeserializeInto(serializer, kSharedObjectName, read.get());
+
+  if (res) {
+    *object = std::move(read);
+  }
+
+  return serializer->CloseEntry() && res;
+}
+
+template <class T>
+bool SharedReader::Get(const ISerializer *serializer, const char *name,
+                       std::weak_ptr<T> *object) {
+  std::uint64_t id;
+
+  if (serializer->IsUint64(name)) {
+    return serializer->GetUint64(name, &id) &&
+           Link(id, typeid(T), object, &SetObject<T, std::weak_ptr<T>>);
+  }
+
+  // Null or the object itself, which the reader keeps alive
+  std::shared_ptr<T> read;
+  const bool res = Get(serializer, name, &read);
+  *object = read;
+  return res;
+}
+
+/* Set object as name with the writer of this thread */
+template <class T>
+inline bool SetShared(ISerializer *serializer, const char *name,
+                      s_size name_length, const std::shared_ptr<T> &object) {
+  SharedWriter *writer = SharedWriter::GetCurrent();
+  return writer != nullptr &&
+         writer->Set(serializer, name, name_length, object.get());
+}
+
+/* Set a weak object as name, null if it expired */
+template <class T>
+inline bool SetShared(ISerializer *serializer, const char *name,
+                      s_size name_length, const std::weak_ptr<T> &object) {
+  return SetShared(serializer, name, name_length, object.lock());
+}
+
+/* Get the named or current object with the reader of this thread */
+template <class T>
+inline bool GetShared(const ISerializer *serializer, const char *name,
+                      std::shared_ptr<T> *object) {
+  SharedReader *reader = SharedReader::GetCurrent();
+  return reader != nullptr && reader->Get(serializer, name, object);
+}
+
+/* Get the named or current object into a weak object */
+template <class T>
+inline bool GetShared(const ISerializer *serializer, const char *name,
+                      std::weak_ptr<T> *object) {
+  SharedReader *reader = SharedReader::GetCurrent();
+  return reader != nullptr && reader->Get(serializer, name, object);
+}
+
+} // namespace Serializer
+
+#endif // !SHARED_GRAPH_HPP
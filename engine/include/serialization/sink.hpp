@@ -0,0 +1,116 @@
+#pragma once
+#ifndef SINK_HPP
+#define SINK_HPP 1
+
+#include "file_load_system/file_load_system.hpp"
+#include "file_load_system/smart_file.hpp"
+
+#include <cstdio>
+#include <string>
+
+namespace Serializer {
+/*
+  Destination of compiled internals, so they don't have to be kept in memory
+  before being written
+*/
+class ISink {
+public:
+  /* Write size bytes of data */
+  virtual bool Write(const char *data, size_t size) = 0;
+  /* Push what was written to its final destination */
+  virtual bool Flush() { return true; }
+
+  /* Virtual Destructor */
+  virtual ~ISink() = default;
+};
+
+/* Sink over a File opened for writing. The File is not owned */
+class FileSink final : public ISink {
+public:
+  explicit FileSink(FileLoadSystem::SmartWriteFile &file)
+      : m_file(file.Get()) {}
+  explicit FileSink(std::FILE *file) : m_file(file) {}
+  ~FileSink() = default;
+
+  /* Write size bytes of data */
+  inline bool Write(const char *data, size_t size) final {
+    return m_file != nullptr &&
+           FileLoadSystem::Fwrite(data, sizeof(char), size, m_file) == size;
+  }
+
+  /* Push what was written to the File */
+  inline bool Flush() final {
+    return m_file != nullptr && std::fflush(m_file) == 0;
+  }
+
+private:
+  std::FILE *m_file = nullptr;
+};
+
+/* Sink that appends to a string, which grows as needed. It is not owned */
+class StringSink final : public ISink {
+public:
+  explicit StringSink(std::string &text) : m_text(&text) {}
+  ~StringSink() = default;
+
+  /* Write size bytes of data */
+  inline bool Write(const char *data, size_t size) final {
+    m_text->append(data, size);
+    return true;
+  }
+
+private:
+  std::string *m_text;
+};
+
+/*
+  rapidjson Output Stream that fills a fixed buffer and empties it into a sink,
+  so the memory used doesn't grow with the text
+*/
+class JsonSinkStream {
+public:
+  /* Character type used */
+  using Ch = char;
+
+  /* Size of the buffer in bytes */
+  static constexpr size_t kBufferSize = 16 * 1024;
+
+  explicit JsonSinkStream(ISink &sink) : m_sink(&sink) {}
+  /* Copy is not allowed because it doesn't make sense */
+  JsonSinkStream(const JsonSinkStream &) = delete;
+  /* Copy is not allowed because it doesn't make sense */
+  JsonSinkStream &operator=(const JsonSinkStream &) = delete;
+  ~JsonSinkStream() = default;
+
+  /* Append a character */
+  inline void Put(Ch c) {
+    if (m_used == kBufferSize) {
+      Flush();
+    }
+    m_buffer[m_used++] = c;
+  }
+
+  /* Empty the buffer into the sink */
+  inline void Flush() {
+    if (m_used != 0 && !m_sink->Write(m_buffer, m_used)) {
+      m_failed = true;
+    }
+    m_used = 0;
+  }
+
+  /* If the sink refused something */
+  inline bool HasFailed() const { return m_failed; }
+
+  /* Forget a failure */
+  inline void ResetFailed() { m_failed = false; }
+
+private:
+  ISink *m_sink;
+  char m_buffer[kBufferSize];
+  size_t m_used = 0;
+  bool m_failed = false;
+};
+
+} // namespace Serializer
+
+#endif // !SINK_HPP
@@ -0,0 +1,855 @@
+#pragma once
+#ifndef TREE_SERIALIZER_HPP
+#define TREE_SERIALIZER_HPP 1
+
+#include "serialization/path_query.hpp"
+#include "serialization/serializer.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace Serializer {
+/*
+  Keeps the entries in a compact in memory tree and leaves Parse and Compile to
+  the derived classes, so binary encodings only have to care about their format.
+  The tree can also be read in place from an image of its nodes and strings
+  (see FlatSerializer), which is copied on the first Set
+*/
+class TreeSerializer : public ISerializer {
+public:
+  TreeSerializer();
+  TreeSerializer(TreeSerializer &&) = default;
+  /* Copy is not allowed because it doesn't make sense */
+  TreeSerializer(const TreeSerializer &) = delete;
+  TreeSerializer &operator=(TreeSerializer &&) = default;
+  /* Copy is not allowed because it doesn't make sense */
+  TreeSerializer &operator=(const TreeSerializer &) = delete;
+  virtual ~TreeSerializer() = default;
+
+  /* Deepest arrays and entries nest in a parsed text, deeper texts fail */
+  static constexpr std::uint32_t kMaxParseDepth = 256;
+
+  /* Clear internals */
+  bool Clear() override;
+  /* Get Size in bytes of the compiled internals */
+  bool GetSize(s_size *size) override;
+  /* Get Length (amount of chars used) of the compiled internals */
+  bool GetLength(s_size *length) override;
+  /* Put the compiled internals in a char array. It should have at least enough
+   * space */
+  bool GetText(char *text) override;
+  /*
+  Get the compiled internals without copying them, excluding null terminator.
+  The view is only valid until the serializer changes
+  */
+  bool GetView(std::string_view *view) const override;
+  /* Compile internals straight into sink, without GetText */
+  bool CompileTo(ISink &sink) override;
+
+  /*
+  Write to delta only what changed from baseline to this: new and changed
+  members, removed members, entries that changed (recursively) and arrays as
+  one splice (the elements between their equal start and end are removed and
+  inserted). delta is a document like any other, so any tree serializer can
+  compile it. False if delta is this or baseline
+  */
+  bool Diff(const TreeSerializer &baseline, TreeSerializer *delta) const;
+  /*
+  Apply a delta made by Diff with this as its baseline. New members go after
+  the ones of the baseline. False if the delta is not valid, then this is not
+  changed
+  */
+  bool ApplyDelta(const TreeSerializer &delta);
+
+  /*
+  Open an space for a new entry with name and version. Length excludes null
+  terminator. If it is at the same level as an opened array, the name is not
+  used and the entry is appended to the array
+  */
+  bool SetEntry(const char *name, s_size name_length, s_size version) override;
+  /*
+  Gets in the space of an entry and return its version
+  If it is at the same level as an opened array, the name is not used and the
+  array entry is opened
+  */
+  bool OpenEntry(const char *name, s_size *version) const override;
+  /* Close an entry */
+  bool CloseEntry() const override;
+
+  /*
+  Sets a new bool. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetBool(const char *name, s_size name_length, bool value) override;
+  /*
+  Gets if the current/named entry is a bool
+  If it is at the same level as an opened array, the name is not used and it
+  checks if the current opened entry is
+  */
+  bool IsBool(const char *name) const override;
+  /*
+  Gets the named or current bool entry
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetBool(const char *name, bool *result) const override;
+
+  /*
+  Sets a new unsigned entry. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetUint(const char *name, s_size name_length, unsigned value) override;
+  /*
+  Gets if the current/named entry is an unsigned
+  If it is at the same level as an opened array, the name is not used and it
+  checks if the current opened entry is
+  */
+  bool IsUint(const char *name) const override;
+  /*
+  Gets the named or current unsigned entry
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetUint(const char *name, unsigned *result) const override;
+
+  /*
+  Sets a new int entry. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetInt(const char *name, s_size name_length, int value) override;
+  /*
+  Gets if the current/named entry is an int
+  If it is at the same level as an opened array, the name is not used and it
+  checks if the current opened entry is
+  */
+  bool IsInt(const char *name) const override;
+  /*
+  Gets the named or current int entry
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetInt(const char *name, int *result) const override;
+
+  /*
+  Sets a new uint64_t entry. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetUint64(const char *name, s_size name_length, uint64_t value) override;
+  /*
+  Gets if the current/named entry is an uint64_t
+  If it is at the same level as an opened array, the name is not used and it
+  checks if the current opened entry is
+  */
+  bool IsUint64(const char *name) const override;
+  /*
+  Gets the named or current uint64_t entry
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetUint64(const char *name, uint64_t *result) const override;
+
+  /*
+  Sets a new int64_t entry. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetInt64(const char *name, s_size name_length, int64_t value) override;
+  /*
+  Gets if the current/named entry is an int64_t
+  If it is at the same level as an opened array, the name is not used and it
+  checks if the current opened entry is
+  */
+  bool IsInt64(const char *name) const override;
+  /*
+  Gets the named or current int64_t entry
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetInt64(const char *name, int64_t *result) const override;
+
+  /*
+  Sets a new double entry. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetDouble(const char *name, s_size name_length, double value) override;
+  /*
+  Gets if the current/named entry is an double
+  If it is at the same level as an opened array, the name is not used and it
+  checks if the current opened entry is
+  */
+  bool IsDouble(const char *name) const override;
+  /*
+  Gets the named or current double entry
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetDouble(const char *name, double *result) const override;
+
+  /*
+  Sets a new string entry. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetString(const char *name, s_size name_length,
+                 const char *value, s_size length) override;
+  /*
+  Gets if the current/named entry is a string
+  If it is at the same level as an opened array, the name is not used and it
+  checks if the current opened entry is
+  */
+  bool IsString(const char *name) const override;
+  /*
+  Gets the named or current string entry length (UTF makes this tricky)
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetStringLength(const char *name, s_size *result) const override;
+  /*
+  Gets the named or current string size in bytes
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetStringSize(const char *name, s_size *result) const override;
+  /*
+  Gets the named or current string entry. The result pointer must be able to
+  hold the string If it is at the same level as an opened array, the name is not
+  used and it gets the current opened entry is
+  */
+  bool GetString(const char *name, char *result) const override;
+  /*
+  Gets the named or current string entry without copying it. The view is only
+  valid until the serializer changes
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetStringView(const char *name, std::string_view *result) const override;
+
+  /*
+  Sets a new blob (size raw bytes) entry. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetBlob(const char *name, s_size name_length, const void *data,
+               s_size size) override;
+  /*
+  Gets the size in bytes of the named or current blob entry
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetBlobSize(const char *name, s_size *size) const override;
+  /*
+  Gets the named or current blob entry. It fails if it doesn't have exactly
+  size bytes (see GetBlobSize)
+  If it is at the same level as an opened array, the name is not used and it
+  gets the current opened entry is
+  */
+  bool GetBlob(const char *name, void *result, s_size size) const override;
+
+  /*
+  Sets a new null entry. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetNull(const char *name, s_size name_length) override;
+  /*
+  Gets if the current/named entry is null
+  If it is at the same level as an opened array, the name is not used and it
+  checks if the current opened entry is
+  */
+  bool IsNull(const char *name) const override;
+
+  /*
+  Sets a new array entry. Length excludes null terminator.
+  If it is at the same level as an opened array, the name is not used and it
+  is appended to the array
+  */
+  bool SetArray(const char *name, s_size name_length) override;
+  /*
+  Reserve Array memory, might be hard to predict due to recursions
+  */
+  bool ReserveArray(const char *name, s_size size) override;
+  /*
+  Gets if the current/named entry is an array
+  If it is at the same level as an opened array, the name is not used and it
+  checks if the current opened entry is
+  */
+  bool IsArray(const char *name) const override;
+  /*
+  Gets in the space of an entry
+  If it is at the same level as an opened array, the name is not used and the
+  array entry is opened
+  */
+  bool OpenArray(const char *name) const override;
+  /* Get Named Array or Arrary inside Array Capacity */
+  bool GetArrayCapacity(const char *name, s_size *size) const override;
+  /* If the Current Array Iterator is not end() */
+  bool CanMoveArray() const override;
+  /* Moves the Current Array Iterator. It starts at begin(). This function will
+   * return false when it tries to move end() */
+  bool MoveArray() const override;
+  /* Close an array entry */
+  bool CloseArray() const override;
+
+  /*
+  Open the parent of the value path leads to, from the root, like OpenEntry
+  or OpenArray do (moved to the element). The value is then read with the
+  usual calls using path.GetName(), which is not used for an array element.
+  False if the value is not there
+  */
+  bool OpenPath(const PathQuery &path) const override;
+  /* Close what OpenPath opened */
+  bool ClosePath() const override;
+
+  /* Sets a new array of size bools at once */
+  bool SetBoolArray(const char *name, s_size name_length, const bool *values,
+                    s_size size) override;
+  /* Gets the named or current array of bools at once */
+  bool GetBoolArray(const char *name, bool *result, s_size size) const override;
+  /* Sets a new array of size unsigneds at once */
+  bool SetUintArray(const char *name, s_size name_length,
+                    const unsigned *values, s_size size) override;
+  /* Gets the named or current array of unsigneds at once */
+  bool GetUintArray(const char *name, unsigned *result,
+                    s_size size) const override;
+  /* Sets a new array of size ints at once */
+  bool SetIntArray(const char *name, s_size name_length, const int *values,
+                   s_size size) override;
+  /* Gets the named or current array of ints at once */
+  bool GetIntArray(const char *name, int *result, s_size size) const override;
+  /* Sets a new array of size uint64_t at once */
+  bool SetUint64Array(const char *name, s_size name_length,
+                      const uint64_t *values, s_size size) override;
+  /* Gets the named or current array of uint64_t at once */
+  bool GetUint64Array(const char *name, uint64_t *result,
+                      s_size size) const override;
+  /* Sets a new array of size int64_t at once */
+  bool SetInt64Array(const char *name, s_size name_length,
+                     const int64_t *values, s_size size) override;
+  /* Gets the named or current array of int64_t at once */
+  bool GetInt64Array(const char *name, int64_t *result,
+                     s_size size) const override;
+  /* Sets a new array of size doubles at once */
+  bool SetDoubleArray(const char *name, s_size name_length,
+                      const double *values, s_size size) override;
+  /* Gets the named or current array of doubles at once */
+  bool GetDoubleArray(const char *name, double *result,
+                      s_size size) const override;
+
+protected:
+  /* Type of a Node */
+  enum class NodeType : std::uint8_t {
+    kNull,
+    kBool,
+    /* Integer set as unsigned */
+    kUint,
+    /* Integer set as signed */
+    kInt,
+    kDouble,
+    kString,
+    /* Raw bytes, kept in the string pool */
+    kBlob,
+    kArray,
+    /* Object without version (only the root) */
+    kObject,
+    /* Object with version */
+    kEntry,
+  };
+
+  /* Index of a Node, kNone if there is not one */
+  using node_index = std::uint32_t;
+
+  /* No Node */
+  static constexpr node_index kNone = std::numeric_limits<node_index>::max();
+
+  /* Index of the Root Node */
+  static constexpr node_index kRoot = 0;
+
+  /* An Entry of the Tree. Children are a linked list */
+  struct Node {
+    NodeType m_type = NodeType::kNull;
+    /* Offset of the name in m_strings, kNone inside arrays */
+    std::uint32_t m_name = kNone;
+    std::uint32_t m_nameLength = 0;
+    /* Offset of the value in m_strings for strings and blobs */
+    std::uint32_t m_string = kNone;
+    std::uint32_t m_stringLength = 0;
+    node_index m_next = kNone;
+    node_index m_firstChild = kNone;
+    node_index m_lastChild = kNone;
+    std::uint32_t m_childCount = 0;
+    /* Bool, integers, double bits or entry version */
+    union {
+      bool m_bool;
+      std::uint64_t m_uint;
+      std::int64_t m_int;
+      double m_double;
+    };
+
+    Node() : m_uint(0) {}
+  };
+
+  /* Check if we are currently inside an array */
+  bool IsInsideArray() const;
+
+  /* Find a named child of the current entry, kNone if not found */
+  node_index FindMember(const char *name) const;
+
+  /*
+    Node the operations look at: the current array element inside an array or
+    the named child
+  */
+  node_index FindTarget(const char *name) const;
+
+  /*
+    Add a Node to the current entry (or array), copying its name and returns
+    its index
+  */
+  node_index AddNode(NodeType type, const char *name, s_size name_length);
+
+  /* Find a named child of node, kNone if not found */
+  node_index FindChild(node_index node, const std::string &name) const;
+
+  /* Where path leads: the parent and the element if it is in an array */
+  bool ResolvePath(const PathQuery &path, node_index *parent,
+                   node_index *element) const;
+
+  /* The nodes changed, paths must be resolved again */
+  inline void InvalidatePaths() {
+    if (m_pathResolved) {
+      m_pathGeneration = PathQuery::NextGeneration();
+      m_pathResolved = false;
+    }
+  }
+
+  /* Add a Node as the last child of parent */
+  void AppendChild(node_index parent, node_index child);
+
+  /* Copy a string to the string pool and return its offset */
+  std::uint32_t AddString(const char *text, s_size length);
+
+  /* Get a string from the pool */
+  inline const char *GetPoolString(std::uint32_t offset) const {
+    return (m_mappedStrings != nullptr ? m_mappedStrings : m_strings.data()) +
+           offset;
+  }
+
+  /* Get a Node to read it, from the image if there is one */
+  inline const Node &GetNode(node_index index) const {
+    return m_mappedNodes != nullptr ? m_mappedNodes[index] : m_nodes[index];
+  }
+
+  /* Copy the image to the tree, so it can be written */
+  void CopyMapped();
+
+  /* If two nodes (of two trees) have the same value, recursively */
+  static bool NodesEqual(const TreeSerializer &first, node_index firstIndex,
+                         const TreeSerializer &second, node_index secondIndex);
+
+  /* Add node as the last child of parent, without its links and copying name */
+  node_index AppendNode(node_index parent, Node node, const char *name,
+                        std::uint32_t nameLength);
+
+  /* Copy a node of a tree, with its children, as the last child of parent */
+  node_index CopyNode(node_index parent, const char *name,
+                      std::uint32_t nameLength, const TreeSerializer &from,
+                      node_index index);
+
+  /* Get a part of a delta entry, adding it the first time */
+  node_index GetDeltaPart(node_index patch, node_index *part, const char *name,
+                          NodeType type);
+
+  /*
+  Drop the nodes from first on and the strings from strings on, the first node
+  being the last child of parent, which had last as the one before
+  */
+  void RemoveLastNodes(node_index parent, node_index last, node_index first,
+                       std::uint32_t strings);
+
+  /* Write to patch what changed from the base entry to the current one */
+  void DiffEntry(const TreeSerializer &baseline, node_index base,
+                 const TreeSerializer &current, node_index entry,
+                 node_index patch);
+
+  /* Write to arrays the splice from the base array to the current one */
+  void DiffArray(const TreeSerializer &baseline, node_index base,
+                 const TreeSerializer &current, node_index array,
+                 node_index arrays);
+
+  /* Write to entry the base entry (kNone if none) with patch applied */
+  bool ApplyEntry(const TreeSerializer &baseline, node_index base,
+                  const TreeSerializer &delta, node_index patch,
+                  node_index entry);
+
+  /* Write to array the base array (kNone if none) with patch applied */
+  bool ApplyArray(const TreeSerializer &baseline, node_index base,
+                  const TreeSerializer &delta, node_index patch,
+                  node_index array);
+
+  /* Store a T in a node, setting its type (Only primitives and no pointers) */
+  template <typename T> static void SetNodeValue(Node &node, T value);
+
+  /* Sets an entry of type T (Only primitives and no pointers)*/
+  template <typename T>
+  bool SetType(const char *name, s_size name_length, T value);
+
+  /* Sets an array of T at once (Only primitives and no pointers)*/
+  template <typename T>
+  bool SetTypeArray(const char *name, s_size name_length, const T *values,
+                    s_size size);
+
+  /* If a node holds a T (Only primitives and no pointers) */
+  template <typename T> bool IsNodeType(const Node &node) const;
+
+  /* If an entry is of type T (Only primitives and no pointers)*/
+  template <typename T> bool IsType(const char *name) const;
+
+  /* Read a T from a node (Only primitives and no pointers) */
+  template <typename T> bool GetNodeValue(const Node &node, T *result) const;
+
+  /* Get an entry of type T (Only primitives and no pointers)*/
+  template <typename T> bool GetType(const char *name, T *result) const;
+
+  /* Gets an array of T at once (Only primitives and no pointers)*/
+  template <typename T>
+  bool GetTypeArray(const char *name, T *result, s_size size) const;
+
+  /* Every Node. Root is the first one */
+  std::vector<Node> m_nodes;
+
+  /* Names and string values, each one null terminated */
+  std::vector<char> m_strings;
+
+  /* Nodes of the image that is read instead of m_nodes, if there is one */
+  const Node *m_mappedNodes = nullptr;
+  size_t m_mappedNodeCount = 0;
+
+  /* Strings of the image that are read instead of m_strings */
+  const char *m_mappedStrings = nullptr;
+  size_t m_mappedStringsSize = 0;
+
+  /* Where we compile */
+  std::vector<char> m_buffer;
+
+  /* Current Entry we are looking at. Used as a Stack */
+  mutable std::vector<node_index> m_currentEntry;
+
+  /* Current Depth we are looking at */
+  mutable s_size m_currentDepth;
+
+  /* Current Array Depth. Used as a Stack */
+  mutable std::vector<s_size> m_currentArray;
+
+  /* Current Element of the Current Array we are looking at. Used as a Stack */
+  mutable std::vector<node_index> m_currentArrayIter;
+
+  /* Generation of the nodes, for the paths resolved in them */
+  std::uint64_t m_pathGeneration = PathQuery::NextGeneration();
+
+  /* If a path was resolved in the current generation */
+  mutable bool m_pathResolved = false;
+};
+
+inline bool TreeSerializer::IsInsideArray() const {
+  return !m_currentArray.empty() && m_currentDepth == m_currentArray.back();
+}
+
+template <typename T>
+void TreeSerializer::SetNodeValue(Node &node, T value) {
+  static_assert(std::is_arithmetic_v<T>, "Only primitives are supported");
+
+  if constexpr (std::is_same_v<T, bool>) {
+    node.m_type = NodeType::kBool;
+    node.m_bool = value;
+  } else if constexpr (std::is_floating_point_v<T>) {
+    node.m_type = NodeType::kDouble;
+    node.m_double = value;
+  } else if constexpr (std::is_signed_v<T>) {
+    node.m_type = NodeType::kInt;
+    node.m_int = value;
+  } else {
+    node.m_type = NodeType::kUint;
+    node.m_uint = value;
+  }
+}
+
+template <typename T>
+bool TreeSerializer::SetType(const char *name, s_size name_length, T value) {
+  SetNodeValue<T>(m_nodes[AddNode(NodeType::kNull, name, name_length)], value);
+  return true;
+}
+
+template <typename T>
+bool TreeSerializer::SetTypeArray(const char *name, s_size name_length,
+                                  const T *values, s_size size) {
+  node_index array = AddNode(NodeType::kArray, name, name_length);
+
+  // Filled in one pass, without going through the cursors
+  m_nodes.reserve(m_nodes.size() + static_cast<size_t>(size));
+  for (s_size i = 0; i < size; ++i) {
+    node_index index = static_cast<node_index>(m_nodes.size());
+
+    Node node;
+    SetNodeValue<T>(node, values[i]);
+
+    m_nodes.push_back(node);
+    AppendChild(array, index);
+  }
+
+  return true;
+}
+
+template <typename T>
+bool TreeSerializer::IsNodeType(const Node &node) const {
+  static_assert(std::is_arithmetic_v<T>, "Only primitives are supported");
+
+  if constexpr (std::is_same_v<T, bool>) {
+    return node.m_type == NodeType::kBool;
+  } else if constexpr (std::is_floating_point_v<T>) {
+    return node.m_type == NodeType::kDouble;
+  } else {
+    // Like JSON, an integer is of every type that can hold its value
+    if (node.m_type == NodeType::kUint) {
+      return node.m_uint <=
+             static_cast<std::uint64_t>(std::numeric_limits<T>::max());
+    }
+
+    if (node.m_type == NodeType::kInt) {
+      if constexpr (std::is_signed_v<T>) {
+        return node.m_int >= std::numeric_limits<T>::min() &&
+               node.m_int <= std::numeric_limits<T>::max();
+      } else {
+        return node.m_int >= 0 &&
+               static_cast<std::uint64_t>(node.m_int) <=
+                   static_cast<std::uint64_t>(std::numeric_limits<T>::max());
+      }
+    }
+
+    return false;
+  }
+}
+
+template <typename T> bool TreeSerializer::IsType(const char *name) const {
+  node_index target = FindTarget(name);
+
+  if (target == kNone) {
+    return false;
+  }
+
+  return IsNodeType<T>(GetNode(target));
+}
+
+template <typename T>
+bool TreeSerializer::GetType(const char *name, T *result) const {
+  node_index target = FindTarget(name);
+
+  if (target == kNone) {
+    return false;
+  }
+
+  return GetNodeValue<T>(GetNode(target), result);
+}
+
+template <typename T>
+bool TreeSerializer::GetTypeArray(const char *name, T *result,
+                                  s_size size) const {
+  node_index target = FindTarget(name);
+
+  if (target == kNone || GetNode(target).m_type != NodeType::kArray ||
+      GetNode(target).m_childCount != size) {
+    return false;
+  }
+
+  for (node_index child = GetNode(target).m_firstChild; child != kNone;
+       child = GetNode(child).m_next) {
+    if (!GetNodeValue<T>(GetNode(child), result++)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+template <typename T>
+bool TreeSerializer::GetNodeValue(const Node &node, T *result) const {
+  if constexpr (std::is_floating_point_v<T>) {
+    // Integers can be read as doubles
+    if (node.m_type == NodeType::kUint) {
+      *result = static_cast<T>(node.m_uint);
+      return true;
+    }
+
+    if (node.m_type == NodeType::kInt) {
+      *result = static_cast<T>(node.m_int);
+      return true;
+    }
+  }
+
+  if (!IsNodeType<T>(node)) {
+    return false;
+  }
+
+  if constexpr (std::is_same_v<T, bool>) {
+    *result = node.m_bool;
+  } else if constexpr (std::is_floating_point_v<T>) {
+    *result = static_cast<T>(node.m_double);
+  } else if (node.m_type == NodeType::kUint) {
+    *result = static_cast<T>(node.m_uint);
+  } else {
+    *result = static_cast<T>(node.m_int);
+  }
+
+  return true;
+}
+
+inline bool TreeSerializer::SetBool(const char *name, s_size name_length,
+                                    bool value) {
+  return SetType<bool>(name, name_length, value);
+}
+
+inline bool TreeSerializer::IsBool(const char *name) const {
+  return IsType<bool>(name);
+}
+
+inline bool TreeSerializer::GetBool(const char *name, bool *result) const {
+  return GetType<bool>(name, result);
+}
+
+inline bool TreeSerializer::SetUint(const char *name, s_size name_length,
+                                    unsigned value) {
+  return SetType<unsigned>(name, name_length, value);
+}
+
+inline bool TreeSerializer::IsUint(const char *name) const {
+  return IsType<unsigned>(name);
+}
+
+inline bool TreeSerializer::GetUint(const char *name, unsigned *result) const {
+  return GetType<unsigned>(name, result);
+}
+
+inline bool TreeSerializer::SetInt(const char *name, s_size name_length,
+                                   int value) {
+  return SetType<int>(name, name_length, value);
+}
+
+inline bool TreeSerializer::IsInt(const char *name) const {
+  return IsType<int>(name);
+}
+
+inline bool TreeSerializer::GetInt(const char *name, int *result) const {
+  return GetType<int>(name, result);
+}
+
+inline bool TreeSerializer::SetUint64(const char *name, s_size name_length,
+                                      uint64_t value) {
+  return SetType<uint64_t>(name, name_length, value);
+}
+
+inline bool TreeSerializer::IsUint64(const char *name) const {
+  return IsType<uint64_t>(name);
+}
+
+inline bool TreeSerializer::GetUint64(const char *name,
+                                      uint64_t *result) const {
+  return GetType<uint64_t>(name, result);
+}
+
+inline bool TreeSerializer::SetInt64(const char *name, s_size name_length,
+                                     int64_t value) {
+  return SetType<int64_t>(name, name_length, value);
+}
+
+inline bool TreeSerializer::IsInt64(const char *name) const {
+  return IsType<int64_t>(name);
+}
+
+inline bool TreeSerializer::GetInt64(const char *name, int64_t *result) const {
+  return GetType<int64_t>(name, result);
+}
+
+inline bool TreeSerializer::SetDouble(const char *name, s_size name_length,
+                                      double value) {
+  return SetType<double>(name, name_length, value);
+}
+
+inline bool TreeSerializer::IsDouble(const char *name) const {
+  return IsType<double>(name);
+}
+
+inline bool TreeSerializer::GetDouble(const char *name, double *result) const {
+  return GetType<double>(name, result);
+}
+
+inline bool TreeSerializer::SetBoolArray(const char *name, s_size name_length,
+                                         const bool *values, s_size size) {
+  return SetTypeArray<bool>(name, name_length, values, size);
+}
+
+inline bool TreeSerializer::GetBoolArray(const char *name, bool *result,
+                                         s_size size) const {
+  return GetTypeArray<bool>(name, result, size);
+}
+
+inline bool TreeSerializer::SetUintArray(const char *name, s_size name_length,
+                                         const unsigned *values, s_size size) {
+  return SetTypeArray<unsigned>(name, name_length, values, size);
+}
+
+inline bool TreeSerializer::GetUintArray(const char *name, unsigned *result,
+                                         s_size size) const {
+  return GetTypeArray<unsigned>(name, result, size);
+}
+
+inline bool TreeSerializer::SetIntArray(const char *name, s_size name_length,
+                                        const int *values, s_size size) {
+  return SetTypeArray<int>(name, name_length, values, size);
+}
+
+inline bool TreeSerializer::GetIntArray(const char *name, int *result,
+                                        s_size size) const {
+  return GetTypeArray<int>(name, result, size);
+}
+
+inline bool TreeSerializer::SetUint64Array(const char *name, s_size name_length,
+                                           const uint64_t *values,
+                                           s_size size) {
+  return SetTypeArray<uint64_t>(name, name_length, values, size);
+}
+
+inline bool TreeSerializer::GetUint64Array(const char *name, uint64_t *result,
+                                           s_size size) const {
+  return GetTypeArray<uint64_t>(name, result, size);
+}
+
+inline bool TreeSerializer::SetInt64Array(const char *name, s_size name_length,
+                                          const int64_t *values, s_size size) {
+  return SetTypeArray<int64_t>(name, name_length, values, size);
+}
+
+inline bool TreeSerializer::GetInt64Array(const char *name, int64_t *result,
+                                          s_size size) const {
+  return GetTypeArray<int64_t>(name, result, size);
+}
+
+inline bool TreeSerializer::SetDoubleArray(const char *name, s_size name_length,
+                                           const double *values, s_size size) {
+  return SetTypeArray<double>(name, name_length, values, size);
+}
+
+inline bool TreeSerializer::GetDoubleArray(const char *name, double *result,
+                                           s_size size) const {
+  return GetTypeArray<double>(name, result, size);
+}
+
+} // namespace Serializer
+
+#endif // !TREE_SERIALIZER_HPP
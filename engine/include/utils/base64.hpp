@@ -0,0 +1,35 @@
+#pragma once
+#ifndef BASE64_HPP
+#define BASE64_HPP 1
+
+#include <cstddef>
+
+/*
+  Namespace for Base64 (RFC 4648, padded) encoding of raw bytes. SSSE3 or NEON
+  when built with RAPIDJSON_SIMD, lookup tables otherwise
+*/
+namespace Base64 {
+
+/* Length of the text encoding size bytes, without null terminator */
+constexpr std::size_t GetEncodedLength(std::size_t size) {
+  return (size + 2) / 3 * 4;
+}
+
+/*
+  Encode size bytes of data into text, which must hold GetEncodedLength(size)
+  characters. No null terminator is written
+*/
+void Encode(const void *data, std::size_t size, char *text);
+
+/* Bytes decoded from a text of length characters, false if it can't be one */
+bool GetDecodedSize(const char *text, std::size_t length, std::size_t *size);
+
+/*
+  Decode a text of length characters into data, which must hold the size
+  given by GetDecodedSize. False if there is an invalid character
+*/
+bool Decode(const char *text, std::size_t length, void *data);
+
+} // namespace Base64
+
+#endif // !BASE64_HPP
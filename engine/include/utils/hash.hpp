@@ -0,0 +1,50 @@
+#pragma once
+#ifndef HASH_HPP
+#define HASH_HPP 1
+
+#include <cstddef>
+#include <cstdint>
+
+/* Namespace for Hashing related things */
+namespace Hash {
+
+/* Hash Representation */
+using hash_t = std::uint64_t;
+
+/* FNV-1a 64 bits Offset Basis */
+constexpr hash_t kFnvOffsetBasis = 14695981039346656037ull;
+
+/* FNV-1a 64 bits Prime */
+constexpr hash_t kFnvPrime = 1099511628211ull;
+
+/*
+  Continue a FNV-1a 64 bits hash with size bytes of data. Use kFnvOffsetBasis
+  as the starting hash
+*/
+constexpr hash_t Fnv1a(const char *data, std::size_t size,
+                       hash_t hash = kFnvOffsetBasis) {
+  for (std::size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<hash_t>(static_cast<unsigned char>(data[i]));
+    hash *= kFnvPrime;
+  }
+  return hash;
+}
+
+/* FNV-1a 64 bits hash of a null terminated string */
+constexpr hash_t Fnv1a(const char *text) {
+  hash_t hash = kFnvOffsetBasis;
+  for (; *text != '\0'; ++text) {
+    hash ^= static_cast<hash_t>(static_cast<unsigned char>(*text));
+    hash *= kFnvPrime;
+  }
+  return hash;
+}
+
+/* Combine two hashes into one (order matters) */
+constexpr hash_t Combine(hash_t seed, hash_t value) {
+  return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+} // namespace Hash
+
+#endif // !HASH_HPP
@@ -0,0 +1,34 @@
+#pragma once
+#ifndef LZ4_HPP
+#define LZ4_HPP 1
+
+#include <cstddef>
+
+/*
+  Namespace for LZ4 block compression (https://github.com/lz4/lz4, block
+  format). Fast greedy compressor, blocks decode with any LZ4 decoder
+*/
+namespace Lz4 {
+
+/* Most bytes a compressed block of size bytes can take */
+constexpr std::size_t GetMaxCompressedSize(std::size_t size) {
+  return size + size / 255 + 16;
+}
+
+/*
+  Compress size bytes of data into block, which must hold
+  GetMaxCompressedSize(size) bytes. Returns the size of the block
+*/
+std::size_t Compress(const void *data, std::size_t size, void *block);
+
+/*
+  Decompress a block of block_size bytes into data, which is exactly size
+  bytes. Every length and offset is checked, so a corrupt block fails instead
+  of reading or writing out of bounds
+*/
+bool Decompress(const void *block, std::size_t block_size, void *data,
+                std::size_t size);
+
+} // namespace Lz4
+
+#endif // !LZ4_HPP
@@ -5,6 +5,7 @@
 
 #include "file_load_system/file_load_system.hpp"
 #include "locale_handling/locale_handling.hpp"
+#include "os_detection/cpu_features.hpp"
 #include "utils/engine_assert.hpp"
 #include "utils/logger.hpp"
 
@@ -24,6 +25,14 @@ bool Engine::Init(const char *studio_name, const char *game_name) {
 
   debug_assert::engine_handler::Setup(std::move(Logging::Logger::GetDefaultErrorLogger()));
 
+  // The JSON parser might have been built for instructions this CPU lacks
+  if (!OsDetection::HasSimd(OsDetection::kJsonSimdLevel)) {
+    LOG(Logging::Logger::GetDefaultErrorLogger(), 0,
+        "The CPU doesn't support %s, needed by the JSON parser",
+        OsDetection::GetSimdName(OsDetection::kJsonSimdLevel));
+    return false;
+  }
+
   LOG(Logging::Logger::GetDefaultLogger(), 0, "Engine Started");
   return true;
 }
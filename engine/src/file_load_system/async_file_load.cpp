@@ -3,6 +3,7 @@
 #include "file_load_system/file_load_system.hpp"
 #include "file_load_system/smart_file.hpp"
 
+#include <memory>
 #include <utility>
 
 namespace FileLoadSystem {
@@ -61,10 +62,25 @@ FileAndData InternalReadFileAlloc(const FileLoadSystem::path &p) {
     return res;
   }
 
-  std::unique_ptr<char[]> data(
-      static_cast<char *>(std::malloc(size * sizeof(char) + 1)));
+  FileAndData res;
+  res.m_file = FileLoadSystem::OpenReadText(p);
 
-  return InternalReadFile(p, size, std::move(data));
+  if (!res.m_file.IsValid()) {
+    res.m_error = true;
+    return res;
+  }
+
+  // One more for the null terminator, so it can be used as a string (i.e.
+  // parsed in situ)
+  res.m_data = std::make_unique<char[]>(static_cast<size_t>(size) + 1);
+
+  // Text mode might read less than the File Size
+  size_t read = FileLoadSystem::Fread(res.m_data.get(), sizeof(char),
+                                      static_cast<size_t>(size),
+                                      res.m_file.Get());
+  res.m_data[read] = '\0';
+
+  return res;
 }
 
 std::future<FileAndData> ReadFile(FileLoadSystem::SmartReadFile file,
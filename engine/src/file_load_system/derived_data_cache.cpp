@@ -0,0 +1,344 @@
+#include "file_load_system/derived_data_cache.hpp"
+
+#include "file_load_system/file_load_system.hpp"
+#include "file_load_system/smart_file.hpp"
+#include "utils/hash.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace FileLoadSystem {
+
+namespace {
+
+/* Derived Data File Magic Number */
+constexpr char kDerivedDataMagic[4] = {'K', 'D', 'D', 'C'};
+
+/* Extension of the Derived Data Files */
+constexpr char kDerivedDataExtension[] = ".ddc";
+
+/* Extension of the Derived Data Files being written */
+constexpr char kTemporaryExtension[] = ".tmp";
+
+/*
+  Temporary files older than this are leftovers from an interrupted insert.
+  Newer ones might be an insert of another run in flight
+*/
+constexpr std::chrono::hours kStaleTemporaryAge(1);
+
+/* Size of the header of a Derived Data File */
+constexpr size_t kHeaderSize =
+    sizeof(kDerivedDataMagic) + 2 * sizeof(std::uint64_t);
+
+/* Write a little endian unsigned integer into a buffer */
+void PutLE(unsigned char *buffer, std::uint64_t value) {
+  for (size_t i = 0; i < sizeof(std::uint64_t); ++i) {
+    buffer[i] = static_cast<unsigned char>(value >> (8 * i));
+  }
+}
+
+/* Read a little endian unsigned integer from a buffer */
+std::uint64_t GetLE(const unsigned char *buffer) {
+  std::uint64_t value = 0;
+  for (size_t i = 0; i < sizeof(std::uint64_t); ++i) {
+    value |= static_cast<std::uint64_t>(buffer[i]) << (8 * i);
+  }
+  return value;
+}
+
+} // namespace
+
+std::string DerivedDataCache::GetFileName(const DerivedDataKey &key) {
+  char name[64];
+  std::snprintf(name, sizeof(name), "%016" PRIx64 "_%016" PRIx64 "_%" PRIu32,
+                key.m_source, key.m_transform, key.m_version);
+  return std::string(name) + kDerivedDataExtension;
+}
+
+error_status DerivedDataCache::Open(const path &directory,
+                                    file_size_t max_size) {
+  error_status error;
+
+  m_directory = directory;
+  m_maxSize = max_size;
+  m_records.clear();
+  m_useCounter = 0;
+  m_stats = {};
+
+  CreateDirectories(m_directory, error);
+
+  if (error) {
+    return error;
+  }
+
+  // Recover the least recently used order from the last write times
+  std::vector<std::pair<std::filesystem::file_time_type, std::string>> found;
+
+  for (std::filesystem::directory_iterator iter(m_directory, error);
+       !error && iter != std::filesystem::directory_iterator();
+       iter.increment(error)) {
+    const path &p = iter->path();
+
+    if (p.extension() == kTemporaryExtension) {
+      // Leftover from an interrupted insert, unless it is still being written
+      error_status ignored;
+      const auto written = std::filesystem::last_write_time(p, ignored);
+      if (!ignored &&
+          std::filesystem::file_time_type::clock::now() - written >
+              kStaleTemporaryAge) {
+        Remove(p, ignored);
+      }
+      continue;
+    }
+
+    if (p.extension() != kDerivedDataExtension) {
+      continue;
+    }
+
+    error_status ignored;
+    Record record;
+    record.m_size = FileSize(p, ignored);
+
+    if (ignored) {
+      continue;
+    }
+
+    std::string name = p.filename().generic_u8string();
+    found.emplace_back(std::filesystem::last_write_time(p, ignored), name);
+    m_records.emplace(std::move(name), record);
+    m_stats.m_size += record.m_size;
+  }
+
+  if (error) {
+    return error;
+  }
+
+  std::sort(found.begin(), found.end());
+
+  for (const auto &file : found) {
+    m_records[file.second].m_lastUse = ++m_useCounter;
+  }
+
+  Evict(m_maxSize);
+  return error;
+}
+
+error_status DerivedDataCache::Open(file_size_t max_size) {
+  return Open(GetTempDirectory() / CreatePath("DerivedDataCache"), max_size);
+}
+
+bool DerivedDataCache::Get(const DerivedDataKey &key,
+                           std::vector<char> &result) {
+  const std::string name = GetFileName(key);
+  const path p = m_directory / CreatePath(name);
+
+  SmartReadFile file = OpenReadBinary(p);
+
+  if (!file.IsValid()) {
+    ++m_stats.m_misses;
+    return false;
+  }
+
+  unsigned char header[kHeaderSize];
+
+  error_status error;
+  const file_size_t fileSize = FileSize(p, error);
+
+  const bool valid =
+      !error && fileSize >= kHeaderSize &&
+      Fread(header, sizeof(unsigned char), kHeaderSize, file.Get()) ==
+          kHeaderSize &&
+      std::memcmp(header, kDerivedDataMagic, sizeof(kDerivedDataMagic)) == 0;
+
+  const std::uint64_t size =
+      valid ? GetLE(header + sizeof(kDerivedDataMagic)) : 0;
+
+  // The size must be the one of the file before anything is allocated
+  if (!valid || size != fileSize - kHeaderSize) {
+    file = SmartReadFile();
+    Drop(name);
+    ++m_stats.m_misses;
+    return false;
+  }
+
+  const std::uint64_t hash =
+      GetLE(header + sizeof(kDerivedDataMagic) + sizeof(std::uint64_t));
+
+  result.resize(static_cast<size_t>(size));
+
+  // A torn or corrupted output is a miss, and it is removed
+  if (Fread(result.data(), sizeof(char), result.size(), file.Get()) !=
+          result.size() ||
+      Hash::Fnv1a(result.data(), result.size()) != hash) {
+    file = SmartReadFile();
+    result.clear();
+    Drop(name);
+    ++m_stats.m_misses;
+    return false;
+  }
+
+  file = SmartReadFile();
+
+  // Outputs written by other runs are adopted
+  Record &record = m_records[name];
+
+  if (record.m_size == 0) {
+    record.m_size = static_cast<file_size_t>(kHeaderSize + size);
+    m_stats.m_size += record.m_size;
+  }
+
+  record.m_lastUse = ++m_useCounter;
+
+  // Keep the order for the next runs
+  error_status ignored;
+  std::filesystem::last_write_time(
+      p, std::filesystem::file_time_type::clock::now(), ignored);
+
+  ++m_stats.m_hits;
+  return true;
+}
+
+bool DerivedDataCache::Put(const DerivedDataKey &key, const char *data,
+                           size_t size) {
+  const std::string name = GetFileName(key);
+  const path p = m_directory / CreatePath(name);
+
+  const path tmp = GetTemporaryPath(p);
+
+  {
+    SmartWriteFile file = OpenWriteBinary(tmp);
+
+    if (!file.IsValid()) {
+      return false;
+    }
+
+    unsigned char header[kHeaderSize];
+    std::memcpy(header, kDerivedDataMagic, sizeof(kDerivedDataMagic));
+    PutLE(header + sizeof(kDerivedDataMagic), size);
+    PutLE(header + sizeof(kDerivedDataMagic) + sizeof(std::uint64_t),
+          Hash::Fnv1a(data, size));
+
+    if (Fwrite(header, sizeof(unsigned char), kHeaderSize, file.Get()) !=
+            kHeaderSize ||
+        Fwrite(data, sizeof(char), size, file.Get()) != size ||
+        std::fflush(file.Get()) != 0) {
+      file = SmartWriteFile();
+      error_status ignored;
+      Remove(tmp, ignored);
+      return false;
+    }
+  }
+
+  error_status error;
+  Rename(tmp, p, error);
+
+  if (error) {
+    Remove(tmp, error);
+    return false;
+  }
+
+  Record &record = m_records[name];
+  m_stats.m_size -= record.m_size;
+  record.m_size = static_cast<file_size_t>(kHeaderSize + size);
+  record.m_lastUse = ++m_useCounter;
+  m_stats.m_size += record.m_size;
+  ++m_stats.m_inserts;
+
+  Evict(m_maxSize);
+  return true;
+}
+
+bool DerivedDataCache::GetOrBuild(
+    const DerivedDataKey &key, std::vector<char> &result,
+    const std::function<bool(std::vector<char> &)> &build) {
+  if (Get(key, result)) {
+    return true;
+  }
+
+  result.clear();
+
+  if (!build(result)) {
+    return false;
+  }
+
+  // Failing to cache is not an error, it will be built again next time
+  Put(key, result.data(), result.size());
+  return true;
+}
+
+error_status DerivedDataCache::Purge() {
+  while (!m_records.empty()) {
+    Drop(m_records.begin()->first);
+  }
+
+  error_status error;
+  RemoveDirectory(m_directory, error);
+
+  if (error) {
+    return error;
+  }
+
+  CreateDirectories(m_directory, error);
+  return error;
+}
+
+std::string DerivedDataCache::GetReport() const {
+  char report[256];
+  std::snprintf(report, sizeof(report),
+                "Derived Data Cache: %" PRIu64 " hits, %" PRIu64
+                " misses (%.1f%% hit rate), %" PRIu64 " inserts, %" PRIu64
+                " evictions, %" PRIu64 " bytes used of %" PRIu64,
+                m_stats.m_hits, m_stats.m_misses, m_stats.HitRate() * 100.0,
+                m_stats.m_inserts, m_stats.m_evictions,
+                static_cast<std::uint64_t>(m_stats.m_size),
+                static_cast<std::uint64_t>(m_maxSize));
+  return report;
+}
+
+void DerivedDataCache::Evict(file_size_t max_size) {
+  if (m_stats.m_size <= max_size) {
+    return;
+  }
+
+  std::vector<std::pair<std::uint64_t, std::string>> order;
+  order.reserve(m_records.size());
+
+  for (const auto &record : m_records) {
+    order.emplace_back(record.second.m_lastUse, record.first);
+  }
+
+  std::sort(order.begin(), order.end());
+
+  for (const auto &oldest : order) {
+    if (m_stats.m_size <= max_size) {
+      break;
+    }
+
+    Drop(oldest.second);
+    ++m_stats.m_evictions;
+  }
+}
+
+void DerivedDataCache::Drop(const std::string &name) {
+  // Name might be the key of the record that is erased
+  const path p = m_directory / CreatePath(name);
+  auto iter = m_records.find(name);
+
+  if (iter != m_records.end()) {
+    m_stats.m_size -= iter->second.m_size;
+    m_records.erase(iter);
+  }
+
+  error_status ignored;
+  Remove(p, ignored);
+}
+
+} // namespace FileLoadSystem
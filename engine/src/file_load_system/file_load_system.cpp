@@ -13,7 +13,11 @@
 #include "os_detection/windows.hpp"
 #endif // IS_WIN
 
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
 #include <filesystem>
+#include <random>
 #include <system_error>
 
 #if IS_WIN
@@ -247,6 +251,20 @@ SmartWriteFile OpenReadAppendText(const path &p) {
   return f;
 }
 
+path GetTemporaryPath(const path &p) {
+  thread_local std::mt19937_64 generator(
+      (static_cast<std::uint64_t>(std::random_device()()) << 32) ^
+      std::random_device()());
+
+  char suffix[32];
+  std::snprintf(suffix, sizeof(suffix), ".%016" PRIx64 ".tmp",
+                static_cast<std::uint64_t>(generator()));
+
+  path temporary = p;
+  temporary += suffix;
+  return temporary;
+}
+
 /* Temporary Path */
 path kTempPath;
 
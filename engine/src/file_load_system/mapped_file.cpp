@@ -0,0 +1,103 @@
+#include "file_load_system/mapped_file.hpp"
+
+#include "file_load_system/file_load_system.hpp"
+#include "os_detection/os_detection.hpp"
+
+#if IS_LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // IS_LINUX
+
+#if IS_WIN
+#include "os_detection/windows.hpp"
+#endif // IS_WIN
+
+#include <cstddef>
+
+namespace FileLoadSystem {
+
+bool MappedFile::Open(const path &p) {
+  Close();
+
+#if IS_WIN
+  HANDLE file = CreateFileW(p.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0) {
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping =
+      CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mapping == nullptr) {
+    return false;
+  }
+
+  // The view keeps the mapping alive
+  void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (data == nullptr) {
+    return false;
+  }
+
+  m_data = static_cast<const char *>(data);
+  m_size = static_cast<size_t>(size.QuadPart);
+// IS_WIN
+#elif IS_LINUX
+  const int file = open(p.c_str(), O_RDONLY | O_CLOEXEC);
+  if (file == -1) {
+    return false;
+  }
+
+  struct stat status;
+  if (fstat(file, &status) != 0 || status.st_size <= 0) {
+    close(file);
+    return false;
+  }
+
+  // The mapping keeps the file alive
+  void *data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ,
+                    MAP_PRIVATE, file, 0);
+  close(file);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+
+  m_data = static_cast<const char *>(data);
+  m_size = static_cast<size_t>(status.st_size);
+// IS_LINUX
+#else
+#error Platform Not Supported Yet
+#endif // else
+
+  return true;
+}
+
+void MappedFile::Close() {
+  if (m_data == nullptr) {
+    return;
+  }
+
+#if IS_WIN
+  UnmapViewOfFile(m_data);
+// IS_WIN
+#elif IS_LINUX
+  munmap(const_cast<char *>(m_data), m_size);
+// IS_LINUX
+#else
+#error Platform Not Supported Yet
+#endif // else
+
+  m_data = nullptr;
+  m_size = 0;
+}
+
+} // namespace FileLoadSystem
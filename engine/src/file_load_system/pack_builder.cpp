@@ -0,0 +1,565 @@
+#include "file_load_system/pack_builder.hpp"
+
+#include "file_load_system/file_load_system.hpp"
+#include "file_load_system/smart_file.hpp"
+#include "utils/hash.hpp"
+#include "utils/lz4.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace FileLoadSystem {
+
+namespace {
+
+/* An entry read, hashed and compressed by a worker */
+struct LoadedEntry {
+  /* What is written to the pack */
+  std::unique_ptr<char[]> m_data;
+  file_size_t m_size = 0;
+  file_size_t m_storedSize = 0;
+  Hash::hash_t m_hash = 0;
+  PackMethod m_method = PackMethod::kStored;
+  bool m_error = false;
+};
+
+/* Read, hash and compress (if asked) a whole file. Runs on a worker */
+LoadedEntry LoadEntry(path source, bool compress) {
+  LoadedEntry res;
+
+  error_status error;
+  res.m_size = FileSize(source, error);
+
+  if (error) {
+    res.m_error = true;
+    return res;
+  }
+
+  SmartReadFile file = OpenReadBinary(source);
+
+  if (!file.IsValid()) {
+    res.m_error = true;
+    return res;
+  }
+
+  res.m_data.reset(new char[static_cast<size_t>(res.m_size) + 1]);
+
+  if (Fread(res.m_data.get(), sizeof(char), static_cast<size_t>(res.m_size),
+            file.Get()) != static_cast<size_t>(res.m_size)) {
+    res.m_error = true;
+    return res;
+  }
+
+  res.m_hash =
+      Hash::Fnv1a(res.m_data.get(), static_cast<std::size_t>(res.m_size));
+  res.m_storedSize = res.m_size;
+
+  // Positions inside a block are 32 bits
+  if (!compress || res.m_size == 0 ||
+      res.m_size > std::numeric_limits<std::uint32_t>::max()) {
+    return res;
+  }
+
+  const size_t size = static_cast<size_t>(res.m_size);
+  std::unique_ptr<char[]> block(new char[Lz4::GetMaxCompressedSize(size)]);
+  const size_t blockSize = Lz4::Compress(res.m_data.get(), size, block.get());
+
+  // Only what gets smaller is compressed
+  if (blockSize < size) {
+    res.m_data = std::move(block);
+    res.m_storedSize = blockSize;
+    res.m_method = PackMethod::kLz4;
+  }
+
+  return res;
+}
+
+/*
+  Fixed set of workers loading entries for the writer. Each one takes the next
+  entry from a shared index, and they only get a window ahead of what the
+  writer took, so only that many entries are in memory
+*/
+class EntryLoader {
+public:
+  EntryLoader(const std::vector<PackEntry> &entries, unsigned workers,
+              bool compress)
+      : m_entries(entries), m_compress(compress),
+        m_window(static_cast<size_t>(workers) * 2), m_slots(m_window),
+        m_ready(m_window, false) {
+    const size_t count = std::min<size_t>(workers, entries.size());
+    m_workers.reserve(count);
+
+    for (size_t i = 0; i < count; ++i) {
+      m_workers.emplace_back(&EntryLoader::Work, this);
+    }
+  }
+  /* Copy is not allowed because it doesn't make sense */
+  EntryLoader(const EntryLoader &) = delete;
+  /* Copy is not allowed because it doesn't make sense */
+  EntryLoader &operator=(const EntryLoader &) = delete;
+  ~EntryLoader() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_space.notify_all();
+
+    for (std::thread &worker : m_workers) {
+      worker.join();
+    }
+  }
+
+  /* Wait for the entry at index, they must be taken in order */
+  LoadedEntry Take(size_t index) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const size_t slot = index % m_window;
+    m_loaded.wait(lock, [&] { return m_ready[slot]; });
+
+    LoadedEntry loaded = std::move(m_slots[slot]);
+    m_ready[slot] = false;
+    ++m_taken;
+
+    lock.unlock();
+    m_space.notify_all();
+    return loaded;
+  }
+
+private:
+  void Work() {
+    for (;;) {
+      const size_t index = m_next.fetch_add(1);
+
+      if (index >= m_entries.size()) {
+        return;
+      }
+
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_space.wait(lock,
+                     [&] { return m_stop || index < m_taken + m_window; });
+
+        if (m_stop) {
+          return;
+        }
+      }
+
+      LoadedEntry loaded = LoadEntry(m_entries[index].m_source, m_compress);
+
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_slots[index % m_window] = std::move(loaded);
+        m_ready[index % m_window] = true;
+      }
+      m_loaded.notify_all();
+    }
+  }
+
+  const std::vector<PackEntry> &m_entries;
+  const bool m_compress;
+  const size_t m_window;
+
+  std::atomic<size_t> m_next{0};
+
+  /* Guards everything below */
+  std::mutex m_mutex;
+  std::condition_variable m_loaded;
+  std::condition_variable m_space;
+  /* Entry at index goes to slot index % m_window */
+  std::vector<LoadedEntry> m_slots;
+  std::vector<bool> m_ready;
+  size_t m_taken = 0;
+  bool m_stop = false;
+
+  std::vector<std::thread> m_workers;
+};
+
+/* Write a little endian unsigned integer */
+template <typename T> bool WriteLE(std::FILE *f, T value) {
+  unsigned char bytes[sizeof(T)];
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    bytes[i] = static_cast<unsigned char>(value >> (8 * i));
+  }
+  return Fwrite(bytes, sizeof(unsigned char), sizeof(T), f) == sizeof(T);
+}
+
+/* Write zeros until offset is aligned */
+bool WritePadding(std::FILE *f, file_size_t &offset) {
+  static constexpr char kZeros[kPackAlignment] = {};
+  file_size_t padding =
+      (kPackAlignment - (offset % kPackAlignment)) % kPackAlignment;
+
+  if (Fwrite(kZeros, sizeof(char), static_cast<size_t>(padding), f) !=
+      static_cast<size_t>(padding)) {
+    return false;
+  }
+
+  offset += padding;
+  return true;
+}
+
+/* Read a little endian unsigned integer */
+template <typename T> bool ReadLE(std::FILE *f, T *value) {
+  unsigned char bytes[sizeof(T)];
+  if (Fread(bytes, sizeof(unsigned char), sizeof(T), f) != sizeof(T)) {
+    return false;
+  }
+
+  *value = 0;
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    *value |= static_cast<T>(static_cast<T>(bytes[i]) << (8 * i));
+  }
+  return true;
+}
+
+/* Write the header of a pack */
+bool WriteHeader(std::FILE *f, std::uint64_t count, std::uint64_t table) {
+  return Fwrite(kPackMagic, sizeof(char), sizeof(kPackMagic), f) ==
+             sizeof(kPackMagic) &&
+         WriteLE<std::uint32_t>(f, kPackVersion) &&
+         WriteLE<std::uint64_t>(f, count) && WriteLE<std::uint64_t>(f, table);
+}
+
+/* Size of the header of a pack */
+constexpr file_size_t kPackHeaderSize = sizeof(kPackMagic) +
+                                        sizeof(std::uint32_t) +
+                                        2 * sizeof(std::uint64_t);
+
+/* Write the entries to a pack, filling where they were written */
+error_status WritePack(const path &pack, std::vector<PackEntry> &entries,
+                       unsigned workers, bool compress) {
+  SmartWriteFile file = OpenWriteBinary(pack);
+
+  if (!file.IsValid()) {
+    return std::make_error_code(std::errc::io_error);
+  }
+
+  // Table offset is patched when it is known
+  if (!WriteHeader(file.Get(), entries.size(), 0)) {
+    return std::make_error_code(std::errc::io_error);
+  }
+
+  file_size_t offset = kPackHeaderSize;
+
+  // Entries are read by the workers while the oldest one is written
+  EntryLoader loader(entries, workers, compress);
+
+  for (size_t i = 0; i < entries.size(); ++i) {
+    PackEntry &entry = entries[i];
+    LoadedEntry loaded = loader.Take(i);
+
+    if (loaded.m_error) {
+      return std::make_error_code(std::errc::io_error);
+    }
+
+    if (!WritePadding(file.Get(), offset)) {
+      return std::make_error_code(std::errc::io_error);
+    }
+
+    if (Fwrite(loaded.m_data.get(), sizeof(char),
+               static_cast<size_t>(loaded.m_storedSize),
+               file.Get()) != static_cast<size_t>(loaded.m_storedSize)) {
+      return std::make_error_code(std::errc::io_error);
+    }
+
+    entry.m_offset = offset;
+    entry.m_size = loaded.m_size;
+    entry.m_storedSize = loaded.m_storedSize;
+    entry.m_hash = loaded.m_hash;
+    entry.m_method = loaded.m_method;
+
+    offset += loaded.m_storedSize;
+  }
+
+  const file_size_t table = offset;
+
+  for (const PackEntry &entry : entries) {
+    if (!WriteLE<std::uint64_t>(file.Get(), entry.m_offset) ||
+        !WriteLE<std::uint64_t>(file.Get(), entry.m_size) ||
+        !WriteLE<std::uint64_t>(file.Get(), entry.m_storedSize) ||
+        !WriteLE<std::uint64_t>(file.Get(), entry.m_hash) ||
+        !WriteLE<std::uint8_t>(file.Get(),
+                               static_cast<std::uint8_t>(entry.m_method)) ||
+        !WriteLE<std::uint32_t>(
+            file.Get(), static_cast<std::uint32_t>(entry.m_name.size())) ||
+        Fwrite(entry.m_name.data(), sizeof(char), entry.m_name.size(),
+               file.Get()) != entry.m_name.size()) {
+      return std::make_error_code(std::errc::io_error);
+    }
+  }
+
+  if (FSeek(file.Get(), 0, kSeekSet) != 0 ||
+      !WriteHeader(file.Get(), entries.size(), table) ||
+      std::fflush(file.Get()) != 0 || Ferror(file.Get())) {
+    return std::make_error_code(std::errc::io_error);
+  }
+
+  return error_status();
+}
+
+} // namespace
+
+error_status GatherPackEntries(const path &content,
+                               std::vector<PackEntry> &entries) {
+  error_status error;
+  entries.clear();
+
+  std::filesystem::recursive_directory_iterator iter(content, error);
+
+  if (error) {
+    return error;
+  }
+
+  for (; iter != std::filesystem::recursive_directory_iterator();
+       iter.increment(error)) {
+    if (error) {
+      return error;
+    }
+
+    if (!iter->is_regular_file(error)) {
+      continue;
+    }
+
+    PackEntry entry;
+    entry.m_source = iter->path();
+    entry.m_name = entry.m_source.lexically_relative(content).generic_u8string();
+    entries.push_back(std::move(entry));
+  }
+
+  std::sort(entries.begin(), entries.end(),
+            [](const PackEntry &a, const PackEntry &b) {
+              return a.m_name < b.m_name;
+            });
+
+  return error;
+}
+
+error_status OrderPackEntries(const path &access_order,
+                              std::vector<PackEntry> &entries) {
+  error_status error;
+  file_size_t size = FileSize(access_order, error);
+
+  if (error) {
+    return error;
+  }
+
+  SmartReadFile file = OpenReadText(access_order);
+
+  if (!file.IsValid()) {
+    return std::make_error_code(std::errc::io_error);
+  }
+
+  std::string text(static_cast<size_t>(size), '\0');
+  text.resize(Fread(text.data(), sizeof(char), text.size(), file.Get()));
+
+  // Position of each name in the list, the first one wins
+  std::unordered_map<std::string, size_t> rank;
+  size_t start = 0;
+
+  while (start < text.size()) {
+    size_t end = text.find('\n', start);
+
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+
+    std::string name = text.substr(start, end - start);
+
+    if (!name.empty() && name.back() == '\r') {
+      name.pop_back();
+    }
+
+    if (!name.empty()) {
+      rank.emplace(CreatePath(name).generic_u8string(), rank.size());
+    }
+
+    start = end + 1;
+  }
+
+  // Listed first by rank, then the rest keeping their order
+  std::stable_sort(entries.begin(), entries.end(),
+                   [&rank](const PackEntry &a, const PackEntry &b) {
+                     auto aIter = rank.find(a.m_name);
+                     auto bIter = rank.find(b.m_name);
+
+                     if (bIter == rank.end()) {
+                       return aIter != rank.end();
+                     }
+
+                     return aIter != rank.end() && aIter->second < bIter->second;
+                   });
+
+  return error;
+}
+
+error_status BuildPack(const path &content, const path &pack,
+                       const PackBuildOptions &options,
+                       std::vector<PackEntry> *result) {
+  std::vector<PackEntry> entries;
+  error_status error = GatherPackEntries(content, entries);
+
+  if (error) {
+    return error;
+  }
+
+  if (!options.m_accessOrder.empty()) {
+    error = OrderPackEntries(options.m_accessOrder, entries);
+
+    if (error) {
+      return error;
+    }
+  }
+
+  unsigned workers = options.m_workers;
+
+  if (workers == 0) {
+    workers = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  const path tmpPack = GetTemporaryPath(pack);
+
+  error = WritePack(tmpPack, entries, workers, options.m_compress);
+
+  // Rename replaces the old pack, which is kept if anything failed
+  if (!error) {
+    Rename(tmpPack, pack, error);
+  }
+
+  if (error) {
+    error_status ignored;
+    Remove(tmpPack, ignored);
+    return error;
+  }
+
+  if (result != nullptr) {
+    *result = std::move(entries);
+  }
+
+  return error;
+}
+
+error_status ReadPackTable(const path &pack, std::vector<PackEntry> &entries) {
+  entries.clear();
+
+  error_status error;
+  const file_size_t packSize = FileSize(pack, error);
+
+  if (error) {
+    return error;
+  }
+
+  SmartReadFile file = OpenReadBinary(pack);
+
+  if (!file.IsValid()) {
+    return std::make_error_code(std::errc::io_error);
+  }
+
+  char magic[sizeof(kPackMagic)];
+  std::uint32_t version;
+  std::uint64_t count;
+  std::uint64_t table;
+
+  if (Fread(magic, sizeof(char), sizeof(magic), file.Get()) != sizeof(magic) ||
+      std::memcmp(magic, kPackMagic, sizeof(kPackMagic)) != 0 ||
+      !ReadLE(file.Get(), &version) || version != kPackVersion ||
+      !ReadLE(file.Get(), &count) || !ReadLE(file.Get(), &table) ||
+      table < kPackHeaderSize || table > packSize ||
+      FSeek(file.Get(), table, kSeekSet) != 0) {
+    return std::make_error_code(std::errc::illegal_byte_sequence);
+  }
+
+  // Every entry takes some bytes, so a broken count can't allocate much
+  if (count > packSize - table) {
+    return std::make_error_code(std::errc::illegal_byte_sequence);
+  }
+
+  entries.resize(static_cast<size_t>(count));
+
+  for (PackEntry &entry : entries) {
+    std::uint8_t method;
+    std::uint32_t nameSize;
+
+    if (!ReadLE<std::uint64_t>(file.Get(), &entry.m_offset) ||
+        !ReadLE<std::uint64_t>(file.Get(), &entry.m_size) ||
+        !ReadLE<std::uint64_t>(file.Get(), &entry.m_storedSize) ||
+        !ReadLE<std::uint64_t>(file.Get(), &entry.m_hash) ||
+        !ReadLE(file.Get(), &method) || !ReadLE(file.Get(), &nameSize) ||
+        method > static_cast<std::uint8_t>(PackMethod::kLz4) ||
+        entry.m_offset < kPackHeaderSize || entry.m_offset > table ||
+        entry.m_storedSize > table - entry.m_offset ||
+        nameSize > packSize - table) {
+      entries.clear();
+      return std::make_error_code(std::errc::illegal_byte_sequence);
+    }
+
+    entry.m_method = static_cast<PackMethod>(method);
+    entry.m_name.resize(nameSize);
+
+    if (Fread(entry.m_name.data(), sizeof(char), nameSize, file.Get()) !=
+        nameSize) {
+      entries.clear();
+      return std::make_error_code(std::errc::illegal_byte_sequence);
+    }
+  }
+
+  return error;
+}
+
+error_status ReadPackEntry(const path &pack, const PackEntry &entry,
+                           std::vector<char> &data) {
+  data.clear();
+
+  // Stored entries are as big as the original and a LZ4 byte decodes to 255
+  // at most, so a broken table can't allocate much
+  if ((entry.m_method == PackMethod::kStored &&
+       entry.m_storedSize != entry.m_size) ||
+      entry.m_size / 255 > entry.m_storedSize) {
+    return std::make_error_code(std::errc::illegal_byte_sequence);
+  }
+
+  SmartReadFile file = OpenReadBinary(pack);
+
+  if (!file.IsValid()) {
+    return std::make_error_code(std::errc::io_error);
+  }
+
+  std::vector<char> stored(static_cast<size_t>(entry.m_storedSize));
+
+  if (FSeek(file.Get(), entry.m_offset, kSeekSet) != 0 ||
+      Fread(stored.data(), sizeof(char), stored.size(), file.Get()) !=
+          stored.size()) {
+    return std::make_error_code(std::errc::io_error);
+  }
+
+  if (entry.m_method == PackMethod::kStored) {
+    data = std::move(stored);
+  } else {
+    data.resize(static_cast<size_t>(entry.m_size));
+
+    if (!Lz4::Decompress(stored.data(), stored.size(), data.data(),
+                         data.size())) {
+      data.clear();
+      return std::make_error_code(std::errc::illegal_byte_sequence);
+    }
+  }
+
+  if (Hash::Fnv1a(data.data(), data.size()) != entry.m_hash) {
+    data.clear();
+    return std::make_error_code(std::errc::illegal_byte_sequence);
+  }
+
+  return error_status();
+}
+
+} // namespace FileLoadSystem
@@ -0,0 +1,89 @@
+#include "os_detection/cpu_features.hpp"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+
+namespace OsDetection {
+
+namespace {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) ||             \
+    defined(__i386__)
+/* Bit of SSE2 in EDX of CPUID leaf 1 */
+constexpr unsigned kSse2Bit = 1u << 26;
+
+/* Bit of SSE4.2 in ECX of CPUID leaf 1 */
+constexpr unsigned kSse42Bit = 1u << 20;
+#endif
+
+CpuFeatures DetectCpuFeatures() {
+  CpuFeatures features;
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  int info[4];
+  __cpuid(info, 0);
+
+  if (info[0] >= 1) {
+    __cpuid(info, 1);
+    features.m_sse2 = (static_cast<unsigned>(info[3]) & kSse2Bit) != 0;
+    features.m_sse42 = (static_cast<unsigned>(info[2]) & kSse42Bit) != 0;
+  }
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  unsigned eax, ebx, ecx, edx;
+
+  if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) != 0) {
+    features.m_sse2 = (edx & kSse2Bit) != 0;
+    features.m_sse42 = (ecx & kSse42Bit) != 0;
+  }
+#elif defined(__aarch64__) || defined(_M_ARM64)
+  // Advanced SIMD is mandatory in ARMv8
+  features.m_neon = true;
+#elif defined(__ARM_NEON)
+  // 32 bits ARM only gets here if it was built for NEON
+  features.m_neon = true;
+#endif
+
+  return features;
+}
+} // namespace
+
+const CpuFeatures &GetCpuFeatures() {
+  static const CpuFeatures features = DetectCpuFeatures();
+  return features;
+}
+
+bool HasSimd(SimdLevel level) {
+  const CpuFeatures &features = GetCpuFeatures();
+
+  switch (level) {
+  case SimdLevel::kNone:
+    return true;
+  case SimdLevel::kSse2:
+    return features.m_sse2;
+  case SimdLevel::kSse42:
+    return features.m_sse42;
+  case SimdLevel::kNeon:
+    return features.m_neon;
+  }
+
+  return false;
+}
+
+const char *GetSimdName(SimdLevel level) {
+  switch (level) {
+  case SimdLevel::kNone:
+    return "none";
+  case SimdLevel::kSse2:
+    return "SSE2";
+  case SimdLevel::kSse42:
+    return "SSE4.2";
+  case SimdLevel::kNeon:
+    return "NEON";
+  }
+
+  return "unknown";
+}
+
+} // namespace OsDetection
@@ -0,0 +1,98 @@
+#include "serialization/background_save.hpp"
+
+#include "file_load_system/file_load_system.hpp"
+#include "file_load_system/smart_file.hpp"
+#include "serialization/serializer.hpp"
+#include "serialization/serializer_factory.hpp"
+#include "serialization/sink.hpp"
+
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace Serializer {
+
+namespace {
+/* Write text to a unique file next to path and rename it to path */
+bool WriteSave(const FileLoadSystem::path &path, std::string_view text) {
+  const FileLoadSystem::path temporary = FileLoadSystem::GetTemporaryPath(path);
+
+  bool written;
+  {
+    FileLoadSystem::SmartWriteFile file =
+        FileLoadSystem::OpenWriteBinary(temporary);
+    FileSink sink(file);
+
+    written = file.IsValid() && sink.Write(text.data(), text.size()) &&
+              sink.Flush();
+  }
+
+  FileLoadSystem::error_status error;
+  if (!written) {
+    FileLoadSystem::Remove(temporary, error);
+    return false;
+  }
+
+  FileLoadSystem::Rename(temporary, path, error);
+
+  if (error) {
+    FileLoadSystem::Remove(temporary, error);
+    return false;
+  }
+
+  return true;
+}
+
+/* Everything a background save does */
+bool SaveSnapshot(ISerializable &snapshot, const std::string &name,
+                  const FileLoadSystem::path &path, SerializerFormat format,
+                  bool pretty) {
+  std::unique_ptr<ISerializer> serializer = CreateSerializer(format);
+
+  if (!serializer ||
+      !snapshot.Serialize(serializer.get(), name.c_str(), name.length()) ||
+      !(pretty ? serializer->CompilePretty() : serializer->Compile())) {
+    return false;
+  }
+
+  std::string_view text;
+  if (serializer->GetView(&text)) {
+    return WriteSave(path, text);
+  }
+
+  // Without a view the text is copied out, with its null terminator
+  s_size size;
+  if (!serializer->GetSize(&size) || size == 0) {
+    return false;
+  }
+
+  std::unique_ptr<char[]> buffer(new char[size]);
+  if (!serializer->GetText(buffer.get())) {
+    return false;
+  }
+
+  return WriteSave(path, std::string_view(buffer.get(), size - 1));
+}
+} // namespace
+
+std::future<bool> SaveInBackground(std::shared_ptr<ISerializable> snapshot,
+                                   std::string name,
+                                   FileLoadSystem::path path,
+                                   SerializerFormat format, bool pretty) {
+  if (!snapshot) {
+    std::promise<bool> failed;
+    failed.set_value(false);
+    return failed.get_future();
+  }
+
+  return std::async(std::launch::async,
+                    [snapshot = std::move(snapshot), name = std::move(name),
+                     path = std::move(path), format, pretty]() {
+                      return SaveSnapshot(*snapshot, name, path, format,
+                                          pretty);
+                    });
+}
+
+} // namespace Serializer
@@ -0,0 +1,315 @@
+#include "serialization/binary_serializer.hpp"
+
+#include "serialization/serializer.hpp"
+#include "serialization/tree_serializer.hpp"
+
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace Serializer {
+
+bool BinarySerializer::ParseText(const char *text) {
+  // Magic has no null terminators so a shorter text stops the comparison
+  if (std::strncmp(text, kMagic, sizeof(kMagic)) != 0) {
+    return false;
+  }
+
+  std::uint64_t size = 0;
+  for (size_t i = 0; i < sizeof(std::uint64_t); ++i) {
+    size |= static_cast<std::uint64_t>(
+                static_cast<unsigned char>(text[sizeof(kMagic) + i]))
+            << (8 * i);
+  }
+
+  return ParseText(text, kHeaderSize + static_cast<size_t>(size));
+}
+
+bool BinarySerializer::ParseText(const char *text, size_t length) {
+  if (length < kHeaderSize ||
+      std::memcmp(text, kMagic, sizeof(kMagic)) != 0) {
+    return false;
+  }
+
+  std::uint64_t size = 0;
+  for (size_t i = 0; i < sizeof(std::uint64_t); ++i) {
+    size |= static_cast<std::uint64_t>(
+                static_cast<unsigned char>(text[sizeof(kMagic) + i]))
+            << (8 * i);
+  }
+
+  // Length might include a null terminator
+  if (size > length - kHeaderSize) {
+    return false;
+  }
+
+  Clear();
+
+  const char *cursor = text + kHeaderSize;
+  const char *end = cursor + size;
+
+  if (!ReadChildren(cursor, end, kRoot, true, 0) || cursor != end) {
+    Clear();
+    return false;
+  }
+
+  return true;
+}
+
+bool BinarySerializer::Compile() {
+  m_buffer.clear();
+  m_buffer.insert(m_buffer.end(), kMagic, kMagic + sizeof(kMagic));
+  // Body size is patched at the end
+  m_buffer.resize(kHeaderSize, '\0');
+
+  WriteChildren(kRoot, true);
+
+  const std::uint64_t size =
+      static_cast<std::uint64_t>(m_buffer.size() - kHeaderSize);
+  for (size_t i = 0; i < sizeof(std::uint64_t); ++i) {
+    m_buffer[sizeof(kMagic) + i] = static_cast<char>(size >> (8 * i));
+  }
+
+  return true;
+}
+
+bool BinarySerializer::CompilePretty() { return Compile(); }
+
+void BinarySerializer::WriteVarint(std::uint64_t value) {
+  while (value >= 0x80) {
+    m_buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  m_buffer.push_back(static_cast<char>(value));
+}
+
+void BinarySerializer::WriteChildren(node_index parent, bool named) {
+  WriteVarint(m_nodes[parent].m_childCount);
+
+  for (node_index child = m_nodes[parent].m_firstChild; child != kNone;
+       child = m_nodes[child].m_next) {
+    const Node &node = m_nodes[child];
+
+    if (named) {
+      WriteVarint(node.m_nameLength);
+      const char *name = GetPoolString(node.m_name);
+      m_buffer.insert(m_buffer.end(), name, name + node.m_nameLength);
+    }
+
+    WriteValue(node, child);
+  }
+}
+
+void BinarySerializer::WriteValue(const Node &node, node_index index) {
+  switch (node.m_type) {
+  case NodeType::kNull:
+    m_buffer.push_back(static_cast<char>(kTagNull));
+    break;
+  case NodeType::kBool:
+    m_buffer.push_back(static_cast<char>(node.m_bool ? kTagTrue : kTagFalse));
+    break;
+  case NodeType::kUint:
+    m_buffer.push_back(static_cast<char>(kTagUint));
+    WriteVarint(node.m_uint);
+    break;
+  case NodeType::kInt:
+    m_buffer.push_back(static_cast<char>(kTagSint));
+    // ZigZag: small magnitudes give small varints
+    WriteVarint((static_cast<std::uint64_t>(node.m_int) << 1) ^
+                static_cast<std::uint64_t>(node.m_int >> 63));
+    break;
+  case NodeType::kDouble: {
+    m_buffer.push_back(static_cast<char>(kTagDouble));
+    std::uint64_t bits;
+    std::memcpy(&bits, &node.m_double, sizeof(bits));
+    for (size_t i = 0; i < sizeof(bits); ++i) {
+      m_buffer.push_back(static_cast<char>(bits >> (8 * i)));
+    }
+    break;
+  }
+  case NodeType::kString: {
+    m_buffer.push_back(static_cast<char>(kTagString));
+    WriteVarint(node.m_stringLength);
+    const char *text = GetPoolString(node.m_string);
+    m_buffer.insert(m_buffer.end(), text, text + node.m_stringLength);
+    break;
+  }
+  case NodeType::kBlob: {
+    m_buffer.push_back(static_cast<char>(kTagBlob));
+    WriteVarint(node.m_stringLength);
+    // Counted from the start, after the padding count itself
+    const size_t padding =
+        (kBlobAlignment - (m_buffer.size() + 1) % kBlobAlignment) %
+        kBlobAlignment;
+    m_buffer.push_back(static_cast<char>(padding));
+    m_buffer.resize(m_buffer.size() + padding, '\0');
+    const char *data = GetPoolString(node.m_string);
+    m_buffer.insert(m_buffer.end(), data, data + node.m_stringLength);
+    break;
+  }
+  case NodeType::kArray:
+    m_buffer.push_back(static_cast<char>(kTagArray));
+    WriteChildren(index, false);
+    break;
+  case NodeType::kObject:
+  case NodeType::kEntry:
+    m_buffer.push_back(static_cast<char>(kTagEntry));
+    WriteVarint(node.m_uint);
+    WriteChildren(index, true);
+    break;
+  }
+}
+
+bool BinarySerializer::ReadVarint(const char *&cursor, const char *end,
+                                  std::uint64_t *value) {
+  std::uint64_t result = 0;
+
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (cursor == end) {
+      return false;
+    }
+
+    std::uint64_t byte = static_cast<unsigned char>(*cursor++);
+    result |= (byte & 0x7F) << shift;
+
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool BinarySerializer::ReadChildren(const char *&cursor, const char *end,
+                                    node_index parent, bool named,
+                                    std::uint32_t depth) {
+  std::uint64_t count;
+
+  if (depth > kMaxParseDepth || !ReadVarint(cursor, end, &count)) {
+    return false;
+  }
+
+  for (std::uint64_t i = 0; i < count; ++i) {
+    Node node;
+
+    if (named) {
+      std::uint64_t nameLength;
+
+      if (!ReadVarint(cursor, end, &nameLength) ||
+          nameLength > static_cast<std::uint64_t>(end - cursor)) {
+        return false;
+      }
+
+      node.m_name = AddString(cursor, static_cast<s_size>(nameLength));
+      node.m_nameLength = static_cast<std::uint32_t>(nameLength);
+      cursor += nameLength;
+    }
+
+    if (cursor == end) {
+      return false;
+    }
+
+    const std::uint8_t tag = static_cast<std::uint8_t>(*cursor++);
+    bool recurse = false;
+
+    switch (tag) {
+    case kTagNull:
+      node.m_type = NodeType::kNull;
+      break;
+    case kTagFalse:
+    case kTagTrue:
+      node.m_type = NodeType::kBool;
+      node.m_bool = tag == kTagTrue;
+      break;
+    case kTagUint:
+      node.m_type = NodeType::kUint;
+      if (!ReadVarint(cursor, end, &node.m_uint)) {
+        return false;
+      }
+      break;
+    case kTagSint: {
+      std::uint64_t zigzag;
+      if (!ReadVarint(cursor, end, &zigzag)) {
+        return false;
+      }
+      node.m_type = NodeType::kInt;
+      node.m_int = static_cast<std::int64_t>(zigzag >> 1) ^
+                   -static_cast<std::int64_t>(zigzag & 1);
+      break;
+    }
+    case kTagDouble: {
+      if (end - cursor < static_cast<std::ptrdiff_t>(sizeof(std::uint64_t))) {
+        return false;
+      }
+      std::uint64_t bits = 0;
+      for (size_t j = 0; j < sizeof(bits); ++j) {
+        bits |=
+            static_cast<std::uint64_t>(static_cast<unsigned char>(*cursor++))
+            << (8 * j);
+      }
+      node.m_type = NodeType::kDouble;
+      std::memcpy(&node.m_double, &bits, sizeof(bits));
+      break;
+    }
+    case kTagString: {
+      std::uint64_t length;
+      if (!ReadVarint(cursor, end, &length) ||
+          length > static_cast<std::uint64_t>(end - cursor)) {
+        return false;
+      }
+      node.m_type = NodeType::kString;
+      node.m_string = AddString(cursor, static_cast<s_size>(length));
+      node.m_stringLength = static_cast<std::uint32_t>(length);
+      cursor += length;
+      break;
+    }
+    case kTagBlob: {
+      std::uint64_t size;
+      if (!ReadVarint(cursor, end, &size) || cursor == end) {
+        return false;
+      }
+      const size_t padding = static_cast<unsigned char>(*cursor++);
+      if (padding >= kBlobAlignment ||
+          padding > static_cast<size_t>(end - cursor) ||
+          size > static_cast<std::uint64_t>(end - cursor) - padding ||
+          size > std::numeric_limits<std::uint32_t>::max()) {
+        return false;
+      }
+      cursor += padding;
+      node.m_type = NodeType::kBlob;
+      node.m_string = AddString(cursor, static_cast<s_size>(size));
+      node.m_stringLength = static_cast<std::uint32_t>(size);
+      cursor += size;
+      break;
+    }
+    case kTagArray:
+      node.m_type = NodeType::kArray;
+      recurse = true;
+      break;
+    case kTagEntry:
+      node.m_type = NodeType::kEntry;
+      if (!ReadVarint(cursor, end, &node.m_uint)) {
+        return false;
+      }
+      recurse = true;
+      break;
+    default:
+      return false;
+    }
+
+    node_index index = static_cast<node_index>(m_nodes.size());
+    m_nodes.push_back(node);
+    AppendChild(parent, index);
+
+    if (recurse &&
+        !ReadChildren(cursor, end, index, node.m_type == NodeType::kEntry,
+                      depth + 1)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+} // namespace Serializer
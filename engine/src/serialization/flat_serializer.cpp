@@ -0,0 +1,190 @@
+#include "serialization/flat_serializer.hpp"
+
+#include "serialization/serializer.hpp"
+#include "serialization/tree_serializer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace Serializer {
+
+namespace {
+/* Where each field of the header is */
+constexpr size_t kNodeSizeOffset = 4;
+constexpr size_t kByteOrderMarkOffset = 8;
+constexpr size_t kNodeCountOffset = 16;
+constexpr size_t kStringsSizeOffset = 24;
+} // namespace
+
+bool FlatSerializer::ReadHeader(const char *text, Header *header) {
+  if (std::memcmp(text, kMagic, sizeof(kMagic)) != 0) {
+    return false;
+  }
+
+  std::memcpy(&header->m_nodeSize, text + kNodeSizeOffset,
+              sizeof(header->m_nodeSize));
+  std::memcpy(&header->m_byteOrderMark, text + kByteOrderMarkOffset,
+              sizeof(header->m_byteOrderMark));
+  std::memcpy(&header->m_nodeCount, text + kNodeCountOffset,
+              sizeof(header->m_nodeCount));
+  std::memcpy(&header->m_stringsSize, text + kStringsSizeOffset,
+              sizeof(header->m_stringsSize));
+
+  // Nodes are read in place, so they must be laid out like ours
+  return header->m_nodeSize == sizeof(Node) &&
+         header->m_byteOrderMark == kByteOrderMark &&
+         header->m_nodeCount != 0 && header->m_nodeCount <= kNone;
+}
+
+bool FlatSerializer::ParseText(const char *text) {
+  // Magic has no null terminators so a shorter text stops the comparison
+  if (std::strncmp(text, kMagic, sizeof(kMagic)) != 0) {
+    return false;
+  }
+
+  Header header;
+  if (!ReadHeader(text, &header)) {
+    return false;
+  }
+
+  return ParseText(text, kHeaderSize + static_cast<size_t>(
+                                           header.m_nodeCount * sizeof(Node) +
+                                           header.m_stringsSize));
+}
+
+bool FlatSerializer::ParseText(const char *text, size_t length) {
+  Header header;
+
+  if (length < kHeaderSize ||
+      reinterpret_cast<std::uintptr_t>(text) % alignof(Node) != 0 ||
+      !ReadHeader(text, &header)) {
+    return false;
+  }
+
+  const size_t room = length - kHeaderSize;
+
+  if (header.m_nodeCount > room / sizeof(Node) ||
+      header.m_stringsSize > room - header.m_nodeCount * sizeof(Node)) {
+    return false;
+  }
+
+  const Node *nodes = reinterpret_cast<const Node *>(text + kHeaderSize);
+
+  if (nodes[kRoot].m_type != NodeType::kObject) {
+    return false;
+  }
+
+  Clear();
+
+  // Nothing is decoded, reads go to the image
+  m_mappedNodes = nodes;
+  m_mappedNodeCount = static_cast<size_t>(header.m_nodeCount);
+  m_mappedStrings = text + kHeaderSize + m_mappedNodeCount * sizeof(Node);
+  m_mappedStringsSize = static_cast<size_t>(header.m_stringsSize);
+  return true;
+}
+
+bool FlatSerializer::Compile() {
+  const bool mapped = m_mappedNodes != nullptr;
+  const Node *nodes = mapped ? m_mappedNodes : m_nodes.data();
+  const size_t nodeCount = mapped ? m_mappedNodeCount : m_nodes.size();
+  const char *strings = mapped ? m_mappedStrings : m_strings.data();
+  const size_t stringsSize = mapped ? m_mappedStringsSize : m_strings.size();
+
+  m_buffer.assign(kHeaderSize, '\0');
+  std::memcpy(m_buffer.data(), kMagic, sizeof(kMagic));
+
+  const std::uint32_t nodeSize = sizeof(Node);
+  const std::uint64_t count = nodeCount;
+  const std::uint64_t size = stringsSize;
+  std::memcpy(m_buffer.data() + kNodeSizeOffset, &nodeSize, sizeof(nodeSize));
+  std::memcpy(m_buffer.data() + kByteOrderMarkOffset, &kByteOrderMark,
+              sizeof(kByteOrderMark));
+  std::memcpy(m_buffer.data() + kNodeCountOffset, &count, sizeof(count));
+  std::memcpy(m_buffer.data() + kStringsSizeOffset, &size, sizeof(size));
+
+  const size_t nodesSize = nodeCount * sizeof(Node);
+  m_buffer.resize(kHeaderSize + nodesSize + stringsSize);
+
+  char *image = m_buffer.data() + kHeaderSize;
+  std::memcpy(image, nodes, nodesSize);
+  std::memcpy(image + nodesSize, strings, stringsSize);
+
+  // The padding after the type is not initialized, so images are repeatable
+  for (size_t i = 0; i < nodeCount; ++i) {
+    std::memset(image + i * sizeof(Node) + sizeof(NodeType), 0,
+                offsetof(Node, m_name) - sizeof(NodeType));
+  }
+
+  return true;
+}
+
+bool FlatSerializer::CompilePretty() { return Compile(); }
+
+bool FlatSerializer::Verify() const {
+  if (m_mappedNodes == nullptr) {
+    return true;
+  }
+
+  for (size_t i = 0; i < m_mappedNodeCount; ++i) {
+    const Node &node = m_mappedNodes[i];
+
+    if (node.m_type > NodeType::kEntry ||
+        (node.m_type == NodeType::kObject && i != kRoot)) {
+      return false;
+    }
+
+    // Children and siblings are always added after a node, so this also
+    // means there are no cycles
+    if ((node.m_firstChild != kNone &&
+         (node.m_firstChild <= i || node.m_firstChild >= m_mappedNodeCount)) ||
+        (node.m_next != kNone &&
+         (node.m_next <= i || node.m_next >= m_mappedNodeCount))) {
+      return false;
+    }
+
+    // Strings are null terminated inside the pool
+    if (node.m_name != kNone &&
+        (node.m_name >= m_mappedStringsSize ||
+         node.m_nameLength >= m_mappedStringsSize - node.m_name ||
+         m_mappedStrings[node.m_name + node.m_nameLength] != '\0')) {
+      return false;
+    }
+
+    if ((node.m_type == NodeType::kString || node.m_type == NodeType::kBlob) &&
+        (node.m_string >= m_mappedStringsSize ||
+         node.m_stringLength >= m_mappedStringsSize - node.m_string ||
+         m_mappedStrings[node.m_string + node.m_stringLength] != '\0')) {
+      return false;
+    }
+
+    // Every child of an array or entry is where its count says, and the last
+    // one is where the next Set appends after copying the image
+    if (node.m_type == NodeType::kArray || node.m_type == NodeType::kEntry ||
+        node.m_type == NodeType::kObject) {
+      std::uint32_t count = 0;
+      node_index last = kNone;
+      for (node_index child = node.m_firstChild; child != kNone;
+           child = m_mappedNodes[child].m_next) {
+        if (child >= m_mappedNodeCount ||
+            (m_mappedNodes[child].m_name == kNone) !=
+                (node.m_type == NodeType::kArray) ||
+            ++count > node.m_childCount) {
+          return false;
+        }
+        last = child;
+      }
+      if (count != node.m_childCount || node.m_lastChild != last) {
+        return false;
+      }
+    } else if (node.m_firstChild != kNone || node.m_lastChild != kNone ||
+               node.m_childCount != 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+} // namespace Serializer
@@ -0,0 +1,79 @@
+#include "serialization/incremental_save.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace Serializer {
+
+IncrementalSave::IncrementalSave() {
+  // Cleared for every object, so it keeps one block of the biggest one
+  m_scratch.SetArenaReset(true);
+}
+
+bool IncrementalSave::Compile(ISerializable &object, const char *name,
+                              s_size name_length, std::uint64_t generation,
+                              CachedObject *cached) {
+  cached->m_generation = ISerializable::kUntrackedGeneration;
+  cached->m_fragments.clear();
+
+  if (!m_scratch.Clear() ||
+      !object.Serialize(&m_scratch, name, name_length) ||
+      !m_scratch.CompileFragments(&cached->m_fragments)) {
+    return false;
+  }
+
+  cached->m_generation = generation;
+  cached->m_name.assign(name, name_length);
+  return true;
+}
+
+bool IncrementalSave::Save(JsonStreamSerializer &target, ISerializable &object,
+                           const char *name, s_size name_length) {
+  const std::uint64_t generation = object.GetSaveGeneration();
+
+  // Untracked objects are not worth keeping, they can't be reused
+  if (generation == ISerializable::kUntrackedGeneration) {
+    CachedObject scratch;
+    ++m_serializedCount;
+    return Compile(object, name, name_length, generation, &scratch) &&
+           target.Splice(scratch.m_fragments);
+  }
+
+  CachedObject &cached = m_cache[&object];
+  cached.m_saved = true;
+
+  if (cached.m_generation == generation &&
+      std::string_view(cached.m_name) == std::string_view(name, name_length)) {
+    ++m_reusedCount;
+  } else {
+    ++m_serializedCount;
+    if (!Compile(object, name, name_length, generation, &cached)) {
+      return false;
+    }
+  }
+
+  return target.Splice(cached.m_fragments);
+}
+
+void IncrementalSave::EndPass() {
+  for (auto iter = m_cache.begin(); iter != m_cache.end();) {
+    if (iter->second.m_saved) {
+      iter->second.m_saved = false;
+      ++iter;
+    } else {
+      iter = m_cache.erase(iter);
+    }
+  }
+
+  m_serializedCount = 0;
+  m_reusedCount = 0;
+}
+
+void IncrementalSave::Clear() {
+  m_cache.clear();
+  m_serializedCount = 0;
+  m_reusedCount = 0;
+}
+
+} // namespace Serializer
@@ -0,0 +1,209 @@
+#include "serialization/json_lines_reader.hpp"
+
+#include "file_load_system/file_load_system.hpp"
+#include "serialization/json_serializer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace Serializer {
+
+namespace {
+/* Smallest arena of a document */
+constexpr size_t kMinDocumentArena = 256;
+
+/* If a line has nothing but whitespace */
+bool IsBlank(const char *begin, const char *end) {
+  return std::all_of(begin, end, [](char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+  });
+}
+
+/* Where the chunk starting at offset ends: after a line end, or at length */
+size_t FindChunkEnd(const char *text, size_t offset, size_t length,
+                    size_t chunkSize) {
+  if (length - offset <= chunkSize) {
+    return length;
+  }
+
+  const char *newLine = static_cast<const char *>(
+      std::memchr(text + offset + chunkSize - 1, '\n',
+                  length - offset - chunkSize + 1));
+
+  return newLine != nullptr ? static_cast<size_t>(newLine - text) + 1 : length;
+}
+} // namespace
+
+JsonLinesReader::JsonLinesReader(unsigned workers, size_t chunkSize)
+    : m_chunkSize(std::max<size_t>(1, chunkSize)) {
+  if (workers == 0) {
+    workers = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  // Keep the workers busy while the oldest chunk is handed out
+  m_window = static_cast<size_t>(workers) * 2;
+}
+
+JsonLinesReader::ParsedChunk JsonLinesReader::ParseChunk(const char *text,
+                                                         size_t length) {
+  ParsedChunk chunk;
+  const char *end = text + length;
+
+  for (const char *begin = text; begin != end; ++chunk.m_lineCount) {
+    const char *lineEnd = static_cast<const char *>(
+        std::memchr(begin, '\n', static_cast<size_t>(end - begin)));
+    if (lineEnd == nullptr) {
+      lineEnd = end;
+    }
+
+    if (!IsBlank(begin, lineEnd)) {
+      const size_t lineLength = static_cast<size_t>(lineEnd - begin);
+
+      // Each document gets an arena its size, instead of the default chunk
+      chunk.m_allocators.push_back(
+          std::make_unique<JsonSerializer::AllocatorType>(
+              std::max(kMinDocumentArena, lineLength * 2)));
+      chunk.m_documents.push_back(
+          std::make_unique<JsonSerializer>(chunk.m_allocators.back().get()));
+
+      if (!chunk.m_documents.back()->ParseText(begin, lineLength)) {
+        chunk.m_documents.pop_back();
+        chunk.m_failed = true;
+        chunk.m_failedLine = chunk.m_lineCount;
+        break;
+      }
+
+      chunk.m_lines.push_back(chunk.m_lineCount);
+    }
+
+    begin = lineEnd != end ? lineEnd + 1 : end;
+  }
+
+  return chunk;
+}
+
+bool JsonLinesReader::Deliver(ParsedChunk &chunk, size_t line,
+                              const Handler &handler) {
+  for (size_t i = 0; i < chunk.m_documents.size(); ++i) {
+    if (!handler(line + chunk.m_lines[i], *chunk.m_documents[i])) {
+      return false;
+    }
+  }
+
+  if (chunk.m_failed) {
+    m_failed = true;
+    m_errorLine = line + chunk.m_failedLine;
+    return false;
+  }
+
+  return true;
+}
+
+bool JsonLinesReader::Read(const char *text, size_t length,
+                           const Handler &handler) {
+  m_failed = false;
+
+  if (text == nullptr) {
+    return false;
+  }
+
+  std::deque<std::future<ParsedChunk>> inFlight;
+  size_t offset = 0;
+  size_t line = 0;
+
+  // Unfinished chunks are waited for by their futures, text outlives them
+  while (offset < length || !inFlight.empty()) {
+    while (offset < length && inFlight.size() < m_window) {
+      const size_t end = FindChunkEnd(text, offset, length, m_chunkSize);
+
+      inFlight.push_back(std::async(std::launch::async, ParseChunk,
+                                    text + offset, end - offset));
+      offset = end;
+    }
+
+    ParsedChunk chunk = inFlight.front().get();
+    inFlight.pop_front();
+
+    if (!Deliver(chunk, line, handler)) {
+      return false;
+    }
+    line += chunk.m_lineCount;
+  }
+
+  return true;
+}
+
+bool JsonLinesReader::Read(std::FILE *file, const Handler &handler) {
+  m_failed = false;
+
+  if (file == nullptr) {
+    return false;
+  }
+
+  std::deque<std::future<ParsedChunk>> inFlight;
+  std::string partial;
+  bool end = false;
+  size_t line = 0;
+
+  while (!end || !inFlight.empty()) {
+    while (!end && inFlight.size() < m_window) {
+      // Start with the partial last line of the previous block
+      std::string block = std::move(partial);
+      partial.clear();
+
+      const size_t used = block.size();
+      block.resize(used + m_chunkSize);
+
+      const size_t read = FileLoadSystem::Fread(&block[used], sizeof(char),
+                                                m_chunkSize, file);
+      block.resize(used + read);
+
+      if (read < m_chunkSize) {
+        if (FileLoadSystem::Ferror(file)) {
+          return false;
+        }
+        end = true;
+      } else {
+        const size_t lastLine = block.rfind('\n');
+
+        // A line longer than a block, keep reading it
+        if (lastLine == std::string::npos) {
+          partial = std::move(block);
+          continue;
+        }
+
+        partial.assign(block, lastLine + 1, std::string::npos);
+        block.resize(lastLine + 1);
+      }
+
+      if (!block.empty()) {
+        // The chunk owns its text
+        inFlight.push_back(
+            std::async(std::launch::async, [text = std::move(block)]() {
+              return ParseChunk(text.data(), text.size());
+            }));
+      }
+    }
+
+    if (inFlight.empty()) {
+      break;
+    }
+
+    ParsedChunk chunk = inFlight.front().get();
+    inFlight.pop_front();
+
+    if (!Deliver(chunk, line, handler)) {
+      return false;
+    }
+    line += chunk.m_lineCount;
+  }
+
+  return true;
+}
+
+} // namespace Serializer
@@ -0,0 +1,581 @@
+#include "serialization/json_pull_serializer.hpp"
+
+#include "file_load_system/file_load_system.hpp"
+#include "file_load_system/smart_file.hpp"
+#include "rapidjson/reader.h"
+#include "serialization/serializer.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Serializer {
+
+void JsonPullStream::Open(const char *text, size_t length) {
+  m_file = nullptr;
+  m_begin = text;
+  m_current = text;
+  m_end = text + length;
+  m_count = 0;
+}
+
+void JsonPullStream::Open(std::FILE *file) {
+  m_file = file;
+  m_begin = m_buffer;
+  m_current = m_buffer;
+  m_end = m_buffer;
+  m_count = 0;
+  Refill();
+}
+
+void JsonPullStream::Close() {
+  m_file = nullptr;
+  m_begin = nullptr;
+  m_current = nullptr;
+  m_end = nullptr;
+  m_count = 0;
+}
+
+void JsonPullStream::Refill() {
+  // Texts in memory are already whole
+  if (m_file == nullptr) {
+    return;
+  }
+
+  m_count += static_cast<size_t>(m_end - m_begin);
+
+  size_t read =
+      FileLoadSystem::Fread(m_buffer, sizeof(Ch), kBufferSize, m_file);
+
+  m_begin = m_buffer;
+  m_current = m_buffer;
+  m_end = m_buffer + read;
+}
+
+bool JsonPullSerializer::Handler::Null() {
+  m_tokens->emplace_back();
+  return true;
+}
+
+bool JsonPullSerializer::Handler::Bool(bool value) {
+  Token &token = m_tokens->emplace_back();
+  token.m_type = TokenType::kBool;
+  token.m_bool = value;
+  return true;
+}
+
+bool JsonPullSerializer::Handler::Int(int value) {
+  return Int64(static_cast<int64_t>(value));
+}
+
+bool JsonPullSerializer::Handler::Uint(unsigned value) {
+  return Uint64(static_cast<uint64_t>(value));
+}
+
+bool JsonPullSerializer::Handler::Int64(int64_t value) {
+  // Only negative numbers are kInt, so "-0" is a kUint
+  if (value >= 0) {
+    return Uint64(static_cast<uint64_t>(value));
+  }
+
+  Token &token = m_tokens->emplace_back();
+  token.m_type = TokenType::kInt;
+  token.m_int = value;
+  return true;
+}
+
+bool JsonPullSerializer::Handler::Uint64(uint64_t value) {
+  Token &token = m_tokens->emplace_back();
+  token.m_type = TokenType::kUint;
+  token.m_uint = value;
+  return true;
+}
+
+bool JsonPullSerializer::Handler::Double(double value) {
+  Token &token = m_tokens->emplace_back();
+  token.m_type = TokenType::kDouble;
+  token.m_double = value;
+  return true;
+}
+
+bool JsonPullSerializer::Handler::RawNumber(const char *, rapidjson::SizeType,
+                                            bool) {
+  // Only used when numbers are parsed as strings, which we don't
+  return false;
+}
+
+bool JsonPullSerializer::Handler::String(const char *text,
+                                         rapidjson::SizeType length, bool) {
+  // The text is only valid during the call
+  Token &token = m_tokens->emplace_back();
+  token.m_type = TokenType::kString;
+  token.m_string.assign(text, length);
+  return true;
+}
+
+bool JsonPullSerializer::Handler::StartObject() {
+  m_tokens->emplace_back().m_type = TokenType::kStartObject;
+  return true;
+}
+
+bool JsonPullSerializer::Handler::Key(const char *text,
+                                      rapidjson::SizeType length, bool) {
+  // The text is only valid during the call
+  Token &token = m_tokens->emplace_back();
+  token.m_type = TokenType::kKey;
+  token.m_string.assign(text, length);
+  return true;
+}
+
+bool JsonPullSerializer::Handler::EndObject(rapidjson::SizeType) {
+  m_tokens->emplace_back().m_type = TokenType::kEndObject;
+  return true;
+}
+
+bool JsonPullSerializer::Handler::StartArray() {
+  m_tokens->emplace_back().m_type = TokenType::kStartArray;
+  return true;
+}
+
+bool JsonPullSerializer::Handler::EndArray(rapidjson::SizeType) {
+  m_tokens->emplace_back().m_type = TokenType::kEndArray;
+  return true;
+}
+
+bool JsonPullSerializer::ParseText(const char *text) {
+  return ParseText(text, std::strlen(text));
+}
+
+bool JsonPullSerializer::ParseText(const char *text, size_t length) {
+  m_stream.Open(text, length);
+  return Start();
+}
+
+bool JsonPullSerializer::ParseFile(std::FILE *file) {
+  if (file == nullptr) {
+    return false;
+  }
+
+  m_stream.Open(file);
+  return Start();
+}
+
+bool JsonPullSerializer::ParseFile(FileLoadSystem::SmartReadFile &file) {
+  return ParseFile(file.Get());
+}
+
+bool JsonPullSerializer::Clear() {
+  m_stream.Close();
+  m_reader.IterativeParseInit();
+  m_tokens.clear();
+  m_levels.clear();
+  m_failed = false;
+  return true;
+}
+
+bool JsonPullSerializer::Start() {
+  m_reader.IterativeParseInit();
+  m_tokens.clear();
+  m_levels.clear();
+  m_failed = false;
+
+  const Token *token = Front();
+
+  if (token == nullptr || token->m_type != TokenType::kStartObject) {
+    m_failed = true;
+    return false;
+  }
+
+  m_tokens.pop_front();
+  m_levels.emplace_back(); // push root value
+  return true;
+}
+
+bool JsonPullSerializer::Compile() { return false; }
+
+bool JsonPullSerializer::CompilePretty() { return false; }
+
+bool JsonPullSerializer::GetSize(s_size *) { return false; }
+
+bool JsonPullSerializer::GetLength(s_size *) { return false; }
+
+bool JsonPullSerializer::GetText(char *) { return false; }
+
+bool JsonPullSerializer::Fill(size_t count) const {
+  Handler handler{&m_tokens};
+
+  while (m_tokens.size() < count) {
+    if (m_failed || m_reader.IterativeParseComplete()) {
+      return false;
+    }
+
+    // Every step gives at most one token
+    if (!m_reader.IterativeParseNext<rapidjson::kParseNanAndInfFlag>(
+            m_stream, handler) ||
+        m_reader.HasParseError()) {
+      m_failed = true;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+const JsonPullSerializer::Token *JsonPullSerializer::Front() const {
+  return Fill(1) ? &m_tokens.front() : nullptr;
+}
+
+bool JsonPullSerializer::SkipValue() const {
+  size_t depth = 0;
+
+  do {
+    const Token *token = Front();
+
+    if (token == nullptr) {
+      return false;
+    }
+
+    switch (token->m_type) {
+    case TokenType::kStartObject:
+    case TokenType::kStartArray:
+      ++depth;
+      break;
+    case TokenType::kEndObject:
+    case TokenType::kEndArray:
+      // Never leave the current level
+      if (depth == 0) {
+        return false;
+      }
+      --depth;
+      break;
+    default:
+      break;
+    }
+
+    m_tokens.pop_front();
+  } while (depth != 0);
+
+  return true;
+}
+
+bool JsonPullSerializer::LeaveLevel(TokenType end) const {
+  for (;;) {
+    const Token *token = Front();
+
+    if (token == nullptr) {
+      return false;
+    }
+
+    if (token->m_type == end) {
+      m_tokens.pop_front();
+      break;
+    }
+
+    if (!SkipValue()) {
+      return false;
+    }
+  }
+
+  m_levels.pop_back();
+  return true;
+}
+
+const JsonPullSerializer::Token *
+JsonPullSerializer::FindValue(const char *name) const {
+  if (m_levels.empty()) {
+    return nullptr;
+  }
+
+  Level &level = m_levels.back();
+
+  // We are inside an array
+  if (level.m_array) {
+    // The current element was opened, it is not at the front anymore
+    if (level.m_entered) {
+      return nullptr;
+    }
+
+    const Token *token = Front();
+
+    if (token == nullptr || token->m_type == TokenType::kEndArray) {
+      return nullptr;
+    }
+    return token;
+  }
+
+  // We are in a normal entry
+  if (name == nullptr) {
+    return nullptr;
+  }
+
+  if (level.m_pending) {
+    if (level.m_pendingName == name) {
+      return Front();
+    }
+
+    level.m_pending = false;
+
+    const Token *token = Front();
+
+    if (token == nullptr) {
+      return nullptr;
+    }
+
+    if (token->m_type == TokenType::kStartObject ||
+        token->m_type == TokenType::kStartArray) {
+      if (!SkipValue()) {
+        return nullptr;
+      }
+    } else {
+      level.m_skipped.emplace_back(std::move(level.m_pendingName),
+                                   std::move(m_tokens.front()));
+      m_tokens.pop_front();
+    }
+  }
+
+  for (auto &skipped : level.m_skipped) {
+    if (skipped.first == name) {
+      return &skipped.second;
+    }
+  }
+
+  // Search forward
+  for (;;) {
+    const Token *token = Front();
+
+    // Reached the end of the entry
+    if (token == nullptr || token->m_type != TokenType::kKey) {
+      return nullptr;
+    }
+
+    std::string key = std::move(m_tokens.front().m_string);
+    m_tokens.pop_front();
+
+    token = Front();
+
+    if (token == nullptr) {
+      return nullptr;
+    }
+
+    if (key == name) {
+      level.m_pending = true;
+      level.m_pendingName = std::move(key);
+      return token;
+    }
+
+    if (token->m_type == TokenType::kStartObject ||
+        token->m_type == TokenType::kStartArray) {
+      if (!SkipValue()) {
+        return nullptr;
+      }
+    } else {
+      level.m_skipped.emplace_back(std::move(key), std::move(m_tokens.front()));
+      m_tokens.pop_front();
+    }
+  }
+}
+
+bool JsonPullSerializer::EnterLevel(const char *name, TokenType start) const {
+  const Token *token = FindValue(name);
+
+  if (token == nullptr || token->m_type != start) {
+    return false;
+  }
+
+  // Remembered values are never entries nor arrays, so it is the front
+  Level &parent = m_levels.back();
+
+  if (parent.m_array) {
+    parent.m_entered = true;
+  } else {
+    parent.m_pending = false;
+  }
+
+  m_tokens.pop_front();
+
+  Level level;
+  level.m_array = start == TokenType::kStartArray;
+  m_levels.push_back(std::move(level));
+  return true;
+}
+
+bool JsonPullSerializer::SetEntry(const char *, s_size, s_size) {
+  return false;
+}
+
+bool JsonPullSerializer::OpenEntry(const char *name, s_size *version) const {
+  if (!EnterLevel(name, TokenType::kStartObject)) {
+    return false;
+  }
+
+  if (!GetType<s_size>(kVersionEntryName, version)) {
+    // Not an entry, it can't be opened again anyway
+    LeaveLevel(TokenType::kEndObject);
+    return false;
+  }
+
+  return true;
+}
+
+bool JsonPullSerializer::CloseEntry() const {
+  // The root value can't be closed
+  if (m_levels.size() < 2 || m_levels.back().m_array) {
+    return false;
+  }
+  return LeaveLevel(TokenType::kEndObject);
+}
+
+bool JsonPullSerializer::SetBool(const char *, s_size, bool) { return false; }
+
+bool JsonPullSerializer::SetUint(const char *, s_size, unsigned) {
+  return false;
+}
+
+bool JsonPullSerializer::SetInt(const char *, s_size, int) { return false; }
+
+bool JsonPullSerializer::SetUint64(const char *, s_size, uint64_t) {
+  return false;
+}
+
+bool JsonPullSerializer::SetInt64(const char *, s_size, int64_t) {
+  return false;
+}
+
+bool JsonPullSerializer::SetDouble(const char *, s_size, double) {
+  return false;
+}
+
+bool JsonPullSerializer::SetString(const char *, s_size, const char *,
+                                   s_size) {
+  return false;
+}
+
+bool JsonPullSerializer::IsString(const char *name) const {
+  const Token *token = FindValue(name);
+
+  return token != nullptr && token->m_type == TokenType::kString;
+}
+
+bool JsonPullSerializer::GetStringLength(const char *name,
+                                         s_size *result) const {
+  const Token *token = FindValue(name);
+
+  if (token == nullptr || token->m_type != TokenType::kString) {
+    return false;
+  }
+
+  *result = static_cast<s_size>(token->m_string.length()) + 1;
+  return true;
+}
+
+bool JsonPullSerializer::GetStringSize(const char *name,
+                                       s_size *result) const {
+  bool res = GetStringLength(name, result);
+  if (res) {
+    *result *= sizeof(char);
+  }
+  return res;
+}
+
+bool JsonPullSerializer::GetString(const char *name, char *result) const {
+  const Token *token = FindValue(name);
+
+  if (token == nullptr || token->m_type != TokenType::kString) {
+    return false;
+  }
+
+  std::memcpy(result, token->m_string.data(), token->m_string.length());
+  result[token->m_string.length()] = '\0';
+  return true;
+}
+
+bool JsonPullSerializer::GetStringView(const char *name,
+                                       std::string_view *result) const {
+  const Token *token = FindValue(name);
+
+  if (token == nullptr || token->m_type != TokenType::kString) {
+    return false;
+  }
+
+  *result = token->m_string;
+  return true;
+}
+
+bool JsonPullSerializer::SetNull(const char *, s_size) { return false; }
+
+bool JsonPullSerializer::IsNull(const char *name) const {
+  const Token *token = FindValue(name);
+
+  return token != nullptr && token->m_type == TokenType::kNull;
+}
+
+bool JsonPullSerializer::SetArray(const char *, s_size) { return false; }
+
+bool JsonPullSerializer::ReserveArray(const char *, s_size) { return false; }
+
+bool JsonPullSerializer::IsArray(const char *name) const {
+  // We are inside an array
+  if (!m_levels.empty() && m_levels.back().m_array) {
+    return true;
+  }
+  // We are in a normal entry
+  const Token *token = FindValue(name);
+
+  return token != nullptr && token->m_type == TokenType::kStartArray;
+}
+
+bool JsonPullSerializer::OpenArray(const char *name) const {
+  return EnterLevel(name, TokenType::kStartArray);
+}
+
+bool JsonPullSerializer::GetArrayCapacity(const char *, s_size *) const {
+  return false;
+}
+
+bool JsonPullSerializer::CanMoveArray() const {
+  // We are inside an array
+  if (!m_levels.empty() && m_levels.back().m_array) {
+    if (m_levels.back().m_entered) {
+      return true;
+    }
+
+    const Token *token = Front();
+
+    return token != nullptr && token->m_type != TokenType::kEndArray;
+  }
+  return false;
+}
+
+bool JsonPullSerializer::MoveArray() const {
+  // We are inside an array
+  if (!m_levels.empty() && m_levels.back().m_array) {
+    // The current element was opened and closed, the next one is at the front
+    if (m_levels.back().m_entered) {
+      m_levels.back().m_entered = false;
+      return true;
+    }
+
+    const Token *token = Front();
+
+    // We are at the last position
+    if (token == nullptr || token->m_type == TokenType::kEndArray) {
+      return false;
+    }
+
+    return SkipValue();
+  }
+  return false;
+}
+
+bool JsonPullSerializer::CloseArray() const {
+  if (m_levels.empty() || !m_levels.back().m_array) {
+    return false;
+  }
+  return LeaveLevel(TokenType::kEndArray);
+}
+
+} // namespace Serializer
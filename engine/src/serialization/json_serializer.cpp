@@ -6,40 +6,189 @@
 #include "rapidjson/reader.h"
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
+#include "serialization/path_query.hpp"
 #include "serialization/serializer.hpp"
+#include "serialization/sink.hpp"
+#include "utils/base64.hpp"
+#include "utils/hash.hpp"
 
 #include <cstring>
 #include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace Serializer {
 
+namespace {
+/* Parse a value in a text into value, using the memory of the document */
+bool ParseSection(const char *text, size_t length, rapidjson::Value *value,
+                  JsonSerializer::AllocatorType &allocator) {
+  // Only the parse stack is the section's own
+  rapidjson::Document section(&allocator);
+
+  if (section.Parse<rapidjson::kParseNanAndInfFlag>(text, length)
+          .HasParseError()) {
+    return false;
+  }
+
+  value->Swap(section);
+  return true;
+}
+} // namespace
+
 bool JsonSerializer::Clear() {
-  m_document.Swap(rapidjson::Value(rapidjson::kObjectType).Move());
+  ResetLookups();
+  if (m_arenaReset) {
+    ResetArena();
+  } else {
+    m_document.Swap(rapidjson::Value(rapidjson::kObjectType).Move());
+  }
   m_currentEntry.clear();
   m_currentDepth = 0;
   m_currentArray.clear();
   m_currentArrayIter.clear();
   m_buffer.Clear();
+  m_spliced.clear();
   m_currentEntry.push_back(m_document); // push root value
   return true;
 }
 
+void JsonSerializer::ResetArena() {
+  AllocatorType &allocator = m_document.GetAllocator();
+
+  // The values live in the arena, drop them before resetting it
+  m_document.SetObject();
+  ++m_arenaResets;
+
+  if (m_ownsArena && (!m_arena || allocator.Capacity() > m_arenaCapacity)) {
+    // Keep the peak capacity (and some more) as a single block
+    size_t size = allocator.Capacity() + allocator.Capacity() / 2;
+    if (size < kDefaultArenaSize) {
+      size = kDefaultArenaSize;
+    }
+
+    if (m_arena) {
+      ++m_arenaGrowths;
+    }
+
+    BuildArena(size);
+    return;
+  }
+
+  allocator.Clear();
+}
+
+void JsonSerializer::BuildArena(size_t size) {
+  std::unique_ptr<char[]> arena(new char[size]);
+  std::unique_ptr<AllocatorType> allocator =
+      std::make_unique<AllocatorType>(arena.get(), size);
+
+  // The old arena can only go after the document stops using it
+  m_document = rapidjson::Document(rapidjson::kObjectType, allocator.get());
+
+  m_allocator = std::move(allocator);
+  m_arena = std::move(arena);
+  m_arenaCapacity = m_allocator->Capacity();
+}
+
+JsonSerializer::ArenaStats JsonSerializer::GetArenaStats() {
+  AllocatorType &allocator = m_document.GetAllocator();
+
+  ArenaStats stats;
+  stats.m_used = allocator.Size();
+  stats.m_capacity = allocator.Capacity();
+  stats.m_resets = m_arenaResets;
+  stats.m_growths = m_arenaGrowths;
+  return stats;
+}
+
+std::unique_ptr<JsonSerializer> JsonSerializer::Fork() const {
+  std::unique_ptr<JsonSerializer> child = std::make_unique<JsonSerializer>();
+  child->SetMemberIndexThreshold(m_memberIndexThreshold);
+  return child;
+}
+
+bool JsonSerializer::Splice(JsonSerializer &child) {
+  // The values stay in the child's memory, it can't be the user's
+  if (&child == this || !child.m_ownsArena) {
+    return false;
+  }
+
+  InvalidateLookups();
+  // Its values are moved, so they can't be found by address later
+  child.LoadAllLazy();
+
+  rapidjson::Document::AllocatorType &allocator = m_document.GetAllocator();
+  rapidjson::Value &current = m_currentEntry.back().get();
+  const bool insideArray = IsInsideArray();
+
+  // Only the member list of current grows, names and values are moved
+  for (rapidjson::Value::MemberIterator iter = child.m_document.MemberBegin();
+       iter != child.m_document.MemberEnd(); ++iter) {
+    // We are inside an array
+    if (insideArray) {
+      current.PushBack(iter->value.Move(), allocator);
+    }
+    // We are in a normal entry
+    else {
+      current.AddMember(iter->name.Move(), iter->value.Move(), allocator);
+    }
+  }
+
+  m_spliced.push_back(SplicedMemory{std::move(child.m_arena),
+                                    std::move(child.m_allocator),
+                                    std::move(child.m_document)});
+
+  // What the child had spliced is kept too
+  for (SplicedMemory &spliced : child.m_spliced) {
+    m_spliced.push_back(std::move(spliced));
+  }
+  child.m_spliced.clear();
+
+  child.m_document = rapidjson::Document(rapidjson::kObjectType);
+  child.m_arenaCapacity = 0;
+  return child.Clear();
+}
+
+bool JsonSerializer::CompileFragments(std::vector<Fragment> *fragments) const {
+  LoadAllLazy();
+
+  rapidjson::StringBuffer buffer;
+
+  for (rapidjson::Value::ConstMemberIterator iter = m_document.MemberBegin();
+       iter != m_document.MemberEnd(); ++iter) {
+    buffer.Clear();
+
+    CompactWriter writer(buffer);
+    if (!iter->value.Accept(writer)) {
+      return false;
+    }
+
+    Fragment fragment;
+    fragment.m_name.assign(iter->name.GetString(),
+                           iter->name.GetStringLength());
+    fragment.m_text.assign(buffer.GetString(), buffer.GetSize());
+    fragment.m_type = iter->value.GetType();
+    fragments->push_back(std::move(fragment));
+  }
+
+  return true;
+}
+
 bool JsonSerializer::Compile() {
+  LoadAllLazy();
   m_buffer.Clear();
 
-  using Writer = typename rapidjson::Writer<
-      /* typename OutputStream */ rapidjson::StringBuffer,
-      /* typename SourceEncoding */ rapidjson::UTF8<>,
-      /* typename TargetEncoding */ rapidjson::UTF8<>,
-      /* typename Allocator */ rapidjson::CrtAllocator,
-      /* unsigned writeFlags */ rapidjson::kWriteNanAndInfFlag>;
-
-  Writer writer(m_buffer);
+  CompactWriter writer(m_buffer);
   return m_document.Accept(writer);
 }
 
 bool JsonSerializer::CompilePretty() {
+  LoadAllLazy();
   m_buffer.Clear();
 
   using PrettyWriter = typename rapidjson::PrettyWriter<
@@ -70,14 +219,238 @@ bool JsonSerializer::GetText(char *text) {
   return true;
 }
 
+bool JsonSerializer::GetView(std::string_view *view) const {
+  *view = std::string_view(m_buffer.GetString(),
+                           static_cast<size_t>(m_buffer.GetSize()));
+  return true;
+}
+
+bool JsonSerializer::CompileTo(ISink &sink) {
+  using SinkWriter = typename rapidjson::Writer<
+      /* typename OutputStream */ JsonSinkStream,
+      /* typename SourceEncoding */ rapidjson::UTF8<>,
+      /* typename TargetEncoding */ rapidjson::UTF8<>,
+      /* typename Allocator */ rapidjson::CrtAllocator,
+      /* unsigned writeFlags */ rapidjson::kWriteNanAndInfFlag>;
+
+  LoadAllLazy();
+
+  // Written through a fixed buffer, m_buffer is not used
+  JsonSinkStream stream(sink);
+  SinkWriter writer(stream);
+
+  const bool res = m_document.Accept(writer);
+  stream.Flush();
+
+  return res && !stream.HasFailed() && sink.Flush();
+}
+
+bool JsonSerializer::ParseTextLazy(const char *text, size_t length) {
+  std::vector<JsonSkipEntry> entries;
+
+  if (!BuildJsonSkipIndex(text, length, &entries)) {
+    return ParseText(text, length);
+  }
+
+  size_t rootCount = 0;
+  for (size_t i = 0; i < entries.size(); i += entries[i].m_childCount + 1) {
+    ++rootCount;
+  }
+
+  for (const JsonSkipEntry &entry : entries) {
+    if (entry.m_escapedName) {
+      return ParseText(text, length);
+    }
+  }
+
+  ResetLookups();
+  if (m_arenaReset) {
+    ResetArena();
+  }
+  m_document.SetObject();
+  m_spliced.clear();
+
+  AllocatorType &allocator = m_document.GetAllocator();
+  m_lazyAllocator = &allocator;
+
+  // Sections are found by address, the root can't grow after one is added
+  m_document.MemberReserve(static_cast<rapidjson::SizeType>(rootCount),
+                           allocator);
+
+  for (size_t i = 0; i < entries.size(); i += entries[i].m_childCount + 1) {
+    const JsonSkipEntry &entry = entries[i];
+
+    if (!AddLazyMember(m_document, text, entry, allocator)) {
+      ResetLookups();
+      m_document.SetObject();
+      return false;
+    }
+
+    rapidjson::Value &value = (m_document.MemberEnd() - 1)->value;
+    const char *valueText = text + entry.m_valueOffset;
+
+    // Objects of the root are kept with their names, their values are lazy
+    if (*valueText == '{') {
+      value.SetObject();
+      value.MemberReserve(static_cast<rapidjson::SizeType>(entry.m_childCount),
+                          allocator);
+
+      for (size_t j = i + 1; j <= i + entry.m_childCount; ++j) {
+        if (!AddLazyMember(value, text, entries[j], allocator)) {
+          ResetLookups();
+          m_document.SetObject();
+          return false;
+        }
+
+        const char *childText = text + entries[j].m_valueOffset;
+        if (*childText == '{' || *childText == '[') {
+          m_lazySections[&(value.MemberEnd() - 1)->value] =
+              LazySection{childText, entries[j].m_valueLength};
+        }
+      }
+    } else if (*valueText == '[') {
+      m_lazySections[&value] = LazySection{valueText, entry.m_valueLength};
+    }
+  }
+
+  return true;
+}
+
+bool JsonSerializer::AddLazyMember(rapidjson::Value &object, const char *text,
+                                   const JsonSkipEntry &entry,
+                                   AllocatorType &allocator) {
+  rapidjson::Value name(text + entry.m_nameOffset,
+                        static_cast<rapidjson::SizeType>(entry.m_nameLength),
+                        allocator); // copy string name
+  rapidjson::Value value;
+
+  const char *valueText = text + entry.m_valueOffset;
+
+  // Small values are parsed right away
+  if (*valueText != '{' && *valueText != '[' &&
+      !ParseSection(valueText, entry.m_valueLength, &value, allocator)) {
+    return false;
+  }
+
+  object.AddMember(name.Move(), value.Move(), allocator);
+  return true;
+}
+
+bool JsonSerializer::LoadLazy(rapidjson::Value &value) const {
+  auto found = m_lazySections.find(&value);
+
+  if (found == m_lazySections.end()) {
+    return true;
+  }
+
+  // A broken section stays, so it is missing every time
+  if (!ParseSection(found->second.m_text, found->second.m_length, &value,
+                    *m_lazyAllocator)) {
+    return false;
+  }
+
+  m_lazySections.erase(found);
+  return true;
+}
+
+void JsonSerializer::LoadAllLazy() const {
+  for (auto &section : m_lazySections) {
+    ParseSection(section.second.m_text, section.second.m_length,
+                 section.first, *m_lazyAllocator);
+  }
+  m_lazySections.clear();
+}
+
+rapidjson::Value::MemberIterator
+JsonSerializer::FindMember(rapidjson::Value &object, const char *name) const {
+  // The value of an open path was already found (and loaded) by OpenPath
+  if (!m_pathMembers.empty() && m_pathMembers.back().m_parent == &object &&
+      m_pathMembers.back().m_name == name) {
+    return m_pathMembers.back().m_member;
+  }
+
+  rapidjson::Value::MemberIterator iter = FindIndexedMember(object, name);
+
+  if (!m_lazySections.empty() && iter != object.MemberEnd() &&
+      !LoadLazy(iter->value)) {
+    return object.MemberEnd();
+  }
+
+  return iter;
+}
+
+rapidjson::Value::MemberIterator
+JsonSerializer::FindIndexedMember(rapidjson::Value &object,
+                                  const char *name) const {
+  // Narrow objects are faster to search linearly
+  if (name == nullptr || object.MemberCount() < m_memberIndexThreshold) {
+    return object.FindMember(name);
+  }
+
+  const size_t length = std::strlen(name);
+  MemberIndex &index = m_memberIndexes[&object];
+
+  // Built lazily, on the first lookup
+  if (index.m_offsets.empty() || index.m_count != object.MemberCount()) {
+    index.m_offsets.clear();
+    index.m_offsets.reserve(object.MemberCount());
+    index.m_count = object.MemberCount();
+
+    rapidjson::SizeType offset = 0;
+    for (auto iter = object.MemberBegin(); iter != object.MemberEnd();
+         ++iter, ++offset) {
+      // Repeated names keep the first one, like FindMember
+      index.m_offsets.emplace(
+          Hash::Fnv1a(iter->name.GetString(),
+                      static_cast<size_t>(iter->name.GetStringLength())),
+          offset);
+    }
+  }
+
+  auto found = index.m_offsets.find(Hash::Fnv1a(name, length));
+
+  if (found == index.m_offsets.end()) {
+    return object.MemberEnd();
+  }
+
+  rapidjson::Value::MemberIterator iter = object.MemberBegin() + found->second;
+
+  if (iter->name.GetStringLength() == length &&
+      std::memcmp(iter->name.GetString(), name, length) == 0) {
+    return iter;
+  }
+
+  // Another name with the same hash
+  return object.FindMember(name);
+}
+
+rapidjson::Value::MemberIterator
+JsonSerializer::FindVersion(rapidjson::Value &entry) {
+  if (entry.MemberCount() != 0) {
+    rapidjson::Value::MemberIterator first = entry.MemberBegin();
+    if (first->name.GetStringLength() == kVersionEntryNameLength &&
+        std::memcmp(first->name.GetString(), kVersionEntryName,
+                    kVersionEntryNameLength) == 0) {
+      return first;
+    }
+  }
+
+  // Written by someone else, the key is built without copying it
+  return entry.FindMember(rapidjson::Value(
+      rapidjson::StringRef(kVersionEntryName, kVersionEntryNameLength)));
+}
+
 bool JsonSerializer::SetEntry(const char *name, s_size name_length,
                               s_size version) {
+  InvalidateLookups();
+
 
   rapidjson::Value object(rapidjson::kObjectType);
   rapidjson::Document::AllocatorType &allocator = m_document.GetAllocator();
 
-  rapidjson::Value key(kVersionEntryName, kVersionEntryNameLength,
-                       allocator); // copy string name
+  // Always the same constant, never copied
+  rapidjson::Value key(
+      rapidjson::StringRef(kVersionEntryName, kVersionEntryNameLength));
   rapidjson::Value val(version);
 
   object.AddMember(key.Move(), val.Move(), allocator);
@@ -92,16 +465,14 @@ bool JsonSerializer::SetEntry(const char *name, s_size name_length,
   }
   // We are in a normal entry
   else {
-    rapidjson::Value nameKey(name,
-                             static_cast<rapidjson::SizeType>(name_length),
-                             allocator); // copy string name
+    rapidjson::Value nameKey = MakeName(name, name_length);
 
     rapidjson::Value &current = m_currentEntry.back().get();
 
     current.AddMember(nameKey.Move(), object.Move(), allocator);
 
-    // This is dumb but the library doesn't support other way
-    m_currentEntry.push_back(current[name]);
+    // The new member is the last one, no need to look it up
+    m_currentEntry.push_back((current.MemberEnd() - 1)->value);
   }
 
   ++m_currentDepth;
@@ -113,8 +484,7 @@ bool JsonSerializer::OpenEntry(const char *name, s_size *version) const {
   if (IsInsideArray()) {
     rapidjson::Value &new_current = *m_currentArrayIter.back();
 
-    rapidjson::Value::MemberIterator iter =
-        new_current.FindMember(kVersionEntryName);
+    rapidjson::Value::MemberIterator iter = FindVersion(new_current);
 
     if (iter == new_current.MemberEnd()) {
       return false;
@@ -129,7 +499,7 @@ bool JsonSerializer::OpenEntry(const char *name, s_size *version) const {
 
     rapidjson::Value &current = m_currentEntry.back().get();
 
-    rapidjson::Value::MemberIterator iter = current.FindMember(name);
+    rapidjson::Value::MemberIterator iter = FindMember(current, name);
 
     if (iter == current.MemberEnd()) {
       return false;
@@ -137,7 +507,7 @@ bool JsonSerializer::OpenEntry(const char *name, s_size *version) const {
 
     rapidjson::Value &new_current = iter->value;
 
-    iter = new_current.FindMember(kVersionEntryName);
+    iter = FindVersion(new_current);
 
     if (iter == new_current.MemberEnd()) {
       return false;
@@ -161,6 +531,8 @@ bool JsonSerializer::CloseEntry() const {
 
 bool JsonSerializer::SetString(const char *name, s_size name_length,
                                const char *value, s_size length) {
+  InvalidateLookups();
+
   rapidjson::Document::AllocatorType &allocator = m_document.GetAllocator();
   rapidjson::Value val(value, static_cast<rapidjson::SizeType>(length),
                        allocator);
@@ -173,9 +545,7 @@ bool JsonSerializer::SetString(const char *name, s_size name_length,
   }
   // We are in a normal entry
   else {
-    rapidjson::Value nameKey(name,
-                             static_cast<rapidjson::SizeType>(name_length),
-                             allocator); // copy string name
+    rapidjson::Value nameKey = MakeName(name, name_length);
 
     current.AddMember(nameKey.Move(), val.Move(), allocator);
   }
@@ -194,7 +564,7 @@ bool JsonSerializer::GetStringLength(const char *name, s_size *result) const {
   else {
     rapidjson::Value &current = m_currentEntry.back().get();
 
-    rapidjson::Value::MemberIterator iter = current.FindMember(name);
+    rapidjson::Value::MemberIterator iter = FindMember(current, name);
 
     if (iter == current.MemberEnd()) {
       return false;
@@ -230,7 +600,7 @@ bool JsonSerializer::GetString(const char *name, char *result) const {
   else {
     rapidjson::Value &current = m_currentEntry.back().get();
 
-    rapidjson::Value::MemberIterator iter = current.FindMember(name);
+    rapidjson::Value::MemberIterator iter = FindMember(current, name);
 
     if (iter == current.MemberEnd()) {
       return false;
@@ -247,7 +617,74 @@ bool JsonSerializer::GetString(const char *name, char *result) const {
   return true;
 }
 
+bool JsonSerializer::GetStringView(const char *name,
+                                   std::string_view *result) const {
+  const rapidjson::Value *value;
+
+  // We are inside an array
+  if (IsInsideArray()) {
+    value = &*m_currentArrayIter.back();
+  }
+  // We are in a normal entry
+  else {
+    rapidjson::Value &current = m_currentEntry.back().get();
+
+    rapidjson::Value::MemberIterator iter = FindMember(current, name);
+
+    if (iter == current.MemberEnd()) {
+      return false;
+    }
+
+    value = &iter->value;
+  }
+
+  if (!value->IsString()) {
+    return false;
+  }
+
+  *result = std::string_view(value->GetString(),
+                             static_cast<size_t>(value->GetStringLength()));
+  return true;
+}
+
+bool JsonSerializer::SetBlob(const char *name, s_size name_length,
+                             const void *data, s_size size) {
+  InvalidateLookups();
+
+  rapidjson::Document::AllocatorType &allocator = m_document.GetAllocator();
+
+  // The value only points to the text, which lives as long as the document
+  const size_t length = Base64::GetEncodedLength(static_cast<size_t>(size));
+  char *text = static_cast<char *>(allocator.Malloc(length + 1));
+  if (text == nullptr) {
+    return false;
+  }
+
+  Base64::Encode(data, static_cast<size_t>(size), text);
+  text[length] = '\0';
+
+  rapidjson::Value val(
+      rapidjson::StringRef(text, static_cast<rapidjson::SizeType>(length)));
+
+  rapidjson::Value &current = m_currentEntry.back().get();
+
+  // We are inside an array
+  if (IsInsideArray()) {
+    current.PushBack(val.Move(), allocator);
+  }
+  // We are in a normal entry
+  else {
+    rapidjson::Value nameKey = MakeName(name, name_length);
+
+    current.AddMember(nameKey.Move(), val.Move(), allocator);
+  }
+
+  return true;
+}
+
 bool JsonSerializer::SetNull(const char *name, s_size name_length) {
+  InvalidateLookups();
+
   rapidjson::Document::AllocatorType &allocator = m_document.GetAllocator();
   rapidjson::Value val;
 
@@ -259,9 +696,7 @@ bool JsonSerializer::SetNull(const char *name, s_size name_length) {
   }
   // We are in a normal entry
   else {
-    rapidjson::Value nameKey(name,
-                             static_cast<rapidjson::SizeType>(name_length),
-                             allocator); // copy string name
+    rapidjson::Value nameKey = MakeName(name, name_length);
 
     current.AddMember(nameKey.Move(), val.Move(), allocator);
   }
@@ -280,7 +715,7 @@ bool JsonSerializer::IsNull(const char *name) const {
   else {
     rapidjson::Value &current = m_currentEntry.back().get();
 
-    rapidjson::Value::MemberIterator iter = current.FindMember(name);
+    rapidjson::Value::MemberIterator iter = FindMember(current, name);
 
     if (iter == current.MemberEnd()) {
       return false;
@@ -291,6 +726,8 @@ bool JsonSerializer::IsNull(const char *name) const {
 }
 
 bool JsonSerializer::SetArray(const char *name, s_size name_length) {
+  InvalidateLookups();
+
   rapidjson::Value object(rapidjson::kArrayType);
   rapidjson::Document::AllocatorType &allocator = m_document.GetAllocator();
 
@@ -308,16 +745,14 @@ bool JsonSerializer::SetArray(const char *name, s_size name_length) {
   }
   // We are in a normal entry
   else {
-    rapidjson::Value nameKey(name,
-                             static_cast<rapidjson::SizeType>(name_length),
-                             allocator); // copy string name
+    rapidjson::Value nameKey = MakeName(name, name_length);
 
     rapidjson::Value &current = m_currentEntry.back().get();
 
     current.AddMember(nameKey.Move(), object.Move(), allocator);
 
-    // This is dumb but the library doesn't support other way
-    rapidjson::Value &new_current = current[name];
+    // The new member is the last one, no need to look it up
+    rapidjson::Value &new_current = (current.MemberEnd() - 1)->value;
 
     m_currentArrayIter.push_back(new_current.End());
 
@@ -330,6 +765,8 @@ bool JsonSerializer::SetArray(const char *name, s_size name_length) {
 }
 
 bool JsonSerializer::ReserveArray(const char *name, s_size size) {
+  InvalidateLookups();
+
   rapidjson::Document::AllocatorType &allocator = m_document.GetAllocator();
 
   // We are inside an array
@@ -342,7 +779,7 @@ bool JsonSerializer::ReserveArray(const char *name, s_size size) {
   else {
     rapidjson::Value &current = m_currentEntry.back().get();
 
-    rapidjson::Value::MemberIterator iter = current.FindMember(name);
+    rapidjson::Value::MemberIterator iter = FindMember(current, name);
 
     if (iter == current.MemberEnd()) {
       return false;
@@ -365,7 +802,7 @@ bool JsonSerializer::IsArray(const char *name) const {
   else {
     rapidjson::Value &current = m_currentEntry.back().get();
 
-    rapidjson::Value::MemberIterator iter = current.FindMember(name);
+    rapidjson::Value::MemberIterator iter = FindMember(current, name);
 
     if (iter == current.MemberEnd()) {
       return false;
@@ -390,7 +827,7 @@ bool JsonSerializer::OpenArray(const char *name) const {
   else {
     rapidjson::Value &current = m_currentEntry.back().get();
 
-    rapidjson::Value::MemberIterator iter = current.FindMember(name);
+    rapidjson::Value::MemberIterator iter = FindMember(current, name);
 
     if (iter == current.MemberEnd()) {
       return false;
@@ -421,7 +858,7 @@ bool JsonSerializer::GetArrayCapacity(const char *name, s_size *size) const {
   else {
     rapidjson::Value &current = m_currentEntry.back().get();
 
-    rapidjson::Value::MemberIterator iter = current.FindMember(name);
+    rapidjson::Value::MemberIterator iter = FindMember(current, name);
 
     if (iter == current.MemberEnd()) {
       return false;
@@ -470,4 +907,104 @@ bool JsonSerializer::CloseArray() const {
   --m_currentDepth;
   return true;
 }
+
+bool JsonSerializer::ResolvePath(const PathQuery &path,
+                                 rapidjson::Value **parent,
+                                 std::uintptr_t *element) const {
+  const std::vector<PathQuery::Step> &steps = path.GetSteps();
+  if (steps.empty()) {
+    return false;
+  }
+
+  // The root is always the first one
+  rapidjson::Value *current = &m_currentEntry.front().get();
+
+  for (size_t i = 0; i + 1 < steps.size(); ++i) {
+    if (current->IsArray()) {
+      if (steps[i].m_index >= current->Size()) {
+        return false;
+      }
+      current = current->Begin() + steps[i].m_index;
+    } else if (current->IsObject()) {
+      rapidjson::Value::MemberIterator iter =
+          FindMember(*current, steps[i].m_name.c_str());
+      if (iter == current->MemberEnd()) {
+        return false;
+      }
+      current = &iter->value;
+    } else {
+      return false;
+    }
+  }
+
+  *parent = current;
+
+  if (current->IsArray()) {
+    if (steps.back().m_index >= current->Size()) {
+      return false;
+    }
+    *element = reinterpret_cast<std::uintptr_t>(current->Begin() +
+                                                steps.back().m_index);
+    return true;
+  }
+
+  if (!current->IsObject()) {
+    return false;
+  }
+
+  rapidjson::Value::MemberIterator iter =
+      FindMember(*current, steps.back().m_name.c_str());
+  if (iter == current->MemberEnd()) {
+    return false;
+  }
+
+  *element = reinterpret_cast<std::uintptr_t>(&*iter);
+  return true;
+}
+
+bool JsonSerializer::OpenPath(const PathQuery &path) const {
+  std::uintptr_t parentAddress;
+  std::uintptr_t element;
+  rapidjson::Value *parent;
+
+  if (path.GetResolved(this, m_pathGeneration, &parentAddress, &element)) {
+    parent = reinterpret_cast<rapidjson::Value *>(parentAddress);
+  } else {
+    if (!ResolvePath(path, &parent, &element)) {
+      return false;
+    }
+
+    path.SetResolved(this, m_pathGeneration,
+                     reinterpret_cast<std::uintptr_t>(parent), element);
+    m_pathResolved = true;
+  }
+
+  m_currentEntry.push_back(*parent);
+  ++m_currentDepth;
+
+  if (parent->IsArray()) {
+    m_currentArrayIter.push_back(
+        reinterpret_cast<rapidjson::Value::ValueIterator>(element));
+    m_currentArray.push_back(m_currentDepth);
+  } else {
+    m_pathMembers.push_back(
+        {parent, path.GetName(),
+         reinterpret_cast<rapidjson::Value::MemberIterator>(element)});
+  }
+
+  return true;
+}
+
+bool JsonSerializer::ClosePath() const {
+  if (IsInsideArray()) {
+    return CloseArray();
+  }
+
+  if (!m_pathMembers.empty() &&
+      m_pathMembers.back().m_parent == &m_currentEntry.back().get()) {
+    m_pathMembers.pop_back();
+  }
+  return CloseEntry();
+}
+
 } // namespace Serializer
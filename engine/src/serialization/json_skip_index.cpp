@@ -0,0 +1,211 @@
+#include "serialization/json_skip_index.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace Serializer {
+
+namespace {
+/* Levels with members in the index: the root and its objects */
+constexpr int kIndexedLevels = 2;
+
+/* If c is JSON whitespace */
+inline bool IsSpace(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+/* If c ends a number or a literal */
+inline bool IsSeparator(char c) {
+  return c == ',' || c == '}' || c == ']' || IsSpace(c);
+}
+
+/* Cursor over the text */
+class SkipScanner {
+public:
+  SkipScanner(const char *text, size_t length)
+      : m_text(text), m_length(length) {}
+
+  /* Index the members of the object at the cursor */
+  bool ScanObject(int level, std::vector<JsonSkipEntry> *entries);
+
+  /* Skip spaces, tabs and line ends */
+  inline void SkipSpace() {
+    while (m_pos < m_length && IsSpace(m_text[m_pos])) {
+      ++m_pos;
+    }
+  }
+
+  /* If the cursor is at c */
+  inline bool At(char c) const {
+    return m_pos < m_length && m_text[m_pos] == c;
+  }
+
+  /* If everything was scanned */
+  inline bool AtEnd() const { return m_pos == m_length; }
+
+private:
+  /* Skip the string at the cursor, including its quotes */
+  bool SkipString();
+
+  /* Skip the value at the cursor */
+  bool SkipValue();
+
+  const char *m_text;
+  size_t m_length;
+  size_t m_pos = 0;
+};
+
+bool SkipScanner::SkipString() {
+  ++m_pos;
+
+  // Jump from quote to quote, a quote after an odd number of \ is escaped
+  while (m_pos < m_length) {
+    const char *quote = static_cast<const char *>(
+        std::memchr(m_text + m_pos, '"', m_length - m_pos));
+    if (quote == nullptr) {
+      return false;
+    }
+
+    size_t end = static_cast<size_t>(quote - m_text);
+    size_t slashes = 0;
+    while (end - slashes > m_pos && m_text[end - slashes - 1] == '\\') {
+      ++slashes;
+    }
+
+    m_pos = end + 1;
+    if (slashes % 2 == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool SkipScanner::SkipValue() {
+  if (m_pos == m_length) {
+    return false;
+  }
+
+  const char c = m_text[m_pos];
+
+  if (c == '"') {
+    return SkipString();
+  }
+
+  // Numbers and literals end at a separator
+  if (c != '{' && c != '[') {
+    const size_t begin = m_pos;
+    while (m_pos < m_length && !IsSeparator(m_text[m_pos])) {
+      ++m_pos;
+    }
+    return m_pos != begin;
+  }
+
+  // Only the nesting is tracked
+  size_t depth = 0;
+  while (m_pos < m_length) {
+    switch (m_text[m_pos]) {
+    case '"':
+      if (!SkipString()) {
+        return false;
+      }
+      continue;
+    case '{':
+    case '[':
+      ++depth;
+      break;
+    case '}':
+    case ']':
+      if (--depth == 0) {
+        ++m_pos;
+        return true;
+      }
+      break;
+    default:
+      break;
+    }
+    ++m_pos;
+  }
+
+  return false;
+}
+
+bool SkipScanner::ScanObject(int level, std::vector<JsonSkipEntry> *entries) {
+  ++m_pos;
+  SkipSpace();
+
+  if (At('}')) {
+    ++m_pos;
+    return true;
+  }
+
+  while (true) {
+    if (!At('"')) {
+      return false;
+    }
+
+    JsonSkipEntry entry;
+    entry.m_nameOffset = m_pos + 1;
+
+    if (!SkipString()) {
+      return false;
+    }
+
+    entry.m_nameLength = m_pos - 1 - entry.m_nameOffset;
+    entry.m_escapedName = std::memchr(m_text + entry.m_nameOffset, '\\',
+                                      entry.m_nameLength) != nullptr;
+
+    SkipSpace();
+    if (!At(':')) {
+      return false;
+    }
+    ++m_pos;
+    SkipSpace();
+
+    entry.m_valueOffset = m_pos;
+
+    // The entry is added before its children, so it is found by position
+    const size_t index = entries->size();
+    entries->push_back(entry);
+
+    if (level + 1 < kIndexedLevels && At('{')) {
+      if (!ScanObject(level + 1, entries)) {
+        return false;
+      }
+      (*entries)[index].m_childCount = entries->size() - index - 1;
+    } else if (!SkipValue()) {
+      return false;
+    }
+
+    (*entries)[index].m_valueLength = m_pos - entry.m_valueOffset;
+
+    SkipSpace();
+    if (At(',')) {
+      ++m_pos;
+      SkipSpace();
+    } else if (At('}')) {
+      ++m_pos;
+      return true;
+    } else {
+      return false;
+    }
+  }
+}
+} // namespace
+
+bool BuildJsonSkipIndex(const char *text, size_t length,
+                        std::vector<JsonSkipEntry> *entries) {
+  entries->clear();
+
+  SkipScanner scanner(text, length);
+  scanner.SkipSpace();
+
+  if (!scanner.At('{') || !scanner.ScanObject(0, entries)) {
+    return false;
+  }
+
+  scanner.SkipSpace();
+  return scanner.AtEnd();
+}
+
+} // namespace Serializer
@@ -0,0 +1,202 @@
+#include "serialization/json_stream_serializer.hpp"
+
+#include "rapidjson/writer.h"
+#include "serialization/serializer.hpp"
+#include "serialization/sink.hpp"
+
+#include <vector>
+
+namespace Serializer {
+
+JsonStreamSerializer::JsonStreamSerializer(ISink &sink)
+    : m_sink(&sink), m_stream(sink), m_writer(m_stream) {
+  m_writer.StartObject(); // open root value
+}
+
+bool JsonStreamSerializer::ParseText(const char *) { return false; }
+
+bool JsonStreamSerializer::ParseText(const char *, size_t) { return false; }
+
+bool JsonStreamSerializer::Clear() {
+  m_writer.Reset(m_stream);
+  m_scopes.clear();
+  m_finished = false;
+  m_stream.ResetFailed();
+  return m_writer.StartObject(); // open root value
+}
+
+bool JsonStreamSerializer::Compile() {
+  if (!m_finished) {
+    // Whatever is left open is closed
+    while (!m_scopes.empty()) {
+      CloseScope(m_scopes.back());
+    }
+
+    m_writer.EndObject(); // close root value
+    m_finished = true;
+  }
+
+  m_stream.Flush();
+  const bool flushed = m_sink->Flush();
+
+  return flushed && !m_stream.HasFailed() && m_writer.IsComplete();
+}
+
+bool JsonStreamSerializer::CompilePretty() { return false; }
+
+bool JsonStreamSerializer::GetSize(s_size *) { return false; }
+
+bool JsonStreamSerializer::GetLength(s_size *) { return false; }
+
+bool JsonStreamSerializer::GetText(char *) { return false; }
+
+bool JsonStreamSerializer::WriteName(const char *name, s_size name_length) {
+  if (m_finished) {
+    return false;
+  }
+
+  // We are inside an array
+  if (IsInsideArray()) {
+    return true;
+  }
+  // We are in a normal entry
+  return m_writer.Key(name, static_cast<rapidjson::SizeType>(name_length),
+                      true);
+}
+
+bool JsonStreamSerializer::Splice(
+    const std::vector<JsonSerializer::Fragment> &fragments) {
+  for (const JsonSerializer::Fragment &fragment : fragments) {
+    // Already valid JSON, written as it is
+    if (!WriteName(fragment.m_name.c_str(), fragment.m_name.length()) ||
+        !m_writer.RawValue(fragment.m_text.c_str(), fragment.m_text.length(),
+                           fragment.m_type)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool JsonStreamSerializer::CloseScope(Scope scope) const {
+  if (m_finished || m_scopes.empty() || m_scopes.back() != scope) {
+    return false;
+  }
+
+  m_scopes.pop_back();
+
+  if (scope == Scope::kArray) {
+    return m_writer.EndArray();
+  }
+  return m_writer.EndObject();
+}
+
+bool JsonStreamSerializer::SetEntry(const char *name, s_size name_length,
+                                    s_size version) {
+  if (!WriteName(name, name_length) || !m_writer.StartObject()) {
+    return false;
+  }
+
+  m_scopes.push_back(Scope::kEntry);
+
+  return m_writer.Key(
+             kVersionEntryName,
+             static_cast<rapidjson::SizeType>(kVersionEntryNameLength)) &&
+         m_writer.Uint64(static_cast<uint64_t>(version));
+}
+
+bool JsonStreamSerializer::OpenEntry(const char *, s_size *) const {
+  return false;
+}
+
+bool JsonStreamSerializer::CloseEntry() const {
+  return CloseScope(Scope::kEntry);
+}
+
+bool JsonStreamSerializer::IsBool(const char *) const { return false; }
+
+bool JsonStreamSerializer::GetBool(const char *, bool *) const {
+  return false;
+}
+
+bool JsonStreamSerializer::IsUint(const char *) const { return false; }
+
+bool JsonStreamSerializer::GetUint(const char *, unsigned *) const {
+  return false;
+}
+
+bool JsonStreamSerializer::IsInt(const char *) const { return false; }
+
+bool JsonStreamSerializer::GetInt(const char *, int *) const { return false; }
+
+bool JsonStreamSerializer::IsUint64(const char *) const { return false; }
+
+bool JsonStreamSerializer::GetUint64(const char *, uint64_t *) const {
+  return false;
+}
+
+bool JsonStreamSerializer::IsInt64(const char *) const { return false; }
+
+bool JsonStreamSerializer::GetInt64(const char *, int64_t *) const {
+  return false;
+}
+
+bool JsonStreamSerializer::IsDouble(const char *) const { return false; }
+
+bool JsonStreamSerializer::GetDouble(const char *, double *) const {
+  return false;
+}
+
+bool JsonStreamSerializer::SetString(const char *name, s_size name_length,
+                                     const char *value, s_size length) {
+  return WriteName(name, name_length) &&
+         m_writer.String(value, static_cast<rapidjson::SizeType>(length),
+                         true);
+}
+
+bool JsonStreamSerializer::IsString(const char *) const { return false; }
+
+bool JsonStreamSerializer::GetStringLength(const char *, s_size *) const {
+  return false;
+}
+
+bool JsonStreamSerializer::GetStringSize(const char *, s_size *) const {
+  return false;
+}
+
+bool JsonStreamSerializer::GetString(const char *, char *) const {
+  return false;
+}
+
+bool JsonStreamSerializer::IsNull(const char *) const { return false; }
+
+bool JsonStreamSerializer::SetArray(const char *name, s_size name_length) {
+  if (!WriteName(name, name_length) || !m_writer.StartArray()) {
+    return false;
+  }
+
+  m_scopes.push_back(Scope::kArray);
+  return true;
+}
+
+bool JsonStreamSerializer::ReserveArray(const char *, s_size) {
+  return !m_finished;
+}
+
+bool JsonStreamSerializer::IsArray(const char *) const { return false; }
+
+bool JsonStreamSerializer::OpenArray(const char *) const { return false; }
+
+bool JsonStreamSerializer::GetArrayCapacity(const char *, s_size *) const {
+  return false;
+}
+
+bool JsonStreamSerializer::CanMoveArray() const { return false; }
+
+bool JsonStreamSerializer::MoveArray() const { return false; }
+
+bool JsonStreamSerializer::CloseArray() const {
+  return CloseScope(Scope::kArray);
+}
+
+} // namespace Serializer
@@ -0,0 +1,468 @@
+#include "serialization/message_pack_serializer.hpp"
+
+#include "serialization/serializer.hpp"
+#include "serialization/tree_serializer.hpp"
+
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace Serializer {
+
+namespace {
+/* Name of the version member of entries, the same as JSON */
+constexpr char kVersionName[] = "__VERSION__";
+
+/* Length of kVersionName */
+constexpr std::uint32_t kVersionNameLength = sizeof(kVersionName) - 1;
+} // namespace
+
+bool MessagePackSerializer::ParseText(const char *text) {
+  // The root map tells where it ends
+  return Parse(text, std::numeric_limits<size_t>::max(), false);
+}
+
+bool MessagePackSerializer::ParseText(const char *text, size_t length) {
+  return Parse(text, length, true);
+}
+
+bool MessagePackSerializer::Parse(const char *text, size_t length,
+                                  bool exact) {
+  Clear();
+
+  Reader reader{text, length};
+  std::uint64_t count;
+
+  if (!ReadMapSize(reader, &count) ||
+      !ReadChildren(reader, count, kRoot, true, 0)) {
+    Clear();
+    return false;
+  }
+
+  // Length might include a null terminator
+  if (exact && reader.m_remaining != 0 &&
+      (reader.m_remaining != 1 || *reader.m_cursor != '\0')) {
+    Clear();
+    return false;
+  }
+
+  return true;
+}
+
+bool MessagePackSerializer::Compile() {
+  m_buffer.clear();
+  WriteChildren(kRoot, true);
+  return true;
+}
+
+bool MessagePackSerializer::CompilePretty() { return Compile(); }
+
+void MessagePackSerializer::WriteBigEndian(std::uint64_t value, size_t size) {
+  for (size_t i = size; i > 0; --i) {
+    m_buffer.push_back(static_cast<char>(value >> (8 * (i - 1))));
+  }
+}
+
+void MessagePackSerializer::WriteFormat(Format format, std::uint64_t value,
+                                        size_t size) {
+  m_buffer.push_back(static_cast<char>(format));
+  WriteBigEndian(value, size);
+}
+
+void MessagePackSerializer::WriteUint(std::uint64_t value) {
+  if (value < 0x80) {
+    m_buffer.push_back(static_cast<char>(value));
+  } else if (value <= std::numeric_limits<std::uint8_t>::max()) {
+    WriteFormat(kFormatUint8, value, 1);
+  } else if (value <= std::numeric_limits<std::uint16_t>::max()) {
+    WriteFormat(kFormatUint16, value, 2);
+  } else if (value <= std::numeric_limits<std::uint32_t>::max()) {
+    WriteFormat(kFormatUint32, value, 4);
+  } else {
+    WriteFormat(kFormatUint64, value, 8);
+  }
+}
+
+void MessagePackSerializer::WriteInt(std::int64_t value) {
+  if (value >= 0) {
+    WriteUint(static_cast<std::uint64_t>(value));
+    return;
+  }
+
+  const std::uint64_t bits = static_cast<std::uint64_t>(value);
+
+  if (value >= -32) {
+    m_buffer.push_back(static_cast<char>(bits));
+  } else if (value >= std::numeric_limits<std::int8_t>::min()) {
+    WriteFormat(kFormatInt8, bits, 1);
+  } else if (value >= std::numeric_limits<std::int16_t>::min()) {
+    WriteFormat(kFormatInt16, bits, 2);
+  } else if (value >= std::numeric_limits<std::int32_t>::min()) {
+    WriteFormat(kFormatInt32, bits, 4);
+  } else {
+    WriteFormat(kFormatInt64, bits, 8);
+  }
+}
+
+void MessagePackSerializer::WriteString(const char *text,
+                                        std::uint32_t length) {
+  if (length < 32) {
+    m_buffer.push_back(static_cast<char>(kFormatFixStr | length));
+  } else if (length <= std::numeric_limits<std::uint8_t>::max()) {
+    WriteFormat(kFormatStr8, length, 1);
+  } else if (length <= std::numeric_limits<std::uint16_t>::max()) {
+    WriteFormat(kFormatStr16, length, 2);
+  } else {
+    WriteFormat(kFormatStr32, length, 4);
+  }
+
+  m_buffer.insert(m_buffer.end(), text, text + length);
+}
+
+void MessagePackSerializer::WriteChildren(node_index parent, bool named) {
+  const Node &parentNode = m_nodes[parent];
+  std::uint64_t count = parentNode.m_childCount;
+
+  // The version is one more member
+  if (parentNode.m_type == NodeType::kEntry) {
+    ++count;
+  }
+
+  if (named) {
+    if (count < 16) {
+      m_buffer.push_back(static_cast<char>(kFormatFixMap | count));
+    } else if (count <= std::numeric_limits<std::uint16_t>::max()) {
+      WriteFormat(kFormatMap16, count, 2);
+    } else {
+      WriteFormat(kFormatMap32, count, 4);
+    }
+  } else if (count < 16) {
+    m_buffer.push_back(static_cast<char>(kFormatFixArray | count));
+  } else if (count <= std::numeric_limits<std::uint16_t>::max()) {
+    WriteFormat(kFormatArray16, count, 2);
+  } else {
+    WriteFormat(kFormatArray32, count, 4);
+  }
+
+  if (parentNode.m_type == NodeType::kEntry) {
+    WriteString(kVersionName, kVersionNameLength);
+    WriteUint(parentNode.m_uint);
+  }
+
+  for (node_index child = parentNode.m_firstChild; child != kNone;
+       child = m_nodes[child].m_next) {
+    const Node &node = m_nodes[child];
+
+    if (named) {
+      WriteString(GetPoolString(node.m_name), node.m_nameLength);
+    }
+
+    WriteValue(node, child);
+  }
+}
+
+void MessagePackSerializer::WriteValue(const Node &node, node_index index) {
+  switch (node.m_type) {
+  case NodeType::kNull:
+    m_buffer.push_back(static_cast<char>(kFormatNil));
+    break;
+  case NodeType::kBool:
+    m_buffer.push_back(
+        static_cast<char>(node.m_bool ? kFormatTrue : kFormatFalse));
+    break;
+  case NodeType::kUint:
+    WriteUint(node.m_uint);
+    break;
+  case NodeType::kInt:
+    WriteInt(node.m_int);
+    break;
+  case NodeType::kDouble: {
+    std::uint64_t bits;
+    std::memcpy(&bits, &node.m_double, sizeof(bits));
+    WriteFormat(kFormatFloat64, bits, sizeof(bits));
+    break;
+  }
+  case NodeType::kString:
+    WriteString(GetPoolString(node.m_string), node.m_stringLength);
+    break;
+  case NodeType::kBlob: {
+    const std::uint32_t size = node.m_stringLength;
+    if (size <= std::numeric_limits<std::uint8_t>::max()) {
+      WriteFormat(kFormatBin8, size, 1);
+    } else if (size <= std::numeric_limits<std::uint16_t>::max()) {
+      WriteFormat(kFormatBin16, size, 2);
+    } else {
+      WriteFormat(kFormatBin32, size, 4);
+    }
+    const char *data = GetPoolString(node.m_string);
+    m_buffer.insert(m_buffer.end(), data, data + size);
+    break;
+  }
+  case NodeType::kArray:
+    WriteChildren(index, false);
+    break;
+  case NodeType::kObject:
+  case NodeType::kEntry:
+    WriteChildren(index, true);
+    break;
+  }
+}
+
+bool MessagePackSerializer::ReadBigEndian(Reader &reader, size_t size,
+                                          std::uint64_t *value) {
+  if (reader.m_remaining < size) {
+    return false;
+  }
+
+  std::uint64_t result = 0;
+  for (size_t i = 0; i < size; ++i) {
+    result = (result << 8) | static_cast<unsigned char>(reader.m_cursor[i]);
+  }
+
+  reader.m_cursor += size;
+  reader.m_remaining -= size;
+  *value = result;
+  return true;
+}
+
+bool MessagePackSerializer::ReadString(Reader &reader, const char **text,
+                                       std::uint32_t *length) {
+  std::uint64_t format;
+  std::uint64_t size;
+
+  if (!ReadBigEndian(reader, 1, &format)) {
+    return false;
+  }
+
+  if ((format & 0xE0) == kFormatFixStr) {
+    size = format & 0x1F;
+  } else if (format < kFormatStr8 || format > kFormatStr32 ||
+             !ReadBigEndian(reader, size_t{1} << (format - kFormatStr8),
+                            &size)) {
+    return false;
+  }
+
+  if (size > reader.m_remaining) {
+    return false;
+  }
+
+  *text = reader.m_cursor;
+  *length = static_cast<std::uint32_t>(size);
+  reader.m_cursor += size;
+  reader.m_remaining -= size;
+  return true;
+}
+
+bool MessagePackSerializer::ReadMapSize(Reader &reader, std::uint64_t *count) {
+  std::uint64_t format;
+
+  if (!ReadBigEndian(reader, 1, &format)) {
+    return false;
+  }
+
+  if ((format & 0xF0) == kFormatFixMap) {
+    *count = format & 0x0F;
+    return true;
+  }
+
+  return (format == kFormatMap16 || format == kFormatMap32) &&
+         ReadBigEndian(reader, format == kFormatMap16 ? 2 : 4, count);
+}
+
+bool MessagePackSerializer::ReadValue(Reader &reader, Node &node,
+                                      std::uint64_t *count) {
+  std::uint64_t format;
+
+  if (!ReadBigEndian(reader, 1, &format)) {
+    return false;
+  }
+
+  *count = 0;
+
+  // Formats with the value or the size in the format byte
+  if (format < kFormatFixMap) {
+    node.m_type = NodeType::kUint;
+    node.m_uint = format;
+    return true;
+  }
+  if (format >= kFormatNegativeFixInt) {
+    node.m_type = NodeType::kInt;
+    node.m_int = static_cast<std::int8_t>(format);
+    return true;
+  }
+  if (format < kFormatFixArray) {
+    node.m_type = NodeType::kEntry;
+    *count = format & 0x0F;
+    return ReadVersion(reader, node, count);
+  }
+  if (format < kFormatFixStr) {
+    node.m_type = NodeType::kArray;
+    *count = format & 0x0F;
+    return true;
+  }
+
+  if (format < kFormatNil ||
+      (format >= kFormatStr8 && format <= kFormatStr32)) {
+    // Read again from the format byte
+    --reader.m_cursor;
+    ++reader.m_remaining;
+
+    const char *text;
+    std::uint32_t length;
+    if (!ReadString(reader, &text, &length)) {
+      return false;
+    }
+    node.m_type = NodeType::kString;
+    node.m_string = AddString(text, static_cast<s_size>(length));
+    node.m_stringLength = length;
+    return true;
+  }
+
+  std::uint64_t value;
+
+  switch (format) {
+  case kFormatNil:
+    node.m_type = NodeType::kNull;
+    return true;
+  case kFormatFalse:
+  case kFormatTrue:
+    node.m_type = NodeType::kBool;
+    node.m_bool = format == kFormatTrue;
+    return true;
+  case kFormatBin8:
+  case kFormatBin16:
+  case kFormatBin32:
+    if (!ReadBigEndian(reader, size_t{1} << (format - kFormatBin8), &value) ||
+        value > reader.m_remaining) {
+      return false;
+    }
+    node.m_type = NodeType::kBlob;
+    node.m_string = AddString(reader.m_cursor, static_cast<s_size>(value));
+    node.m_stringLength = static_cast<std::uint32_t>(value);
+    reader.m_cursor += value;
+    reader.m_remaining -= value;
+    return true;
+  case kFormatFloat32: {
+    if (!ReadBigEndian(reader, 4, &value)) {
+      return false;
+    }
+    const std::uint32_t bits = static_cast<std::uint32_t>(value);
+    float single;
+    std::memcpy(&single, &bits, sizeof(single));
+    node.m_type = NodeType::kDouble;
+    node.m_double = single;
+    return true;
+  }
+  case kFormatFloat64:
+    if (!ReadBigEndian(reader, 8, &value)) {
+      return false;
+    }
+    node.m_type = NodeType::kDouble;
+    std::memcpy(&node.m_double, &value, sizeof(value));
+    return true;
+  case kFormatUint8:
+  case kFormatUint16:
+  case kFormatUint32:
+  case kFormatUint64:
+    node.m_type = NodeType::kUint;
+    return ReadBigEndian(reader, size_t{1} << (format - kFormatUint8),
+                         &node.m_uint);
+  case kFormatInt8:
+  case kFormatInt16:
+  case kFormatInt32:
+  case kFormatInt64: {
+    const size_t size = size_t{1} << (format - kFormatInt8);
+    if (!ReadBigEndian(reader, size, &value)) {
+      return false;
+    }
+    // Sign extended from its top bit
+    const unsigned unused = static_cast<unsigned>(64 - 8 * size);
+    node.m_type = NodeType::kInt;
+    node.m_int = static_cast<std::int64_t>(value << unused) >> unused;
+    return true;
+  }
+  case kFormatArray16:
+  case kFormatArray32:
+    node.m_type = NodeType::kArray;
+    return ReadBigEndian(reader, format == kFormatArray16 ? 2 : 4, count);
+  case kFormatMap16:
+  case kFormatMap32:
+    node.m_type = NodeType::kEntry;
+    return ReadBigEndian(reader, format == kFormatMap16 ? 2 : 4, count) &&
+           ReadVersion(reader, node, count);
+  default:
+    // Extension types and the unused format
+    return false;
+  }
+}
+
+bool MessagePackSerializer::ReadVersion(Reader &reader, Node &node,
+                                        std::uint64_t *count) {
+  node.m_uint = 0;
+
+  if (*count == 0) {
+    return true;
+  }
+
+  // Only looked at, the first member is read again if it is not the version
+  Reader peek = reader;
+  const char *name;
+  std::uint32_t length;
+  Node version;
+  std::uint64_t unused;
+
+  if (!ReadString(peek, &name, &length) || length != kVersionNameLength ||
+      std::memcmp(name, kVersionName, length) != 0 ||
+      !ReadValue(peek, version, &unused) ||
+      version.m_type != NodeType::kUint) {
+    return true;
+  }
+
+  node.m_uint = version.m_uint;
+  --*count;
+  reader = peek;
+  return true;
+}
+
+bool MessagePackSerializer::ReadChildren(Reader &reader, std::uint64_t count,
+                                         node_index parent, bool named,
+                                         std::uint32_t depth) {
+  if (depth > kMaxParseDepth) {
+    return false;
+  }
+
+  for (std::uint64_t i = 0; i < count; ++i) {
+    Node node;
+
+    if (named) {
+      const char *name;
+      std::uint32_t nameLength;
+
+      if (!ReadString(reader, &name, &nameLength)) {
+        return false;
+      }
+
+      node.m_name = AddString(name, static_cast<s_size>(nameLength));
+      node.m_nameLength = nameLength;
+    }
+
+    std::uint64_t childCount;
+    if (!ReadValue(reader, node, &childCount)) {
+      return false;
+    }
+
+    node_index index = static_cast<node_index>(m_nodes.size());
+    m_nodes.push_back(node);
+    AppendChild(parent, index);
+
+    if ((node.m_type == NodeType::kArray || node.m_type == NodeType::kEntry) &&
+        !ReadChildren(reader, childCount, index,
+                      node.m_type == NodeType::kEntry, depth + 1)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+} // namespace Serializer
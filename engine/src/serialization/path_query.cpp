@@ -0,0 +1,112 @@
+#include "serialization/path_query.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Serializer {
+
+namespace {
+/* Index of a step if it is a number without leading zeros */
+size_t GetIndex(const std::string &name) {
+  if (name.empty() || (name[0] == '0' && name.size() > 1)) {
+    return PathQuery::kNoIndex;
+  }
+
+  size_t index = 0;
+  for (char c : name) {
+    if (c < '0' || c > '9' ||
+        index > (PathQuery::kNoIndex - 1 - static_cast<size_t>(c - '0')) / 10) {
+      return PathQuery::kNoIndex;
+    }
+    index = index * 10 + static_cast<size_t>(c - '0');
+  }
+
+  return index;
+}
+
+/* Unescape a JSON pointer token, false if it has a bad escape */
+bool Unescape(std::string_view token, std::string *name) {
+  name->clear();
+  name->reserve(token.size());
+
+  for (size_t i = 0; i < token.size(); ++i) {
+    if (token[i] != '~') {
+      name->push_back(token[i]);
+      continue;
+    }
+
+    if (i + 1 == token.size()) {
+      return false;
+    }
+
+    ++i;
+    if (token[i] == '0') {
+      name->push_back('~');
+    } else if (token[i] == '1') {
+      name->push_back('/');
+    } else {
+      return false;
+    }
+  }
+
+  return true;
+}
+} // namespace
+
+bool PathQuery::Compile(std::string_view path, PathQuery *query) {
+  std::vector<Step> steps;
+
+  if (!path.empty() && path[0] == '/') {
+    // JSON pointer, every token is a step, even the empty ones
+    size_t begin = 1;
+    while (true) {
+      const size_t end = std::min(path.find('/', begin), path.size());
+
+      Step step;
+      if (!Unescape(path.substr(begin, end - begin), &step.m_name)) {
+        return false;
+      }
+      steps.push_back(std::move(step));
+
+      if (end == path.size()) {
+        break;
+      }
+      begin = end + 1;
+    }
+  } else {
+    size_t begin = 0;
+    while (begin <= path.size()) {
+      const size_t end = std::min(path.find_first_of("/.", begin), path.size());
+      if (end == begin) {
+        return false;
+      }
+
+      Step step;
+      step.m_name.assign(path.substr(begin, end - begin));
+      steps.push_back(std::move(step));
+
+      begin = end + 1;
+    }
+  }
+
+  for (Step &step : steps) {
+    step.m_index = GetIndex(step.m_name);
+  }
+
+  query->m_steps = std::move(steps);
+  query->m_owner = nullptr;
+  return true;
+}
+
+std::uint64_t PathQuery::NextGeneration() {
+  static std::atomic<std::uint64_t> s_generation{0};
+  return ++s_generation;
+}
+
+} // namespace Serializer
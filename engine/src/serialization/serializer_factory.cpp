@@ -0,0 +1,45 @@
+#include "serialization/serializer_factory.hpp"
+
+#include "serialization/binary_serializer.hpp"
+#include "serialization/flat_serializer.hpp"
+#include "serialization/json_serializer.hpp"
+#include "serialization/message_pack_serializer.hpp"
+#include "serialization/serializer.hpp"
+
+#include <memory>
+#include <string_view>
+
+namespace Serializer {
+
+bool GetSerializerFormat(std::string_view name, SerializerFormat *format) {
+  if (name == "json") {
+    *format = SerializerFormat::kJson;
+  } else if (name == "binary") {
+    *format = SerializerFormat::kBinary;
+  } else if (name == "msgpack") {
+    *format = SerializerFormat::kMessagePack;
+  } else if (name == "flat") {
+    *format = SerializerFormat::kFlat;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+std::unique_ptr<ISerializer> CreateSerializer(SerializerFormat format) {
+  switch (format) {
+  case SerializerFormat::kJson:
+    return std::make_unique<JsonSerializer>();
+  case SerializerFormat::kBinary:
+    return std::make_unique<BinarySerializer>();
+  case SerializerFormat::kMessagePack:
+    return std::make_unique<MessagePackSerializer>();
+  case SerializerFormat::kFlat:
+    return std::make_unique<FlatSerializer>();
+  }
+
+  return nullptr;
+}
+
+} // namespace Serializer
@@ -0,0 +1,91 @@
+#include "serialization/shared_graph.hpp"
+
+#include "serialization/serializer.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <typeinfo>
+#include <utility>
+
+namespace Serializer {
+
+namespace {
+/* Writer and reader of this thread */
+thread_local SharedWriter *t_writer = nullptr;
+thread_local SharedReader *t_reader = nullptr;
+} // namespace
+
+SharedWriter::SharedWriter() : m_previous(t_writer) { t_writer = this; }
+
+SharedWriter::~SharedWriter() { t_writer = m_previous; }
+
+bool SharedWriter::Set(ISerializer *serializer, const char *name,
+                       s_size name_length, ISerializable *object) {
+  if (object == nullptr) {
+    return serializer->SetNull(name, name_length);
+  }
+
+  // IDs start at 1, in the order the objects are written
+  const auto [found, added] = m_ids.try_emplace(object, m_ids.size() + 1);
+
+  if (!added) {
+    return serializer->SetUint64(name, name_length, found->second);
+  }
+
+  return serializer->SetEntry(name, name_length, kSharedVersion) &&
+         serializer->SetUint64(kSharedIdName, sizeof(kSharedIdName) - 1,
+                               found->second) &&
+         object->Serialize(serializer, kSharedObjectName,
+                           sizeof(kSharedObjectName) - 1) &&
+         serializer->CloseEntry();
+}
+
+SharedWriter *SharedWriter::GetCurrent() { return t_writer; }
+
+SharedReader::SharedReader() : m_previous(t_reader) { t_reader = this; }
+
+SharedReader::~SharedReader() { t_reader = m_previous; }
+
+bool SharedReader::Register(std::uint64_t id, const std::type_info &type,
+                            std::shared_ptr<void> object) {
+  return m_objects.try_emplace(id, Object{std::move(object), &type}).second;
+}
+
+bool SharedReader::Link(std::uint64_t id, const std::type_info &type,
+                        void *target, Setter setter) {
+  const auto found = m_objects.find(id);
+
+  if (found == m_objects.end()) {
+    m_fixups.push_back(Fixup{id, &type, target, setter});
+    return true;
+  }
+
+  if (*found->second.m_type != type) {
+    return false;
+  }
+
+  setter(target, found->second.m_object);
+  return true;
+}
+
+bool SharedReader::Resolve() {
+  bool res = true;
+
+  for (const Fixup &fixup : m_fixups) {
+    const auto found = m_objects.find(fixup.m_id);
+
+    if (found == m_objects.end() || *found->second.m_type != *fixup.m_type) {
+      res = false;
+      continue;
+    }
+
+    fixup.m_setter(fixup.m_target, found->second.m_object);
+  }
+
+  m_fixups.clear();
+  return res;
+}
+
+SharedReader *SharedReader::GetCurrent() { return t_reader; }
+
+} // namespace Serializer
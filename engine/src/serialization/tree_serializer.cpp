@@ -0,0 +1,1031 @@
+#include "serialization/tree_serializer.hpp"
+
+#include "serialization/serializer.hpp"
+#include "serialization/sink.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace Serializer {
+
+namespace {
+/* Parts of a delta entry: members set whole, names of removed members and
+ * patches of entries and arrays */
+constexpr char kDeltaSet[] = "__SET__";
+constexpr char kDeltaRemove[] = "__REMOVE__";
+constexpr char kDeltaEntries[] = "__ENTRIES__";
+constexpr char kDeltaArrays[] = "__ARRAYS__";
+
+/* Parts of a delta array: where the splice is, the count of elements removed
+ * (kDeltaRemove) and the ones inserted */
+constexpr char kDeltaAt[] = "__AT__";
+constexpr char kDeltaInsert[] = "__INSERT__";
+
+/* Tree where a delta is applied, it is never parsed nor compiled */
+class DeltaTree final : public TreeSerializer {
+public:
+  bool ParseText(const char *) final { return false; }
+  bool ParseText(const char *, size_t) final { return false; }
+  bool Compile() final { return false; }
+  bool CompilePretty() final { return false; }
+};
+
+/* Members of an entry by name, the first one if there are more */
+using MemberMap = std::unordered_map<std::string_view, std::uint32_t>;
+} // namespace
+
+TreeSerializer::TreeSerializer() { TreeSerializer::Clear(); }
+
+bool TreeSerializer::Clear() {
+  InvalidatePaths();
+  m_nodes.clear();
+  m_strings.clear();
+  m_mappedNodes = nullptr;
+  m_mappedNodeCount = 0;
+  m_mappedStrings = nullptr;
+  m_mappedStringsSize = 0;
+  m_buffer.clear();
+  m_currentEntry.clear();
+  m_currentDepth = 0;
+  m_currentArray.clear();
+  m_currentArrayIter.clear();
+
+  Node root;
+  root.m_type = NodeType::kObject;
+  m_nodes.push_back(root);
+
+  m_currentEntry.push_back(kRoot); // push root value
+  return true;
+}
+
+bool TreeSerializer::GetSize(s_size *size) {
+  *size = static_cast<s_size>(m_buffer.size()) + sizeof(char);
+  return true;
+}
+
+bool TreeSerializer::GetLength(s_size *length) {
+  *length = static_cast<s_size>(m_buffer.size()) + 1;
+  return true;
+}
+
+bool TreeSerializer::GetText(char *text) {
+  std::memcpy(text, m_buffer.data(), m_buffer.size());
+  text[m_buffer.size()] = '\0';
+  return true;
+}
+
+bool TreeSerializer::GetView(std::string_view *view) const {
+  *view = std::string_view(m_buffer.data(), m_buffer.size());
+  return true;
+}
+
+bool TreeSerializer::CompileTo(ISink &sink) {
+  // The encoding needs the whole body first (i.e. its size in the header)
+  return Compile() && sink.Write(m_buffer.data(), m_buffer.size()) &&
+         sink.Flush();
+}
+
+void TreeSerializer::CopyMapped() {
+  m_nodes.assign(m_mappedNodes, m_mappedNodes + m_mappedNodeCount);
+  m_strings.assign(m_mappedStrings, m_mappedStrings + m_mappedStringsSize);
+
+  m_mappedNodes = nullptr;
+  m_mappedNodeCount = 0;
+  m_mappedStrings = nullptr;
+  m_mappedStringsSize = 0;
+}
+
+std::uint32_t TreeSerializer::AddString(const char *text, s_size length) {
+  std::uint32_t offset = static_cast<std::uint32_t>(m_strings.size());
+  m_strings.insert(m_strings.end(), text, text + length);
+  m_strings.push_back('\0');
+  return offset;
+}
+
+void TreeSerializer::AppendChild(node_index parent, node_index child) {
+  Node &parentNode = m_nodes[parent];
+
+  if (parentNode.m_lastChild == kNone) {
+    parentNode.m_firstChild = child;
+  } else {
+    m_nodes[parentNode.m_lastChild].m_next = child;
+  }
+
+  parentNode.m_lastChild = child;
+  ++parentNode.m_childCount;
+}
+
+TreeSerializer::node_index
+TreeSerializer::AddNode(NodeType type, const char *name, s_size name_length) {
+  // Every Set goes through here, the image is read only
+  if (m_mappedNodes != nullptr) {
+    CopyMapped();
+  }
+  InvalidatePaths();
+
+  node_index index = static_cast<node_index>(m_nodes.size());
+
+  Node node;
+  node.m_type = type;
+
+  // Array elements have no name
+  if (!IsInsideArray()) {
+    node.m_name = AddString(name, name_length);
+    node.m_nameLength = static_cast<std::uint32_t>(name_length);
+  }
+
+  m_nodes.push_back(node);
+  AppendChild(m_currentEntry.back(), index);
+  return index;
+}
+
+TreeSerializer::node_index TreeSerializer::FindMember(const char *name) const {
+  if (name == nullptr) {
+    return kNone;
+  }
+
+  const size_t length = std::strlen(name);
+  node_index child = GetNode(m_currentEntry.back()).m_firstChild;
+
+  while (child != kNone) {
+    const Node &node = GetNode(child);
+
+    if (node.m_nameLength == length &&
+        std::memcmp(GetPoolString(node.m_name), name, length) == 0) {
+      return child;
+    }
+
+    child = node.m_next;
+  }
+
+  return kNone;
+}
+
+TreeSerializer::node_index TreeSerializer::FindTarget(const char *name) const {
+  // We are inside an array
+  if (IsInsideArray()) {
+    return m_currentArrayIter.back();
+  }
+  // We are in a normal entry
+  return FindMember(name);
+}
+
+bool TreeSerializer::SetEntry(const char *name, s_size name_length,
+                              s_size version) {
+  node_index index = AddNode(NodeType::kEntry, name, name_length);
+  m_nodes[index].m_uint = static_cast<std::uint64_t>(version);
+
+  m_currentEntry.push_back(index);
+
+  ++m_currentDepth;
+  return true;
+}
+
+bool TreeSerializer::OpenEntry(const char *name, s_size *version) const {
+  node_index target = FindTarget(name);
+
+  if (target == kNone || GetNode(target).m_type != NodeType::kEntry) {
+    return false;
+  }
+
+  *version = static_cast<s_size>(GetNode(target).m_uint);
+
+  m_currentEntry.push_back(target);
+
+  ++m_currentDepth;
+  return true;
+}
+
+bool TreeSerializer::CloseEntry() const {
+  m_currentEntry.pop_back();
+
+  --m_currentDepth;
+  return true;
+}
+
+bool TreeSerializer::SetString(const char *name, s_size name_length,
+                               const char *value, s_size length) {
+  node_index index = AddNode(NodeType::kString, name, name_length);
+  std::uint32_t offset = AddString(value, length);
+
+  m_nodes[index].m_string = offset;
+  m_nodes[index].m_stringLength = static_cast<std::uint32_t>(length);
+  return true;
+}
+
+bool TreeSerializer::IsString(const char *name) const {
+  node_index target = FindTarget(name);
+
+  return target != kNone && GetNode(target).m_type == NodeType::kString;
+}
+
+bool TreeSerializer::GetStringLength(const char *name, s_size *result) const {
+  node_index target = FindTarget(name);
+
+  if (target == kNone || GetNode(target).m_type != NodeType::kString) {
+    return false;
+  }
+
+  *result = static_cast<s_size>(GetNode(target).m_stringLength) + 1;
+  return true;
+}
+
+bool TreeSerializer::GetStringSize(const char *name, s_size *result) const {
+  bool res = GetStringLength(name, result);
+  if (res) {
+    *result *= sizeof(char);
+  }
+  return res;
+}
+
+bool TreeSerializer::GetString(const char *name, char *result) const {
+  node_index target = FindTarget(name);
+
+  if (target == kNone || GetNode(target).m_type != NodeType::kString) {
+    return false;
+  }
+
+  const Node &node = GetNode(target);
+  std::memcpy(result, GetPoolString(node.m_string), node.m_stringLength);
+  result[node.m_stringLength] = '\0';
+  return true;
+}
+
+bool TreeSerializer::GetStringView(const char *name,
+                                   std::string_view *result) const {
+  node_index target = FindTarget(name);
+
+  if (target == kNone || GetNode(target).m_type != NodeType::kString) {
+    return false;
+  }
+
+  const Node &node = GetNode(target);
+  *result = std::string_view(GetPoolString(node.m_string), node.m_stringLength);
+  return true;
+}
+
+bool TreeSerializer::SetBlob(const char *name, s_size name_length,
+                             const void *data, s_size size) {
+  // Offsets and sizes in the pool are 32 bits
+  if (size > std::numeric_limits<std::uint32_t>::max()) {
+    return false;
+  }
+
+  node_index index = AddNode(NodeType::kBlob, name, name_length);
+  std::uint32_t offset = AddString(static_cast<const char *>(data), size);
+
+  m_nodes[index].m_string = offset;
+  m_nodes[index].m_stringLength = static_cast<std::uint32_t>(size);
+  return true;
+}
+
+bool TreeSerializer::GetBlobSize(const char *name, s_size *size) const {
+  node_index target = FindTarget(name);
+
+  if (target == kNone || GetNode(target).m_type != NodeType::kBlob) {
+    return false;
+  }
+
+  *size = static_cast<s_size>(GetNode(target).m_stringLength);
+  return true;
+}
+
+bool TreeSerializer::GetBlob(const char *name, void *result,
+                             s_size size) const {
+  node_index target = FindTarget(name);
+
+  if (target == kNone || GetNode(target).m_type != NodeType::kBlob ||
+      GetNode(target).m_stringLength != size) {
+    return false;
+  }
+
+  // An empty blob might come with no memory at all
+  if (size != 0) {
+    std::memcpy(result, GetPoolString(GetNode(target).m_string),
+                static_cast<size_t>(size));
+  }
+  return true;
+}
+
+bool TreeSerializer::SetNull(const char *name, s_size name_length) {
+  AddNode(NodeType::kNull, name, name_length);
+  return true;
+}
+
+bool TreeSerializer::IsNull(const char *name) const {
+  node_index target = FindTarget(name);
+
+  return target != kNone && GetNode(target).m_type == NodeType::kNull;
+}
+
+bool TreeSerializer::SetArray(const char *name, s_size name_length) {
+  node_index index = AddNode(NodeType::kArray, name, name_length);
+
+  // A new array is empty, so its iterator is at the end
+  m_currentArrayIter.push_back(kNone);
+
+  m_currentEntry.push_back(index);
+
+  ++m_currentDepth;
+  m_currentArray.push_back(m_currentDepth);
+  return true;
+}
+
+bool TreeSerializer::ReserveArray(const char *name, s_size size) {
+  // We are in a normal entry
+  if (!IsInsideArray() && FindMember(name) == kNone) {
+    return false;
+  }
+
+  m_nodes.reserve(m_nodes.size() + static_cast<size_t>(size));
+  return true;
+}
+
+bool TreeSerializer::IsArray(const char *name) const {
+  // We are inside an array
+  if (IsInsideArray()) {
+    return GetNode(m_currentEntry.back()).m_type == NodeType::kArray;
+  }
+  // We are in a normal entry
+  node_index target = FindMember(name);
+
+  return target != kNone && GetNode(target).m_type == NodeType::kArray;
+}
+
+bool TreeSerializer::OpenArray(const char *name) const {
+  node_index target = FindTarget(name);
+
+  if (target == kNone || GetNode(target).m_type != NodeType::kArray) {
+    return false;
+  }
+
+  m_currentArrayIter.push_back(GetNode(target).m_firstChild);
+
+  m_currentEntry.push_back(target);
+
+  ++m_currentDepth;
+  m_currentArray.push_back(m_currentDepth);
+  return true;
+}
+
+bool TreeSerializer::GetArrayCapacity(const char *name, s_size *size) const {
+  node_index target = FindTarget(name);
+
+  if (target == kNone || GetNode(target).m_type != NodeType::kArray) {
+    return false;
+  }
+
+  *size = static_cast<s_size>(GetNode(target).m_childCount);
+  return true;
+}
+
+bool TreeSerializer::CanMoveArray() const {
+  // We are inside an array
+  if (IsInsideArray()) {
+    return m_currentArrayIter.back() != kNone;
+  }
+  return false;
+}
+
+bool TreeSerializer::MoveArray() const {
+  // We are inside an array
+  if (IsInsideArray()) {
+    node_index current = m_currentArrayIter.back();
+
+    // We are at the last position
+    if (current == kNone) {
+      return false;
+    }
+
+    m_currentArrayIter.back() = GetNode(current).m_next;
+    return true;
+  }
+  return false;
+}
+
+bool TreeSerializer::CloseArray() const {
+  m_currentEntry.pop_back();
+  m_currentArrayIter.pop_back();
+  m_currentArray.pop_back();
+
+  --m_currentDepth;
+  return true;
+}
+
+TreeSerializer::node_index
+TreeSerializer::FindChild(node_index node, const std::string &name) const {
+  node_index child = GetNode(node).m_firstChild;
+
+  while (child != kNone) {
+    const Node &childNode = GetNode(child);
+
+    if (childNode.m_nameLength == name.size() &&
+        std::memcmp(GetPoolString(childNode.m_name), name.data(),
+                    name.size()) == 0) {
+      return child;
+    }
+
+    child = childNode.m_next;
+  }
+
+  return kNone;
+}
+
+bool TreeSerializer::ResolvePath(const PathQuery &path, node_index *parent,
+                                 node_index *element) const {
+  const std::vector<PathQuery::Step> &steps = path.GetSteps();
+  if (steps.empty()) {
+    return false;
+  }
+
+  node_index current = kRoot;
+  for (size_t i = 0; i + 1 < steps.size(); ++i) {
+    const Node &node = GetNode(current);
+
+    if (node.m_type == NodeType::kArray) {
+      if (steps[i].m_index >= node.m_childCount) {
+        return false;
+      }
+
+      current = node.m_firstChild;
+      for (size_t j = 0; j < steps[i].m_index; ++j) {
+        current = GetNode(current).m_next;
+      }
+    } else if (node.m_type == NodeType::kEntry ||
+               node.m_type == NodeType::kObject) {
+      current = FindChild(current, steps[i].m_name);
+      if (current == kNone) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+
+  const Node &node = GetNode(current);
+  *parent = current;
+  *element = kNone;
+
+  // The element is kept, a member is looked up again by name when read
+  if (node.m_type == NodeType::kArray) {
+    if (steps.back().m_index >= node.m_childCount) {
+      return false;
+    }
+
+    *element = node.m_firstChild;
+    for (size_t j = 0; j < steps.back().m_index; ++j) {
+      *element = GetNode(*element).m_next;
+    }
+    return true;
+  }
+
+  return (node.m_type == NodeType::kEntry ||
+          node.m_type == NodeType::kObject) &&
+         FindChild(current, steps.back().m_name) != kNone;
+}
+
+bool TreeSerializer::OpenPath(const PathQuery &path) const {
+  std::uintptr_t parent;
+  std::uintptr_t element;
+
+  if (!path.GetResolved(this, m_pathGeneration, &parent, &element)) {
+    node_index parentIndex;
+    node_index elementIndex;
+    if (!ResolvePath(path, &parentIndex, &elementIndex)) {
+      return false;
+    }
+
+    parent = parentIndex;
+    element = elementIndex;
+    path.SetResolved(this, m_pathGeneration, parent, element);
+    m_pathResolved = true;
+  }
+
+  m_currentEntry.push_back(static_cast<node_index>(parent));
+  ++m_currentDepth;
+
+  if (GetNode(static_cast<node_index>(parent)).m_type == NodeType::kArray) {
+    m_currentArrayIter.push_back(static_cast<node_index>(element));
+    m_currentArray.push_back(m_currentDepth);
+  }
+
+  return true;
+}
+
+bool TreeSerializer::ClosePath() const {
+  return IsInsideArray() ? CloseArray() : CloseEntry();
+}
+
+bool TreeSerializer::Diff(const TreeSerializer &baseline,
+                          TreeSerializer *delta) const {
+  if (delta == this || delta == &baseline) {
+    return false;
+  }
+
+  delta->Clear();
+  delta->DiffEntry(baseline, kRoot, *this, kRoot, kRoot);
+  return true;
+}
+
+bool TreeSerializer::ApplyDelta(const TreeSerializer &delta) {
+  if (&delta == this) {
+    return false;
+  }
+
+  // Built apart, so a broken delta leaves this as it was
+  DeltaTree result;
+  if (!result.ApplyEntry(*this, kRoot, delta, kRoot, kRoot)) {
+    return false;
+  }
+
+  Clear();
+  m_nodes = std::move(result.m_nodes);
+  m_strings = std::move(result.m_strings);
+  return true;
+}
+
+bool TreeSerializer::NodesEqual(const TreeSerializer &first,
+                                node_index firstIndex,
+                                const TreeSerializer &second,
+                                node_index secondIndex) {
+  const Node &a = first.GetNode(firstIndex);
+  const Node &b = second.GetNode(secondIndex);
+
+  if (a.m_type != b.m_type) {
+    return false;
+  }
+
+  switch (a.m_type) {
+  case NodeType::kNull:
+    return true;
+  case NodeType::kBool:
+    return a.m_bool == b.m_bool;
+  case NodeType::kUint:
+  case NodeType::kInt:
+  case NodeType::kDouble:
+    // Bits, so a NaN is not a change
+    return a.m_uint == b.m_uint;
+  case NodeType::kString:
+  case NodeType::kBlob:
+    return a.m_stringLength == b.m_stringLength &&
+           std::memcmp(first.GetPoolString(a.m_string),
+                       second.GetPoolString(b.m_string),
+                       a.m_stringLength) == 0;
+  case NodeType::kEntry:
+    if (a.m_uint != b.m_uint) {
+      return false;
+    }
+    break;
+  case NodeType::kArray:
+  case NodeType::kObject:
+    break;
+  }
+
+  if (a.m_childCount != b.m_childCount) {
+    return false;
+  }
+
+  for (node_index x = a.m_firstChild, y = b.m_firstChild; x != kNone;
+       x = first.GetNode(x).m_next, y = second.GetNode(y).m_next) {
+    const Node &childA = first.GetNode(x);
+    const Node &childB = second.GetNode(y);
+
+    if (childA.m_nameLength != childB.m_nameLength ||
+        (childA.m_name != kNone &&
+         std::memcmp(first.GetPoolString(childA.m_name),
+                     second.GetPoolString(childB.m_name),
+                     childA.m_nameLength) != 0) ||
+        !NodesEqual(first, x, second, y)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+TreeSerializer::node_index
+TreeSerializer::AppendNode(node_index parent, Node node, const char *name,
+                           std::uint32_t nameLength) {
+  InvalidatePaths();
+
+  node.m_next = kNone;
+  node.m_firstChild = kNone;
+  node.m_lastChild = kNone;
+  node.m_childCount = 0;
+  node.m_name = name != nullptr ? AddString(name, nameLength) : kNone;
+  node.m_nameLength = name != nullptr ? nameLength : 0;
+
+  node_index index = static_cast<node_index>(m_nodes.size());
+  m_nodes.push_back(node);
+  AppendChild(parent, index);
+  return index;
+}
+
+TreeSerializer::node_index
+TreeSerializer::CopyNode(node_index parent, const char *name,
+                         std::uint32_t nameLength, const TreeSerializer &from,
+                         node_index index) {
+  Node node = from.GetNode(index);
+
+  if (node.m_type == NodeType::kString || node.m_type == NodeType::kBlob) {
+    node.m_string = AddString(from.GetPoolString(node.m_string),
+                              node.m_stringLength);
+  }
+
+  node_index copy = AppendNode(parent, node, name, nameLength);
+
+  for (node_index child = from.GetNode(index).m_firstChild; child != kNone;
+       child = from.GetNode(child).m_next) {
+    const Node &childNode = from.GetNode(child);
+    CopyNode(copy,
+             childNode.m_name != kNone ? from.GetPoolString(childNode.m_name)
+                                       : nullptr,
+             childNode.m_nameLength, from, child);
+  }
+
+  return copy;
+}
+
+TreeSerializer::node_index
+TreeSerializer::GetDeltaPart(node_index patch, node_index *part,
+                             const char *name, NodeType type) {
+  if (*part == kNone) {
+    Node node;
+    node.m_type = type;
+    *part = AppendNode(patch, node, name,
+                       static_cast<std::uint32_t>(std::strlen(name)));
+  }
+
+  return *part;
+}
+
+void TreeSerializer::RemoveLastNodes(node_index parent, node_index last,
+                                     node_index first, std::uint32_t strings) {
+  Node &parentNode = m_nodes[parent];
+
+  if (last == kNone) {
+    parentNode.m_firstChild = kNone;
+  } else {
+    m_nodes[last].m_next = kNone;
+  }
+
+  parentNode.m_lastChild = last;
+  --parentNode.m_childCount;
+
+  m_nodes.resize(first);
+  m_strings.resize(strings);
+}
+
+void TreeSerializer::DiffEntry(const TreeSerializer &baseline,
+                               node_index base, const TreeSerializer &current,
+                               node_index entry, node_index patch) {
+  MemberMap members;
+  for (node_index child = baseline.GetNode(base).m_firstChild; child != kNone;
+       child = baseline.GetNode(child).m_next) {
+    const Node &node = baseline.GetNode(child);
+    members.emplace(std::string_view(baseline.GetPoolString(node.m_name),
+                                     node.m_nameLength),
+                    child);
+  }
+
+  node_index set = kNone;
+  node_index entries = kNone;
+  node_index arrays = kNone;
+  node_index removed = kNone;
+
+  for (node_index child = current.GetNode(entry).m_firstChild; child != kNone;
+       child = current.GetNode(child).m_next) {
+    const Node &node = current.GetNode(child);
+    const char *name = current.GetPoolString(node.m_name);
+    auto found = members.find(std::string_view(name, node.m_nameLength));
+
+    if (found == members.end()) {
+      CopyNode(GetDeltaPart(patch, &set, kDeltaSet, NodeType::kEntry), name,
+               node.m_nameLength, current, child);
+      continue;
+    }
+
+    const node_index other = found->second;
+    // Matched, what is left was removed
+    members.erase(found);
+
+    if (NodesEqual(baseline, other, current, child)) {
+      continue;
+    }
+
+    const NodeType type = baseline.GetNode(other).m_type;
+
+    if (type == NodeType::kEntry && node.m_type == NodeType::kEntry) {
+      Node version;
+      version.m_type = NodeType::kEntry;
+      version.m_uint = node.m_uint;
+
+      // Kept to undo the patch if only the order of the members changed
+      const bool added = entries == kNone;
+      const node_index parent = added ? patch : entries;
+      const node_index last = m_nodes[parent].m_lastChild;
+      const node_index first = static_cast<node_index>(m_nodes.size());
+      const std::uint32_t strings =
+          static_cast<std::uint32_t>(m_strings.size());
+
+      node_index nested = AppendNode(
+          GetDeltaPart(patch, &entries, kDeltaEntries, NodeType::kEntry),
+          version, name, node.m_nameLength);
+      DiffEntry(baseline, other, current, child, nested);
+
+      if (m_nodes[nested].m_childCount == 0 &&
+          node.m_uint == baseline.GetNode(other).m_uint) {
+        RemoveLastNodes(parent, last, first, strings);
+        entries = added ? kNone : entries;
+      }
+    } else if (type == NodeType::kArray && node.m_type == NodeType::kArray) {
+      DiffArray(baseline, other, current, child,
+                GetDeltaPart(patch, &arrays, kDeltaArrays, NodeType::kEntry));
+    } else {
+      CopyNode(GetDeltaPart(patch, &set, kDeltaSet, NodeType::kEntry), name,
+               node.m_nameLength, current, child);
+    }
+  }
+
+  // In the order of the baseline, so deltas are repeatable
+  for (node_index child = baseline.GetNode(base).m_firstChild; child != kNone;
+       child = baseline.GetNode(child).m_next) {
+    const Node &node = baseline.GetNode(child);
+    auto found = members.find(std::string_view(
+        baseline.GetPoolString(node.m_name), node.m_nameLength));
+
+    if (found == members.end() || found->second != child) {
+      continue;
+    }
+
+    Node text;
+    text.m_type = NodeType::kString;
+    text.m_string = AddString(baseline.GetPoolString(node.m_name),
+                              node.m_nameLength);
+    text.m_stringLength = node.m_nameLength;
+    AppendNode(GetDeltaPart(patch, &removed, kDeltaRemove, NodeType::kArray),
+               text, nullptr, 0);
+  }
+}
+
+void TreeSerializer::DiffArray(const TreeSerializer &baseline,
+                               node_index base, const TreeSerializer &current,
+                               node_index array, node_index arrays) {
+  std::vector<node_index> before;
+  for (node_index child = baseline.GetNode(base).m_firstChild; child != kNone;
+       child = baseline.GetNode(child).m_next) {
+    before.push_back(child);
+  }
+
+  std::vector<node_index> after;
+  for (node_index child = current.GetNode(array).m_firstChild; child != kNone;
+       child = current.GetNode(child).m_next) {
+    after.push_back(child);
+  }
+
+  // Only what is between the equal start and end changes
+  const size_t common = std::min(before.size(), after.size());
+  size_t start = 0;
+  while (start < common &&
+         NodesEqual(baseline, before[start], current, after[start])) {
+    ++start;
+  }
+
+  size_t end = 0;
+  while (end < common - start &&
+         NodesEqual(baseline, before[before.size() - 1 - end], current,
+                    after[after.size() - 1 - end])) {
+    ++end;
+  }
+
+  const Node &node = current.GetNode(array);
+  Node splice;
+  splice.m_type = NodeType::kEntry;
+  node_index patch = AppendNode(arrays, splice,
+                                current.GetPoolString(node.m_name),
+                                node.m_nameLength);
+
+  Node at;
+  SetNodeValue<std::uint64_t>(at, start);
+  AppendNode(patch, at, kDeltaAt, sizeof(kDeltaAt) - 1);
+
+  Node count;
+  SetNodeValue<std::uint64_t>(count, before.size() - start - end);
+  AppendNode(patch, count, kDeltaRemove, sizeof(kDeltaRemove) - 1);
+
+  Node inserted;
+  inserted.m_type = NodeType::kArray;
+  node_index insert =
+      AppendNode(patch, inserted, kDeltaInsert, sizeof(kDeltaInsert) - 1);
+  for (size_t i = start; i < after.size() - end; ++i) {
+    CopyNode(insert, nullptr, 0, current, after[i]);
+  }
+}
+
+bool TreeSerializer::ApplyEntry(const TreeSerializer &baseline,
+                                node_index base, const TreeSerializer &delta,
+                                node_index patch, node_index entry) {
+  MemberMap set;
+  MemberMap entries;
+  MemberMap arrays;
+  std::unordered_set<std::string_view> removed;
+
+  for (node_index part = delta.GetNode(patch).m_firstChild; part != kNone;
+       part = delta.GetNode(part).m_next) {
+    const Node &partNode = delta.GetNode(part);
+    const std::string_view name(delta.GetPoolString(partNode.m_name),
+                                partNode.m_nameLength);
+
+    MemberMap *members = nullptr;
+    NodeType type = NodeType::kEntry;
+
+    if (name == kDeltaSet) {
+      members = &set;
+    } else if (name == kDeltaEntries) {
+      members = &entries;
+    } else if (name == kDeltaArrays) {
+      members = &arrays;
+    } else if (name == kDeltaRemove) {
+      type = NodeType::kArray;
+    } else {
+      return false;
+    }
+
+    if (partNode.m_type != type) {
+      return false;
+    }
+
+    for (node_index child = partNode.m_firstChild; child != kNone;
+         child = delta.GetNode(child).m_next) {
+      const Node &node = delta.GetNode(child);
+
+      if (members == nullptr) {
+        if (node.m_type != NodeType::kString) {
+          return false;
+        }
+        removed.emplace(delta.GetPoolString(node.m_string),
+                        node.m_stringLength);
+      } else if (members == &set || node.m_type == NodeType::kEntry) {
+        members->emplace(
+            std::string_view(delta.GetPoolString(node.m_name),
+                             node.m_nameLength),
+            child);
+      } else {
+        return false;
+      }
+    }
+  }
+
+  // Members of the baseline keep their place
+  for (node_index child =
+           base != kNone ? baseline.GetNode(base).m_firstChild : kNone;
+       child != kNone; child = baseline.GetNode(child).m_next) {
+    const Node &node = baseline.GetNode(child);
+    const char *name = baseline.GetPoolString(node.m_name);
+    const std::string_view key(name, node.m_nameLength);
+
+    if (removed.count(key) != 0) {
+      continue;
+    }
+
+    if (auto found = set.find(key); found != set.end()) {
+      CopyNode(entry, name, node.m_nameLength, delta, found->second);
+      set.erase(found);
+    } else if (auto found = entries.find(key); found != entries.end()) {
+      Node version;
+      version.m_type = NodeType::kEntry;
+      version.m_uint = delta.GetNode(found->second).m_uint;
+
+      node_index nested = AppendNode(entry, version, name, node.m_nameLength);
+      if (!ApplyEntry(baseline,
+                      node.m_type == NodeType::kEntry ? child : kNone, delta,
+                      found->second, nested)) {
+        return false;
+      }
+      entries.erase(found);
+    } else if (auto found = arrays.find(key); found != arrays.end()) {
+      Node list;
+      list.m_type = NodeType::kArray;
+
+      node_index nested = AppendNode(entry, list, name, node.m_nameLength);
+      if (!ApplyArray(baseline,
+                      node.m_type == NodeType::kArray ? child : kNone, delta,
+                      found->second, nested)) {
+        return false;
+      }
+      arrays.erase(found);
+    } else {
+      CopyNode(entry, name, node.m_nameLength, baseline, child);
+    }
+  }
+
+  // New members, in the order of the delta
+  for (node_index child = delta.GetNode(patch).m_firstChild; child != kNone;
+       child = delta.GetNode(child).m_next) {
+    for (node_index member = delta.GetNode(child).m_firstChild;
+         member != kNone; member = delta.GetNode(member).m_next) {
+      const Node &node = delta.GetNode(member);
+
+      // Names of removed members
+      if (node.m_name == kNone) {
+        continue;
+      }
+
+      const char *name = delta.GetPoolString(node.m_name);
+      const std::string_view key(name, node.m_nameLength);
+
+      if (auto found = set.find(key);
+          found != set.end() && found->second == member) {
+        CopyNode(entry, name, node.m_nameLength, delta, member);
+      } else if (auto found = entries.find(key);
+                 found != entries.end() && found->second == member) {
+        Node version;
+        version.m_type = NodeType::kEntry;
+        version.m_uint = node.m_uint;
+
+        node_index nested = AppendNode(entry, version, name, node.m_nameLength);
+        if (!ApplyEntry(baseline, kNone, delta, member, nested)) {
+          return false;
+        }
+      } else if (auto found = arrays.find(key);
+                 found != arrays.end() && found->second == member) {
+        Node list;
+        list.m_type = NodeType::kArray;
+
+        node_index nested = AppendNode(entry, list, name, node.m_nameLength);
+        if (!ApplyArray(baseline, kNone, delta, member, nested)) {
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+bool TreeSerializer::ApplyArray(const TreeSerializer &baseline,
+                                node_index base, const TreeSerializer &delta,
+                                node_index patch, node_index array) {
+  std::uint64_t at = 0;
+  std::uint64_t count = 0;
+  node_index insert = kNone;
+
+  for (node_index part = delta.GetNode(patch).m_firstChild; part != kNone;
+       part = delta.GetNode(part).m_next) {
+    const Node &node = delta.GetNode(part);
+    const std::string_view name(delta.GetPoolString(node.m_name),
+                                node.m_nameLength);
+
+    if (name == kDeltaAt) {
+      if (!delta.GetNodeValue<std::uint64_t>(node, &at)) {
+        return false;
+      }
+    } else if (name == kDeltaRemove) {
+      if (!delta.GetNodeValue<std::uint64_t>(node, &count)) {
+        return false;
+      }
+    } else if (name == kDeltaInsert && node.m_type == NodeType::kArray) {
+      insert = part;
+    } else {
+      return false;
+    }
+  }
+
+  const std::uint64_t size =
+      base != kNone ? baseline.GetNode(base).m_childCount : 0;
+  if (at > size || count > size - at) {
+    return false;
+  }
+
+  std::uint64_t i = 0;
+  node_index child =
+      base != kNone ? baseline.GetNode(base).m_firstChild : kNone;
+
+  for (; i < at; ++i, child = baseline.GetNode(child).m_next) {
+    CopyNode(array, nullptr, 0, baseline, child);
+  }
+
+  for (; i < at + count; ++i) {
+    child = baseline.GetNode(child).m_next;
+  }
+
+  for (node_index element =
+           insert != kNone ? delta.GetNode(insert).m_firstChild : kNone;
+       element != kNone; element = delta.GetNode(element).m_next) {
+    CopyNode(array, nullptr, 0, delta, element);
+  }
+
+  for (; child != kNone; child = baseline.GetNode(child).m_next) {
+    CopyNode(array, nullptr, 0, baseline, child);
+  }
+
+  return true;
+}
+
+} // namespace Serializer
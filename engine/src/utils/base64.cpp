@@ -0,0 +1,427 @@
+#include "utils/base64.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// SIMD is used when the JSON parser is built with it (RAPIDJSON_SIMD in CMake)
+// (SSE4.2 CPUs have SSSE3, SSE2 alone is not faster than the tables)
+#if defined(KCH_JSON_SIMD_SSE42) && (defined(__SSSE3__) || defined(_MSC_VER))
+#define KCH_BASE64_SSSE3 1
+#include <tmmintrin.h>
+#elif defined(KCH_JSON_SIMD_NEON) && (defined(__ARM_NEON) || defined(_M_ARM64))
+#define KCH_BASE64_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace Base64 {
+
+namespace {
+/* Characters of each 6 bits value */
+constexpr char kAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* Padding character */
+constexpr char kPad = '=';
+
+/* Bit set in a decoded value by an invalid character */
+constexpr std::uint32_t kInvalid = 1u << 24;
+
+/*
+  Lookup tables, so every 3 bytes are encoded with 2 lookups and every 4
+  characters decoded with 4 lookups and no branches
+*/
+struct Tables {
+  /* The 2 characters of each 12 bits value */
+  char m_pairs[4096 * 2] = {};
+  /* 6 bits value of each character, already shifted to its place in a group
+   * of 4 characters. kInvalid if it is not in the alphabet */
+  std::uint32_t m_decode[4][256] = {};
+};
+
+constexpr Tables MakeTables() {
+  Tables tables;
+
+  for (std::size_t i = 0; i < 4096; ++i) {
+    tables.m_pairs[i * 2] = kAlphabet[i >> 6];
+    tables.m_pairs[i * 2 + 1] = kAlphabet[i & 0x3F];
+  }
+
+  for (std::size_t slot = 0; slot < 4; ++slot) {
+    for (std::size_t c = 0; c < 256; ++c) {
+      tables.m_decode[slot][c] = kInvalid;
+    }
+    for (std::uint32_t value = 0; value < 64; ++value) {
+      const unsigned char c = static_cast<unsigned char>(kAlphabet[value]);
+      tables.m_decode[slot][c] = value << (6 * (3 - slot));
+    }
+  }
+
+  return tables;
+}
+
+constexpr Tables kTables = MakeTables();
+
+/* Decode a group of 4 characters into its 24 bits, kInvalid bit if it fails */
+inline std::uint32_t DecodeGroup(const unsigned char *text) {
+  return kTables.m_decode[0][text[0]] | kTables.m_decode[1][text[1]] |
+         kTables.m_decode[2][text[2]] | kTables.m_decode[3][text[3]];
+}
+
+#if defined(KCH_BASE64_SSSE3) || defined(KCH_BASE64_NEON)
+/* Value to add to the 6 bits values of each range to get its characters */
+constexpr int kUpperOffset = 'A';
+constexpr int kLowerOffset = 'a' - 26;
+constexpr int kDigitOffset = '0' - 52;
+constexpr int kPlusOffset = '+' - 62;
+constexpr int kSlashOffset = '/' - 63;
+#endif
+
+#if defined(KCH_BASE64_SSSE3)
+/*
+  Bytes encoded and characters decoded at once. Encoding loads 4 bytes more
+  than it uses
+*/
+constexpr std::size_t kEncodeBlock = 12;
+constexpr std::size_t kEncodeLoad = 16;
+constexpr std::size_t kDecodeBlock = 16;
+
+/* Characters of 16 values of 6 bits, one per byte */
+inline __m128i ToCharacters(__m128i values) {
+  // Offset of each range, the digits take 10 slots
+  const __m128i offsets = _mm_setr_epi8(
+      kUpperOffset, kLowerOffset, kDigitOffset, kDigitOffset, kDigitOffset,
+      kDigitOffset, kDigitOffset, kDigitOffset, kDigitOffset, kDigitOffset,
+      kDigitOffset, kDigitOffset, kPlusOffset, kSlashOffset, 0, 0);
+
+  // 0 for the upper case letters, 1 for the lower case, 2 to 13 for the rest
+  __m128i slots = _mm_subs_epu8(values, _mm_set1_epi8(51));
+  slots = _mm_sub_epi8(slots, _mm_cmpgt_epi8(values, _mm_set1_epi8(25)));
+
+  return _mm_add_epi8(values, _mm_shuffle_epi8(offsets, slots));
+}
+
+/* Encode 12 bytes into 16 characters, 16 bytes are loaded */
+inline void EncodeBlock(const unsigned char *bytes, char *text) {
+  __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes));
+
+  // Every 3 bytes to 4 as b1 b0 b2 b1, so each value is in a 16 bits half
+  in = _mm_shuffle_epi8(
+      in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+
+  // Move the values to their bytes, the first and third with a high multiply
+  const __m128i first = _mm_mulhi_epu16(
+      _mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)),
+      _mm_set1_epi32(0x04000040));
+  const __m128i second = _mm_mullo_epi16(
+      _mm_and_si128(in, _mm_set1_epi32(0x003F03F0)),
+      _mm_set1_epi32(0x01000010));
+
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(text),
+                   ToCharacters(_mm_or_si128(first, second)));
+}
+
+/*
+  Decode 16 characters into 12 bytes. The result is not 0 where a character
+  is not in the alphabet
+*/
+inline __m128i DecodeBlock(const unsigned char *text, unsigned char *bytes) {
+  // Bit of each kind of character (by the high nibble) and the kinds each low
+  // nibble can be, a character is valid if they share no bit
+  const __m128i lowKinds =
+      _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                    0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m128i highKinds =
+      _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10,
+                    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  // Offset by the high nibble, '/' has its own in the slot before '+'
+  const __m128i offsets = _mm_setr_epi8(
+      0, -kSlashOffset, -kPlusOffset, -kDigitOffset, -kUpperOffset,
+      -kUpperOffset, -kLowerOffset, -kLowerOffset, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+
+  const __m128i chars =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(text));
+  const __m128i high = _mm_and_si128(_mm_srli_epi32(chars, 4), nibble);
+  const __m128i low = _mm_and_si128(chars, nibble);
+
+  // Characters above 0x7F have a high nibble of a kind never valid
+  const __m128i invalid = _mm_and_si128(_mm_shuffle_epi8(lowKinds, low),
+                                        _mm_shuffle_epi8(highKinds, high));
+
+  const __m128i slash = _mm_cmpeq_epi8(chars, _mm_set1_epi8('/'));
+  const __m128i values = _mm_add_epi8(
+      chars, _mm_shuffle_epi8(offsets, _mm_add_epi8(high, slash)));
+
+  // Join the values in pairs of 12 bits, then in groups of 24 bits and put
+  // their 3 bytes together, highest first
+  const __m128i pairs =
+      _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+  const __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+  const __m128i out = _mm_shuffle_epi8(
+      groups,
+      _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+  _mm_storel_epi64(reinterpret_cast<__m128i *>(bytes), out);
+  const int last = _mm_cvtsi128_si32(_mm_srli_si128(out, 8));
+  std::memcpy(bytes + 8, &last, sizeof(last));
+  return invalid;
+}
+
+/* Masks of invalid characters of both */
+inline __m128i Either(__m128i a, __m128i b) { return _mm_or_si128(a, b); }
+
+/* If the masks of invalid characters have none */
+inline bool IsValid(__m128i invalid) {
+  return _mm_movemask_epi8(
+             _mm_cmpeq_epi8(invalid, _mm_setzero_si128())) == 0xFFFF;
+}
+#elif defined(KCH_BASE64_NEON)
+/* Bytes encoded and characters decoded at once */
+constexpr std::size_t kEncodeBlock = 48;
+constexpr std::size_t kEncodeLoad = 48;
+constexpr std::size_t kDecodeBlock = 64;
+
+/* offset where values are greater than limit, 0 elsewhere */
+inline uint8x16_t OffsetAbove(uint8x16_t values, int limit, int offset) {
+  return vandq_u8(
+      vcgtq_u8(values, vdupq_n_u8(static_cast<std::uint8_t>(limit))),
+      vdupq_n_u8(static_cast<std::uint8_t>(offset)));
+}
+
+/* Characters of 16 values of 6 bits, one per byte */
+inline uint8x16_t ToCharacters(uint8x16_t values) {
+  // Every range adds what is missing from the offset of the one before
+  uint8x16_t offset = vdupq_n_u8(static_cast<std::uint8_t>(kUpperOffset));
+  offset =
+      vaddq_u8(offset, OffsetAbove(values, 25, kLowerOffset - kUpperOffset));
+  offset =
+      vaddq_u8(offset, OffsetAbove(values, 51, kDigitOffset - kLowerOffset));
+  offset =
+      vaddq_u8(offset, OffsetAbove(values, 61, kPlusOffset - kDigitOffset));
+  offset =
+      vaddq_u8(offset, OffsetAbove(values, 62, kSlashOffset - kPlusOffset));
+  return vaddq_u8(values, offset);
+}
+
+/* Encode 48 bytes into 64 characters */
+inline void EncodeBlock(const unsigned char *bytes, char *text) {
+  const uint8x16x3_t in = vld3q_u8(bytes);
+  const uint8x16_t mask = vdupq_n_u8(0x3F);
+
+  uint8x16x4_t out;
+  out.val[0] = vshrq_n_u8(in.val[0], 2);
+  out.val[1] = vandq_u8(
+      vorrq_u8(vshlq_n_u8(in.val[0], 4), vshrq_n_u8(in.val[1], 4)), mask);
+  out.val[2] = vandq_u8(
+      vorrq_u8(vshlq_n_u8(in.val[1], 2), vshrq_n_u8(in.val[2], 6)), mask);
+  out.val[3] = vandq_u8(in.val[2], mask);
+
+  for (uint8x16_t &values : out.val) {
+    values = ToCharacters(values);
+  }
+  vst4q_u8(reinterpret_cast<std::uint8_t *>(text), out);
+}
+
+/* Mask of the characters between low and high */
+inline uint8x16_t InRange(uint8x16_t chars, char low, char high) {
+  return vandq_u8(vcgeq_u8(chars, vdupq_n_u8(low)),
+                  vcleq_u8(chars, vdupq_n_u8(high)));
+}
+
+/* offset where mask is set, 0 elsewhere */
+inline uint8x16_t OffsetWhere(uint8x16_t mask, int offset) {
+  return vandq_u8(mask, vdupq_n_u8(static_cast<std::uint8_t>(offset)));
+}
+
+/* Values of 16 characters, valid is cleared where one is not in the alphabet */
+inline uint8x16_t ToValues(uint8x16_t chars, uint8x16_t *valid) {
+  const uint8x16_t upper = InRange(chars, 'A', 'Z');
+  const uint8x16_t lower = InRange(chars, 'a', 'z');
+  const uint8x16_t digit = InRange(chars, '0', '9');
+  const uint8x16_t plus = vceqq_u8(chars, vdupq_n_u8('+'));
+  const uint8x16_t slash = vceqq_u8(chars, vdupq_n_u8('/'));
+
+  *valid = vandq_u8(
+      *valid, vorrq_u8(vorrq_u8(vorrq_u8(upper, lower), vorrq_u8(digit, plus)),
+                       slash));
+
+  // Only one range matches each character, so only its offset is there
+  uint8x16_t offset = OffsetWhere(upper, -kUpperOffset);
+  offset = vorrq_u8(offset, OffsetWhere(lower, -kLowerOffset));
+  offset = vorrq_u8(offset, OffsetWhere(digit, -kDigitOffset));
+  offset = vorrq_u8(offset, OffsetWhere(plus, -kPlusOffset));
+  offset = vorrq_u8(offset, OffsetWhere(slash, -kSlashOffset));
+  return vaddq_u8(chars, offset);
+}
+
+/*
+  Decode 64 characters into 48 bytes. The result is not 0 where a character
+  is not in the alphabet
+*/
+inline uint8x16_t DecodeBlock(const unsigned char *text,
+                              unsigned char *bytes) {
+  uint8x16x4_t in = vld4q_u8(text);
+  uint8x16_t valid = vdupq_n_u8(0xFF);
+
+  for (uint8x16_t &chars : in.val) {
+    chars = ToValues(chars, &valid);
+  }
+
+  uint8x16x3_t out;
+  out.val[0] = vorrq_u8(vshlq_n_u8(in.val[0], 2), vshrq_n_u8(in.val[1], 4));
+  out.val[1] = vorrq_u8(vshlq_n_u8(in.val[1], 4), vshrq_n_u8(in.val[2], 2));
+  out.val[2] = vorrq_u8(vshlq_n_u8(in.val[2], 6), in.val[3]);
+  vst3q_u8(bytes, out);
+  return vmvnq_u8(valid);
+}
+
+/* Masks of invalid characters of both */
+inline uint8x16_t Either(uint8x16_t a, uint8x16_t b) { return vorrq_u8(a, b); }
+
+/* If the masks of invalid characters have none */
+inline bool IsValid(uint8x16_t invalid) {
+  // Biggest lane, not 0 if any character is invalid
+  uint8x8_t biggest = vmax_u8(vget_low_u8(invalid), vget_high_u8(invalid));
+  biggest = vpmax_u8(biggest, biggest);
+  biggest = vpmax_u8(biggest, biggest);
+  biggest = vpmax_u8(biggest, biggest);
+  return vget_lane_u8(biggest, 0) == 0;
+}
+#endif
+} // namespace
+
+void Encode(const void *data, std::size_t size, char *text) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  const unsigned char *end = bytes + size - size % 3;
+
+#if defined(KCH_BASE64_SSSE3) || defined(KCH_BASE64_NEON)
+  for (; static_cast<std::size_t>(end - bytes) >= kEncodeLoad;
+       bytes += kEncodeBlock, text += kEncodeBlock / 3 * 4) {
+    EncodeBlock(bytes, text);
+  }
+#endif
+
+  for (; bytes != end; bytes += 3, text += 4) {
+    const std::uint32_t group = (static_cast<std::uint32_t>(bytes[0]) << 16) |
+                                (static_cast<std::uint32_t>(bytes[1]) << 8) |
+                                bytes[2];
+    const char *high = kTables.m_pairs + (group >> 12) * 2;
+    const char *low = kTables.m_pairs + (group & 0xFFF) * 2;
+
+    text[0] = high[0];
+    text[1] = high[1];
+    text[2] = low[0];
+    text[3] = low[1];
+  }
+
+  // Last 1 or 2 bytes are padded
+  switch (size % 3) {
+  case 1: {
+    const std::uint32_t group = static_cast<std::uint32_t>(bytes[0]) << 16;
+    text[0] = kAlphabet[group >> 18];
+    text[1] = kAlphabet[(group >> 12) & 0x3F];
+    text[2] = kPad;
+    text[3] = kPad;
+    break;
+  }
+  case 2: {
+    const std::uint32_t group = (static_cast<std::uint32_t>(bytes[0]) << 16) |
+                                (static_cast<std::uint32_t>(bytes[1]) << 8);
+    text[0] = kAlphabet[group >> 18];
+    text[1] = kAlphabet[(group >> 12) & 0x3F];
+    text[2] = kAlphabet[(group >> 6) & 0x3F];
+    text[3] = kPad;
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+bool GetDecodedSize(const char *text, std::size_t length, std::size_t *size) {
+  if (length % 4 != 0) {
+    return false;
+  }
+
+  std::size_t padding = 0;
+  if (length != 0 && text[length - 1] == kPad) {
+    padding = text[length - 2] == kPad ? 2 : 1;
+  }
+
+  *size = length / 4 * 3 - padding;
+  return true;
+}
+
+bool Decode(const char *text, std::size_t length, void *data) {
+  if (length % 4 != 0) {
+    return false;
+  }
+  if (length == 0) {
+    return true;
+  }
+
+  const unsigned char *chars = reinterpret_cast<const unsigned char *>(text);
+  unsigned char *bytes = static_cast<unsigned char *>(data);
+
+  // The last group might be padded
+  const unsigned char *end = chars + length - 4;
+
+#if defined(KCH_BASE64_SSSE3) || defined(KCH_BASE64_NEON)
+  // Checked once at the end, like the groups below
+#if defined(KCH_BASE64_SSSE3)
+  __m128i blocksInvalid = _mm_setzero_si128();
+#else
+  uint8x16_t blocksInvalid = vdupq_n_u8(0);
+#endif
+
+  for (; static_cast<std::size_t>(end - chars) >= kDecodeBlock;
+       chars += kDecodeBlock, bytes += kDecodeBlock / 4 * 3) {
+    blocksInvalid = Either(blocksInvalid, DecodeBlock(chars, bytes));
+  }
+
+  if (!IsValid(blocksInvalid)) {
+    return false;
+  }
+#endif
+
+  std::uint32_t invalid = 0;
+  for (; chars != end; chars += 4, bytes += 3) {
+    const std::uint32_t group = DecodeGroup(chars);
+    invalid |= group;
+
+    bytes[0] = static_cast<unsigned char>(group >> 16);
+    bytes[1] = static_cast<unsigned char>(group >> 8);
+    bytes[2] = static_cast<unsigned char>(group);
+  }
+
+  if ((invalid & kInvalid) != 0) {
+    return false;
+  }
+
+  unsigned char last[4] = {chars[0], chars[1], chars[2], chars[3]};
+  std::size_t count = 3;
+
+  if (last[3] == kPad) {
+    last[3] = 'A';
+    count = 2;
+
+    if (last[2] == kPad) {
+      last[2] = 'A';
+      count = 1;
+    }
+  }
+
+  const std::uint32_t group = DecodeGroup(last);
+  if ((group & kInvalid) != 0) {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < count; ++i) {
+    bytes[i] = static_cast<unsigned char>(group >> (16 - 8 * i));
+  }
+
+  return true;
+}
+
+} // namespace Base64
@@ -0,0 +1,193 @@
+#include "utils/lz4.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace Lz4 {
+
+namespace {
+/* Shortest match */
+constexpr std::size_t kMinMatch = 4;
+
+/* A match can't start in the last bytes of a block */
+constexpr std::size_t kMatchStartLimit = 12;
+
+/* The last bytes of a block are always literals */
+constexpr std::size_t kLastLiterals = 5;
+
+/* Farthest a match can be */
+constexpr std::size_t kMaxOffset = 65535;
+
+/* Bits of the hash of 4 bytes, the table has an entry for each */
+constexpr int kHashBits = 16;
+
+/* Length that is continued in the following bytes */
+constexpr std::size_t kLengthMask = 15;
+
+/* 4 bytes as an integer, in any byte order */
+inline std::uint32_t Read32(const unsigned char *p) {
+  std::uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+/* Slot of 4 bytes in the table */
+inline std::uint32_t Hash(std::uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - kHashBits);
+}
+
+/* Write the continuation of a length that didn't fit in the token */
+inline unsigned char *WriteLength(unsigned char *out, std::size_t length) {
+  for (; length >= 255; length -= 255) {
+    *out++ = 255;
+  }
+  *out++ = static_cast<unsigned char>(length);
+  return out;
+}
+
+/* Read the continuation of a length, false if the block ends first */
+inline bool ReadLength(const unsigned char *&in, const unsigned char *end,
+                       std::size_t *length) {
+  unsigned char byte;
+  do {
+    if (in == end) {
+      return false;
+    }
+    byte = *in++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/* Write the literals from anchor and the token of a sequence */
+unsigned char *WriteLiterals(unsigned char *out, const unsigned char *anchor,
+                             std::size_t literals, std::size_t match) {
+  unsigned char *token = out++;
+  *token = static_cast<unsigned char>(
+      (literals < kLengthMask ? literals : kLengthMask) << 4);
+  *token |= static_cast<unsigned char>(match < kLengthMask ? match
+                                                           : kLengthMask);
+
+  if (literals >= kLengthMask) {
+    out = WriteLength(out, literals - kLengthMask);
+  }
+
+  std::memcpy(out, anchor, literals);
+  return out + literals;
+}
+} // namespace
+
+std::size_t Compress(const void *data, std::size_t size, void *block) {
+  const unsigned char *in = static_cast<const unsigned char *>(data);
+  unsigned char *out = static_cast<unsigned char *>(block);
+  const unsigned char *anchor = in;
+
+  if (size > kMatchStartLimit) {
+    // Last position each hash was seen at, from the start of data
+    std::unique_ptr<std::uint32_t[]> table(
+        new std::uint32_t[std::size_t{1} << kHashBits]());
+
+    const unsigned char *ip = in;
+    const unsigned char *startLimit = in + size - kMatchStartLimit;
+    const unsigned char *matchLimit = in + size - kLastLiterals;
+
+    while (ip < startLimit) {
+      const std::uint32_t sequence = Read32(ip);
+      const std::uint32_t slot = Hash(sequence);
+      const unsigned char *ref = in + table[slot];
+      table[slot] = static_cast<std::uint32_t>(ip - in);
+
+      if (ref >= ip || static_cast<std::size_t>(ip - ref) > kMaxOffset ||
+          Read32(ref) != sequence) {
+        ++ip;
+        continue;
+      }
+
+      std::size_t length = kMinMatch;
+      while (ip + length < matchLimit && ref[length] == ip[length]) {
+        ++length;
+      }
+
+      const std::size_t offset = static_cast<std::size_t>(ip - ref);
+      out = WriteLiterals(out, anchor, static_cast<std::size_t>(ip - anchor),
+                          length - kMinMatch);
+      *out++ = static_cast<unsigned char>(offset);
+      *out++ = static_cast<unsigned char>(offset >> 8);
+
+      if (length - kMinMatch >= kLengthMask) {
+        out = WriteLength(out, length - kMinMatch - kLengthMask);
+      }
+
+      ip += length;
+      anchor = ip;
+    }
+  }
+
+  // The last sequence only has literals
+  out = WriteLiterals(out, anchor, static_cast<std::size_t>(in + size - anchor),
+                      0);
+  return static_cast<std::size_t>(out - static_cast<unsigned char *>(block));
+}
+
+bool Decompress(const void *block, std::size_t block_size, void *data,
+                std::size_t size) {
+  const unsigned char *in = static_cast<const unsigned char *>(block);
+  const unsigned char *inEnd = in + block_size;
+  unsigned char *start = static_cast<unsigned char *>(data);
+  unsigned char *out = start;
+  unsigned char *outEnd = out + size;
+
+  while (in != inEnd) {
+    const unsigned char token = *in++;
+
+    std::size_t literals = token >> 4;
+    if (literals == kLengthMask && !ReadLength(in, inEnd, &literals)) {
+      return false;
+    }
+
+    if (literals > static_cast<std::size_t>(inEnd - in) ||
+        literals > static_cast<std::size_t>(outEnd - out)) {
+      return false;
+    }
+
+    std::memcpy(out, in, literals);
+    in += literals;
+    out += literals;
+
+    // The last sequence ends after its literals
+    if (in == inEnd) {
+      return out == outEnd;
+    }
+
+    if (inEnd - in < 2) {
+      return false;
+    }
+
+    const std::size_t offset = in[0] | (static_cast<std::size_t>(in[1]) << 8);
+    in += 2;
+
+    std::size_t length = token & kLengthMask;
+    if (length == kLengthMask && !ReadLength(in, inEnd, &length)) {
+      return false;
+    }
+    length += kMinMatch;
+
+    if (offset == 0 || offset > static_cast<std::size_t>(out - start) ||
+        length > static_cast<std::size_t>(outEnd - out)) {
+      return false;
+    }
+
+    // Byte by byte, a match can overlap what it writes
+    const unsigned char *match = out - offset;
+    for (std::size_t i = 0; i < length; ++i) {
+      out[i] = match[i];
+    }
+    out += length;
+  }
+
+  return false;
+}
+
+} // namespace Lz4
@@ -0,0 +1,242 @@
+#pragma once
+#ifndef RECURSIVE_STRUCT_HPP
+#define RECURSIVE_STRUCT_HPP 1
+
+#include "serialization/serializer.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+  Serializable test data: a few primitives, a vector and a pointer to another
+  one, serialized by hand. Shared by the serialization tests and benchmarks
+*/
+class RecursiveStruct : public Serializer::ISerializableImpl<RecursiveStruct> {
+public:
+  std::string m_someText;
+  int m_anInt;
+  double m_aDouble;
+  bool m_aBool;
+  std::vector<uint64_t> m_someUints;
+
+  std::unique_ptr<RecursiveStruct> m_aPtr;
+
+  RecursiveStruct() = default;
+
+  RecursiveStruct(RecursiveStruct *ptr) {
+    m_aPtr = std::unique_ptr<RecursiveStruct>(ptr);
+  }
+
+  RecursiveStruct(RecursiveStruct &&) = default;
+  RecursiveStruct &operator=(RecursiveStruct &&) = default;
+
+  virtual ~RecursiveStruct() = default;
+
+  void SetRandom(const char *text) {
+    m_someText.clear();
+    m_someText.assign(text);
+
+    auto intGenerator = std::bind(kIntDistribution, kGenerator);
+    m_anInt = intGenerator();
+    m_aBool = intGenerator() & 1;
+
+    int size = intGenerator() % kMaxVectorSize;
+    m_someUints.clear();
+    m_someUints.reserve(size);
+
+    auto doubleGenerator = std::bind(kDoubleDistribution, kGenerator);
+    m_aDouble = doubleGenerator();
+
+    auto unitGenerator = std::bind(kUintDistribution, kGenerator);
+    for (int i = 0; i < size; i++) {
+      m_someUints.push_back(unitGenerator());
+    }
+  }
+
+  bool operator==(const RecursiveStruct &other) {
+    if (m_someText != other.m_someText) {
+      return false;
+    }
+    if (m_anInt != other.m_anInt) {
+      return false;
+    }
+    if (m_aDouble != other.m_aDouble) {
+      return false;
+    }
+    if (m_aBool != other.m_aBool) {
+      return false;
+    }
+    if (m_someUints != other.m_someUints) {
+      return false;
+    }
+    if (m_aPtr && other.m_aPtr) {
+      return *m_aPtr == *other.m_aPtr;
+    }
+    return !m_aPtr && !other.m_aPtr;
+  }
+
+  bool operator!=(const RecursiveStruct &other) { return !(*this == other); }
+
+  bool Serialize(Serializer::ISerializer *serializer, const char *name,
+                 Serializer::s_size name_length) {
+    if (!serializer->SetEntry(name, name_length, kSerializerVersion)) {
+      return false;
+    }
+
+    if (!serializer->SetString(SET_NAME(m_someText), m_someText.c_str(),
+                               m_someText.length())) {
+      return false;
+    }
+
+    if (!serializer->SetInt(SET_NAME(m_anInt), m_anInt)) {
+      return false;
+    }
+
+    if (!serializer->SetDouble(SET_NAME(m_aDouble), m_aDouble)) {
+      return false;
+    }
+
+    if (!serializer->SetBool(SET_NAME(m_aBool), m_aBool)) {
+      return false;
+    }
+
+    if (!serializer->SetArray(SET_NAME(m_someUints))) {
+      return false;
+    }
+
+    for (auto anUint : m_someUints) {
+      if (!serializer->SetUint64(nullptr, 0, anUint)) {
+        return false;
+      }
+    }
+
+    if (!serializer->CloseArray()) {
+      return false;
+    }
+
+    if (m_aPtr) {
+      if (!m_aPtr->Serialize(serializer, SET_NAME(m_aPtr))) {
+        return false;
+      }
+
+    } else {
+      if (!serializer->SetNull(SET_NAME(m_aPtr))) {
+        return false;
+      }
+    }
+
+    if (!serializer->CloseEntry()) {
+      return false;
+    }
+
+    return true;
+  }
+
+  /*
+    Fill object, which is reused. Its m_aPtr is kept when the text has one too,
+    so loading again into the same objects doesn't allocate them again
+  */
+  static bool DeserializeInto(const Serializer::ISerializer *serializer,
+                              const char *name, RecursiveStruct *object) {
+
+    Serializer::s_size version;
+
+    if (!serializer->OpenEntry(name, &version)) {
+      return false;
+    }
+
+    if (version != kSerializerVersion) {
+      return false;
+    }
+
+    size_t size;
+
+    if (!serializer->GetStringLength(GET_NAME(m_someText), &size)) {
+      return false;
+    }
+
+    std::unique_ptr<char[]> someText(new char[size]);
+
+    if (!serializer->GetString(GET_NAME(m_someText), someText.get())) {
+      return false;
+    }
+
+    object->m_someText.clear();
+
+    object->m_someText.assign(someText.get());
+
+    if (!serializer->GetInt(GET_NAME(m_anInt), &(object->m_anInt))) {
+      return false;
+    }
+
+    if (!serializer->GetDouble(GET_NAME(m_aDouble), &(object->m_aDouble))) {
+      return false;
+    }
+
+    if (!serializer->GetBool(GET_NAME(m_aBool), &(object->m_aBool))) {
+      return false;
+    }
+
+    // Readers that can't count ahead (i.e. JsonPullSerializer) are walked
+    Serializer::s_size m_someUints_size = 0;
+    const bool counted = serializer->GetArrayCapacity(GET_NAME(m_someUints),
+                                                      &m_someUints_size);
+
+    if (!serializer->OpenArray(GET_NAME(m_someUints))) {
+      return false;
+    }
+
+    object->m_someUints.clear();
+    object->m_someUints.reserve(static_cast<size_t>(m_someUints_size));
+
+    {
+      uint64_t tmp;
+
+      for (Serializer::s_size i = 0;
+           counted ? i < m_someUints_size : serializer->CanMoveArray(); i++) {
+        if (!serializer->GetUint64(nullptr, &tmp)) {
+          return false;
+        }
+        object->m_someUints.push_back(tmp);
+        serializer->MoveArray();
+      }
+    }
+
+    if (!serializer->CloseArray()) {
+      return false;
+    }
+
+    if (serializer->IsNull(GET_NAME(m_aPtr))) {
+      object->m_aPtr.reset();
+    } else {
+      if (!object->m_aPtr) {
+        object->m_aPtr = std::make_unique<RecursiveStruct>();
+      }
+
+      if (!DeserializeInto(serializer, GET_NAME(m_aPtr),
+                           object->m_aPtr.get())) {
+        return false;
+      }
+    }
+
+    if (!serializer->CloseEntry()) {
+      return false;
+    }
+
+    return true;
+  }
+
+private:
+  inline static std::default_random_engine kGenerator{42};
+  inline static std::uniform_int_distribution<int> kIntDistribution;
+  inline static std::uniform_int_distribution<uint64_t> kUintDistribution;
+  inline static std::uniform_real_distribution<double> kDoubleDistribution;
+  static constexpr int kMaxVectorSize = 512;
+  static constexpr Serializer::s_size kSerializerVersion = 0;
+};
+
+#endif // !RECURSIVE_STRUCT_HPP
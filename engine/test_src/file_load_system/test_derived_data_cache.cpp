@@ -0,0 +1,213 @@
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "file_load_system/derived_data_cache.hpp"
+#include "file_load_system/file_load_system.hpp"
+#include "file_load_system/smart_file.hpp"
+
+namespace {
+/* Scratch directory of a test, empty at the start */
+FileLoadSystem::path MakeScratch(const char *name) {
+  const FileLoadSystem::path p =
+      std::filesystem::temp_directory_path() / "kch_derived_data_cache" / name;
+  FileLoadSystem::error_status error;
+  FileLoadSystem::RemoveDirectory(p, error);
+  return p;
+}
+
+/* Files of the directory with an extension */
+std::vector<FileLoadSystem::path> FindFiles(const FileLoadSystem::path &dir,
+                                            const char *extension) {
+  std::vector<FileLoadSystem::path> files;
+  for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+    if (entry.path().extension() == extension) {
+      files.push_back(entry.path());
+    }
+  }
+  return files;
+}
+
+/* Key of a numbered source */
+FileLoadSystem::DerivedDataKey MakeKey(int source) {
+  const std::string text = "source " + std::to_string(source);
+  return FileLoadSystem::MakeDerivedDataKey(text.c_str(), text.size(),
+                                            "test_transform", 1);
+}
+
+/* Size of the header of a Derived Data File */
+constexpr size_t kHeaderSize = 20;
+} // namespace
+
+TEST(DerivedDataCacheTest, putAndGet) {
+  const FileLoadSystem::path dir = MakeScratch("put_and_get");
+  FileLoadSystem::DerivedDataCache cache;
+  EXPECT_FALSE(cache.Open(dir));
+
+  std::vector<char> result;
+  EXPECT_FALSE(cache.Get(MakeKey(1), result));
+
+  const std::string data = "derived output";
+  EXPECT_TRUE(cache.Put(MakeKey(1), data.c_str(), data.size()));
+  EXPECT_TRUE(cache.Get(MakeKey(1), result));
+  EXPECT_EQ(std::string(result.begin(), result.end()), data);
+  EXPECT_FALSE(cache.Get(MakeKey(2), result));
+
+  // The insert was renamed into place, nothing is left behind
+  EXPECT_EQ(FindFiles(dir, ".ddc").size(), 1u);
+  EXPECT_TRUE(FindFiles(dir, ".tmp").empty());
+
+  const FileLoadSystem::DerivedDataStats &stats = cache.GetStats();
+  EXPECT_EQ(stats.m_hits, 1u);
+  EXPECT_EQ(stats.m_misses, 2u);
+  EXPECT_EQ(stats.m_inserts, 1u);
+  EXPECT_EQ(stats.m_size, kHeaderSize + data.size());
+  EXPECT_DOUBLE_EQ(stats.HitRate(), 1.0 / 3.0);
+
+  const std::string report = cache.GetReport();
+  EXPECT_NE(report.find("1 hits, 2 misses"), std::string::npos) << report;
+  EXPECT_NE(report.find("1 inserts"), std::string::npos) << report;
+
+  // Another run finds it
+  FileLoadSystem::DerivedDataCache other;
+  EXPECT_FALSE(other.Open(dir));
+  EXPECT_EQ(other.GetStats().m_size, stats.m_size);
+  EXPECT_TRUE(other.Get(MakeKey(1), result));
+  EXPECT_EQ(std::string(result.begin(), result.end()), data);
+
+  EXPECT_FALSE(cache.Purge());
+  EXPECT_TRUE(FindFiles(dir, ".ddc").empty());
+}
+
+TEST(DerivedDataCacheTest, getOrBuild) {
+  const FileLoadSystem::path dir = MakeScratch("get_or_build");
+  FileLoadSystem::DerivedDataCache cache;
+  EXPECT_FALSE(cache.Open(dir));
+
+  int builds = 0;
+  auto build = [&builds](std::vector<char> &output) {
+    ++builds;
+    output.assign({'b', 'u', 'i', 'l', 't'});
+    return true;
+  };
+
+  std::vector<char> result;
+  EXPECT_TRUE(cache.GetOrBuild(MakeKey(1), result, build));
+  EXPECT_TRUE(cache.GetOrBuild(MakeKey(1), result, build));
+  EXPECT_EQ(builds, 1);
+  EXPECT_EQ(std::string(result.begin(), result.end()), "built");
+
+  // A failed build is not cached
+  EXPECT_FALSE(cache.GetOrBuild(MakeKey(2), result,
+                                [](std::vector<char> &) { return false; }));
+  EXPECT_FALSE(cache.Get(MakeKey(2), result));
+
+  EXPECT_FALSE(cache.Purge());
+}
+
+TEST(DerivedDataCacheTest, evictLeastRecentlyUsed) {
+  constexpr size_t kOutputSize = 100;
+  const FileLoadSystem::path dir = MakeScratch("evict");
+  FileLoadSystem::DerivedDataCache cache;
+  EXPECT_FALSE(cache.Open(dir, 3 * (kHeaderSize + kOutputSize)));
+
+  const std::vector<char> data(kOutputSize, 'x');
+  std::vector<char> result;
+
+  for (int i = 0; i < 3; i++) {
+    EXPECT_TRUE(cache.Put(MakeKey(i), data.data(), data.size()));
+  }
+
+  // The first one was used last, so the second is the oldest
+  EXPECT_TRUE(cache.Get(MakeKey(0), result));
+  EXPECT_TRUE(cache.Put(MakeKey(3), data.data(), data.size()));
+
+  EXPECT_EQ(cache.GetStats().m_evictions, 1u);
+  EXPECT_EQ(cache.GetStats().m_size, 3 * (kHeaderSize + kOutputSize));
+  EXPECT_EQ(FindFiles(dir, ".ddc").size(), 3u);
+  EXPECT_TRUE(cache.Get(MakeKey(0), result));
+  EXPECT_FALSE(cache.Get(MakeKey(1), result));
+  EXPECT_TRUE(cache.Get(MakeKey(2), result));
+  EXPECT_TRUE(cache.Get(MakeKey(3), result));
+
+  EXPECT_FALSE(cache.Purge());
+}
+
+TEST(DerivedDataCacheTest, corruptedOutputs) {
+  const FileLoadSystem::path dir = MakeScratch("corrupted");
+  FileLoadSystem::DerivedDataCache cache;
+  EXPECT_FALSE(cache.Open(dir));
+
+  const std::string data = "some derived output";
+  std::vector<char> result;
+
+  // Torn: the file is shorter than its header says
+  EXPECT_TRUE(cache.Put(MakeKey(1), data.c_str(), data.size()));
+  std::vector<FileLoadSystem::path> files = FindFiles(dir, ".ddc");
+  ASSERT_EQ(files.size(), 1u);
+  std::filesystem::resize_file(files.front(), kHeaderSize + 4);
+
+  EXPECT_FALSE(cache.Get(MakeKey(1), result));
+  EXPECT_TRUE(result.empty());
+  EXPECT_TRUE(FindFiles(dir, ".ddc").empty());
+  EXPECT_EQ(cache.GetStats().m_size, 0u);
+
+  // Hostile: a size that can't be allocated is a miss, not an exception
+  EXPECT_TRUE(cache.Put(MakeKey(2), data.c_str(), data.size()));
+  files = FindFiles(dir, ".ddc");
+  ASSERT_EQ(files.size(), 1u);
+  {
+    std::vector<char> bytes(kHeaderSize + data.size());
+    FileLoadSystem::SmartReadFile in =
+        FileLoadSystem::OpenReadBinary(files.front());
+    ASSERT_TRUE(in.IsValid());
+    ASSERT_EQ(FileLoadSystem::Fread(bytes.data(), sizeof(char), bytes.size(),
+                                    in.Get()),
+              bytes.size());
+    in = FileLoadSystem::SmartReadFile();
+
+    std::memset(bytes.data() + 4, 0xFF, sizeof(std::uint64_t));
+    FileLoadSystem::SmartWriteFile out =
+        FileLoadSystem::OpenWriteBinary(files.front());
+    ASSERT_TRUE(out.IsValid());
+    ASSERT_EQ(FileLoadSystem::Fwrite(bytes.data(), sizeof(char), bytes.size(),
+                                     out.Get()),
+              bytes.size());
+  }
+
+  EXPECT_FALSE(cache.Get(MakeKey(2), result));
+  EXPECT_TRUE(FindFiles(dir, ".ddc").empty());
+  EXPECT_EQ(cache.GetStats().m_misses, 2u);
+
+  EXPECT_FALSE(cache.Purge());
+}
+
+TEST(DerivedDataCacheTest, temporaryFiles) {
+  const FileLoadSystem::path dir = MakeScratch("temporary");
+  FileLoadSystem::error_status error;
+  FileLoadSystem::CreateDirectories(dir, error);
+  ASSERT_FALSE(error);
+
+  // An insert of another run in flight and a leftover of a crashed one
+  const FileLoadSystem::path fresh = dir / "fresh.ddc.0123456789abcdef.tmp";
+  const FileLoadSystem::path stale = dir / "stale.ddc.fedcba9876543210.tmp";
+  for (const FileLoadSystem::path &p : {fresh, stale}) {
+    FileLoadSystem::SmartWriteFile file = FileLoadSystem::OpenWriteBinary(p);
+    ASSERT_TRUE(file.IsValid());
+  }
+  std::filesystem::last_write_time(
+      stale, std::filesystem::file_time_type::clock::now() -
+                 std::chrono::hours(2));
+
+  FileLoadSystem::DerivedDataCache cache;
+  EXPECT_FALSE(cache.Open(dir));
+  EXPECT_TRUE(FileLoadSystem::Exists(fresh, error));
+  EXPECT_FALSE(FileLoadSystem::Exists(stale, error));
+
+  EXPECT_FALSE(cache.Purge());
+}
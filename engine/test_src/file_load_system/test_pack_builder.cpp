@@ -0,0 +1,245 @@
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "file_load_system/file_load_system.hpp"
+#include "file_load_system/pack_builder.hpp"
+#include "file_load_system/smart_file.hpp"
+#include "utils/hash.hpp"
+#include "utils/lz4.hpp"
+
+namespace {
+/* Scratch directory of a test, empty at the start */
+FileLoadSystem::path MakeScratch(const char *name) {
+  const FileLoadSystem::path p =
+      std::filesystem::temp_directory_path() / "kch_pack_builder" / name;
+  FileLoadSystem::error_status error;
+  FileLoadSystem::RemoveDirectory(p, error);
+  FileLoadSystem::CreateDirectories(p, error);
+  return p;
+}
+
+/* Write a whole file */
+void WriteFile(const FileLoadSystem::path &p, const std::string &data) {
+  FileLoadSystem::error_status error;
+  FileLoadSystem::CreateDirectories(p.parent_path(), error);
+  FileLoadSystem::SmartWriteFile file = FileLoadSystem::OpenWriteBinary(p);
+  ASSERT_TRUE(file.IsValid()) << "Failed to open " << p;
+  ASSERT_EQ(FileLoadSystem::Fwrite(data.data(), sizeof(char), data.size(),
+                                   file.Get()),
+            data.size());
+}
+
+/* Whether a build left a temporary file in dir */
+bool HasTemporaryFiles(const FileLoadSystem::path &dir) {
+  for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+    if (entry.path().extension() == ".tmp") {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Bytes that don't compress */
+std::string MakeNoise(size_t size) {
+  std::mt19937 generator(7);
+  std::string noise(size, '\0');
+  for (char &c : noise) {
+    c = static_cast<char>(generator());
+  }
+  return noise;
+}
+
+/* Names of entries, in order */
+std::vector<std::string>
+GetNames(const std::vector<FileLoadSystem::PackEntry> &entries) {
+  std::vector<std::string> names;
+  for (const FileLoadSystem::PackEntry &entry : entries) {
+    names.push_back(entry.m_name);
+  }
+  return names;
+}
+
+/* Content of every pack test */
+struct PackContent {
+  FileLoadSystem::path m_content;
+  std::string m_text;
+  std::string m_noise;
+
+  explicit PackContent(const FileLoadSystem::path &dir)
+      : m_content(dir / "content") {
+    for (int i = 0; i < 200; i++) {
+      m_text += "line " + std::to_string(i % 10) + " of a text file\n";
+    }
+    m_noise = MakeNoise(1000);
+
+    WriteFile(m_content / "a.txt", m_text);
+    WriteFile(m_content / "empty.dat", "");
+    WriteFile(m_content / "sub" / "b.bin", m_noise);
+    WriteFile(m_content / "sub" / "c.txt", "hi");
+  }
+};
+} // namespace
+
+TEST(Lz4Test, roundTrip) {
+  std::string repeated;
+  for (int i = 0; i < 1000; i++) {
+    repeated += "abcabcabd" + std::to_string(i % 7);
+  }
+
+  for (const std::string &data :
+       {std::string(), std::string("short"), std::string(70000, 'z'),
+        repeated, MakeNoise(5000)}) {
+    std::vector<char> block(Lz4::GetMaxCompressedSize(data.size()));
+    const size_t size = Lz4::Compress(data.data(), data.size(), block.data());
+    ASSERT_LE(size, block.size());
+
+    std::string decoded(data.size(), '\0');
+    EXPECT_TRUE(Lz4::Decompress(block.data(), size, decoded.data(),
+                                decoded.size()));
+    EXPECT_EQ(decoded, data);
+
+    // The size must be exact
+    std::string bigger(data.size() + 1, '\0');
+    EXPECT_FALSE(
+        Lz4::Decompress(block.data(), size, bigger.data(), bigger.size()));
+  }
+
+  std::vector<char> block(Lz4::GetMaxCompressedSize(repeated.size()));
+  const size_t size =
+      Lz4::Compress(repeated.data(), repeated.size(), block.data());
+  EXPECT_LT(size, repeated.size() / 4);
+
+  // Broken blocks fail instead of going out of bounds
+  std::string decoded(repeated.size(), '\0');
+  EXPECT_FALSE(Lz4::Decompress(block.data(), size - 1, decoded.data(),
+                               decoded.size()));
+  const unsigned char farMatch[] = {0x1F, 'a', 0xFF, 0x00};
+  EXPECT_FALSE(Lz4::Decompress(farMatch, sizeof(farMatch), decoded.data(),
+                               decoded.size()));
+}
+
+TEST(PackBuilderTest, gatherAndOrder) {
+  const FileLoadSystem::path dir = MakeScratch("gather");
+  PackContent content(dir);
+
+  std::vector<FileLoadSystem::PackEntry> entries;
+  EXPECT_FALSE(FileLoadSystem::GatherPackEntries(content.m_content, entries));
+  EXPECT_EQ(GetNames(entries),
+            std::vector<std::string>(
+                {"a.txt", "empty.dat", "sub/b.bin", "sub/c.txt"}));
+  EXPECT_EQ(entries[2].m_source, content.m_content / "sub" / "b.bin");
+
+  // Listed first, names that are not there are skipped, then the rest
+  WriteFile(dir / "order.txt", "sub/c.txt\nmissing.txt\r\n\na.txt\nsub/c.txt");
+  EXPECT_FALSE(FileLoadSystem::OrderPackEntries(dir / "order.txt", entries));
+  EXPECT_EQ(GetNames(entries),
+            std::vector<std::string>(
+                {"sub/c.txt", "a.txt", "empty.dat", "sub/b.bin"}));
+
+  EXPECT_TRUE(FileLoadSystem::OrderPackEntries(dir / "none.txt", entries));
+  EXPECT_TRUE(FileLoadSystem::GatherPackEntries(dir / "none", entries));
+}
+
+TEST(PackBuilderTest, buildAndRead) {
+  const FileLoadSystem::path dir = MakeScratch("build");
+  PackContent content(dir);
+  WriteFile(dir / "order.txt", "sub/b.bin\nsub/c.txt\n");
+
+  FileLoadSystem::PackBuildOptions options;
+  options.m_workers = 2;
+  options.m_accessOrder = dir / "order.txt";
+
+  const FileLoadSystem::path pack = dir / "content.pack";
+  std::vector<FileLoadSystem::PackEntry> built;
+  EXPECT_FALSE(
+      FileLoadSystem::BuildPack(content.m_content, pack, options, &built));
+
+  EXPECT_FALSE(HasTemporaryFiles(dir));
+
+  // The table is in access order and matches what the build returned
+  std::vector<FileLoadSystem::PackEntry> table;
+  EXPECT_FALSE(FileLoadSystem::ReadPackTable(pack, table));
+  EXPECT_EQ(GetNames(table),
+            std::vector<std::string>(
+                {"sub/b.bin", "sub/c.txt", "a.txt", "empty.dat"}));
+  ASSERT_EQ(table.size(), built.size());
+
+  FileLoadSystem::file_size_t end = 0;
+  for (size_t i = 0; i < table.size(); i++) {
+    EXPECT_EQ(table[i].m_name, built[i].m_name);
+    EXPECT_EQ(table[i].m_offset, built[i].m_offset);
+    EXPECT_EQ(table[i].m_size, built[i].m_size);
+    EXPECT_EQ(table[i].m_storedSize, built[i].m_storedSize);
+    EXPECT_EQ(table[i].m_hash, built[i].m_hash);
+    EXPECT_EQ(table[i].m_method, built[i].m_method);
+
+    EXPECT_EQ(table[i].m_offset % FileLoadSystem::kPackAlignment, 0u);
+    EXPECT_GE(table[i].m_offset, end);
+    end = table[i].m_offset + table[i].m_storedSize;
+  }
+
+  // Text is compressed, noise and tiny files are not
+  EXPECT_EQ(table[0].m_method, FileLoadSystem::PackMethod::kStored);
+  EXPECT_EQ(table[1].m_method, FileLoadSystem::PackMethod::kStored);
+  EXPECT_EQ(table[2].m_method, FileLoadSystem::PackMethod::kLz4);
+  EXPECT_LT(table[2].m_storedSize, table[2].m_size / 4);
+  EXPECT_EQ(table[3].m_size, 0u);
+
+  const std::vector<std::string> expected = {content.m_noise, "hi",
+                                             content.m_text, ""};
+  for (size_t i = 0; i < table.size(); i++) {
+    std::vector<char> data;
+    EXPECT_FALSE(FileLoadSystem::ReadPackEntry(pack, table[i], data))
+        << table[i].m_name;
+    EXPECT_EQ(std::string(data.begin(), data.end()), expected[i])
+        << table[i].m_name;
+    EXPECT_EQ(table[i].m_hash,
+              Hash::Fnv1a(expected[i].data(), expected[i].size()));
+  }
+
+  // A broken entry is not handed out
+  FileLoadSystem::PackEntry broken = table[2];
+  broken.m_hash ^= 1;
+  std::vector<char> data;
+  EXPECT_TRUE(FileLoadSystem::ReadPackEntry(pack, broken, data));
+  EXPECT_TRUE(data.empty());
+
+  // Without compression everything is stored, the old pack is replaced
+  options.m_compress = false;
+  EXPECT_FALSE(
+      FileLoadSystem::BuildPack(content.m_content, pack, options, &built));
+  EXPECT_FALSE(FileLoadSystem::ReadPackTable(pack, table));
+  for (const FileLoadSystem::PackEntry &entry : table) {
+    EXPECT_EQ(entry.m_method, FileLoadSystem::PackMethod::kStored);
+    EXPECT_EQ(entry.m_storedSize, entry.m_size);
+  }
+  EXPECT_FALSE(FileLoadSystem::ReadPackEntry(pack, table[2], data));
+  EXPECT_EQ(std::string(data.begin(), data.end()), content.m_text);
+
+  // A failed build leaves the pack as it was and no temporary file
+  options.m_accessOrder = dir / "none.txt";
+  EXPECT_TRUE(FileLoadSystem::BuildPack(content.m_content, pack, options));
+  EXPECT_FALSE(FileLoadSystem::ReadPackTable(pack, table));
+  EXPECT_EQ(table.size(), 4u);
+  EXPECT_FALSE(HasTemporaryFiles(dir));
+
+  // Nor when it can't replace what is in the way
+  FileLoadSystem::error_status error;
+  options.m_accessOrder.clear();
+  ASSERT_TRUE(FileLoadSystem::CreateDirectories(dir / "blocked" / "inside",
+                                                error));
+  EXPECT_TRUE(
+      FileLoadSystem::BuildPack(content.m_content, dir / "blocked", options));
+  EXPECT_FALSE(HasTemporaryFiles(dir));
+
+  // Not a pack
+  EXPECT_TRUE(FileLoadSystem::ReadPackTable(dir / "order.txt", table));
+  EXPECT_TRUE(table.empty());
+
+  FileLoadSystem::RemoveDirectory(dir, error);
+}
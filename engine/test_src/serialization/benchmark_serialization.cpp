@@ -0,0 +1,121 @@
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "os_detection/cpu_features.hpp"
+#include "serialization/json_serializer.hpp"
+#include "serialization/recursive_struct.hpp"
+#include "serialization/serializer.hpp"
+#include "utils/stopwatch.hpp"
+
+/*
+  Parse and Compile throughput of JsonSerializer over RecursiveStruct data.
+  Build with RAPIDJSON_SIMD ON (SSE2, or RAPIDJSON_SIMD_LEVEL=SSE42) and OFF
+  and compare the reported MB/s. It is disabled so ctest doesn't time it on
+  every run, run it with
+  kch_engine_test --gtest_also_run_disabled_tests
+  --gtest_filter=SerializationBenchmark.*
+*/
+
+namespace {
+/* Objects serialized */
+constexpr int kObjects = 64;
+
+/* Depth of each object */
+constexpr int kDepth = 4;
+
+/* Times each operation is repeated */
+constexpr int kIterations = 20;
+
+/* Report the throughput of an operation */
+void Report(const char *operation, size_t bytes, Stopwatch::us::rep elapsed) {
+  const double megabytes =
+      static_cast<double>(bytes) * kIterations / (1024.0 * 1024.0);
+  const double seconds = static_cast<double>(elapsed) / 1e6;
+
+  std::printf("[ BENCH    ] %-14s %8.2f MB/s (SIMD %s)\n", operation,
+              seconds > 0.0 ? megabytes / seconds : 0.0,
+              OsDetection::GetSimdName(OsDetection::kJsonSimdLevel));
+
+  ::testing::Test::RecordProperty(operation, static_cast<int>(elapsed));
+}
+} // namespace
+
+TEST(SerializationBenchmark, DISABLED_recursiveStructJson) {
+  ASSERT_TRUE(OsDetection::HasSimd(OsDetection::kJsonSimdLevel));
+
+  // Long strings, so string scanning counts as much as whitespace skipping
+  const std::string text(1024, 'a');
+
+  std::vector<std::unique_ptr<RecursiveStruct>> objects;
+  for (int i = 0; i < kObjects; i++) {
+    RecursiveStruct *rec = nullptr;
+
+    for (int j = 0; j < kDepth; j++) {
+      rec = rec == nullptr ? new RecursiveStruct() : new RecursiveStruct(rec);
+      rec->SetRandom(text.c_str());
+    }
+
+    objects.emplace_back(rec);
+  }
+
+  Serializer::JsonSerializer serializer;
+  for (int i = 0; i < kObjects; i++) {
+    const std::string name = "rec_" + std::to_string(i);
+    ASSERT_TRUE(
+        objects[i]->Serialize(&serializer, name.c_str(), name.length()));
+  }
+
+  Serializer::s_size size;
+
+  // Compile
+  Stopwatch::Stopwatch watch;
+  for (int i = 0; i < kIterations; i++) {
+    ASSERT_TRUE(serializer.Compile());
+  }
+  Stopwatch::us::rep elapsed = watch.Stop<Stopwatch::us>();
+
+  ASSERT_TRUE(serializer.GetSize(&size));
+  std::unique_ptr<char[]> compact(new char[size]);
+  ASSERT_TRUE(serializer.GetText(compact.get()));
+  Report("Compile", size, elapsed);
+
+  watch.Start();
+  for (int i = 0; i < kIterations; i++) {
+    ASSERT_TRUE(serializer.CompilePretty());
+  }
+  elapsed = watch.Stop<Stopwatch::us>();
+
+  ASSERT_TRUE(serializer.GetSize(&size));
+  std::unique_ptr<char[]> pretty(new char[size]);
+  ASSERT_TRUE(serializer.GetText(pretty.get()));
+  Report("CompilePretty", size, elapsed);
+
+  // Parse
+  Serializer::JsonSerializer parser;
+
+  for (const char *json : {compact.get(), pretty.get()}) {
+    const size_t length = std::char_traits<char>::length(json);
+
+    watch.Start();
+    for (int i = 0; i < kIterations; i++) {
+      ASSERT_TRUE(parser.ParseText(json, length));
+    }
+    elapsed = watch.Stop<Stopwatch::us>();
+
+    Report(json == compact.get() ? "Parse" : "ParsePretty", length, elapsed);
+
+    // What was measured is right
+    for (int i = 0; i < kObjects; i++) {
+      const std::string name = "rec_" + std::to_string(i);
+      std::unique_ptr<RecursiveStruct> rec =
+          RecursiveStruct::Deserialize(&parser, name.c_str());
+
+      ASSERT_TRUE(rec) << name;
+      EXPECT_TRUE(*objects[i] == *rec) << name;
+    }
+  }
+}
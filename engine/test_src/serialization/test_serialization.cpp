@@ -1,16 +1,38 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <limits>
 #include <memory>
 #include <random>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "gtest/gtest.h"
 
+#include "file_load_system/file_load_system.hpp"
+#include "file_load_system/mapped_file.hpp"
+#include "serialization/background_save.hpp"
+#include "serialization/binary_serializer.hpp"
+#include "serialization/flat_serializer.hpp"
+#include "serialization/incremental_save.hpp"
+#include "serialization/json_lines_reader.hpp"
+#include "serialization/json_pull_serializer.hpp"
 #include "serialization/json_serializer.hpp"
+#include "serialization/json_stream_serializer.hpp"
+#include "serialization/message_pack_serializer.hpp"
+#include "serialization/path_query.hpp"
+#include "serialization/parallel_serializer.hpp"
+#include "serialization/recursive_struct.hpp"
+#include "serialization/reflection.hpp"
 #include "serialization/serializer.hpp"
+#include "serialization/serializer_factory.hpp"
+#include "serialization/shared_graph.hpp"
+#include "serialization/sink.hpp"
 
 // https://stackoverflow.com/questions/55892577/how-to-test-the-same-behaviour-for-multiple-templated-classes-with-different-tem
 template <typename Serializer> class SerializerTest : public ::testing::Test {
@@ -21,7 +43,10 @@ protected:
 };
 
 // Register here other serializers
-using serializermethods = ::testing::Types<Serializer::JsonSerializer>;
+using serializermethods =
+    ::testing::Types<Serializer::JsonSerializer, Serializer::BinarySerializer,
+                     Serializer::MessagePackSerializer,
+                     Serializer::FlatSerializer>;
 
 TYPED_TEST_SUITE(SerializerTest, serializermethods);
 
@@ -525,6 +550,45 @@ TYPED_TEST(SerializerTest, stringType) {
       << std::string(hola_res3.get());
 }
 
+TYPED_TEST(SerializerTest, stringView) {
+  std::unique_ptr<Serializer::ISerializer> serializer(this->GetSerializer());
+
+  const std::string hola = "sdfsd fsdfsdf \"sdfsdf\",s,s ,s,s\n\t";
+  const std::string hola_name = "hola";
+  std::string test_start_text = "Expected \"" + hola_name + "\" ";
+
+  EXPECT_TRUE(serializer->SetString(hola_name.c_str(), hola_name.length(),
+                                    hola.c_str(), hola.length()))
+      << test_start_text << "to be inserted";
+
+  std::string_view hola_view;
+
+  EXPECT_TRUE(serializer->GetStringView(hola_name.c_str(), &hola_view))
+      << test_start_text << "to be an String";
+  EXPECT_EQ(hola_view, hola) << test_start_text << "to be " << hola;
+
+  // Compile
+  EXPECT_TRUE(serializer->Compile()) << "Failed to Compile";
+
+  Serializer::s_size size;
+
+  EXPECT_TRUE(serializer->GetSize(&size)) << "Failed to Get Size of Compile";
+
+  std::unique_ptr<char[]> resp(new char[size]);
+
+  EXPECT_TRUE(serializer->GetText(resp.get())) << "Failed to Get Compile";
+
+  std::unique_ptr<Serializer::ISerializer> serializerNormal(
+      this->GetSerializer());
+
+  EXPECT_TRUE(serializerNormal->ParseText(resp.get(), size))
+      << "Failed to Parse Compile";
+  EXPECT_TRUE(serializerNormal->GetStringView(hola_name.c_str(), &hola_view))
+      << test_start_text << "to be an String in Compile";
+  EXPECT_EQ(hola_view, hola) << test_start_text << "in Compile to be " << hola;
+  EXPECT_FALSE(serializerNormal->GetStringView("missing", &hola_view));
+}
+
 TYPED_TEST(SerializerTest, nullType) {
   std::unique_ptr<Serializer::ISerializer> serializer(this->GetSerializer());
 
@@ -1300,229 +1364,218 @@ TYPED_TEST(SerializerTest, nullArrayType) {
   EXPECT_TRUE(serializerNormal->CloseArray());
 }
 
-class RecursiveStruct : public Serializer::ISerializableImpl<RecursiveStruct> {
-public:
-  std::string m_someText;
-  int m_anInt;
-  double m_aDouble;
-  bool m_aBool;
-  std::vector<uint64_t> m_someUints;
+TYPED_TEST(SerializerTest, bulkArrayType) {
+  std::unique_ptr<Serializer::ISerializer> serializer(this->GetSerializer());
 
-  std::unique_ptr<RecursiveStruct> m_aPtr;
+  const std::vector<int> ints{-3, 0, 7, std::numeric_limits<int>::min()};
+  const std::vector<unsigned> uints{0, 1, std::numeric_limits<unsigned>::max()};
+  const std::vector<int64_t> int64s{-1, std::numeric_limits<int64_t>::min()};
+  const std::vector<uint64_t> uint64s{std::numeric_limits<uint64_t>::max()};
+  const std::vector<double> doubles{0.5, -2.25, 1024.125};
+  const bool bools[] = {true, false, true};
 
-  RecursiveStruct() = default;
+  EXPECT_TRUE(
+      serializer->SetIntArray(SET_NAME(ints), ints.data(), ints.size()));
+  EXPECT_TRUE(
+      serializer->SetUintArray(SET_NAME(uints), uints.data(), uints.size()));
+  EXPECT_TRUE(serializer->SetInt64Array(SET_NAME(int64s), int64s.data(),
+                                        int64s.size()));
+  EXPECT_TRUE(serializer->SetUint64Array(SET_NAME(uint64s), uint64s.data(),
+                                         uint64s.size()));
+  EXPECT_TRUE(serializer->SetDoubleArray(SET_NAME(doubles), doubles.data(),
+                                         doubles.size()));
+  EXPECT_TRUE(serializer->SetBoolArray(SET_NAME(bools), bools, 3));
+  EXPECT_TRUE(serializer->SetIntArray(SET_NAME(empty), nullptr, 0));
+
+  // Arrays inside arrays
+  EXPECT_TRUE(serializer->SetArray(SET_NAME(nested)));
+  EXPECT_TRUE(serializer->SetIntArray(nullptr, 0, ints.data(), ints.size()));
+  EXPECT_TRUE(serializer->CloseArray());
 
-  RecursiveStruct(RecursiveStruct *ptr) {
-    m_aPtr = std::unique_ptr<RecursiveStruct>(ptr);
-  }
+  EXPECT_TRUE(serializer->Compile()) << "Failed to Compile";
 
-  virtual ~RecursiveStruct() = default;
+  Serializer::s_size size;
 
-  void SetRandom(const char *text) {
-    m_someText.clear();
-    m_someText.assign(text);
+  EXPECT_TRUE(serializer->GetSize(&size)) << "Failed to Get Size of Compile";
 
-    auto intGenerator = std::bind(kIntDistribution, kGenerator);
-    m_anInt = intGenerator();
-    m_aBool = intGenerator() & 1;
+  std::unique_ptr<char[]> resp(new char[size]);
 
-    int size = intGenerator() % kMaxVectorSize;
-    m_someUints.clear();
-    m_someUints.reserve(size);
+  EXPECT_TRUE(serializer->GetText(resp.get())) << "Failed to Get Compile";
 
-    auto doubleGenerator = std::bind(kDoubleDistribution, kGenerator);
-    m_aDouble = doubleGenerator();
+  std::unique_ptr<Serializer::ISerializer> serializerNormal(
+      this->GetSerializer());
 
-    auto unitGenerator = std::bind(kUintDistribution, kGenerator);
-    for (int i = 0; i < size; i++) {
-      m_someUints.push_back(unitGenerator());
-    }
-  }
+  EXPECT_TRUE(serializerNormal->ParseText(resp.get(), size))
+      << "Failed to Parse Compile";
+
+  std::vector<int> int_result(ints.size());
+  std::vector<unsigned> uint_result(uints.size());
+  std::vector<int64_t> int64_result(int64s.size());
+  std::vector<uint64_t> uint64_result(uint64s.size());
+  std::vector<double> double_result(doubles.size());
+  bool bool_result[3];
+
+  EXPECT_TRUE(serializerNormal->GetIntArray(GET_NAME(ints), int_result.data(),
+                                            int_result.size()));
+  EXPECT_EQ(int_result, ints);
+  EXPECT_TRUE(serializerNormal->GetUintArray(
+      GET_NAME(uints), uint_result.data(), uint_result.size()));
+  EXPECT_EQ(uint_result, uints);
+  EXPECT_TRUE(serializerNormal->GetInt64Array(
+      GET_NAME(int64s), int64_result.data(), int64_result.size()));
+  EXPECT_EQ(int64_result, int64s);
+  EXPECT_TRUE(serializerNormal->GetUint64Array(
+      GET_NAME(uint64s), uint64_result.data(), uint64_result.size()));
+  EXPECT_EQ(uint64_result, uint64s);
+  EXPECT_TRUE(serializerNormal->GetDoubleArray(
+      GET_NAME(doubles), double_result.data(), double_result.size()));
+  EXPECT_EQ(double_result, doubles);
+  EXPECT_TRUE(serializerNormal->GetBoolArray(GET_NAME(bools), bool_result, 3));
+  EXPECT_TRUE(std::equal(bools, bools + 3, bool_result));
+  EXPECT_TRUE(serializerNormal->GetIntArray(GET_NAME(empty), nullptr, 0));
+
+  // Integers can be read as doubles
+  std::vector<double> int_doubles(ints.size());
+  EXPECT_TRUE(serializerNormal->GetDoubleArray(
+      GET_NAME(ints), int_doubles.data(), int_doubles.size()));
+  EXPECT_EQ(int_doubles[0], -3.0);
+
+  // Wrong size or type
+  EXPECT_FALSE(serializerNormal->GetIntArray(GET_NAME(ints), int_result.data(),
+                                             int_result.size() - 1));
+  EXPECT_FALSE(serializerNormal->GetUintArray(
+      GET_NAME(ints), uint_result.data(), ints.size()));
+  EXPECT_FALSE(serializerNormal->GetIntArray(GET_NAME(doubles),
+                                             int_result.data(), 3));
+  EXPECT_FALSE(serializerNormal->GetIntArray("missing", int_result.data(), 1));
+
+  // Bulk and element by element give the same arrays
+  Serializer::s_size array_size;
+  int value;
 
-  bool operator==(const RecursiveStruct &other) {
-    if (m_someText != other.m_someText) {
-      return false;
-    }
-    if (m_anInt != other.m_anInt) {
-      return false;
-    }
-    if (m_aDouble != other.m_aDouble) {
-      return false;
-    }
-    if (m_aBool != other.m_aBool) {
-      return false;
-    }
-    if (m_someUints != other.m_someUints) {
-      return false;
-    }
-    if (m_aPtr && other.m_aPtr) {
-      return *m_aPtr == *other.m_aPtr;
-    }
-    return !m_aPtr && !other.m_aPtr;
+  EXPECT_TRUE(serializerNormal->GetArrayCapacity(GET_NAME(ints), &array_size));
+  ASSERT_EQ(array_size, ints.size());
+  EXPECT_TRUE(serializerNormal->OpenArray(GET_NAME(ints)));
+  for (size_t i = 0; i < array_size; i++) {
+    EXPECT_TRUE(serializerNormal->GetInt(nullptr, &value));
+    EXPECT_EQ(value, ints[i]);
+    EXPECT_TRUE(serializerNormal->MoveArray());
   }
+  EXPECT_TRUE(serializerNormal->CloseArray());
 
-  bool operator!=(const RecursiveStruct &other) { return !(*this == other); }
-
-  bool Serialize(Serializer::ISerializer *serializer, const char *name,
-                 Serializer::s_size name_length) {
-    if (!serializer->SetEntry(name, name_length, kSerializerVersion)) {
-      return false;
-    }
-
-    if (!serializer->SetString(SET_NAME(m_someText), m_someText.c_str(),
-                               m_someText.length())) {
-      return false;
-    }
-
-    if (!serializer->SetInt(SET_NAME(m_anInt), m_anInt)) {
-      return false;
-    }
-
-    if (!serializer->SetDouble(SET_NAME(m_aDouble), m_aDouble)) {
-      return false;
-    }
-
-    if (!serializer->SetBool(SET_NAME(m_aBool), m_aBool)) {
-      return false;
-    }
+  std::fill(int_result.begin(), int_result.end(), 0);
+  EXPECT_TRUE(serializerNormal->OpenArray(GET_NAME(nested)));
+  EXPECT_TRUE(serializerNormal->GetIntArray(nullptr, int_result.data(),
+                                            int_result.size()));
+  EXPECT_EQ(int_result, ints);
+  EXPECT_TRUE(serializerNormal->CloseArray());
 
-    if (!serializer->SetArray(SET_NAME(m_someUints))) {
-      return false;
-    }
+  // The default goes element by element
+  EXPECT_TRUE(serializerNormal->Serializer::ISerializer::GetIntArray(
+      GET_NAME(ints), int_result.data(), int_result.size()));
+  EXPECT_EQ(int_result, ints);
+  EXPECT_TRUE(serializer->Serializer::ISerializer::SetIntArray(
+      SET_NAME(element_ints), ints.data(), ints.size()));
+  EXPECT_TRUE(serializer->GetIntArray(GET_NAME(element_ints),
+                                      int_result.data(), int_result.size()));
+  EXPECT_EQ(int_result, ints);
+}
 
-    for (auto anUint : m_someUints) {
-      if (!serializer->SetUint64(nullptr, 0, anUint)) {
-        return false;
-      }
-    }
+TYPED_TEST(SerializerTest, compileTo) {
+  std::unique_ptr<Serializer::ISerializer> serializer(this->GetSerializer());
 
-    if (!serializer->CloseArray()) {
-      return false;
-    }
+  EXPECT_TRUE(serializer->SetEntry(SET_NAME(entry), 3));
+  EXPECT_TRUE(serializer->SetInt(SET_NAME(value), -42));
+  EXPECT_TRUE(serializer->SetString(SET_NAME(text), "compiled", 8));
+  EXPECT_TRUE(serializer->CloseEntry());
 
-    if (m_aPtr) {
-      if (!m_aPtr->Serialize(serializer, SET_NAME(m_aPtr))) {
-        return false;
-      }
+  EXPECT_TRUE(serializer->Compile());
 
-    } else {
-      if (!serializer->SetNull(SET_NAME(m_aPtr))) {
-        return false;
-      }
-    }
+  Serializer::s_size size;
+  EXPECT_TRUE(serializer->GetSize(&size));
+  std::unique_ptr<char[]> text(new char[size]);
+  EXPECT_TRUE(serializer->GetText(text.get()));
+
+  // The view is the same text, without copying it
+  std::string_view view;
+  EXPECT_TRUE(serializer->GetView(&view));
+  EXPECT_EQ(view.size() + 1, size);
+  EXPECT_EQ(view, std::string_view(text.get(), size - 1));
+
+  // Compiled straight into a growable buffer
+  std::string compiled;
+  Serializer::StringSink sink(compiled);
+  EXPECT_TRUE(serializer->CompileTo(sink));
+  EXPECT_EQ(compiled, std::string(text.get(), size - 1));
+
+  EXPECT_TRUE(serializer->ParseText(compiled.c_str(), compiled.length()));
+
+  int value;
+  Serializer::s_size version;
+  EXPECT_TRUE(serializer->OpenEntry(GET_NAME(entry), &version));
+  EXPECT_EQ(version, 3u);
+  EXPECT_TRUE(serializer->GetInt(GET_NAME(value), &value));
+  EXPECT_EQ(value, -42);
+  EXPECT_TRUE(serializer->CloseEntry());
+}
 
-    if (!serializer->CloseEntry()) {
-      return false;
-    }
+TYPED_TEST(SerializerTest, blobType) {
+  std::unique_ptr<Serializer::ISerializer> serializer(this->GetSerializer());
 
-    return true;
+  // Every byte value, and the sizes that need padding
+  std::vector<unsigned char> bytes(256 + 2);
+  for (size_t i = 0; i < bytes.size(); i++) {
+    bytes[i] = static_cast<unsigned char>(i);
   }
 
-  static std::unique_ptr<RecursiveStruct>
-  Deserialize(const Serializer::ISerializer *serializer, const char *name) {
-
-    Serializer::s_size version;
-
-    if (!serializer->OpenEntry(name, &version)) {
-      return nullptr;
-    }
-
-    if (version != kSerializerVersion) {
-      return nullptr;
-    }
-
-    size_t size;
-
-    if (!serializer->GetStringLength(GET_NAME(m_someText), &size)) {
-      return nullptr;
-    }
-
-    std::unique_ptr<char[]> someText(new char[size]);
-
-    if (!serializer->GetString(GET_NAME(m_someText), someText.get())) {
-      return nullptr;
-    }
-
-    std::unique_ptr<RecursiveStruct> object =
-        std::make_unique<RecursiveStruct>();
-
-    object->m_someText.clear();
-
-    object->m_someText.assign(someText.get());
-
-    if (!serializer->GetInt(GET_NAME(m_anInt), &(object->m_anInt))) {
-      return nullptr;
-    }
-
-    if (!serializer->GetDouble(GET_NAME(m_aDouble), &(object->m_aDouble))) {
-      return nullptr;
-    }
-
-    if (!serializer->GetBool(GET_NAME(m_aBool), &(object->m_aBool))) {
-      return nullptr;
-    }
-
-    Serializer::s_size m_someUints_size;
-
-    if (!serializer->GetArrayCapacity(GET_NAME(m_someUints),
-                                      &m_someUints_size)) {
-      return nullptr;
-    }
-
-    if (!serializer->OpenArray(GET_NAME(m_someUints))) {
-      return nullptr;
-    }
+  EXPECT_TRUE(serializer->SetBlob(SET_NAME(bytes), bytes.data(), bytes.size()));
+  EXPECT_TRUE(serializer->SetBlob(SET_NAME(empty), nullptr, 0));
+  EXPECT_TRUE(serializer->SetBlob(SET_NAME(one), bytes.data() + 1, 1));
+  EXPECT_TRUE(serializer->SetArray(SET_NAME(blobs)));
+  EXPECT_TRUE(serializer->SetBlob(nullptr, 0, bytes.data(), 2));
+  EXPECT_TRUE(serializer->CloseArray());
 
-    object->m_someUints.clear();
-    object->m_someUints.reserve(static_cast<size_t>(m_someUints_size));
+  // Compile and Parse
+  EXPECT_TRUE(serializer->Compile());
 
-    {
-      uint64_t tmp;
+  Serializer::s_size size;
+  EXPECT_TRUE(serializer->GetSize(&size));
+  std::unique_ptr<char[]> compile(new char[size]);
+  EXPECT_TRUE(serializer->GetText(compile.get()));
 
-      for (Serializer::s_size i = 0; i < m_someUints_size; i++) {
-        if (!serializer->GetUint64(nullptr, &tmp)) {
-          return nullptr;
-        }
-        object->m_someUints.push_back(tmp);
-        serializer->MoveArray();
-      }
-    }
+  std::unique_ptr<Serializer::ISerializer> parser(this->GetSerializer());
+  EXPECT_TRUE(parser->ParseText(compile.get(), size - 1));
 
-    if (!serializer->CloseArray()) {
-      return nullptr;
-    }
+  for (Serializer::ISerializer *reader : {serializer.get(), parser.get()}) {
+    std::vector<unsigned char> result(bytes.size());
 
-    object->m_aPtr.reset();
+    EXPECT_TRUE(reader->GetBlobSize(GET_NAME(bytes), &size));
+    EXPECT_EQ(size, bytes.size());
+    EXPECT_TRUE(reader->GetBlob(GET_NAME(bytes), result.data(), size));
+    EXPECT_EQ(result, bytes);
 
-    if (!serializer->IsNull(GET_NAME(m_aPtr))) {
+    // The size must match
+    EXPECT_FALSE(reader->GetBlob(GET_NAME(bytes), result.data(), size - 1));
 
-      object->m_aPtr = std::move(Deserialize(serializer, GET_NAME(m_aPtr)));
+    EXPECT_TRUE(reader->GetBlobSize(GET_NAME(empty), &size));
+    EXPECT_EQ(size, 0u);
+    EXPECT_TRUE(reader->GetBlob(GET_NAME(empty), result.data(), 0));
 
-      if (!object->m_aPtr) {
-        return nullptr;
-      }
-    }
+    EXPECT_TRUE(reader->GetBlobSize(GET_NAME(one), &size));
+    EXPECT_EQ(size, 1u);
+    EXPECT_TRUE(reader->GetBlob(GET_NAME(one), result.data(), 1));
+    EXPECT_EQ(result[0], 1);
 
-    if (!serializer->CloseEntry()) {
-      return nullptr;
-    }
+    EXPECT_TRUE(reader->OpenArray(GET_NAME(blobs)));
+    EXPECT_TRUE(reader->GetBlobSize(nullptr, &size));
+    EXPECT_EQ(size, 2u);
+    EXPECT_TRUE(reader->GetBlob(nullptr, result.data(), 2));
+    EXPECT_EQ(result[1], 1);
+    EXPECT_TRUE(reader->CloseArray());
 
-    return object;
+    EXPECT_FALSE(reader->GetBlobSize(GET_NAME(missing), &size));
   }
-
-private:
-  static std::default_random_engine kGenerator;
-  static std::uniform_int_distribution<int> kIntDistribution;
-  static std::uniform_int_distribution<uint64_t> kUintDistribution;
-  static std::uniform_real_distribution<double> kDoubleDistribution;
-  static constexpr int kMaxVectorSize = 512;
-  static constexpr Serializer::s_size kSerializerVersion = 0;
-};
-
-std::default_random_engine RecursiveStruct::kGenerator(42);
-std::uniform_int_distribution<int> RecursiveStruct::kIntDistribution;
-std::uniform_int_distribution<uint64_t> RecursiveStruct::kUintDistribution;
-std::uniform_real_distribution<double> RecursiveStruct::kDoubleDistribution;
+}
 
 TYPED_TEST(SerializerTest, recursiveObject) {
   RecursiveStruct *recTmp = new RecursiveStruct();
@@ -1604,4 +1657,1656 @@ TYPED_TEST(SerializerTest, recursiveObject) {
   EXPECT_TRUE(*rec == *rec_resp)
       << "Failed to Deserialize Correctly in Compile\n"
       << compile;
-}
\ No newline at end of file
+}
+
+TYPED_TEST(SerializerTest, deserializeInto) {
+  constexpr size_t kObjects = 64;
+
+  std::vector<RecursiveStruct> objects(kObjects);
+  for (size_t i = 0; i < kObjects; i++) {
+    objects[i].SetRandom("pooled");
+    if (i % 2 == 0) {
+      objects[i].m_aPtr = std::make_unique<RecursiveStruct>();
+      objects[i].m_aPtr->SetRandom("child");
+    }
+  }
+
+  std::unique_ptr<Serializer::ISerializer> serializer(this->GetSerializer());
+
+  EXPECT_TRUE(serializer->SetArray(SET_NAME(objects)));
+  for (RecursiveStruct &object : objects) {
+    EXPECT_TRUE(object.Serialize(serializer.get(), nullptr, 0));
+  }
+  EXPECT_TRUE(serializer->CloseArray());
+  EXPECT_TRUE(objects[1].Serialize(serializer.get(), SET_NAME(single)));
+  EXPECT_TRUE(serializer->Compile()) << "Failed to Compile";
+
+  Serializer::s_size size;
+  EXPECT_TRUE(serializer->GetSize(&size));
+  std::unique_ptr<char[]> text(new char[size]);
+  EXPECT_TRUE(serializer->GetText(text.get()));
+
+  std::unique_ptr<Serializer::ISerializer> parser(this->GetSerializer());
+  EXPECT_TRUE(parser->ParseText(text.get(), static_cast<size_t>(size)));
+
+  // Every object in one vector
+  std::vector<RecursiveStruct> loaded;
+  EXPECT_TRUE(Serializer::DeserializeArrayInto(parser.get(),
+                                               GET_NAME(objects), &loaded));
+  ASSERT_EQ(loaded.size(), kObjects);
+
+  std::vector<const RecursiveStruct *> children;
+  for (size_t i = 0; i < kObjects; i++) {
+    EXPECT_TRUE(loaded[i] == objects[i]) << "Object " << i;
+    children.push_back(loaded[i].m_aPtr.get());
+  }
+
+  // Loading again reuses the storage and the children
+  EXPECT_TRUE(Serializer::DeserializeArrayInto(parser.get(),
+                                               GET_NAME(objects), &loaded));
+  ASSERT_EQ(loaded.size(), kObjects);
+  for (size_t i = 0; i < kObjects; i++) {
+    EXPECT_TRUE(loaded[i] == objects[i]) << "Object " << i;
+    EXPECT_EQ(loaded[i].m_aPtr.get(), children[i]) << "Object " << i;
+  }
+
+  // A slot the caller already has
+  RecursiveStruct &slot = loaded.front();
+  EXPECT_TRUE(Serializer::DeserializeInto(parser.get(), GET_NAME(single),
+                                          &slot));
+  EXPECT_TRUE(slot == objects[1]);
+  EXPECT_FALSE(slot.m_aPtr);
+
+  EXPECT_FALSE(Serializer::DeserializeInto(parser.get(), GET_NAME(missing),
+                                           &slot));
+}
+
+/* Node of a graph, its links can be shared, the parent makes cycles */
+struct GraphNode : public Serializer::ISerializableImpl<GraphNode> {
+  int m_value = 0;
+  std::shared_ptr<GraphNode> m_left;
+  std::shared_ptr<GraphNode> m_right;
+  std::vector<std::shared_ptr<GraphNode>> m_links;
+  std::weak_ptr<GraphNode> m_parent;
+
+  bool Serialize(Serializer::ISerializer *serializer, const char *name,
+                 Serializer::s_size name_length) override {
+    bool res = serializer->SetEntry(name, name_length, 1) &&
+               serializer->SetInt(SET_NAME(value), m_value) &&
+               Serializer::SetShared(serializer, SET_NAME(left), m_left) &&
+               Serializer::SetShared(serializer, SET_NAME(right), m_right) &&
+               serializer->SetArray(SET_NAME(links));
+
+    for (size_t i = 0; res && i < m_links.size(); i++) {
+      res = Serializer::SetShared(serializer, nullptr, 0, m_links[i]);
+    }
+
+    return res && serializer->CloseArray() &&
+           Serializer::SetShared(serializer, SET_NAME(parent), m_parent) &&
+           serializer->CloseEntry();
+  }
+
+  /* Right is read before left, so its ID can come before its object */
+  static bool DeserializeInto(const Serializer::ISerializer *serializer,
+                              const char *name, GraphNode *object) {
+    Serializer::s_size version;
+    Serializer::s_size size;
+
+    if (!serializer->OpenEntry(name, &version)) {
+      return false;
+    }
+
+    bool res =
+        serializer->GetInt(GET_NAME(value), &object->m_value) &&
+        Serializer::GetShared(serializer, GET_NAME(right), &object->m_right) &&
+        Serializer::GetShared(serializer, GET_NAME(left), &object->m_left) &&
+        serializer->GetArrayCapacity(GET_NAME(links), &size) &&
+        serializer->OpenArray(GET_NAME(links));
+
+    if (res) {
+      object->m_links.resize(size);
+      for (Serializer::s_size i = 0; res && i < size; i++) {
+        res = Serializer::GetShared(serializer, nullptr,
+                                    &object->m_links[i]) &&
+              serializer->MoveArray();
+      }
+      res = serializer->CloseArray() && res;
+    }
+
+    res = res && Serializer::GetShared(serializer, GET_NAME(parent),
+                                       &object->m_parent);
+    return serializer->CloseEntry() && res;
+  }
+};
+
+TYPED_TEST(SerializerTest, sharedGraph) {
+  auto root = std::make_shared<GraphNode>();
+  auto shared = std::make_shared<GraphNode>();
+  auto leaf = std::make_shared<GraphNode>();
+  root->m_value = 1;
+  shared->m_value = 2;
+  leaf->m_value = 3;
+
+  root->m_left = shared;
+  root->m_right = shared;
+  root->m_links = {leaf, shared, nullptr};
+  shared->m_left = leaf;
+  shared->m_parent = root;
+  leaf->m_parent = shared;
+
+  std::unique_ptr<Serializer::ISerializer> serializer(this->GetSerializer());
+
+  // Nothing is written without a writer
+  EXPECT_FALSE(Serializer::SetShared(serializer.get(), SET_NAME(graph), root));
+  {
+    Serializer::SharedWriter writer;
+    EXPECT_TRUE(
+        Serializer::SetShared(serializer.get(), SET_NAME(graph), root));
+    EXPECT_EQ(writer.GetObjectCount(), 3u);
+  }
+  EXPECT_TRUE(serializer->SetUint64(SET_NAME(dangling), 7));
+  EXPECT_TRUE(serializer->Compile()) << "Failed to Compile";
+
+  Serializer::s_size size;
+  EXPECT_TRUE(serializer->GetSize(&size));
+  std::unique_ptr<char[]> text(new char[size]);
+  EXPECT_TRUE(serializer->GetText(text.get()));
+
+  std::unique_ptr<Serializer::ISerializer> parser(this->GetSerializer());
+  EXPECT_TRUE(parser->ParseText(text.get(), static_cast<size_t>(size)));
+
+  std::shared_ptr<GraphNode> loaded;
+  {
+    Serializer::SharedReader reader;
+    EXPECT_TRUE(
+        Serializer::GetShared(parser.get(), GET_NAME(graph), &loaded));
+    EXPECT_EQ(reader.GetObjectCount(), 3u);
+
+    // The right link waits for its object
+    ASSERT_NE(loaded, nullptr);
+    EXPECT_EQ(loaded->m_right, nullptr);
+    EXPECT_TRUE(reader.Resolve());
+  }
+
+  // Every object was created once
+  ASSERT_NE(loaded->m_left, nullptr);
+  EXPECT_EQ(loaded->m_value, 1);
+  EXPECT_EQ(loaded->m_right, loaded->m_left);
+  EXPECT_EQ(loaded->m_left->m_value, 2);
+  ASSERT_EQ(loaded->m_links.size(), 3u);
+  EXPECT_EQ(loaded->m_links[0], loaded->m_left->m_left);
+  EXPECT_EQ(loaded->m_links[0]->m_value, 3);
+  EXPECT_EQ(loaded->m_links[1], loaded->m_left);
+  EXPECT_EQ(loaded->m_links[2], nullptr);
+  EXPECT_TRUE(loaded->m_parent.expired());
+  EXPECT_EQ(loaded->m_left->m_parent.lock(), loaded);
+  EXPECT_EQ(loaded->m_links[0]->m_parent.lock(), loaded->m_left);
+
+  // An ID whose object is never read
+  {
+    Serializer::SharedReader reader;
+    std::shared_ptr<GraphNode> dangling;
+    EXPECT_TRUE(
+        Serializer::GetShared(parser.get(), GET_NAME(dangling), &dangling));
+    EXPECT_FALSE(reader.Resolve());
+    EXPECT_EQ(dangling, nullptr);
+  }
+
+  // Back links are weak, so nothing is kept once the root is gone
+  const std::weak_ptr<GraphNode> leaked = loaded->m_links[0];
+  loaded.reset();
+  EXPECT_TRUE(leaked.expired());
+}
+
+TYPED_TEST(SerializerTest, pathQuery) {
+  constexpr int kEntities = 4;
+
+  std::unique_ptr<Serializer::ISerializer> serializer(this->GetSerializer());
+
+  EXPECT_TRUE(serializer->SetInt(SET_NAME(speed), 7));
+  EXPECT_TRUE(serializer->SetArray(SET_NAME(entities)));
+  for (int i = 0; i < kEntities; i++) {
+    const std::string name = "entity_" + std::to_string(i);
+    const double pos[3] = {i * 1.0, i * 2.0, i * 3.0};
+
+    EXPECT_TRUE(serializer->SetEntry(nullptr, 0, 1));
+    EXPECT_TRUE(
+        serializer->SetString(SET_NAME(name), name.c_str(), name.length()));
+    EXPECT_TRUE(serializer->SetEntry(SET_NAME(transform), 2));
+    EXPECT_TRUE(serializer->SetDoubleArray(SET_NAME(pos), pos, 3));
+    EXPECT_TRUE(serializer->SetDouble(SET_NAME(scale), i + 0.5));
+    EXPECT_TRUE(serializer->CloseEntry());
+    EXPECT_TRUE(serializer->CloseEntry());
+  }
+  EXPECT_TRUE(serializer->CloseArray());
+  EXPECT_TRUE(serializer->Compile());
+
+  Serializer::s_size size;
+  EXPECT_TRUE(serializer->GetSize(&size));
+  std::unique_ptr<char[]> text(new char[size]);
+  EXPECT_TRUE(serializer->GetText(text.get()));
+
+  std::unique_ptr<Serializer::ISerializer> parser(this->GetSerializer());
+  EXPECT_TRUE(parser->ParseText(text.get(), static_cast<size_t>(size)));
+
+  Serializer::PathQuery speed;
+  Serializer::PathQuery scale;
+  Serializer::PathQuery name;
+  Serializer::PathQuery pos;
+  Serializer::PathQuery entity;
+  ASSERT_TRUE(Serializer::PathQuery::Compile("speed", &speed));
+  ASSERT_TRUE(
+      Serializer::PathQuery::Compile("entities/2/transform/scale", &scale));
+  ASSERT_TRUE(Serializer::PathQuery::Compile("/entities/1/name", &name));
+  ASSERT_TRUE(Serializer::PathQuery::Compile("entities.3.transform.pos", &pos));
+  ASSERT_TRUE(Serializer::PathQuery::Compile("entities/2", &entity));
+
+  // Twice in each serializer, the second time it is already resolved
+  for (Serializer::ISerializer *document : {serializer.get(), parser.get()}) {
+    for (int pass = 0; pass < 2; pass++) {
+      int speedValue = 0;
+      ASSERT_TRUE(document->OpenPath(speed));
+      EXPECT_TRUE(document->GetInt(speed.GetName(), &speedValue));
+      EXPECT_TRUE(document->ClosePath());
+      EXPECT_EQ(speedValue, 7);
+
+      double scaleValue = 0;
+      ASSERT_TRUE(document->OpenPath(scale));
+      EXPECT_TRUE(document->GetDouble(scale.GetName(), &scaleValue));
+      EXPECT_TRUE(document->ClosePath());
+      EXPECT_EQ(scaleValue, 2.5);
+
+      Serializer::s_size length;
+      ASSERT_TRUE(document->OpenPath(name));
+      EXPECT_TRUE(document->GetStringLength(name.GetName(), &length));
+      std::unique_ptr<char[]> nameValue(new char[length]);
+      EXPECT_TRUE(document->GetString(name.GetName(), nameValue.get()));
+      EXPECT_TRUE(document->ClosePath());
+      EXPECT_STREQ(nameValue.get(), "entity_1");
+
+      double posValue[3] = {};
+      ASSERT_TRUE(document->OpenPath(pos));
+      EXPECT_TRUE(document->GetDoubleArray(pos.GetName(), posValue, 3));
+      EXPECT_TRUE(document->ClosePath());
+      EXPECT_EQ(posValue[2], 9.0);
+
+      // An array element, its name is not used
+      Serializer::s_size version = 0;
+      ASSERT_TRUE(document->OpenPath(entity));
+      EXPECT_TRUE(document->OpenEntry(entity.GetName(), &version));
+      EXPECT_TRUE(document->OpenEntry(GET_NAME(transform), &version));
+      EXPECT_TRUE(document->GetDouble(GET_NAME(scale), &scaleValue));
+      EXPECT_TRUE(document->CloseEntry());
+      EXPECT_TRUE(document->CloseEntry());
+      EXPECT_TRUE(document->ClosePath());
+      EXPECT_EQ(version, 2u);
+      EXPECT_EQ(scaleValue, 2.5);
+
+      // Back at the root
+      EXPECT_TRUE(document->GetInt(GET_NAME(speed), &speedValue));
+    }
+  }
+
+  // A change resolves it again
+  EXPECT_TRUE(parser->Clear());
+  EXPECT_TRUE(parser->SetInt(SET_NAME(other), 1));
+  EXPECT_FALSE(parser->OpenPath(speed));
+  EXPECT_TRUE(parser->SetInt(SET_NAME(speed), 8));
+
+  int speedValue = 0;
+  ASSERT_TRUE(parser->OpenPath(speed));
+  EXPECT_TRUE(parser->GetInt(speed.GetName(), &speedValue));
+  EXPECT_TRUE(parser->ClosePath());
+  EXPECT_EQ(speedValue, 8);
+
+  // Paths that lead nowhere
+  Serializer::PathQuery missing;
+  ASSERT_TRUE(Serializer::PathQuery::Compile("entities/9/name", &missing));
+  EXPECT_FALSE(serializer->OpenPath(missing));
+  ASSERT_TRUE(Serializer::PathQuery::Compile("speed/value", &missing));
+  EXPECT_FALSE(serializer->OpenPath(missing));
+}
+
+TEST(PathQueryTest, compile) {
+  Serializer::PathQuery query;
+
+  ASSERT_TRUE(Serializer::PathQuery::Compile("/a~1b/~0c//12", &query));
+  ASSERT_EQ(query.GetSteps().size(), 4u);
+  EXPECT_EQ(query.GetSteps()[0].m_name, "a/b");
+  EXPECT_EQ(query.GetSteps()[1].m_name, "~c");
+  EXPECT_EQ(query.GetSteps()[2].m_name, "");
+  EXPECT_EQ(query.GetSteps()[3].m_index, 12u);
+  EXPECT_STREQ(query.GetName(), "12");
+
+  ASSERT_TRUE(Serializer::PathQuery::Compile("a.01/b", &query));
+  ASSERT_EQ(query.GetSteps().size(), 3u);
+  EXPECT_EQ(query.GetSteps()[1].m_index, Serializer::PathQuery::kNoIndex);
+
+  EXPECT_FALSE(Serializer::PathQuery::Compile("", &query));
+  EXPECT_FALSE(Serializer::PathQuery::Compile("a..b", &query));
+  EXPECT_FALSE(Serializer::PathQuery::Compile("a/", &query));
+  EXPECT_FALSE(Serializer::PathQuery::Compile("/a~2", &query));
+}
+
+/* RecursiveStruct described with reflection instead of written by hand */
+class ReflectedStruct
+    : public Serializer::ISerializableReflected<ReflectedStruct> {
+public:
+  std::string m_someText;
+  int m_anInt = 0;
+  double m_aDouble = 0.0;
+  bool m_aBool = false;
+  std::vector<uint64_t> m_someUints;
+
+  std::unique_ptr<ReflectedStruct> m_aPtr;
+
+  REFLECT_FIELDS(0, REFLECT_FIELD(ReflectedStruct, m_someText),
+                 REFLECT_FIELD(ReflectedStruct, m_anInt),
+                 REFLECT_FIELD(ReflectedStruct, m_aDouble),
+                 REFLECT_FIELD(ReflectedStruct, m_aBool),
+                 REFLECT_FIELD(ReflectedStruct, m_someUints),
+                 REFLECT_FIELD(ReflectedStruct, m_aPtr))
+
+  void CopyFrom(const RecursiveStruct &other) {
+    m_someText = other.m_someText;
+    m_anInt = other.m_anInt;
+    m_aDouble = other.m_aDouble;
+    m_aBool = other.m_aBool;
+    m_someUints = other.m_someUints;
+
+    m_aPtr.reset();
+    if (other.m_aPtr) {
+      m_aPtr = std::make_unique<ReflectedStruct>();
+      m_aPtr->CopyFrom(*other.m_aPtr);
+    }
+  }
+
+  bool operator==(const RecursiveStruct &other) const {
+    if (m_someText != other.m_someText || m_anInt != other.m_anInt ||
+        m_aDouble != other.m_aDouble || m_aBool != other.m_aBool ||
+        m_someUints != other.m_someUints) {
+      return false;
+    }
+    if (m_aPtr && other.m_aPtr) {
+      return *m_aPtr == *other.m_aPtr;
+    }
+    return !m_aPtr && !other.m_aPtr;
+  }
+};
+
+/* Every other kind of member reflection supports */
+struct ReflectedKinds {
+  short m_aShort = 0;
+  uint8_t m_aByte = 0;
+  float m_aFloat = 0.0f;
+  std::vector<bool> m_someBools;
+  std::vector<std::string> m_someTexts;
+  std::vector<int> m_someInts;
+  std::vector<uint8_t> m_someBytes;
+  std::vector<std::byte> m_someRawBytes;
+  std::vector<ReflectedKinds> m_children;
+
+  REFLECT_FIELDS(3, REFLECT_FIELD(ReflectedKinds, m_aShort),
+                 REFLECT_FIELD(ReflectedKinds, m_aByte),
+                 REFLECT_FIELD(ReflectedKinds, m_aFloat),
+                 REFLECT_FIELD(ReflectedKinds, m_someBools),
+                 REFLECT_FIELD(ReflectedKinds, m_someTexts),
+                 REFLECT_FIELD(ReflectedKinds, m_someInts),
+                 REFLECT_FIELD(ReflectedKinds, m_someBytes),
+                 REFLECT_FIELD(ReflectedKinds, m_someRawBytes),
+                 REFLECT_FIELD(ReflectedKinds, m_children))
+
+  bool operator==(const ReflectedKinds &other) const {
+    return m_aShort == other.m_aShort && m_aByte == other.m_aByte &&
+           m_aFloat == other.m_aFloat && m_someBools == other.m_someBools &&
+           m_someTexts == other.m_someTexts &&
+           m_someInts == other.m_someInts &&
+           m_someBytes == other.m_someBytes &&
+           m_someRawBytes == other.m_someRawBytes &&
+           m_children == other.m_children;
+  }
+};
+
+TYPED_TEST(SerializerTest, reflectedObject) {
+  RecursiveStruct *recTmp = new RecursiveStruct();
+  recTmp->SetRandom("LOWEST\"\n\t");
+
+  RecursiveStruct rec(recTmp);
+  recTmp = nullptr;
+  rec.SetRandom("\"HIGHEST\"");
+
+  ReflectedStruct reflected;
+  reflected.CopyFrom(rec);
+
+  ReflectedKinds kinds;
+  kinds.m_aShort = -12345;
+  kinds.m_aByte = 200;
+  kinds.m_aFloat = 0.25f;
+  kinds.m_someBools = {true, false, false, true};
+  kinds.m_someTexts = {"", "a", "\"quoted\""};
+  kinds.m_someInts = {-1, 2, -3};
+  kinds.m_someBytes = {0, 255, 7, 128, 64};
+  kinds.m_someRawBytes = {std::byte{1}, std::byte{0}, std::byte{254}};
+  kinds.m_children.resize(2);
+  kinds.m_children[1].m_someTexts = {"child"};
+
+  // Templated on the concrete serializer, nothing goes through the vtable
+  TypeParam serializer;
+
+  EXPECT_TRUE(Serializer::SerializeReflected(serializer, SET_NAME(reflected),
+                                             reflected));
+  EXPECT_TRUE(
+      Serializer::SerializeReflected(serializer, SET_NAME(kinds), kinds));
+  EXPECT_TRUE(serializer.Compile()) << "Failed to Compile";
+
+  Serializer::s_size size;
+
+  EXPECT_TRUE(serializer.GetSize(&size)) << "Failed to Get Size of Compile";
+
+  std::unique_ptr<char[]> resp(new char[size]);
+
+  EXPECT_TRUE(serializer.GetText(resp.get())) << "Failed to Get Compile";
+
+  TypeParam serializerNormal;
+
+  EXPECT_TRUE(serializerNormal.ParseText(resp.get(), size))
+      << "Failed to Parse Compile";
+
+  // Same layout as the hand written serialization
+  std::unique_ptr<RecursiveStruct> rec_resp =
+      RecursiveStruct::Deserialize(&serializerNormal, GET_NAME(reflected));
+  ASSERT_TRUE(rec_resp) << "Failed to Deserialize by hand";
+  EXPECT_TRUE(rec == *rec_resp);
+
+  std::unique_ptr<ReflectedStruct> reflected_resp =
+      Serializer::DeserializeReflected<ReflectedStruct>(serializerNormal,
+                                                        GET_NAME(reflected));
+  ASSERT_TRUE(reflected_resp) << "Failed to Deserialize reflected";
+  EXPECT_TRUE(*reflected_resp == rec);
+
+  ReflectedKinds kinds_resp;
+  EXPECT_TRUE(Serializer::DeserializeReflected(serializerNormal,
+                                               GET_NAME(kinds), &kinds_resp));
+  EXPECT_TRUE(kinds_resp == kinds);
+
+  // Through the interface
+  std::unique_ptr<Serializer::ISerializer> serializerVirtual(
+      this->GetSerializer());
+  EXPECT_TRUE(
+      reflected.Serialize(serializerVirtual.get(), SET_NAME(reflected)));
+  reflected_resp = ReflectedStruct::Deserialize(serializerVirtual.get(),
+                                                GET_NAME(reflected));
+  ASSERT_TRUE(reflected_resp) << "Failed to Deserialize through interface";
+  EXPECT_TRUE(*reflected_resp == rec);
+
+  // Another version or values that don't fit are rejected
+  EXPECT_TRUE(serializer.Clear());
+  EXPECT_TRUE(serializer.SetEntry(SET_NAME(kinds), 4));
+  EXPECT_TRUE(serializer.CloseEntry());
+  EXPECT_FALSE(Serializer::DeserializeReflected(serializer, GET_NAME(kinds),
+                                                &kinds_resp));
+
+  EXPECT_TRUE(serializer.SetEntry(SET_NAME(big), 3));
+  EXPECT_TRUE(serializer.SetInt(SET_NAME(m_aShort), 1 << 20));
+  EXPECT_TRUE(serializer.CloseEntry());
+  EXPECT_FALSE(Serializer::DeserializeReflected(serializer, GET_NAME(big),
+                                                &kinds_resp));
+}
+
+TEST(MessagePackSerializerTest, wireFormat) {
+  Serializer::MessagePackSerializer serializer;
+
+  EXPECT_TRUE(serializer.SetInt(SET_NAME(a), 1));
+  EXPECT_TRUE(serializer.SetEntry(SET_NAME(e), 2));
+  EXPECT_TRUE(serializer.SetInt(SET_NAME(n), -1));
+  EXPECT_TRUE(serializer.CloseEntry());
+  EXPECT_TRUE(serializer.SetString(SET_NAME(s), "hi", 2));
+  EXPECT_TRUE(serializer.Compile());
+
+  // Maps of 3 and 2 members (the version is one), fixint and fixstr values
+  const std::string expected = "\x83\xA1"
+                               "a\x01\xA1"
+                               "e\x82\xAB__VERSION__\x02\xA1"
+                               "n\xFF\xA1"
+                               "s\xA2"
+                               "hi";
+
+  std::string_view view;
+  EXPECT_TRUE(serializer.GetView(&view));
+  EXPECT_EQ(view, expected);
+
+  // Written by other tools: a map without version and a float 32
+  const char otherText[] = "\x81\xA1"
+                          "m\x81\xA1"
+                          "x\xCA\x3F\xC0\x00\x00";
+  const std::string other(otherText, sizeof(otherText) - 1);
+
+  Serializer::s_size version;
+  double value;
+
+  EXPECT_TRUE(serializer.ParseText(other.data(), other.size()));
+  EXPECT_TRUE(serializer.OpenEntry("m", &version));
+  EXPECT_EQ(version, 0u);
+  EXPECT_TRUE(serializer.GetDouble("x", &value));
+  EXPECT_EQ(value, 1.5);
+  EXPECT_TRUE(serializer.CloseEntry());
+
+  // Extension types are not supported
+  const char extensionText[] = "\x81\xA1"
+                              "x\xD4\x01\x00";
+  const std::string extension(extensionText, sizeof(extensionText) - 1);
+  EXPECT_FALSE(serializer.ParseText(extension.data(), extension.size()));
+}
+
+TEST(FlatSerializerTest, mappedFile) {
+  Serializer::FlatSerializer serializer;
+  const std::string hola = "hola";
+
+  EXPECT_TRUE(serializer.SetEntry(SET_NAME(world), 3));
+  EXPECT_TRUE(serializer.SetString(SET_NAME(name), hola.c_str(), hola.size()));
+  EXPECT_TRUE(serializer.SetArray(SET_NAME(numbers)));
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(serializer.SetInt(nullptr, 0, i));
+  }
+  EXPECT_TRUE(serializer.CloseArray());
+  EXPECT_TRUE(serializer.CloseEntry());
+  EXPECT_TRUE(serializer.Compile());
+
+  std::string_view image;
+  EXPECT_TRUE(serializer.GetView(&image));
+
+  const FileLoadSystem::path p = std::filesystem::temp_directory_path() /
+                                 "kch_flat_serializer_test.bin";
+  {
+    FileLoadSystem::SmartWriteFile file = FileLoadSystem::OpenWriteBinary(p);
+    ASSERT_TRUE(file.IsValid()) << "Failed to open " << p;
+    ASSERT_EQ(FileLoadSystem::Fwrite(image.data(), sizeof(char), image.size(),
+                                     file.Get()),
+              image.size());
+  }
+
+  FileLoadSystem::MappedFile mapped;
+  ASSERT_TRUE(mapped.Open(p)) << "Failed to map " << p;
+
+  Serializer::FlatSerializer reader;
+  EXPECT_TRUE(reader.ParseText(mapped.Data(), mapped.Size()));
+  EXPECT_TRUE(reader.Verify());
+
+  Serializer::s_size version;
+  std::string_view name;
+  int numbers[100];
+
+  EXPECT_TRUE(reader.OpenEntry(GET_NAME(world), &version));
+  EXPECT_EQ(version, 3u);
+  EXPECT_TRUE(reader.GetStringView(GET_NAME(name), &name));
+  EXPECT_EQ(name, hola);
+  EXPECT_TRUE(reader.GetIntArray(GET_NAME(numbers), numbers, 100));
+  EXPECT_EQ(numbers[99], 99);
+
+  // Read in place, nothing was copied
+  EXPECT_GE(name.data(), mapped.Data());
+  EXPECT_LT(name.data(), mapped.Data() + mapped.Size());
+
+  // The first Set copies the image, so it can be unmapped
+  EXPECT_TRUE(reader.SetInt(SET_NAME(late), 1));
+  EXPECT_TRUE(reader.CloseEntry());
+  mapped.Close();
+  EXPECT_TRUE(reader.OpenEntry(GET_NAME(world), &version));
+  EXPECT_TRUE(reader.GetStringView(GET_NAME(name), &name));
+  EXPECT_EQ(name, hola);
+  EXPECT_TRUE(reader.CloseEntry());
+
+  FileLoadSystem::error_status error;
+  FileLoadSystem::Remove(p, error);
+
+  // Only whole images of this machine are read
+  EXPECT_FALSE(reader.ParseText(image.data(), image.size() - 1));
+  std::vector<char> other(image.begin(), image.end());
+  other[Serializer::FlatSerializer::kHeaderSize - 1] ^= 1;
+  EXPECT_FALSE(reader.ParseText(other.data(), other.size()));
+}
+
+TEST(FlatSerializerTest, corruptedImage) {
+  Serializer::FlatSerializer serializer;
+
+  // Nodes: root, pair, its two elements and last
+  EXPECT_TRUE(serializer.SetArray(SET_NAME(pair)));
+  EXPECT_TRUE(serializer.SetInt(nullptr, 0, 1));
+  EXPECT_TRUE(serializer.SetInt(nullptr, 0, 2));
+  EXPECT_TRUE(serializer.CloseArray());
+  EXPECT_TRUE(serializer.SetInt(SET_NAME(last), 3));
+  EXPECT_TRUE(serializer.Compile());
+
+  std::string_view image;
+  EXPECT_TRUE(serializer.GetView(&image));
+
+  const size_t headerSize = Serializer::FlatSerializer::kHeaderSize;
+  std::uint32_t nodeSize;
+  std::memcpy(&nodeSize, image.data() + 4, sizeof(nodeSize));
+
+  // The root is the only node with a 4 (its last child) and a 2 (its count)
+  size_t lastChild = 0;
+  size_t childCount = 0;
+  for (size_t offset = 0; offset < nodeSize; offset += 4) {
+    std::uint32_t field;
+    std::memcpy(&field, image.data() + headerSize + offset, sizeof(field));
+    lastChild = field == 4 ? offset : lastChild;
+    childCount = field == 2 ? offset : childCount;
+  }
+  ASSERT_NE(lastChild, 0u);
+  ASSERT_NE(childCount, 0u);
+
+  // Parse only checks the header, Verify must find the broken field
+  auto verify = [&](size_t node, size_t offset, std::uint32_t value) {
+    std::vector<std::uint64_t> aligned(image.size() / 8 + 1);
+    char *text = reinterpret_cast<char *>(aligned.data());
+    std::memcpy(text, image.data(), image.size());
+    std::memcpy(text + headerSize + node * nodeSize + offset, &value,
+                sizeof(value));
+
+    Serializer::FlatSerializer reader;
+    EXPECT_TRUE(reader.ParseText(text, image.size()));
+    return reader.Verify();
+  };
+
+  EXPECT_TRUE(verify(0, lastChild, 4));
+  EXPECT_FALSE(verify(0, lastChild, 1000000));
+  EXPECT_FALSE(verify(0, lastChild, 1));
+  EXPECT_FALSE(verify(0, lastChild, std::numeric_limits<std::uint32_t>::max()));
+  EXPECT_FALSE(verify(4, lastChild, 1));
+  EXPECT_FALSE(verify(4, childCount, 1));
+}
+
+TEST(TreeSerializerTest, deltaRoundTrip) {
+  // A world with a few units, then a frame later
+  auto write = [](Serializer::ISerializer *serializer, bool later) {
+    EXPECT_TRUE(serializer->SetInt(SET_NAME(frame), later ? 2 : 1));
+    EXPECT_TRUE(serializer->SetEntry(SET_NAME(world), later ? 4 : 3));
+    EXPECT_TRUE(serializer->SetString(SET_NAME(name), "arena", 5));
+    if (!later) {
+      EXPECT_TRUE(serializer->SetBool(SET_NAME(paused), true));
+    }
+    EXPECT_TRUE(serializer->SetArray(SET_NAME(units)));
+    for (int i = 0; i < 1000; i++) {
+      EXPECT_TRUE(serializer->SetInt(nullptr, 0, i));
+      if (later && i == 500) {
+        EXPECT_TRUE(serializer->SetInt(nullptr, 0, -1));
+      }
+    }
+    EXPECT_TRUE(serializer->CloseArray());
+    EXPECT_TRUE(serializer->CloseEntry());
+    if (later) {
+      EXPECT_TRUE(serializer->SetDouble(SET_NAME(speed), 1.5));
+    }
+  };
+
+  Serializer::BinarySerializer baseline;
+  Serializer::BinarySerializer current;
+  write(&baseline, false);
+  write(&current, true);
+
+  Serializer::BinarySerializer delta;
+  EXPECT_TRUE(current.Diff(baseline, &delta));
+  EXPECT_FALSE(current.Diff(baseline, &current));
+
+  std::string_view full;
+  std::string_view small;
+  EXPECT_TRUE(current.Compile());
+  EXPECT_TRUE(current.GetView(&full));
+  EXPECT_TRUE(delta.Compile());
+  EXPECT_TRUE(delta.GetView(&small));
+  EXPECT_LT(small.size() * 4, full.size());
+
+  // Sent as any other document
+  Serializer::BinarySerializer received;
+  EXPECT_TRUE(received.ParseText(small.data(), small.size()));
+
+  EXPECT_TRUE(baseline.ApplyDelta(received));
+  EXPECT_TRUE(baseline.Compile());
+
+  std::string_view applied;
+  EXPECT_TRUE(baseline.GetView(&applied));
+  EXPECT_EQ(applied, full);
+
+  // Nothing changed, nothing to send
+  EXPECT_TRUE(current.Diff(baseline, &delta));
+  Serializer::s_size version;
+  EXPECT_FALSE(delta.OpenEntry("__SET__", &version));
+  EXPECT_FALSE(delta.OpenEntry("__ENTRIES__", &version));
+
+  // Members of an entry in another order are not a change either
+  Serializer::BinarySerializer ordered;
+  Serializer::BinarySerializer reordered;
+  for (Serializer::BinarySerializer *serializer : {&ordered, &reordered}) {
+    const bool swapped = serializer == &reordered;
+    EXPECT_TRUE(serializer->SetEntry(SET_NAME(world), 3));
+    EXPECT_TRUE(serializer->SetInt(swapped ? "b" : "a", 1, 1));
+    EXPECT_TRUE(serializer->SetInt(swapped ? "a" : "b", 1, 1));
+    EXPECT_TRUE(serializer->CloseEntry());
+    EXPECT_TRUE(serializer->SetInt(SET_NAME(frame), swapped ? 2 : 1));
+  }
+  EXPECT_TRUE(reordered.Diff(ordered, &delta));
+  EXPECT_FALSE(delta.OpenEntry("__ENTRIES__", &version));
+  EXPECT_TRUE(delta.OpenEntry("__SET__", &version));
+  EXPECT_TRUE(delta.CloseEntry());
+
+  // A broken delta leaves the document as it was
+  Serializer::BinarySerializer broken;
+  EXPECT_TRUE(broken.SetEntry(SET_NAME(__ARRAYS__), 0));
+  EXPECT_TRUE(broken.SetEntry(SET_NAME(frame), 0));
+  EXPECT_TRUE(broken.SetUint(SET_NAME(__AT__), 1000));
+  EXPECT_TRUE(broken.CloseEntry());
+  EXPECT_TRUE(broken.CloseEntry());
+  EXPECT_FALSE(baseline.ApplyDelta(broken));
+  EXPECT_TRUE(baseline.Compile());
+  EXPECT_TRUE(baseline.GetView(&applied));
+  EXPECT_EQ(applied, full);
+}
+
+TEST(TreeSerializerTest, deepNesting) {
+  constexpr std::uint32_t kDepth = Serializer::TreeSerializer::kMaxParseDepth;
+
+  // An array in an array... as a, with a null at the bottom
+  auto binary = [](std::uint32_t depth) {
+    std::string body = "\x01\x01"
+                       "a";
+    for (std::uint32_t i = 0; i < depth; i++) {
+      body += "\x07\x01";
+    }
+    body += '\0';
+
+    std::string text(Serializer::BinarySerializer::kMagic,
+                     sizeof(Serializer::BinarySerializer::kMagic));
+    for (size_t i = 0; i < sizeof(std::uint64_t); i++) {
+      text += static_cast<char>(static_cast<std::uint64_t>(body.size()) >>
+                                (8 * i));
+    }
+    return text + body;
+  };
+  auto messagePack = [](std::uint32_t depth) {
+    return "\x81\xA1"
+           "a" +
+           std::string(depth, '\x91') + "\xC0";
+  };
+
+  Serializer::BinarySerializer binaryReader;
+  std::string text = binary(kDepth);
+  EXPECT_TRUE(binaryReader.ParseText(text.data(), text.size()));
+  text = binary(kDepth + 1);
+  EXPECT_FALSE(binaryReader.ParseText(text.data(), text.size()));
+  text = binary(1000000);
+  EXPECT_FALSE(binaryReader.ParseText(text.data(), text.size()));
+
+  // Shorter than the magic number
+  EXPECT_FALSE(binaryReader.ParseText("KCH"));
+
+  Serializer::MessagePackSerializer messagePackReader;
+  text = messagePack(kDepth);
+  EXPECT_TRUE(messagePackReader.ParseText(text.data(), text.size()));
+  text = messagePack(kDepth + 1);
+  EXPECT_FALSE(messagePackReader.ParseText(text.data(), text.size()));
+  text = messagePack(1000000);
+  EXPECT_FALSE(messagePackReader.ParseText(text.data(), text.size()));
+}
+
+TEST(JsonStreamSerializerTest, recursiveObject) {
+  RecursiveStruct *recTmp = new RecursiveStruct();
+
+  recTmp->SetRandom("LOWESTaljsdlakjsldasd;;;;;;;;\"\n\t");
+
+  std::unique_ptr<RecursiveStruct> rec =
+      std::make_unique<RecursiveStruct>(recTmp);
+  recTmp = nullptr;
+  rec->SetRandom("\"HIGHEST\"");
+
+  const std::string hola_name = "hola";
+
+  std::FILE *file = std::tmpfile();
+  ASSERT_NE(file, nullptr) << "Failed to open a temporary file";
+
+  {
+    Serializer::FileSink sink(file);
+    Serializer::JsonStreamSerializer serializer(sink);
+
+    EXPECT_TRUE(
+        rec->Serialize(&serializer, hola_name.c_str(), hola_name.length()))
+        << "failed to serialize";
+
+    EXPECT_TRUE(serializer.Compile()) << "Failed to Compile";
+
+    // Nothing can be added to a finished text
+    EXPECT_FALSE(serializer.SetNull(SET_NAME(after)));
+  }
+
+  std::rewind(file);
+
+  std::string compile;
+  char chunk[4096];
+  size_t read;
+  while ((read = std::fread(chunk, sizeof(char), sizeof(chunk), file)) > 0) {
+    compile.append(chunk, read);
+  }
+  std::fclose(file);
+
+  Serializer::JsonSerializer parser;
+
+  EXPECT_TRUE(parser.ParseText(compile.c_str(), compile.length()))
+      << "Failed to Parse Compile\n"
+      << compile;
+
+  std::unique_ptr<RecursiveStruct> rec_resp =
+      RecursiveStruct::Deserialize(&parser, hola_name.c_str());
+
+  EXPECT_TRUE(rec_resp) << "Failed to Deserialize\n" << compile;
+  EXPECT_TRUE(rec_resp && *rec == *rec_resp)
+      << "Failed to Deserialize Correctly\n"
+      << compile;
+}
+
+TEST(JsonPullSerializerTest, recursiveObject) {
+  RecursiveStruct *recTmp = new RecursiveStruct();
+
+  recTmp->SetRandom("LOWESTaljsdlakjsldasd;;;;;;;;\"\n\t");
+
+  recTmp = new RecursiveStruct(recTmp);
+
+  recTmp->SetRandom("\"MIDDLE\"");
+
+  std::unique_ptr<RecursiveStruct> rec =
+      std::make_unique<RecursiveStruct>(recTmp);
+  recTmp = nullptr;
+  rec->SetRandom("\"HIGHEST\"");
+
+  const std::string hola_name = "hola";
+
+  // From Text
+  Serializer::JsonSerializer serializer;
+
+  EXPECT_TRUE(
+      rec->Serialize(&serializer, hola_name.c_str(), hola_name.length()))
+      << "failed to serialize";
+  EXPECT_TRUE(serializer.SetInt(SET_NAME(after), 7));
+
+  EXPECT_TRUE(serializer.CompilePretty()) << "Failed to Pretty Compile";
+
+  Serializer::s_size size;
+
+  EXPECT_TRUE(serializer.GetSize(&size)) << "Failed to Get Size";
+
+  std::unique_ptr<char[]> resp(new char[size]);
+
+  EXPECT_TRUE(serializer.GetText(resp.get())) << "Failed to Get Text";
+
+  std::string compile(resp.get());
+
+  Serializer::JsonPullSerializer parser;
+
+  EXPECT_TRUE(parser.ParseText(resp.get(), static_cast<size_t>(size)))
+      << "Failed to Parse Compile\n"
+      << compile;
+
+  std::unique_ptr<RecursiveStruct> rec_resp =
+      RecursiveStruct::Deserialize(&parser, hola_name.c_str());
+
+  EXPECT_TRUE(rec_resp) << "Failed to Deserialize\n" << compile;
+  EXPECT_TRUE(rec_resp && *rec == *rec_resp)
+      << "Failed to Deserialize Correctly\n"
+      << compile;
+
+  int after = 0;
+  EXPECT_TRUE(parser.GetInt(GET_NAME(after), &after));
+  EXPECT_EQ(after, 7);
+
+  // Forward only, it was already read
+  Serializer::s_size version;
+  EXPECT_FALSE(parser.OpenEntry(hola_name.c_str(), &version));
+
+  // From File
+  std::FILE *file = std::tmpfile();
+  ASSERT_NE(file, nullptr) << "Failed to open a temporary file";
+
+  ASSERT_EQ(std::fwrite(compile.data(), sizeof(char), compile.length(), file),
+            compile.length());
+  std::rewind(file);
+
+  EXPECT_TRUE(parser.ParseFile(file)) << "Failed to Parse File";
+
+  rec_resp = RecursiveStruct::Deserialize(&parser, hola_name.c_str());
+
+  EXPECT_TRUE(rec_resp) << "Failed to Deserialize from File\n" << compile;
+  EXPECT_TRUE(rec_resp && *rec == *rec_resp)
+      << "Failed to Deserialize Correctly from File\n"
+      << compile;
+
+  parser.Clear();
+  std::fclose(file);
+
+  // Nothing can be written
+  EXPECT_FALSE(parser.SetNull(SET_NAME(after)));
+  EXPECT_FALSE(parser.Compile());
+}
+
+TEST(JsonPullSerializerTest, arraysAreWalked) {
+  const int ints[] = {4, -5, 6};
+
+  Serializer::JsonSerializer serializer;
+  EXPECT_TRUE(serializer.SetIntArray(SET_NAME(ints), ints, 3));
+  EXPECT_TRUE(serializer.SetArray(SET_NAME(names)));
+  for (const char *name : {"a", "b"}) {
+    EXPECT_TRUE(serializer.SetString(nullptr, 0, name, 1));
+  }
+  EXPECT_TRUE(serializer.CloseArray());
+  EXPECT_TRUE(serializer.SetIntArray(SET_NAME(longer), ints, 3));
+  EXPECT_TRUE(serializer.Compile()) << "Failed to Compile";
+
+  Serializer::s_size size;
+  EXPECT_TRUE(serializer.GetSize(&size)) << "Failed to Get Size";
+  std::unique_ptr<char[]> text(new char[size]);
+  EXPECT_TRUE(serializer.GetText(text.get())) << "Failed to Get Text";
+
+  Serializer::JsonPullSerializer parser;
+  EXPECT_TRUE(parser.ParseText(text.get())) << text.get();
+
+  // Not counted ahead, so the bulk Get reads until the end
+  EXPECT_FALSE(parser.GetArrayCapacity(GET_NAME(ints), &size));
+  int result[3] = {};
+  EXPECT_TRUE(parser.GetIntArray(GET_NAME(ints), result, 3));
+  EXPECT_EQ(std::vector<int>(result, result + 3),
+            std::vector<int>(ints, ints + 3));
+
+  std::vector<std::string> names;
+  EXPECT_TRUE(parser.OpenArray(GET_NAME(names)));
+  while (parser.CanMoveArray()) {
+    std::string_view name;
+    EXPECT_TRUE(parser.GetStringView(nullptr, &name));
+    names.emplace_back(name);
+    EXPECT_TRUE(parser.MoveArray());
+  }
+  EXPECT_FALSE(parser.MoveArray());
+  EXPECT_TRUE(parser.CloseArray());
+  EXPECT_EQ(names, std::vector<std::string>({"a", "b"}));
+
+  // An array with more elements than asked is not taken
+  EXPECT_FALSE(parser.GetIntArray(GET_NAME(longer), result, 2));
+}
+
+TEST(JsonSerializerTest, parseInsitu) {
+  Serializer::JsonSerializer serializer;
+
+  const std::string hola = "sdfsd fsdfsdf \"sdfsdf\",s,s ,s,s\n\t";
+  const std::string hola_name = "hola";
+
+  EXPECT_TRUE(serializer.SetString(hola_name.c_str(), hola_name.length(),
+                                   hola.c_str(), hola.length()));
+  EXPECT_TRUE(serializer.SetArray(SET_NAME(strings)));
+  EXPECT_TRUE(serializer.SetString(nullptr, 0, hola.c_str(), hola.length()));
+  EXPECT_TRUE(serializer.CloseArray());
+
+  EXPECT_TRUE(serializer.Compile()) << "Failed to Compile";
+
+  Serializer::s_size size;
+
+  EXPECT_TRUE(serializer.GetSize(&size)) << "Failed to Get Size of Compile";
+
+  // Length excludes the null terminator, the buffer has room for it
+  std::unique_ptr<char[]> buffer(new char[size]);
+
+  EXPECT_TRUE(serializer.GetText(buffer.get())) << "Failed to Get Compile";
+
+  std::string compile(buffer.get());
+
+  Serializer::JsonSerializer parser;
+
+  EXPECT_TRUE(parser.ParseInsitu(buffer.get(), compile.length()))
+      << "Failed to Parse in situ\n"
+      << compile;
+
+  std::string_view hola_view;
+
+  EXPECT_TRUE(parser.GetStringView(hola_name.c_str(), &hola_view));
+  EXPECT_EQ(hola_view, hola);
+
+  // Decoded inside the buffer, not copied
+  EXPECT_GE(hola_view.data(), buffer.get());
+  EXPECT_LT(hola_view.data(), buffer.get() + size);
+
+  EXPECT_TRUE(parser.OpenArray(GET_NAME(strings)));
+  EXPECT_TRUE(parser.GetStringView(nullptr, &hola_view));
+  EXPECT_EQ(hola_view, hola);
+  EXPECT_TRUE(parser.CloseArray());
+}
+
+TEST(JsonSerializerTest, wideObjectLookup) {
+  constexpr int kMembers = 200;
+
+  for (Serializer::s_size threshold :
+       {Serializer::JsonSerializer::kDefaultMemberIndexThreshold,
+        static_cast<Serializer::s_size>(0),
+        Serializer::JsonSerializer::kNoMemberIndex}) {
+    Serializer::JsonSerializer serializer;
+    serializer.SetMemberIndexThreshold(threshold);
+
+    EXPECT_TRUE(serializer.SetEntry(SET_NAME(wide), 1));
+    for (int i = 0; i < kMembers; i++) {
+      const std::string name = "member_" + std::to_string(i);
+      EXPECT_TRUE(serializer.SetInt(name.c_str(), name.length(), i));
+    }
+    EXPECT_TRUE(serializer.CloseEntry());
+
+    Serializer::s_size version;
+    int value;
+
+    EXPECT_TRUE(serializer.OpenEntry(GET_NAME(wide), &version));
+    // Looked up backwards, so a linear scan would be quadratic
+    for (int i = kMembers - 1; i >= 0; i--) {
+      const std::string name = "member_" + std::to_string(i);
+      EXPECT_TRUE(serializer.IsInt(name.c_str())) << name;
+      EXPECT_TRUE(serializer.GetInt(name.c_str(), &value)) << name;
+      EXPECT_EQ(value, i) << name;
+    }
+    EXPECT_FALSE(serializer.IsInt("member_"));
+    EXPECT_FALSE(serializer.GetInt("missing", &value));
+
+    // Members added after the lookups are found too
+    EXPECT_TRUE(serializer.SetInt(SET_NAME(late), -1));
+    EXPECT_TRUE(serializer.GetInt(GET_NAME(late), &value));
+    EXPECT_EQ(value, -1);
+    EXPECT_TRUE(serializer.GetInt("member_0", &value));
+    EXPECT_EQ(value, 0);
+    EXPECT_TRUE(serializer.CloseEntry());
+  }
+}
+
+TEST(JsonSerializerTest, arenaReset) {
+  constexpr int kFrames = 10;
+  const std::string text(100, 'a');
+
+  Serializer::JsonSerializer serializer;
+  serializer.SetArenaReset(true);
+
+  size_t growths = 0;
+  for (int frame = 0; frame < kFrames; frame++) {
+    EXPECT_TRUE(serializer.Clear());
+    EXPECT_EQ(serializer.GetArenaStats().m_used, 0u);
+
+    for (int i = 0; i < 1000; i++) {
+      const std::string name = "member_" + std::to_string(i);
+      EXPECT_TRUE(serializer.SetString(name.c_str(), name.length(),
+                                       text.c_str(), text.length()));
+    }
+    EXPECT_TRUE(serializer.Compile());
+
+    // Only the first frames grow the arena, then it is reused
+    const Serializer::JsonSerializer::ArenaStats stats =
+        serializer.GetArenaStats();
+    if (frame > 1) {
+      EXPECT_EQ(stats.m_growths, growths);
+    }
+    growths = stats.m_growths;
+  }
+
+  const Serializer::JsonSerializer::ArenaStats stats =
+      serializer.GetArenaStats();
+  EXPECT_EQ(stats.m_resets, static_cast<size_t>(kFrames));
+  EXPECT_LE(stats.m_used, stats.m_capacity);
+}
+
+TEST(JsonSerializerTest, arenaUserMemory) {
+  alignas(8) static char buffer[64 * 1024];
+  Serializer::JsonSerializer::AllocatorType allocator;
+
+  Serializer::JsonSerializer buffered(buffer, sizeof(buffer));
+  Serializer::JsonSerializer allocated(&allocator);
+
+  for (Serializer::JsonSerializer *serializer : {&buffered, &allocated}) {
+    int value;
+    Serializer::s_size version;
+
+    for (int frame = 0; frame < 3; frame++) {
+      EXPECT_TRUE(serializer->Clear());
+      EXPECT_EQ(serializer->GetArenaStats().m_used, 0u);
+
+      EXPECT_TRUE(serializer->SetEntry(SET_NAME(entry), 1));
+      EXPECT_TRUE(serializer->SetInt(SET_NAME(frame), frame));
+      EXPECT_TRUE(serializer->CloseEntry());
+      EXPECT_GT(serializer->GetArenaStats().m_used, 0u);
+
+      EXPECT_TRUE(serializer->OpenEntry(GET_NAME(entry), &version));
+      EXPECT_TRUE(serializer->GetInt(GET_NAME(frame), &value));
+      EXPECT_EQ(value, frame);
+      EXPECT_TRUE(serializer->CloseEntry());
+    }
+    EXPECT_EQ(serializer->GetArenaStats().m_growths, 0u);
+  }
+
+  // What was stored went to the user's memory
+  EXPECT_GT(allocator.Size(), 0u);
+  EXPECT_TRUE(allocated.Clear());
+  EXPECT_EQ(allocator.Size(), 0u);
+}
+
+TEST(JsonSerializerTest, namesAreCopied) {
+  // A buffer reused for every name, like one filled by snprintf
+  char name[64];
+  Serializer::JsonSerializer serializer;
+  std::unique_ptr<Serializer::JsonSerializer> child = serializer.Fork();
+
+  for (int i = 0; i < 3; i++) {
+    const int length =
+        std::snprintf(name, sizeof(name), "a_member_with_a_long_name_%d", i);
+    const Serializer::s_size name_length =
+        static_cast<Serializer::s_size>(length);
+    EXPECT_TRUE(serializer.SetInt(name, name_length, i));
+    EXPECT_TRUE(child->SetInt(name, name_length, i + 10));
+  }
+  std::memset(name, 'x', sizeof(name) - 1);
+  name[sizeof(name) - 1] = '\0';
+
+  for (int i = 0; i < 3; i++) {
+    const std::string original =
+        "a_member_with_a_long_name_" + std::to_string(i);
+    int value = -1;
+    EXPECT_TRUE(serializer.GetInt(original.c_str(), &value));
+    EXPECT_EQ(value, i);
+    EXPECT_TRUE(child->GetInt(original.c_str(), &value));
+    EXPECT_EQ(value, i + 10);
+  }
+}
+
+TEST(JsonSerializerTest, lazyParse) {
+  Serializer::JsonSerializer serializer;
+  const int numbers[] = {1, 2, 3};
+
+  EXPECT_TRUE(serializer.SetInt(SET_NAME(top), 7));
+  EXPECT_TRUE(serializer.SetEntry(SET_NAME(outer), 1));
+  EXPECT_TRUE(serializer.SetInt(SET_NAME(value), 8));
+  EXPECT_TRUE(serializer.SetEntry(SET_NAME(inner), 2));
+  EXPECT_TRUE(serializer.SetString(SET_NAME(text), "a \"b\" {c}", 9));
+  EXPECT_TRUE(serializer.CloseEntry());
+  EXPECT_TRUE(serializer.CloseEntry());
+  EXPECT_TRUE(serializer.SetIntArray(SET_NAME(numbers), numbers, 3));
+  EXPECT_TRUE(serializer.Compile());
+
+  Serializer::s_size size;
+  EXPECT_TRUE(serializer.GetSize(&size));
+  std::unique_ptr<char[]> buffer(new char[size]);
+  EXPECT_TRUE(serializer.GetText(buffer.get()));
+  const std::string compile(buffer.get());
+
+  Serializer::JsonSerializer parser;
+  EXPECT_TRUE(parser.ParseTextLazy(compile.c_str(), compile.length()));
+
+  Serializer::s_size version;
+  int value;
+  std::string_view text;
+
+  EXPECT_TRUE(parser.GetInt(GET_NAME(top), &value));
+  EXPECT_EQ(value, 7);
+  EXPECT_TRUE(parser.OpenEntry(GET_NAME(outer), &version));
+  EXPECT_EQ(version, 1u);
+  EXPECT_TRUE(parser.GetInt(GET_NAME(value), &value));
+  EXPECT_EQ(value, 8);
+  EXPECT_TRUE(parser.OpenEntry(GET_NAME(inner), &version));
+  EXPECT_EQ(version, 2u);
+  EXPECT_TRUE(parser.GetStringView(GET_NAME(text), &text));
+  EXPECT_EQ(text, "a \"b\" {c}");
+  EXPECT_TRUE(parser.CloseEntry());
+  EXPECT_TRUE(parser.CloseEntry());
+
+  int result[3];
+  EXPECT_TRUE(parser.GetIntArray(GET_NAME(numbers), result, 3));
+  EXPECT_EQ(result[2], 3);
+
+  // Whatever was not touched is parsed to compile
+  EXPECT_TRUE(parser.ParseTextLazy(compile.c_str(), compile.length()));
+  EXPECT_TRUE(parser.Compile());
+  EXPECT_TRUE(parser.GetText(buffer.get()));
+  EXPECT_EQ(std::string(buffer.get()), compile);
+
+  // A broken section is only found when it is touched
+  const std::string broken =
+      R"({"good": {"__VERSION__": 0, "a": 1},)"
+      R"( "bad": {"__VERSION__": 0, "b": [1, x]}})";
+  EXPECT_TRUE(parser.ParseTextLazy(broken.c_str(), broken.length()));
+  EXPECT_TRUE(parser.OpenEntry("good", &version));
+  EXPECT_TRUE(parser.GetInt("a", &value));
+  EXPECT_TRUE(parser.CloseEntry());
+  EXPECT_TRUE(parser.OpenEntry("bad", &version));
+  EXPECT_FALSE(parser.IsArray("b"));
+  EXPECT_TRUE(parser.CloseEntry());
+
+  const std::string invalid = R"({"a": 1,})";
+  EXPECT_FALSE(parser.ParseTextLazy(invalid.c_str(), invalid.length()));
+}
+
+TEST(ParallelSerializerTest, sameAsSequential) {
+  constexpr size_t kObjects = 37;
+
+  std::vector<std::unique_ptr<RecursiveStruct>> objects;
+  std::vector<std::string> names;
+  for (size_t i = 0; i < kObjects; i++) {
+    objects.push_back(std::make_unique<RecursiveStruct>());
+    objects.back()->SetRandom("parallel");
+    names.push_back("rec_" + std::to_string(i));
+  }
+
+  auto fill = [&objects, &names](Serializer::JsonSerializer &child,
+                                 size_t i) {
+    return objects[i]->Serialize(&child, names[i].c_str(), names[i].length());
+  };
+
+  // Sequential
+  Serializer::JsonSerializer sequential;
+  EXPECT_TRUE(sequential.SetEntry(SET_NAME(level), 1));
+  for (size_t i = 0; i < kObjects; i++) {
+    EXPECT_TRUE(fill(sequential, i));
+  }
+  EXPECT_TRUE(sequential.CloseEntry());
+  EXPECT_TRUE(sequential.Compile());
+
+  Serializer::s_size size;
+  EXPECT_TRUE(sequential.GetSize(&size));
+  std::unique_ptr<char[]> expected(new char[size]);
+  EXPECT_TRUE(sequential.GetText(expected.get()));
+
+  // Fork and Splice
+  Serializer::JsonSerializer parallel;
+  EXPECT_TRUE(parallel.SetEntry(SET_NAME(level), 1));
+  EXPECT_TRUE(Serializer::SerializeParallel(parallel, kObjects, fill, 4));
+  EXPECT_TRUE(parallel.CloseEntry());
+  EXPECT_TRUE(parallel.Compile());
+
+  EXPECT_TRUE(parallel.GetSize(&size));
+  std::unique_ptr<char[]> text(new char[size]);
+  EXPECT_TRUE(parallel.GetText(text.get()));
+  EXPECT_STREQ(expected.get(), text.get());
+
+  // Compiled fragments written to a stream
+  std::FILE *file = std::tmpfile();
+  ASSERT_NE(file, nullptr) << "Failed to open a temporary file";
+
+  {
+    Serializer::FileSink sink(file);
+    Serializer::JsonStreamSerializer stream(sink);
+
+    EXPECT_TRUE(stream.SetEntry(SET_NAME(level), 1));
+    EXPECT_TRUE(Serializer::SerializeParallel(stream, kObjects, fill, 4));
+    EXPECT_TRUE(stream.CloseEntry());
+    EXPECT_TRUE(stream.Compile());
+  }
+
+  std::rewind(file);
+
+  std::string compile;
+  char chunk[4096];
+  size_t read;
+  while ((read = std::fread(chunk, sizeof(char), sizeof(chunk), file)) > 0) {
+    compile.append(chunk, read);
+  }
+  std::fclose(file);
+
+  EXPECT_EQ(compile, expected.get());
+}
+
+/* RecursiveStruct that tracks its changes and counts its serializations */
+class TrackedStruct : public Serializer::ISerializableImpl<TrackedStruct>,
+                      public Serializer::DirtyTracking {
+public:
+  std::unique_ptr<RecursiveStruct> m_data = std::make_unique<RecursiveStruct>();
+  size_t m_serializeCount = 0;
+
+  bool Serialize(Serializer::ISerializer *serializer, const char *name,
+                 Serializer::s_size name_length) override {
+    ++m_serializeCount;
+    return m_data->Serialize(serializer, name, name_length);
+  }
+
+  static std::unique_ptr<TrackedStruct>
+  Deserialize(const Serializer::ISerializer *serializer, const char *name) {
+    std::unique_ptr<TrackedStruct> object = std::make_unique<TrackedStruct>();
+    object->m_data = RecursiveStruct::Deserialize(serializer, name);
+    return object->m_data ? std::move(object) : nullptr;
+  }
+};
+
+TEST(IncrementalSaveTest, onlyDirtyObjects) {
+  constexpr size_t kObjects = 10;
+
+  std::vector<TrackedStruct> objects(kObjects);
+  std::vector<std::string> names;
+  for (size_t i = 0; i < kObjects; i++) {
+    objects[i].m_data->SetRandom("tracked");
+    names.push_back("rec_" + std::to_string(i));
+  }
+  RecursiveStruct untracked;
+  untracked.SetRandom("untracked");
+
+  Serializer::IncrementalSave save;
+
+  auto incremental = [&](std::string *text) {
+    text->clear();
+    Serializer::StringSink sink(*text);
+    Serializer::JsonStreamSerializer stream(sink);
+
+    bool res = stream.SetEntry(SET_NAME(level), 1);
+    for (size_t i = 0; res && i < kObjects; i++) {
+      res = save.Save(stream, objects[i], names[i].c_str(), names[i].length());
+    }
+    res = res && save.Save(stream, untracked, SET_NAME(untracked));
+    return stream.CloseEntry() && stream.Compile() && res;
+  };
+
+  auto full = [&](std::string *text) {
+    Serializer::JsonSerializer serializer;
+
+    bool res = serializer.SetEntry(SET_NAME(level), 1);
+    for (size_t i = 0; res && i < kObjects; i++) {
+      res = objects[i].m_data->Serialize(&serializer, names[i].c_str(),
+                                         names[i].length());
+    }
+    res = res && untracked.Serialize(&serializer, SET_NAME(untracked));
+
+    std::string_view view;
+    res = serializer.CloseEntry() && serializer.Compile() &&
+          serializer.GetView(&view) && res;
+    text->assign(view);
+    return res;
+  };
+
+  std::string text;
+  std::string expected;
+
+  // Everything is new
+  EXPECT_TRUE(incremental(&text));
+  EXPECT_TRUE(full(&expected));
+  EXPECT_EQ(text, expected);
+  EXPECT_EQ(save.GetSerializedCount(), kObjects + 1);
+  EXPECT_EQ(save.GetReusedCount(), 0u);
+  EXPECT_EQ(save.GetCachedCount(), kObjects);
+  save.EndPass();
+
+  // Only the changed one and the untracked one are serialized again
+  objects[3].m_data->SetRandom("changed");
+  objects[3].MarkDirty();
+  untracked.SetRandom("also changed");
+
+  EXPECT_TRUE(incremental(&text));
+  EXPECT_TRUE(full(&expected));
+  EXPECT_EQ(text, expected);
+  EXPECT_EQ(save.GetSerializedCount(), 2u);
+  EXPECT_EQ(save.GetReusedCount(), kObjects - 1);
+  for (size_t i = 0; i < kObjects; i++) {
+    EXPECT_EQ(objects[i].m_serializeCount, i == 3 ? 2u : 1u);
+  }
+  save.EndPass();
+
+  // Objects not saved in a pass are dropped
+  objects.pop_back();
+  names.pop_back();
+  auto less = [&](std::string *out) {
+    out->clear();
+    Serializer::StringSink sink(*out);
+    Serializer::JsonStreamSerializer stream(sink);
+    return save.Save(stream, objects[0], SET_NAME(first)) && stream.Compile();
+  };
+  EXPECT_TRUE(less(&text));
+  save.EndPass();
+  EXPECT_EQ(save.GetCachedCount(), 1u);
+
+  // A new name is serialized again
+  EXPECT_EQ(objects[0].m_serializeCount, 2u);
+
+  Serializer::JsonSerializer parser;
+  EXPECT_TRUE(parser.ParseText(text.c_str(), text.length()));
+  std::unique_ptr<TrackedStruct> loaded =
+      TrackedStruct::Deserialize(&parser, GET_NAME(first));
+  EXPECT_TRUE(loaded && *loaded->m_data == *objects[0].m_data) << text;
+}
+
+TEST(IncrementalSaveTest, arenaStaysFlat) {
+  constexpr size_t kPasses = 200;
+
+  RecursiveStruct untracked;
+  untracked.SetRandom("untracked");
+
+  Serializer::IncrementalSave save;
+  std::string text;
+  size_t capacity = 0;
+
+  // Untracked objects are serialized in every pass
+  for (size_t i = 0; i < kPasses; i++) {
+    text.clear();
+    Serializer::StringSink sink(text);
+    Serializer::JsonStreamSerializer stream(sink);
+
+    EXPECT_TRUE(save.Save(stream, untracked, SET_NAME(untracked)) &&
+                stream.Compile());
+    save.EndPass();
+
+    // The first passes find the biggest object, then the arena is reused
+    const Serializer::JsonSerializer::ArenaStats stats = save.GetArenaStats();
+    if (i == 1) {
+      capacity = stats.m_capacity;
+    }
+    if (i >= 1) {
+      EXPECT_EQ(stats.m_capacity, capacity) << "Pass " << i;
+    }
+  }
+
+  EXPECT_GE(save.GetArenaStats().m_resets, kPasses);
+}
+
+TEST(JsonLinesReaderTest, documentsInOrder) {
+  constexpr int kDocuments = 500;
+
+  // Blank lines every now and then, which are skipped
+  std::string text;
+  std::vector<size_t> lines;
+  size_t line = 0;
+  for (int i = 0; i < kDocuments; i++) {
+    if (i % 7 == 0) {
+      text += "\n";
+      line++;
+    }
+    text += "{\"index\":" + std::to_string(i) + ",\"event\":\"tick\"}\n";
+    lines.push_back(line++);
+  }
+
+  // Small chunks, so there are many of them
+  Serializer::JsonLinesReader reader(4, 256);
+
+  int next = 0;
+  auto handler = [&next, &lines](size_t documentLine,
+                                 Serializer::JsonSerializer &document) {
+    int index;
+    EXPECT_TRUE(document.GetInt(GET_NAME(index), &index));
+    EXPECT_EQ(index, next);
+    EXPECT_EQ(documentLine, lines[next]);
+    next++;
+    return true;
+  };
+
+  EXPECT_TRUE(reader.Read(text.c_str(), text.length(), handler));
+  EXPECT_EQ(next, kDocuments);
+
+  std::FILE *file = std::tmpfile();
+  ASSERT_NE(file, nullptr) << "Failed to open a temporary file";
+  ASSERT_EQ(std::fwrite(text.c_str(), sizeof(char), text.length(), file),
+            text.length());
+  std::rewind(file);
+
+  next = 0;
+  EXPECT_TRUE(reader.Read(file, handler));
+  EXPECT_EQ(next, kDocuments);
+  std::fclose(file);
+
+  size_t errorLine;
+  EXPECT_FALSE(reader.GetErrorLine(&errorLine));
+
+  // Everything before a broken line is handed out
+  text.insert(text.find("{\"index\":100,"), "{broken\n");
+
+  next = 0;
+  EXPECT_FALSE(reader.Read(text.c_str(), text.length(), handler));
+  EXPECT_EQ(next, 100);
+  EXPECT_TRUE(reader.GetErrorLine(&errorLine));
+  EXPECT_EQ(errorLine, lines[100]);
+}
+
+TEST(SerializerFactoryTest, createByName) {
+  Serializer::SerializerFormat format;
+
+  EXPECT_FALSE(Serializer::GetSerializerFormat("yaml", &format));
+
+  for (const char *name : {"json", "binary", "msgpack", "flat"}) {
+    ASSERT_TRUE(Serializer::GetSerializerFormat(name, &format)) << name;
+
+    std::unique_ptr<Serializer::ISerializer> serializer =
+        Serializer::CreateSerializer(format);
+    ASSERT_NE(serializer, nullptr) << name;
+
+    int value;
+    EXPECT_TRUE(serializer->SetInt(SET_NAME(number), 5)) << name;
+    EXPECT_TRUE(serializer->Compile()) << name;
+
+    Serializer::s_size size;
+    EXPECT_TRUE(serializer->GetSize(&size)) << name;
+    std::unique_ptr<char[]> buffer(new char[size]);
+    EXPECT_TRUE(serializer->GetText(buffer.get())) << name;
+
+    std::unique_ptr<Serializer::ISerializer> parser =
+        Serializer::CreateSerializer(format);
+    EXPECT_TRUE(parser->ParseText(buffer.get(), size)) << name;
+    EXPECT_TRUE(parser->GetInt(GET_NAME(number), &value)) << name;
+    EXPECT_EQ(value, 5) << name;
+  }
+}
+
+/* Copyable state of a game, for the background saves */
+struct SaveGameState : public Serializer::ISerializableImpl<SaveGameState> {
+  int m_level = 0;
+  std::vector<int> m_scores;
+
+  bool Serialize(Serializer::ISerializer *serializer, const char *name,
+                 Serializer::s_size name_length) override {
+    return serializer->SetEntry(name, name_length, 1) &&
+           serializer->SetInt(SET_NAME(level), m_level) &&
+           serializer->SetIntArray(
+               SET_NAME(scores), m_scores.data(),
+               static_cast<Serializer::s_size>(m_scores.size())) &&
+           serializer->CloseEntry();
+  }
+
+  static bool DeserializeInto(const Serializer::ISerializer *serializer,
+                              const char *name, SaveGameState *object) {
+    Serializer::s_size version;
+    Serializer::s_size size;
+
+    if (!serializer->OpenEntry(name, &version) ||
+        !serializer->GetInt(GET_NAME(level), &object->m_level) ||
+        !serializer->GetArrayCapacity(GET_NAME(scores), &size)) {
+      return false;
+    }
+    object->m_scores.resize(size);
+
+    return serializer->GetIntArray(GET_NAME(scores), object->m_scores.data(),
+                                   size) &&
+           serializer->CloseEntry();
+  }
+};
+
+TEST(BackgroundSaveTest, snapshotWhileChanging) {
+  Serializer::CopyOnWrite<SaveGameState> state;
+  state.Write().m_level = 3;
+  state.Write().m_scores = {10, 20, 30};
+
+  const FileLoadSystem::path p = std::filesystem::temp_directory_path() /
+                                 "kch_background_save_test.bin";
+
+  std::shared_ptr<SaveGameState> snapshot = state.Snapshot();
+  std::future<bool> saved = Serializer::SaveInBackground(
+      snapshot, "game", p, Serializer::SerializerFormat::kBinary);
+
+  // The game keeps going, the first change copies the state
+  state.Write().m_level = 4;
+  state.Write().m_scores.push_back(40);
+  EXPECT_NE(&state.Read(), snapshot.get());
+  EXPECT_EQ(snapshot->m_level, 3);
+  EXPECT_EQ(snapshot->m_scores.size(), 3u);
+
+  ASSERT_TRUE(saved.get());
+
+  FileLoadSystem::MappedFile mapped;
+  ASSERT_TRUE(mapped.Open(p)) << "Failed to map " << p;
+
+  Serializer::BinarySerializer reader;
+  ASSERT_TRUE(reader.ParseText(mapped.Data(), mapped.Size()));
+
+  SaveGameState loaded;
+  EXPECT_TRUE(Serializer::DeserializeInto(&reader, "game", &loaded));
+  EXPECT_EQ(loaded.m_level, 3);
+  EXPECT_EQ(loaded.m_scores, std::vector<int>({10, 20, 30}));
+  mapped.Close();
+
+  // Copied after every snapshot, even one that is already released, once
+  const SaveGameState *before = &state.Read();
+  state.Snapshot();
+  state.Write().m_level = 5;
+  EXPECT_NE(&state.Read(), before);
+  const SaveGameState *copied = &state.Read();
+  state.Write().m_level = 6;
+  EXPECT_EQ(&state.Read(), copied);
+
+  // Saves that overlap don't share their temporary file
+  std::future<bool> first = Serializer::SaveInBackground(
+      state.Snapshot(), "game", p, Serializer::SerializerFormat::kBinary);
+  state.Write().m_level = 7;
+  std::future<bool> second = Serializer::SaveInBackground(
+      state.Snapshot(), "game", p, Serializer::SerializerFormat::kBinary);
+  EXPECT_TRUE(first.get());
+  EXPECT_TRUE(second.get());
+
+  for (const auto &entry :
+       std::filesystem::directory_iterator(p.parent_path())) {
+    EXPECT_NE(entry.path().filename().string().rfind(
+                  p.filename().string() + ".", 0),
+              0u)
+        << "Left behind " << entry.path();
+  }
+
+  // Without a snapshot or with a directory that is not there nothing is saved
+  EXPECT_FALSE(Serializer::SaveInBackground(
+                   nullptr, "game", p, Serializer::SerializerFormat::kBinary)
+                   .get());
+
+  const FileLoadSystem::path missing = p.parent_path() /
+                                       "kch_background_save_missing" /
+                                       "save.bin";
+  EXPECT_FALSE(Serializer::SaveInBackground(
+                   state.Snapshot(), "game", missing,
+                   Serializer::SerializerFormat::kBinary)
+                   .get());
+
+  FileLoadSystem::error_status error;
+  EXPECT_FALSE(FileLoadSystem::Exists(missing, error));
+
+  // A directory in the way can't be replaced, the temporary file goes away
+  const FileLoadSystem::path blocked =
+      p.parent_path() / "kch_background_save_blocked";
+  ASSERT_TRUE(FileLoadSystem::CreateDirectories(blocked / "inside", error));
+  EXPECT_FALSE(Serializer::SaveInBackground(
+                   state.Snapshot(), "game", blocked,
+                   Serializer::SerializerFormat::kBinary)
+                   .get());
+
+  for (const auto &entry :
+       std::filesystem::directory_iterator(p.parent_path())) {
+    EXPECT_NE(entry.path().filename().string().rfind(
+                  blocked.filename().string() + ".", 0),
+              0u)
+        << "Left behind " << entry.path();
+  }
+
+  FileLoadSystem::RemoveDirectory(blocked, error);
+  FileLoadSystem::Remove(p, error);
+}
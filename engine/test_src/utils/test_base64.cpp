@@ -0,0 +1,98 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "utils/base64.hpp"
+
+namespace {
+/* Bit by bit encoding to check against */
+std::string EncodeSlowly(const std::vector<unsigned char> &data) {
+  const char alphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string text;
+
+  for (size_t i = 0; i < data.size(); i += 3) {
+    unsigned group = data[i] << 16;
+    if (i + 1 < data.size()) {
+      group |= data[i + 1] << 8;
+    }
+    if (i + 2 < data.size()) {
+      group |= data[i + 2];
+    }
+
+    text += alphabet[(group >> 18) & 0x3F];
+    text += alphabet[(group >> 12) & 0x3F];
+    text += i + 1 < data.size() ? alphabet[(group >> 6) & 0x3F] : '=';
+    text += i + 2 < data.size() ? alphabet[group & 0x3F] : '=';
+  }
+  return text;
+}
+
+/* Random bytes */
+std::vector<unsigned char> MakeBytes(size_t size, std::mt19937 &generator) {
+  std::vector<unsigned char> bytes(size);
+  for (unsigned char &byte : bytes) {
+    byte = static_cast<unsigned char>(generator());
+  }
+  return bytes;
+}
+} // namespace
+
+TEST(Base64Test, roundTrip) {
+  std::mt19937 generator(3);
+
+  // Long enough for every SIMD block size and the tails after them
+  for (size_t size = 0; size < 300; size++) {
+    const std::vector<unsigned char> data = MakeBytes(size, generator);
+    const std::string expected = EncodeSlowly(data);
+
+    std::string text(Base64::GetEncodedLength(size), '\0');
+    Base64::Encode(data.data(), size, text.data());
+    ASSERT_EQ(text, expected) << size;
+
+    size_t decodedSize;
+    ASSERT_TRUE(
+        Base64::GetDecodedSize(text.data(), text.size(), &decodedSize));
+    ASSERT_EQ(decodedSize, size);
+
+    std::vector<unsigned char> decoded(size);
+    ASSERT_TRUE(Base64::Decode(text.data(), text.size(), decoded.data()));
+    EXPECT_EQ(decoded, data) << size;
+  }
+
+  // Every value of every byte position
+  std::vector<unsigned char> every(256 * 3);
+  for (size_t i = 0; i < every.size(); i++) {
+    every[i] = static_cast<unsigned char>(i / 3);
+  }
+  std::string text(Base64::GetEncodedLength(every.size()), '\0');
+  Base64::Encode(every.data(), every.size(), text.data());
+  EXPECT_EQ(text, EncodeSlowly(every));
+}
+
+TEST(Base64Test, invalidCharacters) {
+  std::mt19937 generator(5);
+  const std::vector<unsigned char> data = MakeBytes(150, generator);
+  const std::string text = EncodeSlowly(data);
+  std::vector<unsigned char> decoded(data.size());
+
+  // Wherever it is, inside a block or in the tail
+  for (size_t i = 0; i < text.size(); i++) {
+    for (char c : {'*', '=', '\0', '\x80', '\xFF', '@', '[', '`', '{'}) {
+      // Padding is fine at the end
+      if (c == '=' && i == text.size() - 1) {
+        continue;
+      }
+
+      std::string broken = text;
+      broken[i] = c;
+      EXPECT_FALSE(
+          Base64::Decode(broken.data(), broken.size(), decoded.data()))
+          << i << " " << static_cast<int>(c);
+    }
+  }
+
+  EXPECT_FALSE(Base64::Decode(text.data(), text.size() - 1, decoded.data()));
+}
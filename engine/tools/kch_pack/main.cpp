@@ -0,0 +1,73 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "file_load_system/file_load_system.hpp"
+#include "file_load_system/pack_builder.hpp"
+#include "utils/stopwatch.hpp"
+
+/* Print how to use the tool */
+void PrintUsage(const char *program) {
+  printf("Usage: %s <content directory> <output pack> [--order <file>] "
+         "[--jobs <count>] [--store]\n",
+         program);
+  printf("\t--order\tText file with one entry name per line, listed entries "
+         "are placed first\n");
+  printf("\t--jobs\tAmount of worker threads, 0 uses every core\n");
+  printf("\t--store\tDon't compress the entries\n");
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  FileLoadSystem::PackBuildOptions options;
+
+  for (int i = 3; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--order") == 0 && i + 1 < argc) {
+      options.m_accessOrder = FileLoadSystem::CreatePath(argv[++i]);
+    } else if (std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+      options.m_workers =
+          static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--store") == 0) {
+      options.m_compress = false;
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  FileLoadSystem::path content = FileLoadSystem::CreatePath(argv[1]);
+  FileLoadSystem::path pack = FileLoadSystem::CreatePath(argv[2]);
+
+  Stopwatch::Stopwatch watch;
+  std::vector<FileLoadSystem::PackEntry> entries;
+
+  FileLoadSystem::error_status error =
+      FileLoadSystem::BuildPack(content, pack, options, &entries);
+
+  if (error) {
+    printf("Failed to build %s: %s\n", pack.generic_u8string().c_str(),
+           error.message().c_str());
+    return 1;
+  }
+
+  FileLoadSystem::file_size_t total = 0;
+  FileLoadSystem::file_size_t stored = 0;
+
+  for (const FileLoadSystem::PackEntry &entry : entries) {
+    total += entry.m_size;
+    stored += entry.m_storedSize;
+  }
+
+  printf("Packed %zu files (%llu bytes, %llu stored) into %s in %lld ms\n",
+         entries.size(), static_cast<unsigned long long>(total),
+         static_cast<unsigned long long>(stored),
+         pack.generic_u8string().c_str(),
+         static_cast<long long>(watch.Stop<Stopwatch::ms>()));
+
+  return 0;
+}